@@ -0,0 +1,95 @@
+#include <benchmark/benchmark.h>
+#include <opencv2/core.hpp>
+#include <random>
+#include <vector>
+#include "common/ipc_utils.hpp"
+
+// Analytics over stored keypoint blobs: count the keypoints above a response threshold
+// (or inside a region) across 256 SIFT-sized frames of 2000 keypoints, by fully
+// deserializing each blob vs scanning it in place with KeypointBlobView.
+// bytes_per_second is relative to the stored blob bytes, so the view's figure is
+// effective bandwidth: it only reads the sections it filters on.
+// Arg on the view benchmarks = SimdLevel (0 scalar, 1 AVX2).
+
+static const std::vector<std::vector<uint8_t>>& blobs() {
+    static const std::vector<std::vector<uint8_t>> out = []{
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> pos(0.0f, 1920.0f), resp(0.0f, 0.1f);
+        std::vector<std::vector<uint8_t>> b;
+        for(int f = 0; f < 256; ++f) {
+            std::vector<cv::KeyPoint> kps;
+            for(int i = 0; i < 2000; ++i) kps.emplace_back(pos(rng), pos(rng) * 0.5625f, 4.0f, 0.0f, resp(rng));
+            cv::Mat desc(2000, 128, CV_32F, cv::Scalar(1.0));
+            b.push_back(serialize_keypoints_and_descriptors(kps, desc));
+        }
+        return b;
+    }();
+    return out;
+}
+
+static void report(benchmark::State& state, size_t hits) {
+    size_t bytes = 0;
+    for(const auto& b : blobs()) bytes += b.size();
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * blobs().size()));
+    state.counters["hits"] = static_cast<double>(hits);
+}
+
+static void BM_DeserializeFilter(benchmark::State& state) {
+    size_t hits = 0;
+    for(auto _ : state) {
+        hits = 0;
+        for(const auto& b : blobs()) {
+            auto kp = deserialize_keypoints_and_descriptors(b.data(), b.size());
+            for(const auto& k : kp.first) hits += k.response >= 0.09f;
+        }
+        benchmark::DoNotOptimize(hits);
+    }
+    report(state, hits);
+}
+BENCHMARK(BM_DeserializeFilter)->Unit(benchmark::kMillisecond);
+
+static bool select_level(benchmark::State& state, SimdLevel& simd) {
+    simd = static_cast<SimdLevel>(state.range(0));
+    if(static_cast<int>(simd) > static_cast<int>(detect_simd_level())) {
+        state.SkipWithError("kernel not supported by this CPU");
+        return false;
+    }
+    state.SetLabel(simd_level_name(simd));
+    return true;
+}
+
+static void BM_ViewResponseFilter(benchmark::State& state) {
+    SimdLevel simd;
+    if(!select_level(state, simd)) return;
+    size_t hits = 0;
+    for(auto _ : state) {
+        hits = 0;
+        for(const auto& b : blobs()) hits += KeypointBlobView(b.data(), b.size()).for_each_with_response(0.09f, [](uint32_t){}, simd);
+        benchmark::DoNotOptimize(hits);
+    }
+    report(state, hits);
+}
+BENCHMARK(BM_ViewResponseFilter)->ArgName("simd")->DenseRange(0, 1)->Unit(benchmark::kMillisecond);
+
+// ROI filter that also reads the descriptor rows of the hits
+static void BM_ViewRoiDescriptors(benchmark::State& state) {
+    SimdLevel simd;
+    if(!select_level(state, simd)) return;
+    const cv::Rect2f roi(800.0f, 400.0f, 320.0f, 240.0f);
+    size_t hits = 0;
+    for(auto _ : state) {
+        hits = 0;
+        float sum = 0;
+        for(const auto& b : blobs()) {
+            KeypointBlobView view(b.data(), b.size());
+            hits += view.for_each_in_roi(roi, [&](uint32_t i){
+                const float* row = reinterpret_cast<const float*>(view.descriptor_data(i));
+                sum += row[0];
+            }, simd);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    report(state, hits);
+}
+BENCHMARK(BM_ViewRoiDescriptors)->ArgName("simd")->DenseRange(0, 1)->Unit(benchmark::kMillisecond);
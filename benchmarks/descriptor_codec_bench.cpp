@@ -0,0 +1,166 @@
+#include <benchmark/benchmark.h>
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+#include "common/descriptor_codec.hpp"
+#include "common/descriptor_matcher.hpp"
+#include "common/ipc_utils.hpp"
+
+namespace fs = std::filesystem;
+
+// Float descriptor compression (float16 / scaled uint8).
+// BM_Encode* / BM_Decode*: conversion throughput of 1000 SIFT-sized rows per kernel
+// (Arg = SimdLevel, 0 scalar, 1 AVX2/F16C).
+// BM_SiftBlob: SIFT on the sample images, Arg = desc_type (0 float32, 2 float16,
+// 3 uint8). Times serialize + deserialize of each frame's blob and reports
+// blob_bytes/frame plus match_agreement: the share of float32 ratio-test matches between
+// consecutive frames that the decoded descriptors reproduce.
+
+static constexpr size_t kEntries = 1000 * 128;
+
+static const std::vector<float>& float_entries() {
+    static const std::vector<float> v = []{
+        std::mt19937 rng(1);
+        std::uniform_int_distribution<int> d(0, 255);
+        std::vector<float> out(kEntries);
+        for(auto& x : out) x = static_cast<float>(d(rng) % 64 == 0 ? d(rng) : d(rng) / 8); // SIFT-like: mostly small
+        return out;
+    }();
+    return v;
+}
+
+static bool select_level(benchmark::State& state, SimdLevel& simd) {
+    simd = static_cast<SimdLevel>(state.range(0));
+    if(static_cast<int>(simd) > static_cast<int>(detect_simd_level())) {
+        state.SkipWithError("kernel not supported by this CPU");
+        return false;
+    }
+    state.SetLabel(simd_level_name(simd));
+    return true;
+}
+
+static void report(benchmark::State& state) {
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * kEntries);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * kEntries * sizeof(float));
+}
+
+static void BM_EncodeFloat16(benchmark::State& state) {
+    SimdLevel simd;
+    if(!select_level(state, simd)) return;
+    std::vector<uint16_t> out(kEntries);
+    for(auto _ : state) {
+        encode_float16(float_entries().data(), out.data(), kEntries, simd);
+        benchmark::DoNotOptimize(out.data());
+    }
+    report(state);
+}
+BENCHMARK(BM_EncodeFloat16)->ArgName("simd")->DenseRange(0, 1);
+
+static void BM_DecodeFloat16(benchmark::State& state) {
+    SimdLevel simd;
+    if(!select_level(state, simd)) return;
+    std::vector<uint16_t> in(kEntries);
+    std::vector<float> out(kEntries);
+    encode_float16(float_entries().data(), in.data(), kEntries, SimdLevel::Scalar);
+    for(auto _ : state) {
+        decode_float16(in.data(), out.data(), kEntries, simd);
+        benchmark::DoNotOptimize(out.data());
+    }
+    report(state);
+}
+BENCHMARK(BM_DecodeFloat16)->ArgName("simd")->DenseRange(0, 1);
+
+static void BM_EncodeUint8(benchmark::State& state) {
+    SimdLevel simd;
+    if(!select_level(state, simd)) return;
+    std::vector<uint8_t> out(kEntries);
+    for(auto _ : state) {
+        Uint8Scale s = choose_uint8_scale(float_entries().data(), kEntries, simd);
+        encode_uint8(float_entries().data(), out.data(), kEntries, s, simd);
+        benchmark::DoNotOptimize(out.data());
+    }
+    report(state);
+}
+BENCHMARK(BM_EncodeUint8)->ArgName("simd")->DenseRange(0, 1);
+
+static void BM_DecodeUint8(benchmark::State& state) {
+    SimdLevel simd;
+    if(!select_level(state, simd)) return;
+    std::vector<uint8_t> in(kEntries);
+    std::vector<float> out(kEntries);
+    Uint8Scale s = choose_uint8_scale(float_entries().data(), kEntries, SimdLevel::Scalar);
+    encode_uint8(float_entries().data(), in.data(), kEntries, s, SimdLevel::Scalar);
+    for(auto _ : state) {
+        decode_uint8(in.data(), out.data(), kEntries, s, simd);
+        benchmark::DoNotOptimize(out.data());
+    }
+    report(state);
+}
+BENCHMARK(BM_DecodeUint8)->ArgName("simd")->DenseRange(0, 1);
+
+struct SiftFrame {
+    std::vector<cv::KeyPoint> kps;
+    cv::Mat desc;
+};
+
+static const std::vector<SiftFrame>& sift_frames() {
+    static std::vector<SiftFrame> frames = []{
+        std::vector<SiftFrame> out;
+        auto sift = cv::SIFT::create();
+        for(const auto& entry : fs::directory_iterator(UNDERWATER_IMAGES_DIR)) {
+            if(entry.path().extension() != ".jpg") continue;
+            cv::Mat img = cv::imread(entry.path().string(), cv::IMREAD_GRAYSCALE);
+            if(img.empty()) continue;
+            SiftFrame f;
+            sift->detectAndCompute(img, cv::noArray(), f.kps, f.desc);
+            if(!f.desc.empty()) out.push_back(std::move(f));
+        }
+        return out;
+    }();
+    return frames;
+}
+
+static std::set<std::pair<uint32_t, uint32_t>> match_pairs(const cv::Mat& a, const cv::Mat& b) {
+    std::set<std::pair<uint32_t, uint32_t>> out;
+    auto q = DescriptorSet::floats(a.ptr<float>(), static_cast<size_t>(a.rows), static_cast<size_t>(a.cols));
+    auto t = DescriptorSet::floats(b.ptr<float>(), static_cast<size_t>(b.rows), static_cast<size_t>(b.cols));
+    for(const auto& m : match_descriptors(q, t)) out.emplace(m.query, m.train);
+    return out;
+}
+
+static void BM_SiftBlob(benchmark::State& state) {
+    const auto& frames = sift_frames();
+    if(frames.size() < 2) { state.SkipWithError("need two sample images"); return; }
+    uint8_t enc = static_cast<uint8_t>(state.range(0));
+    state.SetLabel(enc == KP_DESC_FLOAT32 ? "float32" : enc == KP_DESC_FLOAT16 ? "float16" : "uint8");
+
+    // Accuracy, once: decoded descriptors against the float32 originals
+    std::vector<cv::Mat> decoded;
+    for(const auto& f : frames) decoded.push_back(deserialize_keypoints_and_descriptors(serialize_keypoints_and_descriptors(f.kps, f.desc, enc)).second);
+    size_t reference = 0, kept = 0;
+    for(size_t i = 0; i + 1 < frames.size(); ++i) {
+        auto ref = match_pairs(frames[i].desc, frames[i + 1].desc);
+        auto got = match_pairs(decoded[i], decoded[i + 1]);
+        reference += ref.size();
+        for(const auto& m : got) kept += ref.count(m);
+    }
+
+    size_t i = 0, bytes = 0;
+    std::vector<uint8_t> blob;
+    for(auto _ : state) {
+        const SiftFrame& f = frames[i++ % frames.size()];
+        blob.resize(keypoint_blob_layout(f.kps, f.desc, enc).total_size);
+        serialize_keypoints_and_descriptors_into(f.kps, f.desc, blob.data(), enc);
+        auto back = deserialize_keypoints_and_descriptors(blob);
+        benchmark::DoNotOptimize(back.second.data);
+        bytes += blob.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["blob_bytes"] = benchmark::Counter(static_cast<double>(bytes), benchmark::Counter::kAvgIterations);
+    state.counters["match_agreement"] = reference ? static_cast<double>(kept) / reference : 1.0;
+}
+BENCHMARK(BM_SiftBlob)->ArgName("desc_type")->Arg(KP_DESC_FLOAT32)->Arg(KP_DESC_FLOAT16)->Arg(KP_DESC_UINT8_SCALED)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,46 @@
+#include <benchmark/benchmark.h>
+#include <opencv2/opencv.hpp>
+#include <filesystem>
+#include <vector>
+#include "common/feature_detector.hpp"
+#include "common/ipc_utils.hpp"
+
+namespace fs = std::filesystem;
+
+// Frames/sec (items_per_second) and keypoints/frame of every detector backend with its
+// default parameters, on the sample images decoded to grayscale as the processor does.
+// The blob counter is the serialized keypoint blob size per frame.
+
+static const std::vector<cv::Mat>& sample_images() {
+    static std::vector<cv::Mat> imgs = []{
+        std::vector<cv::Mat> out;
+        for(const auto& entry : fs::directory_iterator(UNDERWATER_IMAGES_DIR)) {
+            if(entry.path().extension() != ".jpg") continue;
+            cv::Mat img = cv::imread(entry.path().string(), cv::IMREAD_GRAYSCALE);
+            if(!img.empty()) out.push_back(img);
+        }
+        return out;
+    }();
+    return imgs;
+}
+
+static void BM_Detector(benchmark::State& state) {
+    const auto& imgs = sample_images();
+    if(imgs.empty()) { state.SkipWithError("no sample images"); return; }
+    const std::string& name = detector_names()[state.range(0)];
+    state.SetLabel(name);
+    cv::Ptr<cv::Feature2D> detector = create_detector(name);
+    size_t i = 0, keypoints = 0, blob_bytes = 0;
+    for(auto _ : state) {
+        std::vector<cv::KeyPoint> kps;
+        cv::Mat desc;
+        detector->detectAndCompute(imgs[i++ % imgs.size()], cv::noArray(), kps, desc);
+        keypoints += kps.size();
+        blob_bytes += keypoint_blob_layout(kps, desc).total_size;
+        benchmark::DoNotOptimize(desc.data);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["keypoints"] = benchmark::Counter(static_cast<double>(keypoints), benchmark::Counter::kAvgIterations);
+    state.counters["blob_bytes"] = benchmark::Counter(static_cast<double>(blob_bytes), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_Detector)->ArgName("detector")->DenseRange(0, 3)->Unit(benchmark::kMillisecond);
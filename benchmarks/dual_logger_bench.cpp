@@ -0,0 +1,30 @@
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <string>
+#include "common/dual_logger.hpp"
+
+namespace fs = std::filesystem;
+
+constexpr int LINES_PER_ITERATION = 1000;
+
+// File-only log lines/sec through DualLogger, the way the stages log every frame, including
+// the final flush so the async writer's disk work is counted too. async:0 writes and flushes
+// under the mutex per line; async:1 hands lines to the ring (blocking rather than dropping
+// when it is full, so every line reaches the file).
+static void BM_DualLogger(benchmark::State& state) {
+    fs::path path = fs::temp_directory_path() / "bench_dual_logger.log";
+    fs::remove(path);
+    DualLogger::Options opts;
+    opts.async = state.range(0) == 1;
+    opts.block_on_overflow = true;
+    DualLogger logger(path.string(), opts);
+
+    const std::string msg = "Processed image seq=123456 id=0190f3c2a1b24c5d9e8f7a6b5c4d3e2f keypoints=1843";
+    for(auto _ : state) {
+        for(int i = 0; i < LINES_PER_ITERATION; ++i) logger.info(msg, false, true);
+        logger.flush();
+    }
+    state.SetItemsProcessed(state.iterations() * LINES_PER_ITERATION);
+    state.counters["dropped"] = static_cast<double>(logger.dropped());
+}
+BENCHMARK(BM_DualLogger)->ArgName("async")->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond)->UseRealTime();
@@ -0,0 +1,86 @@
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+#include <random>
+#include <string>
+#include "common/frame_header.hpp"
+
+using json = nlohmann::json;
+
+// Per-frame metadata on one hop: what the sender builds and writes and the receiver
+// reads back. BM_JsonMeta is the former path (json object -> dump() -> parse ->
+// field lookups, hex string id); BM_FrameHeader writes the binary header into a message
+// buffer and reads it in place. Arg = extension bytes carried along (0 = none).
+
+static TraceStamps sample_trace() {
+    TraceStamps t;
+    t.ns[GEN_SEND] = mono_ns();
+    t.ns[PROC_RECV] = t.ns[GEN_SEND] + 150000;
+    return t;
+}
+
+static std::string extension(size_t bytes) {
+    if(bytes == 0) return {};
+    json e = {{"camera", "cam0"}, {"note", std::string(bytes > 32 ? bytes - 32 : 1, 'x')}};
+    return e.dump();
+}
+
+static std::string hex_id() {
+    static std::mt19937_64 rng(1);
+    static const char digits[] = "0123456789abcdef";
+    std::string s(32, '0');
+    for(auto& c : s) c = digits[rng() & 0xf];
+    return s;
+}
+
+static void BM_JsonMeta(benchmark::State& state) {
+    std::string ext = extension(static_cast<size_t>(state.range(0)));
+    TraceStamps trace = sample_trace();
+    uint64_t seq = 0, sink = 0;
+    for(auto _ : state) {
+        json meta;
+        meta["image_id"] = hex_id();
+        meta["timestamp"] = "2024-05-01T12:00:00.123Z";
+        meta["width"] = 1920;
+        meta["height"] = 1080;
+        meta["encoding"] = "jpg";
+        meta["seq"] = seq++;
+        meta["num_keypoints"] = 1234;
+        meta["trace"] = trace.to_json();
+        if(!ext.empty()) meta["extra"] = json::parse(ext);
+        std::string wire = meta.dump();
+
+        json in = json::parse(wire);
+        sink += in["seq"].get<uint64_t>() + in["width"].get<int>() + in["num_keypoints"].get<int>() +
+                in["image_id"].get<std::string>().size() + TraceStamps::from_meta(in).ns[GEN_SEND];
+        benchmark::DoNotOptimize(sink);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_JsonMeta)->ArgName("ext_bytes")->Arg(0)->Arg(256);
+
+static void BM_FrameHeader(benchmark::State& state) {
+    std::string ext = extension(static_cast<size_t>(state.range(0)));
+    TraceStamps trace = sample_trace();
+    std::vector<uint64_t> buf(frame_header_wire_size(ext.size()) / 8 + 1); // stands in for zmq::message_t
+    auto* wire = reinterpret_cast<uint8_t*>(buf.data());
+    uint64_t seq = 0, sink = 0;
+    for(auto _ : state) {
+        FrameHeader h;
+        h.set_image_id(ImageId::generate());
+        h.timestamp_ns = unix_ns();
+        h.width = 1920;
+        h.height = 1080;
+        h.seq = seq++;
+        h.num_keypoints = 1234;
+        h.set_trace(trace);
+        write_frame_header(h, ext, wire);
+
+        FrameHeader scratch;
+        std::string_view got_ext;
+        const FrameHeader* in = read_frame_header(wire, frame_header_wire_size(ext.size()), scratch, &got_ext);
+        sink += in->seq + in->width + in->num_keypoints + in->id_lo + in->trace_stamps().ns[GEN_SEND] + got_ext.size();
+        benchmark::DoNotOptimize(sink);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FrameHeader)->ArgName("ext_bytes")->Arg(0)->Arg(256);
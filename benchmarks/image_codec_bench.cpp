@@ -0,0 +1,57 @@
+#include <benchmark/benchmark.h>
+#include <opencv2/opencv.hpp>
+#include <filesystem>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// JPEG encode as the generator does it (quality 90) and full-size colour decode, per
+// sample image. The jpeg_bytes counter is the mean encoded size per frame.
+
+static const std::vector<cv::Mat>& sample_images() {
+    static std::vector<cv::Mat> imgs = []{
+        std::vector<cv::Mat> out;
+        for(const auto& entry : fs::directory_iterator(UNDERWATER_IMAGES_DIR)) {
+            if(entry.path().extension() != ".jpg") continue;
+            cv::Mat img = cv::imread(entry.path().string(), cv::IMREAD_COLOR);
+            if(!img.empty()) out.push_back(img);
+        }
+        return out;
+    }();
+    return imgs;
+}
+
+static void BM_ImEncode(benchmark::State& state) {
+    const auto& imgs = sample_images();
+    if(imgs.empty()) { state.SkipWithError("no sample images"); return; }
+    size_t i = 0, bytes = 0;
+    for(auto _ : state) {
+        std::vector<uchar> buf;
+        cv::imencode(".jpg", imgs[i++ % imgs.size()], buf, {cv::IMWRITE_JPEG_QUALITY, 90});
+        bytes += buf.size();
+        benchmark::DoNotOptimize(buf.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["jpeg_bytes"] = static_cast<double>(bytes) / state.iterations();
+}
+BENCHMARK(BM_ImEncode)->Unit(benchmark::kMillisecond);
+
+static void BM_ImDecode(benchmark::State& state) {
+    const auto& imgs = sample_images();
+    if(imgs.empty()) { state.SkipWithError("no sample images"); return; }
+    std::vector<std::vector<uchar>> jpegs;
+    size_t total = 0;
+    for(const auto& img : imgs) {
+        jpegs.emplace_back();
+        cv::imencode(".jpg", img, jpegs.back(), {cv::IMWRITE_JPEG_QUALITY, 90});
+        total += jpegs.back().size();
+    }
+    size_t i = 0;
+    for(auto _ : state) {
+        cv::Mat img = cv::imdecode(jpegs[i++ % jpegs.size()], cv::IMREAD_COLOR);
+        benchmark::DoNotOptimize(img.data);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * (total / jpegs.size())));
+}
+BENCHMARK(BM_ImDecode)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,99 @@
+#include <benchmark/benchmark.h>
+#include <array>
+#include <random>
+#include <vector>
+#include "common/descriptor_matcher.hpp"
+
+// Brute-force ratio-test matching of one frame against another, per kernel.
+// Frames are 1000 descriptors: SIFT-shaped float rows (128 x float32) and ORB-shaped
+// binary rows (32 bytes); the train frame is a noisy copy of the query so most rows
+// match. Arg = SimdLevel (0 scalar, 1 AVX2, 2 AVX-512); levels the CPU lacks are
+// skipped. comparisons/s counts descriptor pairs.
+
+static constexpr size_t kRows = 1000;
+
+// 0 = query, 1 = train
+static const std::vector<float>& float_rows(int which) {
+    static const std::array<std::vector<float>, 2> frames = []{
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> d(0.0f, 0.2f), noise(-0.01f, 0.01f);
+        std::vector<float> q(kRows * 128), t(kRows * 128);
+        for(size_t i = 0; i < q.size(); ++i) { q[i] = d(rng); t[i] = q[i] + noise(rng); }
+        return std::array<std::vector<float>, 2>{q, t};
+    }();
+    return frames[which];
+}
+
+static const std::vector<uint8_t>& binary_rows(int which) {
+    static const std::array<std::vector<uint8_t>, 2> frames = []{
+        std::mt19937 rng(1);
+        std::uniform_int_distribution<int> d(0, 255);
+        std::vector<uint8_t> q(kRows * 32), t;
+        for(auto& v : q) v = static_cast<uint8_t>(d(rng));
+        t = q;
+        for(size_t r = 0; r < kRows; ++r) t[r * 32 + d(rng) % 32] ^= static_cast<uint8_t>(1u << (d(rng) % 8));
+        return std::array<std::vector<uint8_t>, 2>{q, t};
+    }();
+    return frames[which];
+}
+
+static bool select_level(benchmark::State& state, MatchOptions& opts) {
+    opts.simd = static_cast<SimdLevel>(state.range(0));
+    if(static_cast<int>(opts.simd) > static_cast<int>(detect_simd_level())) {
+        state.SkipWithError("kernel not supported by this CPU");
+        return false;
+    }
+    state.SetLabel(simd_level_name(opts.simd));
+    return true;
+}
+
+static void report(benchmark::State& state, size_t matches) {
+    state.counters["comparisons/s"] = benchmark::Counter(static_cast<double>(state.iterations()) * kRows * kRows, benchmark::Counter::kIsRate);
+    state.counters["matches"] = static_cast<double>(matches);
+}
+
+static void BM_MatchL2(benchmark::State& state) {
+    MatchOptions opts;
+    if(!select_level(state, opts)) return;
+    auto q = DescriptorSet::floats(float_rows(0).data(), kRows, 128);
+    auto t = DescriptorSet::floats(float_rows(1).data(), kRows, 128);
+    size_t matches = 0;
+    for(auto _ : state) {
+        auto m = match_descriptors(q, t, opts);
+        matches = m.size();
+        benchmark::DoNotOptimize(m.data());
+    }
+    report(state, matches);
+}
+BENCHMARK(BM_MatchL2)->ArgName("simd")->DenseRange(0, 2)->Unit(benchmark::kMillisecond);
+
+static void BM_MatchHamming(benchmark::State& state) {
+    MatchOptions opts;
+    if(!select_level(state, opts)) return;
+    auto q = DescriptorSet::binary(binary_rows(0).data(), kRows, 32);
+    auto t = DescriptorSet::binary(binary_rows(1).data(), kRows, 32);
+    size_t matches = 0;
+    for(auto _ : state) {
+        auto m = match_descriptors(q, t, opts);
+        matches = m.size();
+        benchmark::DoNotOptimize(m.data());
+    }
+    report(state, matches);
+}
+BENCHMARK(BM_MatchHamming)->ArgName("simd")->DenseRange(0, 2)->Unit(benchmark::kMillisecond);
+
+// Effect of the train block size on the best kernel (Arg = KiB)
+static void BM_MatchL2Block(benchmark::State& state) {
+    MatchOptions opts;
+    opts.block_bytes = static_cast<size_t>(state.range(0)) << 10;
+    auto q = DescriptorSet::floats(float_rows(0).data(), kRows, 128);
+    auto t = DescriptorSet::floats(float_rows(1).data(), kRows, 128);
+    size_t matches = 0;
+    for(auto _ : state) {
+        auto m = match_descriptors(q, t, opts);
+        matches = m.size();
+        benchmark::DoNotOptimize(m.data());
+    }
+    report(state, matches);
+}
+BENCHMARK(BM_MatchL2Block)->ArgName("block_kb")->Arg(8)->Arg(64)->Arg(256)->Arg(1024)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,304 @@
+#include <benchmark/benchmark.h>
+#include <zmq.hpp>
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "common/feature_detector.hpp"
+#include "common/frame_header.hpp"
+#include "common/ipc_utils.hpp"
+#include "common/latency_trace.hpp"
+#include "common/preprocess.hpp"
+#include "common/sqlite_batch_writer.hpp"
+#include "pipeline/in_process_pipeline.hpp"
+
+namespace fs = std::filesystem;
+
+constexpr int FRAMES_PER_ITERATION = 32;
+
+// JPEG bytes and size of every sample image, encoded the same way the generator does
+struct SampleJpeg {
+    std::vector<uchar> bytes;
+    int width = 0, height = 0;
+};
+
+static const std::vector<SampleJpeg>& sample_jpegs() {
+    static std::vector<SampleJpeg> jpegs = []{
+        std::vector<SampleJpeg> out;
+        for(const auto& entry : fs::directory_iterator(UNDERWATER_IMAGES_DIR)) {
+            if(entry.path().extension() != ".jpg") continue;
+            cv::Mat img = cv::imread(entry.path().string(), cv::IMREAD_COLOR);
+            if(img.empty()) continue;
+            SampleJpeg s;
+            cv::imencode(".jpg", img, s.bytes, {cv::IMWRITE_JPEG_QUALITY, 90});
+            s.width = img.cols;
+            s.height = img.rows;
+            out.push_back(std::move(s));
+        }
+        return out;
+    }();
+    return jpegs;
+}
+
+// generator -> processor -> logger in one process over inproc://, with the stages' default
+// settings: grayscale decode, SIFT, uint8 descriptors, batched SQLite rows. The benchmark
+// thread is the generator; `processors` threads each run decode + detect + serialize on
+// their own frames, one logger thread stores the rows. Image files are not written, which
+// the real logger does off its receive path. An iteration is FRAMES_PER_ITERATION frames
+// sent and committed; latency is GEN_SEND to the row commit.
+static void BM_Pipeline(benchmark::State& state) {
+    const auto& jpegs = sample_jpegs();
+    if(jpegs.empty()) { state.SkipWithError("no sample images"); return; }
+    const int processors = static_cast<int>(state.range(0));
+
+    fs::path db_path = fs::temp_directory_path() / "bench_pipeline.db";
+    fs::remove(db_path); fs::remove(db_path.string() + "-wal"); fs::remove(db_path.string() + "-shm");
+
+    std::mutex mtx;
+    std::condition_variable committed_cv;
+    uint64_t committed = 0;
+    LatencyHistogram hist;
+    SqliteBatchWriter::Options wopts;
+    wopts.on_commit = [&](std::vector<ImageRecord>& batch, double){
+        uint64_t now = mono_ns();
+        std::lock_guard<std::mutex> lock(mtx);
+        for(const auto& r : batch) if(!r.failed) hist.record(now - r.trace.ns[GEN_SEND]);
+        committed += batch.size();
+        committed_cv.notify_all();
+    };
+    SqliteBatchWriter db(db_path.string(), wopts);
+
+    zmq::context_t ctx(1);
+    zmq::socket_t gen_push(ctx, zmq::socket_type::push);
+    gen_push.bind("inproc://bench-gen");
+    zmq::socket_t log_pull(ctx, zmq::socket_type::pull);
+    log_pull.set(zmq::sockopt::rcvtimeo, 100);
+    log_pull.bind("inproc://bench-log");
+
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> workers;
+    for(int w = 0; w < processors; ++w) {
+        workers.emplace_back([&]{
+            zmq::socket_t pull(ctx, zmq::socket_type::pull);
+            pull.set(zmq::sockopt::rcvtimeo, 100);
+            pull.set(zmq::sockopt::rcvhwm, 2);
+            pull.connect("inproc://bench-gen");
+            zmq::socket_t push(ctx, zmq::socket_type::push);
+            push.connect("inproc://bench-log");
+            cv::Ptr<cv::Feature2D> detector = create_detector("sift");
+            PreprocessOptions preprocess;
+            while(!stop) {
+                zmq::message_t meta, img;
+                if(!pull.recv(meta)) continue;
+                (void)pull.recv(img);
+                FrameHeader h;
+                std::memcpy(&h, meta.data(), sizeof(h));
+                TraceStamps trace = h.trace_stamps();
+                trace.stamp(PROC_RECV);
+                PreparedImage prep = prepare_for_detection(img.data(), img.size(), preprocess, static_cast<int>(h.width), static_cast<int>(h.height));
+                std::vector<cv::KeyPoint> kps;
+                cv::Mat desc;
+                detector->detectAndCompute(prep.img, cv::noArray(), kps, desc);
+                rescale_keypoints(kps, prep.scale_x, prep.scale_y);
+                zmq::message_t kp_msg(keypoint_blob_layout(kps, desc, KP_DESC_UINT8_SCALED).total_size);
+                serialize_keypoints_and_descriptors_into(kps, desc, static_cast<uint8_t*>(kp_msg.data()), KP_DESC_UINT8_SCALED);
+                h.num_keypoints = static_cast<uint32_t>(kps.size());
+                trace.stamp(PROC_SEND);
+                h.set_trace(trace);
+                std::memcpy(meta.data(), &h, sizeof(h));
+                push.send(meta, zmq::send_flags::sndmore);
+                push.send(img, zmq::send_flags::sndmore);
+                push.send(kp_msg, zmq::send_flags::none);
+            }
+        });
+    }
+
+    std::thread log_thread([&]{
+        while(!stop) {
+            zmq::message_t meta, img, kp;
+            if(!log_pull.recv(meta)) continue;
+            (void)log_pull.recv(img);
+            (void)log_pull.recv(kp);
+            FrameHeader scratch;
+            const FrameHeader* h = read_frame_header(meta.data(), meta.size(), scratch);
+            if(!h) continue;
+            ImageRecord r;
+            r.image_id = h->image_id().to_string();
+            r.seq = static_cast<int64_t>(h->seq);
+            r.timestamp = h->timestamp_iso8601();
+            r.path = "processed_images/processed/" + r.image_id + ".jpg";
+            r.num_keypoints = static_cast<int>(h->num_keypoints);
+            r.kp_blob.assign(static_cast<const uint8_t*>(kp.data()), static_cast<const uint8_t*>(kp.data()) + kp.size());
+            r.trace = h->trace_stamps();
+            r.trace.stamp(LOG_RECV);
+            db.submit(std::move(r));
+        }
+    });
+
+    uint64_t seq = 0;
+    size_t next = 0, bytes = 0;
+    for(auto _ : state) {
+        for(int i = 0; i < FRAMES_PER_ITERATION; ++i) {
+            const SampleJpeg& jpeg = jpegs[next++ % jpegs.size()];
+            FrameHeader h;
+            h.set_image_id(ImageId::generate());
+            h.timestamp_ns = unix_ns();
+            h.seq = ++seq;
+            h.width = static_cast<uint32_t>(jpeg.width);
+            h.height = static_cast<uint32_t>(jpeg.height);
+            TraceStamps trace;
+            trace.stamp(GEN_SEND);
+            h.set_trace(trace);
+            zmq::message_t meta(sizeof(FrameHeader));
+            write_frame_header(h, {}, static_cast<uint8_t*>(meta.data()));
+            gen_push.send(meta, zmq::send_flags::sndmore);
+            zmq::message_t img(jpeg.bytes.data(), jpeg.bytes.size());
+            gen_push.send(img, zmq::send_flags::none);
+            bytes += jpeg.bytes.size();
+        }
+        std::unique_lock<std::mutex> lock(mtx);
+        committed_cv.wait(lock, [&]{ return committed >= seq; });
+    }
+
+    stop = true;
+    for(auto& t : workers) t.join();
+    log_thread.join();
+
+    state.SetItemsProcessed(state.iterations() * FRAMES_PER_ITERATION);
+    state.SetBytesProcessed(static_cast<int64_t>(bytes));
+    std::lock_guard<std::mutex> lock(mtx);
+    state.counters["p50_ms"] = static_cast<double>(hist.percentile(50)) / 1e6;
+    state.counters["p99_ms"] = static_cast<double>(hist.percentile(99)) / 1e6;
+}
+BENCHMARK(BM_Pipeline)->ArgName("processors")->Arg(1)->Arg(2)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Default config for InProcessPipeline apart from: one unpaced, non-looping pass over the
+// sample images, a generator that waits for credits instead of dropping, `workers` processor
+// threads, no replay, sequence tracking, index or metrics servers, and every output under `dir`
+static nlohmann::json in_process_bench_config(const fs::path& dir, int64_t workers) {
+    nlohmann::json cfg = config::loadConfig(DEFAULT_CONFIG_FILE);
+    cfg["generator"]["image_folder"] = UNDERWATER_IMAGES_DIR;
+    cfg["generator"]["loop_images"] = false;
+    cfg["generator"]["rate_profile"] = "constant";
+    cfg["generator"]["rate_fps"] = 1e6;
+    cfg["generator"]["overload_policy"] = "block"; // every image reaches the logger
+    cfg["generator"]["replay"]["enabled"] = false;
+    cfg["processor"]["num_workers"] = workers;
+    cfg["logger"]["sequence"]["enabled"] = false;
+    cfg["logger"]["index"]["enabled"] = false;
+    cfg["logger"]["db_path"] = (dir / "data_log.db").string();
+    cfg["logger"]["image_root_dir"] = (dir / "images").string();
+    cfg["logger"]["image_save_path"] = (dir / "images" / "processed").string();
+    cfg["logger"]["latency_report_path"] = (dir / "latency_report.json").string();
+    for(const char* stage : {"generator", "processor", "logger"}) cfg[stage]["metrics_port"] = 0;
+    cfg["logging"]["log_folder"] = (dir / "logs").string();
+    cfg["logging"]["level"] = "WARN";
+    return cfg;
+}
+
+// A fresh pipeline over an empty `dir`
+static std::unique_ptr<InProcessPipeline> fresh_pipeline(const fs::path& dir, const nlohmann::json& cfg) {
+    fs::remove_all(dir);
+    fs::create_directories(dir / "images" / "processed");
+    return std::make_unique<InProcessPipeline>(cfg);
+}
+
+// The real stages (ImageSource, FeatureStage, PersistenceSink) composed by InProcessPipeline
+// with in_process_bench_config(). Image files are written and fsynced as configured. Only
+// run() is timed; an iteration is one pass that must store every image, latency is GEN_SEND
+// to the row commit.
+static void BM_InProcessPipeline(benchmark::State& state) {
+    fs::path dir = fs::temp_directory_path() / "bench_in_process_pipeline";
+    nlohmann::json cfg = in_process_bench_config(dir, state.range(0));
+
+    size_t frames = 0;
+    nlohmann::json end_to_end;
+    for(auto _ : state) {
+        state.PauseTiming();
+        std::atomic<bool> running{true};
+        auto pipeline = fresh_pipeline(dir, cfg);
+        state.ResumeTiming();
+        auto start = std::chrono::steady_clock::now();
+        pipeline->run(running);
+        state.SetIterationTime(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        state.PauseTiming();
+        if(pipeline->persistence_sink().frames_received() < pipeline->image_source().images()) {
+            state.SkipWithError("not every image reached the logger");
+            state.ResumeTiming(); // the loop must end with the timer running
+            break;
+        }
+        frames += pipeline->persistence_sink().frames_received();
+        end_to_end = pipeline->persistence_sink().latency_tracker().snapshot()["end_to_end"];
+        pipeline.reset();
+        state.ResumeTiming();
+    }
+    fs::remove_all(dir);
+
+    state.SetItemsProcessed(static_cast<int64_t>(frames));
+    state.counters["p50_ms"] = end_to_end.value("p50_ns", 0.0) / 1e6;
+    state.counters["p99_ms"] = end_to_end.value("p99_ns", 0.0) / 1e6;
+}
+BENCHMARK(BM_InProcessPipeline)->ArgName("workers")->Arg(1)->Arg(2)->Arg(4)->Unit(benchmark::kMillisecond)->UseManualTime();
+
+constexpr auto OVERLOAD_RUN = std::chrono::seconds(5);
+
+// BM_InProcessPipeline's stages driven past their capacity: one unpaced blocking pass measures
+// the frames/s `workers` processors sustain, then each iteration loops the samples at twice
+// that rate for OVERLOAD_RUN with drop-oldest, so the generator sheds what the processors
+// cannot take instead of queueing it. Latency is GEN_SEND to the row commit of the stored
+// frames; `dropped` is the frames per iteration the generator shed for lack of credit.
+static void BM_InProcessPipelineOverload(benchmark::State& state) {
+    fs::path dir = fs::temp_directory_path() / "bench_in_process_pipeline_overload";
+    nlohmann::json cfg = in_process_bench_config(dir, state.range(0));
+
+    double capacity_fps = 0;
+    {
+        std::atomic<bool> running{true};
+        auto pipeline = fresh_pipeline(dir, cfg);
+        auto start = std::chrono::steady_clock::now();
+        pipeline->run(running);
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        capacity_fps = pipeline->persistence_sink().frames_received() / secs;
+    }
+    if(capacity_fps <= 0) { state.SkipWithError("the capacity pass stored no frames"); return; }
+    cfg["generator"]["loop_images"] = true;
+    cfg["generator"]["rate_fps"] = 2 * capacity_fps;
+    cfg["generator"]["overload_policy"] = "drop-oldest";
+
+    size_t frames = 0, dropped = 0;
+    nlohmann::json end_to_end;
+    for(auto _ : state) {
+        state.PauseTiming();
+        std::atomic<bool> running{true};
+        auto pipeline = fresh_pipeline(dir, cfg);
+        state.ResumeTiming();
+        auto start = std::chrono::steady_clock::now();
+        std::thread stopper([&]{ std::this_thread::sleep_for(OVERLOAD_RUN); running = false; });
+        pipeline->run(running);
+        stopper.join();
+        state.SetIterationTime(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        state.PauseTiming();
+        if(pipeline->persistence_sink().frames_received() < pipeline->image_source().frames_sent_total()) {
+            state.SkipWithError("not every frame sent reached the logger");
+            state.ResumeTiming();
+            break;
+        }
+        frames += pipeline->persistence_sink().frames_received();
+        dropped += pipeline->image_source().frames_dropped_total();
+        end_to_end = pipeline->persistence_sink().latency_tracker().snapshot()["end_to_end"];
+        pipeline.reset();
+        state.ResumeTiming();
+    }
+    fs::remove_all(dir);
+
+    state.SetItemsProcessed(static_cast<int64_t>(frames));
+    state.counters["capacity_fps"] = capacity_fps;
+    state.counters["dropped"] = benchmark::Counter(static_cast<double>(dropped), benchmark::Counter::kAvgIterations);
+    state.counters["p50_ms"] = end_to_end.value("p50_ns", 0.0) / 1e6;
+    state.counters["p99_ms"] = end_to_end.value("p99_ns", 0.0) / 1e6;
+}
+BENCHMARK(BM_InProcessPipelineOverload)->ArgName("workers")->Arg(1)->Arg(2)->Arg(4)->Unit(benchmark::kMillisecond)->UseManualTime();
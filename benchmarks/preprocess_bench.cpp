@@ -0,0 +1,142 @@
+#include <benchmark/benchmark.h>
+#include <opencv2/opencv.hpp>
+#include <filesystem>
+#include <map>
+#include <vector>
+#include "common/preprocess.hpp"
+
+namespace fs = std::filesystem;
+
+// Accuracy vs speed of the processor's pre-processing options. Each variant is timed on
+// decode + SIFT + keypoint rescale; its keypoints are compared once against the old path
+// (full-size colour decode) on every sample image:
+//   repeatability - share of reference keypoints with a variant keypoint within 3 px
+//   matched       - share of reference keypoints whose nearest descriptor in the variant
+//                   sits within 3 px of it (geometry and descriptor agree)
+
+struct Variant {
+    const char* name;
+    PreprocessOptions opts;
+};
+
+static const std::vector<Variant>& variants() {
+    static const std::vector<Variant> list = {
+        {"colour", {false, 1, 0}},
+        {"gray", {true, 1, 0}},
+        {"gray_reduce2", {true, 2, 0}},
+        {"gray_reduce4", {true, 4, 0}},
+        {"gray_max640", {true, 1, 640}},
+        {"gray_auto_max640", {true, 0, 640}},
+    };
+    return list;
+}
+
+struct Sample {
+    std::vector<uchar> jpeg;
+    int width = 0, height = 0;
+};
+
+// JPEG bytes of every sample image, encoded the same way the generator does
+static const std::vector<Sample>& samples() {
+    static std::vector<Sample> out = []{
+        std::vector<Sample> s;
+        for(const auto& entry : fs::directory_iterator(UNDERWATER_IMAGES_DIR)) {
+            if(entry.path().extension() != ".jpg") continue;
+            cv::Mat img = cv::imread(entry.path().string(), cv::IMREAD_COLOR);
+            if(img.empty()) continue;
+            Sample smp;
+            cv::imencode(".jpg", img, smp.jpeg, {cv::IMWRITE_JPEG_QUALITY, 90});
+            smp.width = img.cols;
+            smp.height = img.rows;
+            s.push_back(std::move(smp));
+        }
+        return s;
+    }();
+    return out;
+}
+
+struct Detection {
+    std::vector<cv::KeyPoint> kps;
+    cv::Mat desc;
+};
+
+static Detection detect(const Sample& s, const PreprocessOptions& opts, cv::SIFT& sift) {
+    Detection d;
+    PreparedImage p = prepare_for_detection(s.jpeg.data(), s.jpeg.size(), opts, s.width, s.height);
+    sift.detectAndCompute(p.img, cv::noArray(), d.kps, d.desc);
+    rescale_keypoints(d.kps, p.scale_x, p.scale_y);
+    return d;
+}
+
+static bool near(const cv::KeyPoint& a, const cv::KeyPoint& b) {
+    float dx = a.pt.x - b.pt.x, dy = a.pt.y - b.pt.y;
+    return dx * dx + dy * dy <= 9.0f;
+}
+
+static const std::vector<Detection>& reference() {
+    static std::vector<Detection> ref = []{
+        std::vector<Detection> r;
+        auto sift = cv::SIFT::create();
+        for(const auto& s : samples()) r.push_back(detect(s, variants()[0].opts, *sift));
+        return r;
+    }();
+    return ref;
+}
+
+static void accuracy(const PreprocessOptions& opts, double& repeatability, double& matched) {
+    auto sift = cv::SIFT::create();
+    auto matcher = cv::BFMatcher::create(cv::NORM_L2);
+    size_t total = 0, repeated = 0, agreed = 0;
+    const auto& ref = reference();
+    for(size_t i = 0; i < samples().size(); ++i) {
+        Detection d = detect(samples()[i], opts, *sift);
+        total += ref[i].kps.size();
+        for(const auto& rk : ref[i].kps)
+            for(const auto& k : d.kps)
+                if(near(rk, k)) { repeated++; break; }
+        if(d.kps.empty() || ref[i].kps.empty()) continue;
+        std::vector<cv::DMatch> matches;
+        matcher->match(ref[i].desc, d.desc, matches);
+        for(const auto& m : matches)
+            if(near(ref[i].kps[m.queryIdx], d.kps[m.trainIdx])) agreed++;
+    }
+    repeatability = total ? static_cast<double>(repeated) / total : 0;
+    matched = total ? static_cast<double>(agreed) / total : 0;
+}
+
+static void BM_PreprocessAndDetect(benchmark::State& state) {
+    const auto& s = samples();
+    if(s.empty()) { state.SkipWithError("no sample images"); return; }
+    const Variant& v = variants()[state.range(0)];
+    state.SetLabel(v.name);
+    auto sift = cv::SIFT::create();
+    size_t i = 0, keypoints = 0;
+    for(auto _ : state) {
+        Detection d = detect(s[i++ % s.size()], v.opts, *sift);
+        keypoints += d.kps.size();
+        benchmark::DoNotOptimize(d.desc.data);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["keypoints"] = benchmark::Counter(static_cast<double>(keypoints), benchmark::Counter::kAvgIterations);
+    double repeatability = 0, matched = 0;
+    accuracy(v.opts, repeatability, matched);
+    state.counters["repeatability"] = repeatability;
+    state.counters["matched"] = matched;
+}
+BENCHMARK(BM_PreprocessAndDetect)->ArgName("variant")->DenseRange(0, 5)->Unit(benchmark::kMillisecond);
+
+// Decode alone, to separate what DCT-domain reduction saves from the smaller SIFT input
+static void BM_Decode(benchmark::State& state) {
+    const auto& s = samples();
+    if(s.empty()) { state.SkipWithError("no sample images"); return; }
+    const Variant& v = variants()[state.range(0)];
+    state.SetLabel(v.name);
+    size_t i = 0;
+    for(auto _ : state) {
+        const Sample& smp = s[i++ % s.size()];
+        PreparedImage p = prepare_for_detection(smp.jpeg.data(), smp.jpeg.size(), v.opts, smp.width, smp.height);
+        benchmark::DoNotOptimize(p.img.data);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Decode)->ArgName("variant")->DenseRange(0, 5)->Unit(benchmark::kMicrosecond);
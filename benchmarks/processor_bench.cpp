@@ -0,0 +1,82 @@
+#include <benchmark/benchmark.h>
+#include <zmq.hpp>
+#include <opencv2/opencv.hpp>
+#include <filesystem>
+#include <vector>
+#include "common/ipc_utils.hpp"
+
+namespace fs = std::filesystem;
+
+// JPEG bytes of every sample image, encoded the same way the generator does
+static const std::vector<std::vector<uchar>>& sample_jpegs() {
+    static std::vector<std::vector<uchar>> jpegs = []{
+        std::vector<std::vector<uchar>> out;
+        for(const auto& entry : fs::directory_iterator(UNDERWATER_IMAGES_DIR)) {
+            if(entry.path().extension() != ".jpg") continue;
+            cv::Mat img = cv::imread(entry.path().string(), cv::IMREAD_COLOR);
+            if(img.empty()) continue;
+            std::vector<uchar> buf;
+            cv::imencode(".jpg", img, buf, {cv::IMWRITE_JPEG_QUALITY, 90});
+            out.push_back(std::move(buf));
+        }
+        return out;
+    }();
+    return jpegs;
+}
+
+// Per-frame processor work: decode, SIFT, build the outgoing image part.
+// Arg 0 = old path (re-encode at quality 90), 1 = pass-through of the received message.
+static void BM_ProcessorFrame(benchmark::State& state) {
+    const auto& jpegs = sample_jpegs();
+    if(jpegs.empty()) { state.SkipWithError("no sample images"); return; }
+    const bool passthrough = state.range(0) == 1;
+    cv::Ptr<cv::SIFT> detector = cv::SIFT::create();
+    size_t i = 0;
+    for(auto _ : state) {
+        const auto& jpeg = jpegs[i++ % jpegs.size()];
+        zmq::message_t img_msg(jpeg.data(), jpeg.size()); // what the PULL socket hands us
+
+        cv::Mat raw(1, static_cast<int>(img_msg.size()), CV_8U, img_msg.data());
+        cv::Mat img = cv::imdecode(raw, cv::IMREAD_COLOR);
+        std::vector<cv::KeyPoint> kps;
+        cv::Mat desc;
+        detector->detectAndCompute(img, cv::noArray(), kps, desc);
+
+        zmq::message_t out_img;
+        if(passthrough) {
+            out_img.move(img_msg);
+        } else {
+            std::vector<uchar> outbuf;
+            cv::imencode(".jpg", img, outbuf, {cv::IMWRITE_JPEG_QUALITY, 90});
+            out_img.rebuild(outbuf.data(), outbuf.size());
+        }
+        benchmark::DoNotOptimize(out_img.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ProcessorFrame)->ArgName("passthrough")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// Just the outgoing image part, without decode/SIFT, to isolate what pass-through saves
+static void BM_ForwardImage(benchmark::State& state) {
+    const auto& jpegs = sample_jpegs();
+    if(jpegs.empty()) { state.SkipWithError("no sample images"); return; }
+    const bool passthrough = state.range(0) == 1;
+    std::vector<cv::Mat> decoded;
+    for(const auto& jpeg : jpegs) decoded.push_back(cv::imdecode(jpeg, cv::IMREAD_COLOR));
+    size_t i = 0;
+    for(auto _ : state) {
+        size_t k = i++ % jpegs.size();
+        zmq::message_t img_msg(jpegs[k].data(), jpegs[k].size());
+        zmq::message_t out_img;
+        if(passthrough) {
+            out_img.move(img_msg);
+        } else {
+            std::vector<uchar> outbuf;
+            cv::imencode(".jpg", decoded[k], outbuf, {cv::IMWRITE_JPEG_QUALITY, 90});
+            out_img.rebuild(outbuf.data(), outbuf.size());
+        }
+        benchmark::DoNotOptimize(out_img.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ForwardImage)->ArgName("passthrough")->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,54 @@
+#include <benchmark/benchmark.h>
+#include <opencv2/opencv.hpp>
+#include <random>
+#include <vector>
+#include "common/ipc_utils.hpp"
+
+// Keypoint blob serialize / deserialize against the keypoint count, with SIFT-like
+// keypoints and 128-wide float descriptors (entries 0..255 like SIFT's). desc_type is
+// the stored encoding: float32 as is, or scaled uint8 (a quarter of the descriptor bytes).
+
+static void make_keypoints(int n, std::vector<cv::KeyPoint>& kps, cv::Mat& desc) {
+    std::mt19937 rng(n);
+    std::uniform_real_distribution<float> pos(0.f, 1920.f), size(2.f, 40.f), angle(0.f, 360.f), resp(0.f, 0.1f);
+    std::uniform_int_distribution<int> entry(0, 255);
+    kps.clear();
+    for(int i = 0; i < n; ++i) kps.emplace_back(pos(rng), pos(rng), size(rng), angle(rng), resp(rng), i % 4, -1);
+    desc.create(n, 128, CV_32F);
+    for(int r = 0; r < n; ++r)
+        for(int c = 0; c < 128; ++c) desc.at<float>(r, c) = static_cast<float>(entry(rng));
+}
+
+static void BM_SerializeKeypoints(benchmark::State& state) {
+    std::vector<cv::KeyPoint> kps;
+    cv::Mat desc;
+    make_keypoints(static_cast<int>(state.range(0)), kps, desc);
+    uint8_t encoding = static_cast<uint8_t>(state.range(1));
+    size_t bytes = 0;
+    for(auto _ : state) {
+        std::vector<uint8_t> blob = serialize_keypoints_and_descriptors(kps, desc, encoding);
+        bytes = blob.size();
+        benchmark::DoNotOptimize(blob.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+    state.counters["blob_bytes"] = static_cast<double>(bytes);
+}
+BENCHMARK(BM_SerializeKeypoints)->ArgNames({"keypoints", "desc_type"})
+    ->ArgsProduct({{100, 1000, 10000}, {KP_DESC_FLOAT32, KP_DESC_UINT8_SCALED}})->Unit(benchmark::kMicrosecond);
+
+static void BM_DeserializeKeypoints(benchmark::State& state) {
+    std::vector<cv::KeyPoint> kps;
+    cv::Mat desc;
+    make_keypoints(static_cast<int>(state.range(0)), kps, desc);
+    std::vector<uint8_t> blob = serialize_keypoints_and_descriptors(kps, desc, static_cast<uint8_t>(state.range(1)));
+    for(auto _ : state) {
+        auto [out_kps, out_desc] = deserialize_keypoints_and_descriptors(blob);
+        benchmark::DoNotOptimize(out_kps.data());
+        benchmark::DoNotOptimize(out_desc.data);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * blob.size()));
+}
+BENCHMARK(BM_DeserializeKeypoints)->ArgNames({"keypoints", "desc_type"})
+    ->ArgsProduct({{100, 1000, 10000}, {KP_DESC_FLOAT32, KP_DESC_UINT8_SCALED}})->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,112 @@
+#include <benchmark/benchmark.h>
+#include <opencv2/opencv.hpp>
+#include <filesystem>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "common/tiled_detector.hpp"
+
+namespace fs = std::filesystem;
+
+// Untiled vs tiled SIFT on ~20 MP frames (the sample images upscaled to 5472 px wide).
+// Arg = tile size, 0 = one detectAndCompute call on the whole frame. Counters:
+//   keypoints     - per frame
+//   agreement     - share of untiled keypoints that the tiled run also reports within 1 px
+//   extra         - tiled keypoints without an untiled counterpart, relative to untiled count
+
+static const std::vector<cv::Mat>& large_frames() {
+    static std::vector<cv::Mat> frames = []{
+        std::vector<cv::Mat> out;
+        for(const auto& entry : fs::directory_iterator(UNDERWATER_IMAGES_DIR)) {
+            if(entry.path().extension() != ".jpg" || out.size() == 2) continue;
+            cv::Mat img = cv::imread(entry.path().string(), cv::IMREAD_GRAYSCALE);
+            if(img.empty()) continue;
+            double f = 5472.0 / img.cols;
+            cv::Mat big;
+            cv::resize(img, big, cv::Size(), f, f, cv::INTER_CUBIC);
+            out.push_back(big);
+        }
+        return out;
+    }();
+    return frames;
+}
+
+static TilingOptions tiling(int tile_size) {
+    TilingOptions o;
+    o.tile_size = tile_size;
+    o.overlap = 64;
+    o.min_megapixels = 0;
+    o.threads = static_cast<int>(std::thread::hardware_concurrency());
+    return o;
+}
+
+static void detect(int tile_size, const cv::Mat& img, std::vector<cv::KeyPoint>& kps, cv::Mat& desc) {
+    if(tile_size == 0) {
+        cv::SIFT::create()->detectAndCompute(img, cv::noArray(), kps, desc);
+        return;
+    }
+    TiledDetector tiled([]{ return cv::SIFT::create(); }, tiling(tile_size));
+    tiled.detectAndCompute(img, kps, desc);
+}
+
+static const std::vector<std::vector<cv::KeyPoint>>& untiled_reference() {
+    static std::vector<std::vector<cv::KeyPoint>> ref = []{
+        std::vector<std::vector<cv::KeyPoint>> r;
+        for(const auto& img : large_frames()) {
+            std::vector<cv::KeyPoint> kps;
+            cv::Mat desc;
+            detect(0, img, kps, desc);
+            r.push_back(std::move(kps));
+        }
+        return r;
+    }();
+    return ref;
+}
+
+// Fraction of `a` with a keypoint of `b` within 1 px, via a coarse grid over b
+static double covered(const std::vector<cv::KeyPoint>& a, const std::vector<cv::KeyPoint>& b) {
+    if(a.empty()) return 0;
+    std::unordered_multimap<long long, cv::Point2f> grid;
+    auto key = [](int gx, int gy) { return (static_cast<long long>(gx) << 32) ^ static_cast<unsigned>(gy); };
+    for(const auto& k : b) grid.emplace(key(static_cast<int>(k.pt.x), static_cast<int>(k.pt.y)), k.pt);
+    size_t hit = 0;
+    for(const auto& k : a) {
+        bool found = false;
+        int gx = static_cast<int>(k.pt.x), gy = static_cast<int>(k.pt.y);
+        for(int dy = -1; dy <= 1 && !found; ++dy)
+            for(int dx = -1; dx <= 1 && !found; ++dx) {
+                auto range = grid.equal_range(key(gx + dx, gy + dy));
+                for(auto it = range.first; it != range.second && !found; ++it) {
+                    float ex = it->second.x - k.pt.x, ey = it->second.y - k.pt.y;
+                    found = ex * ex + ey * ey <= 1.0f;
+                }
+            }
+        hit += found;
+    }
+    return static_cast<double>(hit) / a.size();
+}
+
+static void BM_TiledSift(benchmark::State& state) {
+    const auto& frames = large_frames();
+    if(frames.empty()) { state.SkipWithError("no sample images"); return; }
+    const int tile_size = static_cast<int>(state.range(0));
+    size_t i = 0, keypoints = 0;
+    double agreement = 0, extra = 0;
+    for(auto _ : state) {
+        size_t k = i++ % frames.size();
+        std::vector<cv::KeyPoint> kps;
+        cv::Mat desc;
+        detect(tile_size, frames[k], kps, desc);
+        keypoints += kps.size();
+        state.PauseTiming();
+        const auto& ref = untiled_reference()[k];
+        agreement += covered(ref, kps);
+        extra += ref.empty() ? 0 : (1.0 - covered(kps, ref)) * kps.size() / ref.size();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["keypoints"] = benchmark::Counter(static_cast<double>(keypoints), benchmark::Counter::kAvgIterations);
+    state.counters["agreement"] = benchmark::Counter(agreement, benchmark::Counter::kAvgIterations);
+    state.counters["extra"] = benchmark::Counter(extra, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_TiledSift)->ArgName("tile")->Arg(0)->Arg(1024)->Arg(2048)->Unit(benchmark::kMillisecond)->UseRealTime();
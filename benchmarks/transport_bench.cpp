@@ -0,0 +1,109 @@
+#include <benchmark/benchmark.h>
+#include <zmq.hpp>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "common/frame_header.hpp"
+#include "common/latency_trace.hpp"
+#include "common/shm_transport.hpp"
+
+// One generator -> processor hop: a producer thread streams header + image frames as fast as
+// the transport takes them, the benchmark loop is the receiving stage (one frame per
+// iteration, reading every cache line of the image like a decoder would). Latency is the
+// header's GEN_SEND stamp to receipt, so it includes queueing behind the HWM / full ring.
+// transport: 0 = tcp://127.0.0.1, 1 = ipc://, 2 = shm:// (ring + inproc bridge).
+
+static const char* TRANSPORT_NAMES[] = {"tcp", "ipc", "shm"};
+
+static std::string zmq_endpoint(int transport) {
+    return transport == 0 ? "tcp://127.0.0.1:6190" : "ipc:///tmp/dis_transport_bench_" + std::to_string(getpid());
+}
+
+static void BM_Hop(benchmark::State& state) {
+    const int transport = static_cast<int>(state.range(0));
+    const size_t image_bytes = static_cast<size_t>(state.range(1)) << 10;
+    std::vector<uint8_t> image(image_bytes, 0x5a);
+
+    zmq::context_t ctx(1);
+    zmq::socket_t pull(ctx, zmq::socket_type::pull);
+    pull.set(zmq::sockopt::rcvhwm, 16);
+    std::unique_ptr<ShmReceiver> shm_in;
+    std::string shm_name = "dis_transport_bench_" + std::to_string(getpid());
+    if(transport == 2) {
+        pull.bind("inproc://shm-in");
+        ShmRing::Options opts;
+        opts.slots = 16;
+        opts.slot_bytes = image_bytes + 4096;
+        shm_in = std::make_unique<ShmReceiver>(ctx, "inproc://shm-in", shm_name, true, opts, [](const std::string&){});
+    } else {
+        pull.bind(zmq_endpoint(transport));
+    }
+
+    std::atomic<bool> stop{false};
+    std::thread producer([&]{
+        std::vector<uint8_t> meta(sizeof(FrameHeader));
+        FrameHeader h;
+        h.width = 1920;
+        h.height = 1080;
+        auto stamp = [&]{
+            TraceStamps t;
+            t.stamp(GEN_SEND);
+            h.seq++;
+            h.set_trace(t);
+            write_frame_header(h, {}, meta.data());
+        };
+        if(transport == 2) {
+            ShmSender out(shm_name, false);
+            while(!stop) {
+                stamp();
+                if(out.send({{meta.data(), meta.size()}, {image.data(), image.size()}}, [&]{ return !stop; })
+                   == ShmSendResult::NoConsumer)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            return;
+        }
+        zmq::socket_t push(ctx, zmq::socket_type::push);
+        push.set(zmq::sockopt::sndhwm, 16);
+        push.set(zmq::sockopt::sndtimeo, 200);
+        push.set(zmq::sockopt::linger, 0);
+        push.connect(zmq_endpoint(transport));
+        while(!stop) {
+            stamp();
+            zmq::message_t m(meta.data(), meta.size());
+            if(!push.send(m, zmq::send_flags::sndmore)) continue;
+            zmq::message_t img(image.data(), image.size());
+            push.send(img, zmq::send_flags::none);
+        }
+    });
+
+    LatencyHistogram hist;
+    uint64_t sink = 0;
+    for(auto _ : state) {
+        zmq::message_t meta, img;
+        (void)pull.recv(meta);
+        (void)pull.recv(img);
+        uint64_t now = mono_ns();
+        FrameHeader scratch;
+        const FrameHeader* h = read_frame_header(meta.data(), meta.size(), scratch);
+        if(h) hist.record(now - h->trace[GEN_SEND]);
+        const uint8_t* p = static_cast<const uint8_t*>(img.data());
+        for(size_t i = 0; i < img.size(); i += 64) sink += p[i];
+        benchmark::DoNotOptimize(sink);
+    }
+
+    stop = true;
+    producer.join();
+    shm_in.reset();
+
+    state.SetLabel(TRANSPORT_NAMES[transport]);
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * image_bytes));
+    state.counters["p50_us"] = static_cast<double>(hist.percentile(50)) / 1000.0;
+    state.counters["p99_us"] = static_cast<double>(hist.percentile(99)) / 1000.0;
+}
+BENCHMARK(BM_Hop)
+    ->ArgNames({"transport", "kb"})
+    ->ArgsProduct({{0, 1, 2}, {64, 1024, 8192}})
+    ->UseRealTime();
@@ -0,0 +1,239 @@
+#pragma once
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "common/bounded_queue.hpp"
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+// One file to persist. `data` must stay valid until on_done has run; `owner` is held
+// for exactly that long (e.g. a shared_ptr to the zmq::message_t the bytes live in).
+struct FileWriteJob {
+    std::string path;
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    std::shared_ptr<void> owner;
+    std::function<void(bool ok, const std::string& error)> on_done;
+};
+
+// fsync a directory so that a completed rename inside it survives a crash
+inline bool fsync_dir(const std::string& dir) {
+    int dfd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(dfd < 0) return false;
+    bool ok = ::fsync(dfd) == 0;
+    ::close(dfd);
+    return ok;
+}
+
+inline std::string parent_dir(const std::string& path) {
+    return std::filesystem::path(path).parent_path().string();
+}
+
+inline bool write_all(int fd, const uint8_t* data, size_t size, off_t offset) {
+    while(size > 0) {
+        ssize_t n = ::pwrite(fd, data, size, offset);
+        if(n < 0) {
+            if(errno == EINTR) continue;
+            return false;
+        }
+        data += n; size -= n; offset += n;
+    }
+    return true;
+}
+
+// Write to `<path>.tmp`, optionally fdatasync it, then rename over `path`.
+// Readers therefore see either no file or the complete file, never a partial one.
+inline bool write_file_atomic(const std::string& path, const uint8_t* data, size_t size, bool durable, std::string& error) {
+    std::string tmp = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd < 0) { error = "open " + tmp + ": " + std::strerror(errno); return false; }
+    bool ok = write_all(fd, data, size, 0);
+    if(!ok) error = "write " + tmp + ": " + std::strerror(errno);
+    if(ok && durable && ::fdatasync(fd) != 0) { ok = false; error = "fdatasync " + tmp + ": " + std::strerror(errno); }
+    ::close(fd);
+    if(ok && ::rename(tmp.c_str(), path.c_str()) != 0) { ok = false; error = "rename " + tmp + ": " + std::strerror(errno); }
+    if(ok && durable && !fsync_dir(parent_dir(path))) { ok = false; error = "fsync dir of " + path + ": " + std::strerror(errno); }
+    if(!ok) ::unlink(tmp.c_str());
+    return ok;
+}
+
+// Persists files off the caller's thread. Uses io_uring when built with HAVE_LIBURING and
+// the kernel allows it, otherwise a pool of threads doing blocking writes. submit() blocks
+// while `queue_capacity` jobs are waiting, which is how backpressure reaches the caller.
+// on_done runs on a writer thread once the file is in place (and synced, if `fsync`).
+class AsyncFileWriter {
+public:
+    struct Options {
+        std::string backend = "auto"; // auto | io_uring | thread_pool
+        int num_threads = 2;          // thread_pool backend
+        unsigned io_uring_depth = 64; // max files in flight on the io_uring backend
+        size_t queue_capacity = 256;
+        bool fsync = true;
+    };
+
+    explicit AsyncFileWriter(const Options& opts) : opts(opts), jobs(opts.queue_capacity) {
+        if(opts.backend != "auto" && opts.backend != "io_uring" && opts.backend != "thread_pool")
+            throw std::runtime_error("Unknown file writer backend: " + opts.backend);
+#ifdef HAVE_LIBURING
+        if(opts.backend != "thread_pool" && io_uring_queue_init(opts.io_uring_depth * 2, &ring, 0) == 0) {
+            uring_ready = true;
+            threads.emplace_back([this]{ run_io_uring(); });
+            return;
+        }
+#endif
+        if(opts.backend == "io_uring") throw std::runtime_error("io_uring backend requested but not available");
+        int n = opts.num_threads > 0 ? opts.num_threads : 1;
+        for(int i = 0; i < n; ++i) threads.emplace_back([this]{ run_pool(); });
+    }
+
+    // Finishes every queued job before returning
+    ~AsyncFileWriter() {
+        jobs.close();
+        for(auto& t : threads) t.join();
+#ifdef HAVE_LIBURING
+        if(uring_ready) io_uring_queue_exit(&ring);
+#endif
+    }
+
+    AsyncFileWriter(const AsyncFileWriter&) = delete;
+    AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+
+    bool submit(FileWriteJob job) { return jobs.push(std::move(job)); }
+
+    size_t queue_depth() const { return jobs.size(); }
+
+    const char* backend() const {
+#ifdef HAVE_LIBURING
+        if(uring_ready) return "io_uring";
+#endif
+        return "thread_pool";
+    }
+
+private:
+    static void finish(FileWriteJob& job, bool ok, const std::string& error) {
+        if(job.on_done) job.on_done(ok, error);
+        job.owner.reset();
+    }
+
+    void run_pool() {
+        while(auto job = jobs.pop()) {
+            std::string error;
+            bool ok = write_file_atomic(job->path, job->data, job->size, opts.fsync, error);
+            finish(*job, ok, error);
+        }
+    }
+
+#ifdef HAVE_LIBURING
+    // One file in flight: a write SQE linked to an fdatasync SQE. Each SQE's user data
+    // points at one of `steps` so its CQE can be matched to the op and the operation.
+    struct UringOp;
+    struct UringStep { UringOp* op; bool is_write; };
+    struct UringOp {
+        FileWriteJob job;
+        std::string tmp;
+        int fd = -1;
+        int pending = 0;     // CQEs still outstanding
+        int write_res = 0;
+        int sync_res = 0;
+        UringStep steps[2];
+    };
+
+    void run_io_uring() {
+        size_t inflight = 0;
+        std::vector<std::unique_ptr<UringOp>> done;
+        for(;;) {
+            // Top up the ring; only block on the queue when nothing is in flight
+            while(inflight < opts.io_uring_depth) {
+                auto job = inflight == 0 ? jobs.pop() : jobs.try_pop();
+                if(!job) break;
+                if(start_op(std::move(*job))) inflight++;
+            }
+            if(inflight == 0) break; // queue closed and drained
+
+            io_uring_submit_and_wait(&ring, 1);
+            io_uring_cqe* cqe = nullptr;
+            unsigned head = 0, seen = 0;
+            io_uring_for_each_cqe(&ring, head, cqe) {
+                auto* step = static_cast<UringStep*>(io_uring_cqe_get_data(cqe));
+                (step->is_write ? step->op->write_res : step->op->sync_res) = cqe->res;
+                if(--step->op->pending == 0) done.emplace_back(step->op);
+                seen++;
+            }
+            io_uring_cq_advance(&ring, seen);
+            inflight -= done.size();
+            complete_ops(done);
+        }
+    }
+
+    bool start_op(FileWriteJob job) {
+        auto* op = new UringOp();
+        op->job = std::move(job);
+        op->tmp = op->job.path + ".tmp";
+        op->fd = ::open(op->tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if(op->fd < 0) {
+            finish(op->job, false, "open " + op->tmp + ": " + std::strerror(errno));
+            delete op;
+            return false;
+        }
+        op->pending = opts.fsync ? 2 : 1;
+        op->steps[0] = UringStep{op, true};
+        op->steps[1] = UringStep{op, false};
+
+        io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+        io_uring_prep_write(sqe, op->fd, op->job.data, static_cast<unsigned>(op->job.size), 0);
+        io_uring_sqe_set_data(sqe, &op->steps[0]);
+        if(opts.fsync) {
+            sqe->flags |= IOSQE_IO_LINK;
+            sqe = io_uring_get_sqe(&ring);
+            io_uring_prep_fsync(sqe, op->fd, IORING_FSYNC_DATASYNC);
+            io_uring_sqe_set_data(sqe, &op->steps[1]);
+        }
+        return true;
+    }
+
+    // Rename every finished file, sync each touched directory once, then report back
+    void complete_ops(std::vector<std::unique_ptr<UringOp>>& done) {
+        std::set<std::string> dirs;
+        std::vector<std::pair<bool, std::string>> results;
+        for(auto& op : done) {
+            bool ok = true;
+            std::string error;
+            if(op->write_res < 0) { ok = false; error = "write " + op->tmp + ": " + std::strerror(-op->write_res); }
+            else if(static_cast<size_t>(op->write_res) < op->job.size) {
+                // Short write: finish the remainder synchronously
+                size_t off = static_cast<size_t>(op->write_res);
+                ok = write_all(op->fd, op->job.data + off, op->job.size - off, static_cast<off_t>(off)) &&
+                     (!opts.fsync || ::fdatasync(op->fd) == 0);
+                if(!ok) error = "write " + op->tmp + ": " + std::strerror(errno);
+            }
+            else if(opts.fsync && op->sync_res < 0) { ok = false; error = "fdatasync " + op->tmp + ": " + std::strerror(-op->sync_res); }
+            ::close(op->fd);
+            if(ok && ::rename(op->tmp.c_str(), op->job.path.c_str()) != 0) { ok = false; error = "rename " + op->tmp + ": " + std::strerror(errno); }
+            if(!ok) ::unlink(op->tmp.c_str());
+            else if(opts.fsync) dirs.insert(parent_dir(op->job.path));
+            results.emplace_back(ok, error);
+        }
+        for(const auto& d : dirs) fsync_dir(d);
+        for(size_t i = 0; i < done.size(); ++i) finish(done[i]->job, results[i].first, results[i].second);
+        done.clear();
+    }
+
+    io_uring ring{};
+    bool uring_ready = false;
+#endif
+
+    Options opts;
+    BoundedQueue<FileWriteJob> jobs;
+    std::vector<std::thread> threads;
+};
@@ -0,0 +1,83 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+// Blocking multi-producer / multi-consumer FIFO with a fixed capacity.
+// push() waits while the queue is full, pop() waits while it is empty.
+// close() wakes every waiter: further pushes fail and pop() returns
+// std::nullopt once the remaining items have been drained.
+// pop_until() additionally returns std::nullopt when the deadline passes, try_pop()
+// never waits; is_closed() tells a timeout apart from the end of the stream.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity ? capacity : 1) {}
+
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mtx);
+        not_full.wait(lock, [&]{ return closed || items.size() < capacity; });
+        if(closed) return false;
+        items.push_back(std::move(item));
+        lock.unlock();
+        not_empty.notify_one();
+        return true;
+    }
+
+    std::optional<T> pop() {
+        std::unique_lock<std::mutex> lock(mtx);
+        not_empty.wait(lock, [&]{ return closed || !items.empty(); });
+        return take_front(lock);
+    }
+
+    template <typename Clock, typename Duration>
+    std::optional<T> pop_until(const std::chrono::time_point<Clock, Duration> &deadline) {
+        std::unique_lock<std::mutex> lock(mtx);
+        not_empty.wait_until(lock, deadline, [&]{ return closed || !items.empty(); });
+        return take_front(lock);
+    }
+
+    std::optional<T> try_pop() {
+        std::unique_lock<std::mutex> lock(mtx);
+        return take_front(lock);
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            closed = true;
+        }
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+
+    bool is_closed() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        return closed;
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        return items.size();
+    }
+
+private:
+    std::optional<T> take_front(std::unique_lock<std::mutex> &lock) {
+        if(items.empty()) return std::nullopt;
+        T item = std::move(items.front());
+        items.pop_front();
+        lock.unlock();
+        not_full.notify_one();
+        return item;
+    }
+
+    const size_t capacity;
+    std::deque<T> items;
+    bool closed = false;
+    mutable std::mutex mtx;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+};
@@ -0,0 +1,438 @@
+#pragma once
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "common/async_file_writer.hpp"
+#include "common/descriptor_matcher.hpp"
+
+/*
+Bag-of-visual-words image index
+
+Every descriptor of a frame is quantized to its nearest "visual word" (a centroid of a
+vocabulary trained by k-means on L2 descriptors, k-majority on binary ones), so a frame
+becomes a sparse histogram of word counts. An inverted file lists, per word, the frames
+containing it; a query only touches the posting lists of its own words and scores frames
+by tf-idf cosine similarity.
+
+Snapshot file, little-endian, every section 8-byte aligned so it can be used in place
+through mmap:
+    BowIndexHeader
+    centroids     words x row_bytes     (float32 rows for L2, packed bits for Hamming)
+    word_offsets  uint64[words + 1]     postings of word w are [word_offsets[w], word_offsets[w+1])
+    postings      BowPosting[postings]  (frame, count), frames ascending within a word
+    norms         float[frames]         tf-idf norm of each frame at snapshot time
+    ids           char[frames][id_width] NUL-padded image ids
+*/
+
+static constexpr char BOW_INDEX_MAGIC[8] = {'D', 'I', 'S', 'B', 'O', 'W', '0', '1'};
+static constexpr uint32_t BOW_INDEX_VERSION = 1;
+
+struct BowIndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint8_t metric;      // DescriptorMetric
+    uint8_t reserved[3];
+    uint32_t cols;       // descriptor entries per row (floats or bytes)
+    uint32_t words;
+    uint32_t frames;
+    uint32_t id_width;
+    uint64_t postings;
+    int64_t last_rowid;  // source rows up to this SQLite rowid are in the index
+    uint64_t centroids_off, word_offsets_off, postings_off, norms_off, ids_off, total_size;
+};
+static_assert(sizeof(BowIndexHeader) == 96, "BowIndexHeader layout changed");
+
+struct BowPosting {
+    uint32_t frame;
+    uint32_t count;
+};
+
+struct IndexHit {
+    std::string image_id;
+    double score = 0; // cosine similarity in [0, 1]
+};
+
+// ---------------------------------------------------------------------------------------
+// Vocabulary
+// ---------------------------------------------------------------------------------------
+
+struct BowVocabulary {
+    DescriptorMetric metric = DescriptorMetric::L2;
+    uint32_t cols = 0;
+    std::vector<uint8_t> centroids; // row-major, row_bytes() per word
+
+    size_t row_bytes() const { return metric == DescriptorMetric::L2 ? cols * sizeof(float) : cols; }
+    uint32_t words() const { return row_bytes() ? static_cast<uint32_t>(centroids.size() / row_bytes()) : 0; }
+    bool empty() const { return centroids.empty(); }
+    DescriptorSet as_set() const { return {centroids.data(), words(), cols, row_bytes(), metric}; }
+
+    // Word of every row of `desc`
+    std::vector<uint32_t> quantize(const DescriptorSet& desc) const { return quantize(desc, as_set()); }
+
+    static std::vector<uint32_t> quantize(const DescriptorSet& desc, const DescriptorSet& vocab) {
+        MatchOptions opts;
+        opts.ratio = 1.0f; // nearest word only
+        std::vector<uint32_t> out(desc.rows, 0);
+        for(const auto& m : match_descriptors(desc, vocab, opts)) out[m.query] = m.train;
+        return out;
+    }
+
+    // k-means++ seeding, then Lloyd iterations. Binary centroids take the majority bit of
+    // their members.
+    static BowVocabulary train(const DescriptorSet& sample, uint32_t words, int iterations, uint32_t seed = 1) {
+        BowVocabulary v;
+        v.metric = sample.metric;
+        v.cols = static_cast<uint32_t>(sample.cols);
+        if(sample.empty() || words == 0) return v;
+        words = static_cast<uint32_t>(std::min<size_t>(words, sample.rows));
+        const size_t rb = v.row_bytes();
+        v.centroids.resize(words * rb);
+
+        // Each next seed is drawn with probability proportional to its squared distance
+        // to the nearest seed so far
+        const SimdLevel simd = detect_simd_level();
+        auto dist = [&](const uint8_t* a, const uint8_t* b) {
+            if(v.metric == DescriptorMetric::L2)
+                return static_cast<double>(l2_kernel(simd)(reinterpret_cast<const float*>(a), reinterpret_cast<const float*>(b), v.cols));
+            double h = hamming_kernel(simd)(a, b, v.cols);
+            return h * h;
+        };
+        std::mt19937 rng(seed);
+        std::vector<double> nearest(sample.rows, std::numeric_limits<double>::max());
+        size_t pick = std::uniform_int_distribution<size_t>(0, sample.rows - 1)(rng);
+        for(uint32_t w = 0; w < words; ++w) {
+            std::memcpy(&v.centroids[w * rb], sample.row(pick), rb);
+            double total = 0;
+            for(size_t r = 0; r < sample.rows; ++r) {
+                nearest[r] = std::min(nearest[r], dist(sample.row(r), &v.centroids[w * rb]));
+                total += nearest[r];
+            }
+            if(total <= 0) { v.centroids.resize((w + 1) * rb); break; } // fewer distinct rows than words
+            double target = std::uniform_real_distribution<double>(0.0, total)(rng);
+            for(pick = 0; pick + 1 < sample.rows && (target -= nearest[pick]) > 0; ++pick) {}
+        }
+        words = v.words();
+
+        for(int it = 0; it < iterations; ++it) {
+            std::vector<uint32_t> assign = v.quantize(sample);
+            std::vector<uint32_t> members(words, 0);
+            std::vector<double> acc(static_cast<size_t>(words) * (v.metric == DescriptorMetric::L2 ? v.cols : v.cols * 8), 0.0);
+            const size_t dims = acc.size() / words;
+            for(size_t r = 0; r < sample.rows; ++r) {
+                double* a = &acc[assign[r] * dims];
+                members[assign[r]]++;
+                if(v.metric == DescriptorMetric::L2) {
+                    const float* f = reinterpret_cast<const float*>(sample.row(r));
+                    for(size_t c = 0; c < v.cols; ++c) a[c] += f[c];
+                } else {
+                    const uint8_t* b = sample.row(r);
+                    for(size_t c = 0; c < dims; ++c) a[c] += (b[c >> 3] >> (c & 7)) & 1;
+                }
+            }
+            for(uint32_t w = 0; w < words; ++w) {
+                if(members[w] == 0) continue; // empty cluster keeps its centroid
+                const double* a = &acc[w * dims];
+                uint8_t* out = &v.centroids[w * rb];
+                if(v.metric == DescriptorMetric::L2) {
+                    float* f = reinterpret_cast<float*>(out);
+                    for(size_t c = 0; c < v.cols; ++c) f[c] = static_cast<float>(a[c] / members[w]);
+                } else {
+                    std::memset(out, 0, rb);
+                    for(size_t c = 0; c < dims; ++c)
+                        if(2 * a[c] > members[w]) out[c >> 3] |= static_cast<uint8_t>(1u << (c & 7));
+                }
+            }
+        }
+        return v;
+    }
+};
+
+namespace bow_detail {
+    // Sorted (word, count) histogram of one frame
+    inline std::vector<std::pair<uint32_t, uint32_t>> histogram(std::vector<uint32_t> words) {
+        std::sort(words.begin(), words.end());
+        std::vector<std::pair<uint32_t, uint32_t>> h;
+        for(uint32_t w : words) {
+            if(!h.empty() && h.back().first == w) h.back().second++;
+            else h.emplace_back(w, 1);
+        }
+        return h;
+    }
+
+    // Smoothed so a word present in every frame still counts a little
+    inline double idf(size_t frames, size_t df) {
+        return df ? std::log(1.0 + static_cast<double>(frames) / static_cast<double>(df)) : 0.0;
+    }
+
+    // Top-k frames by tf-idf cosine over an inverted file given as word offsets + postings
+    template <typename IdFn>
+    std::vector<IndexHit> score(const std::vector<std::pair<uint32_t, uint32_t>>& hist, size_t frames,
+                                const uint64_t* offsets, const BowPosting* postings, const float* norms,
+                                size_t k, IdFn&& id_of) {
+        std::vector<IndexHit> hits;
+        if(hist.empty() || frames == 0 || k == 0) return hits;
+        std::vector<double> acc(frames, 0.0);
+        double qnorm = 0;
+        for(const auto& [w, qc] : hist) {
+            uint64_t b = offsets[w], e = offsets[w + 1];
+            double idf_w = idf(frames, e - b);
+            double qw = qc * idf_w;
+            qnorm += qw * qw;
+            for(uint64_t p = b; p < e; ++p)
+                if(postings[p].frame < frames) acc[postings[p].frame] += qw * postings[p].count * idf_w;
+        }
+        if(qnorm <= 0) return hits;
+        qnorm = std::sqrt(qnorm);
+        std::vector<uint32_t> order;
+        for(uint32_t f = 0; f < frames; ++f)
+            if(acc[f] > 0 && norms[f] > 0) { acc[f] /= qnorm * norms[f]; order.push_back(f); }
+        size_t n = std::min(k, order.size());
+        std::partial_sort(order.begin(), order.begin() + n, order.end(),
+                          [&](uint32_t a, uint32_t b) { return acc[a] != acc[b] ? acc[a] > acc[b] : a < b; });
+        for(size_t i = 0; i < n; ++i) hits.push_back({id_of(order[i]), std::min(1.0, acc[order[i]])});
+        return hits;
+    }
+}
+
+// ---------------------------------------------------------------------------------------
+// Read-only snapshot through mmap
+// ---------------------------------------------------------------------------------------
+
+class BowIndexView {
+public:
+    BowIndexView() = default;
+    ~BowIndexView() { close(); }
+    BowIndexView(const BowIndexView&) = delete;
+    BowIndexView& operator=(const BowIndexView&) = delete;
+    BowIndexView(BowIndexView&& o) noexcept { *this = std::move(o); }
+    BowIndexView& operator=(BowIndexView&& o) noexcept {
+        if(this != &o) { close(); base = o.base; size = o.size; o.base = nullptr; o.size = 0; }
+        return *this;
+    }
+
+    // Map `path`; false (with `error`) when it is missing or not a valid snapshot
+    bool open(const std::string& path, std::string& error) {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0) { error = "open " + path + ": " + std::strerror(errno); return false; }
+        struct stat st{};
+        if(::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(BowIndexHeader))) {
+            ::close(fd);
+            error = path + ": too small for a descriptor index";
+            return false;
+        }
+        void* p = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if(p == MAP_FAILED) { error = "mmap " + path + ": " + std::strerror(errno); return false; }
+        base = static_cast<const uint8_t*>(p);
+        size = static_cast<size_t>(st.st_size);
+        if(!valid()) { close(); error = path + ": not a descriptor index or truncated"; return false; }
+        return true;
+    }
+
+    void close() {
+        if(base) ::munmap(const_cast<uint8_t*>(base), size);
+        base = nullptr;
+        size = 0;
+    }
+
+    bool is_open() const { return base != nullptr; }
+    const BowIndexHeader& header() const { return *reinterpret_cast<const BowIndexHeader*>(base); }
+    uint32_t frames() const { return header().frames; }
+    DescriptorMetric metric() const { return static_cast<DescriptorMetric>(header().metric); }
+    uint32_t cols() const { return header().cols; }
+
+    DescriptorSet vocabulary() const {
+        const auto& h = header();
+        size_t rb = static_cast<DescriptorMetric>(h.metric) == DescriptorMetric::L2 ? h.cols * sizeof(float) : h.cols;
+        return {base + h.centroids_off, h.words, h.cols, rb, static_cast<DescriptorMetric>(h.metric)};
+    }
+    const uint64_t* word_offsets() const { return reinterpret_cast<const uint64_t*>(base + header().word_offsets_off); }
+    const BowPosting* postings() const { return reinterpret_cast<const BowPosting*>(base + header().postings_off); }
+    const float* norms() const { return reinterpret_cast<const float*>(base + header().norms_off); }
+
+    std::string image_id(uint32_t frame) const {
+        const char* p = reinterpret_cast<const char*>(base + header().ids_off) + static_cast<size_t>(frame) * header().id_width;
+        return std::string(p, strnlen(p, header().id_width));
+    }
+
+    // Top-k stored frames for a query frame's descriptors; empty when the descriptor type
+    // differs from the index
+    std::vector<IndexHit> query(const DescriptorSet& desc, size_t k) const {
+        if(!is_open() || desc.empty() || desc.metric != metric() || desc.cols != cols()) return {};
+        auto hist = bow_detail::histogram(BowVocabulary::quantize(desc, vocabulary()));
+        return bow_detail::score(hist, frames(), word_offsets(), postings(), norms(), k,
+                                 [&](uint32_t f) { return image_id(f); });
+    }
+
+private:
+    bool valid() const {
+        const auto& h = header();
+        if(std::memcmp(h.magic, BOW_INDEX_MAGIC, sizeof(h.magic)) != 0 || h.version != BOW_INDEX_VERSION) return false;
+        if(h.metric > static_cast<uint8_t>(DescriptorMetric::Hamming) || h.total_size != size) return false;
+        size_t rb = static_cast<DescriptorMetric>(h.metric) == DescriptorMetric::L2 ? h.cols * sizeof(float) : h.cols;
+        auto fits = [&](uint64_t off, uint64_t bytes) { return off % 8 == 0 && off <= size && bytes <= size - off; };
+        if(!fits(h.centroids_off, static_cast<uint64_t>(h.words) * rb) ||
+           !fits(h.word_offsets_off, (static_cast<uint64_t>(h.words) + 1) * 8) ||
+           !fits(h.postings_off, h.postings * sizeof(BowPosting)) ||
+           !fits(h.norms_off, static_cast<uint64_t>(h.frames) * sizeof(float)) ||
+           !fits(h.ids_off, static_cast<uint64_t>(h.frames) * h.id_width)) return false;
+        const uint64_t* off = word_offsets();
+        for(uint32_t w = 0; w < h.words; ++w) if(off[w] > off[w + 1]) return false;
+        // Posting frame numbers are bounds-checked while scoring, so opening stays O(words)
+        return off[0] == 0 && off[h.words] == h.postings;
+    }
+
+    const uint8_t* base = nullptr;
+    size_t size = 0;
+};
+
+// ---------------------------------------------------------------------------------------
+// Incremental in-memory index, persisted as a snapshot
+// ---------------------------------------------------------------------------------------
+
+class BowIndexBuilder {
+public:
+    BowIndexBuilder() = default;
+    explicit BowIndexBuilder(BowVocabulary vocab) { set_vocabulary(std::move(vocab)); }
+
+    void set_vocabulary(BowVocabulary v) {
+        vocab = std::move(v);
+        inverted.assign(vocab.words(), {});
+    }
+
+    const BowVocabulary& vocabulary() const { return vocab; }
+    bool trained() const { return !vocab.empty(); }
+    size_t frames() const { return ids.size(); }
+    bool contains(const std::string& image_id) const { return id_set.count(image_id) != 0; }
+    bool compatible(const DescriptorSet& desc) const { return desc.metric == vocab.metric && desc.cols == vocab.cols; }
+
+    int64_t last_rowid = 0;
+
+    // Index one frame; false when the vocabulary is missing, the descriptors do not fit it,
+    // or the id is already indexed
+    bool add(const std::string& image_id, const DescriptorSet& desc) {
+        if(!trained() || desc.empty() || !compatible(desc) || contains(image_id)) return false;
+        uint32_t frame = static_cast<uint32_t>(ids.size());
+        for(const auto& [w, c] : bow_detail::histogram(vocab.quantize(desc))) inverted[w].push_back({frame, c});
+        ids.push_back(image_id);
+        id_set.insert(image_id);
+        return true;
+    }
+
+    std::vector<IndexHit> query(const DescriptorSet& desc, size_t k) const {
+        if(!trained() || desc.empty() || !compatible(desc)) return {};
+        std::vector<uint64_t> offsets;
+        std::vector<BowPosting> flat;
+        flatten(offsets, flat);
+        std::vector<float> norms = frame_norms(offsets, flat);
+        auto hist = bow_detail::histogram(vocab.quantize(desc));
+        return bow_detail::score(hist, ids.size(), offsets.data(), flat.data(), norms.data(), k,
+                                 [&](uint32_t f) { return ids[f]; });
+    }
+
+    // Serialized snapshot (layout at the top of this file)
+    std::vector<uint8_t> serialize() const {
+        std::vector<uint64_t> offsets;
+        std::vector<BowPosting> flat;
+        flatten(offsets, flat);
+        std::vector<float> norms = frame_norms(offsets, flat);
+        size_t id_width = 8;
+        for(const auto& id : ids) id_width = std::max(id_width, align8(id.size() + 1));
+
+        BowIndexHeader h{};
+        std::memcpy(h.magic, BOW_INDEX_MAGIC, sizeof(h.magic));
+        h.version = BOW_INDEX_VERSION;
+        h.metric = static_cast<uint8_t>(vocab.metric);
+        h.cols = vocab.cols;
+        h.words = vocab.words();
+        h.frames = static_cast<uint32_t>(ids.size());
+        h.id_width = static_cast<uint32_t>(id_width);
+        h.postings = flat.size();
+        h.last_rowid = last_rowid;
+        h.centroids_off = align8(sizeof(BowIndexHeader));
+        h.word_offsets_off = align8(h.centroids_off + vocab.centroids.size());
+        h.postings_off = h.word_offsets_off + offsets.size() * sizeof(uint64_t);
+        h.norms_off = align8(h.postings_off + flat.size() * sizeof(BowPosting));
+        h.ids_off = align8(h.norms_off + norms.size() * sizeof(float));
+        h.total_size = h.ids_off + ids.size() * id_width;
+
+        std::vector<uint8_t> out(h.total_size, 0);
+        std::memcpy(out.data(), &h, sizeof(h));
+        std::memcpy(&out[h.centroids_off], vocab.centroids.data(), vocab.centroids.size());
+        std::memcpy(&out[h.word_offsets_off], offsets.data(), offsets.size() * sizeof(uint64_t));
+        if(!flat.empty()) std::memcpy(&out[h.postings_off], flat.data(), flat.size() * sizeof(BowPosting));
+        if(!norms.empty()) std::memcpy(&out[h.norms_off], norms.data(), norms.size() * sizeof(float));
+        for(size_t f = 0; f < ids.size(); ++f) std::memcpy(&out[h.ids_off + f * id_width], ids[f].data(), ids[f].size());
+        return out;
+    }
+
+    // Atomic replace of `path` (write `<path>.tmp`, rename), so open views keep their
+    // mapping and new ones see the complete snapshot
+    bool save(const std::string& path, bool durable, std::string& error) const {
+        std::vector<uint8_t> bytes = serialize();
+        return write_file_atomic(path, bytes.data(), bytes.size(), durable, error);
+    }
+
+    // Resume from a snapshot
+    static BowIndexBuilder load(const BowIndexView& view) {
+        BowIndexBuilder b;
+        const auto& h = view.header();
+        DescriptorSet voc = view.vocabulary();
+        BowVocabulary v;
+        v.metric = voc.metric;
+        v.cols = static_cast<uint32_t>(voc.cols);
+        v.centroids.assign(voc.data, voc.data + voc.rows * voc.stride);
+        b.set_vocabulary(std::move(v));
+        const uint64_t* off = view.word_offsets();
+        for(uint32_t w = 0; w < h.words; ++w) b.inverted[w].assign(view.postings() + off[w], view.postings() + off[w + 1]);
+        for(uint32_t f = 0; f < h.frames; ++f) {
+            b.ids.push_back(view.image_id(f));
+            b.id_set.insert(b.ids.back());
+        }
+        b.last_rowid = h.last_rowid;
+        return b;
+    }
+
+private:
+    static size_t align8(size_t v) { return (v + 7) & ~static_cast<size_t>(7); }
+
+    void flatten(std::vector<uint64_t>& offsets, std::vector<BowPosting>& flat) const {
+        offsets.assign(inverted.size() + 1, 0);
+        for(size_t w = 0; w < inverted.size(); ++w) offsets[w + 1] = offsets[w] + inverted[w].size();
+        flat.clear();
+        flat.reserve(offsets.back());
+        for(const auto& list : inverted) flat.insert(flat.end(), list.begin(), list.end());
+    }
+
+    std::vector<float> frame_norms(const std::vector<uint64_t>& offsets, const std::vector<BowPosting>& flat) const {
+        std::vector<double> sq(ids.size(), 0.0);
+        for(size_t w = 0; w + 1 < offsets.size(); ++w) {
+            double idf_w = bow_detail::idf(ids.size(), offsets[w + 1] - offsets[w]);
+            for(uint64_t p = offsets[w]; p < offsets[w + 1]; ++p) {
+                double x = flat[p].count * idf_w;
+                sq[flat[p].frame] += x * x;
+            }
+        }
+        std::vector<float> norms(ids.size());
+        for(size_t f = 0; f < ids.size(); ++f) norms[f] = static_cast<float>(std::sqrt(sq[f]));
+        return norms;
+    }
+
+    BowVocabulary vocab;
+    std::vector<std::vector<BowPosting>> inverted; // per word, frames ascending
+    std::vector<std::string> ids;
+    std::unordered_set<std::string> id_set;
+};
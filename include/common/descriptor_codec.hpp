@@ -0,0 +1,221 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "common/descriptor_matcher.hpp"
+
+// Compact encodings for float descriptor blocks:
+//   float16       IEEE half precision, 2 bytes per entry (round to nearest even)
+//   scaled uint8  value = offset + q * scale, q in 0..255, 1 byte per entry
+// SIFT entries are integers in 0..255 stored as float, so they take the identity scale
+// and survive uint8 exactly; any block with a fractional entry (AKAZE/KAZE, normalised
+// descriptors in 0..1) gets the block's min..max range spread over 256 steps. Each
+// conversion has a scalar version and an AVX2/F16C one selected like the matching kernels.
+
+struct Uint8Scale {
+    float offset = 0;
+    float scale = 1;
+};
+
+// ---------------------------------------------------------------------------------------
+// Scalar
+// ---------------------------------------------------------------------------------------
+
+inline uint16_t float_to_half(float f) {
+    uint32_t x;
+    std::memcpy(&x, &f, 4);
+    uint32_t sign = (x >> 16) & 0x8000u, mant = x & 0x7fffffu;
+    int32_t exp = static_cast<int32_t>((x >> 23) & 0xff);
+    if(exp == 0xff) return static_cast<uint16_t>(sign | 0x7c00u | (mant ? 0x200u | (mant >> 13) : 0u)); // inf / nan
+    int32_t e = exp - 127 + 15;
+    if(e >= 0x1f) return static_cast<uint16_t>(sign | 0x7c00u); // overflow to inf
+    if(e <= 0) { // half subnormal or zero
+        if(e < -10) return static_cast<uint16_t>(sign);
+        mant |= 0x800000u;
+        uint32_t shift = static_cast<uint32_t>(14 - e);
+        uint32_t h = mant >> shift, rem = mant & ((1u << shift) - 1), mid = 1u << (shift - 1);
+        if(rem > mid || (rem == mid && (h & 1))) h++;
+        return static_cast<uint16_t>(sign | h);
+    }
+    uint32_t h = (static_cast<uint32_t>(e) << 10) | (mant >> 13), rem = mant & 0x1fffu;
+    if(rem > 0x1000u || (rem == 0x1000u && (h & 1))) h++; // a carry rounds up into the exponent
+    return static_cast<uint16_t>(sign | h);
+}
+
+inline float half_to_float(uint16_t h) {
+    uint32_t sign = (h & 0x8000u) << 16, exp = (h >> 10) & 0x1fu, mant = h & 0x3ffu, x;
+    if(exp == 0x1f) x = sign | 0x7f800000u | (mant << 13);
+    else if(exp) x = sign | ((exp + 112) << 23) | (mant << 13);
+    else if(mant) { // subnormal: normalize into a float exponent
+        uint32_t e = 113;
+        while(!(mant & 0x400u)) { mant <<= 1; --e; }
+        x = sign | (e << 23) | ((mant & 0x3ffu) << 13);
+    } else x = sign;
+    float f;
+    std::memcpy(&f, &x, 4);
+    return f;
+}
+
+inline void float_to_half_scalar(const float* src, uint16_t* dst, size_t n) {
+    for(size_t i = 0; i < n; ++i) dst[i] = float_to_half(src[i]);
+}
+
+inline void half_to_float_scalar(const uint16_t* src, float* dst, size_t n) {
+    for(size_t i = 0; i < n; ++i) dst[i] = half_to_float(src[i]);
+}
+
+inline void min_max_scalar(const float* src, size_t n, float& lo, float& hi) {
+    for(size_t i = 0; i < n; ++i) { lo = std::min(lo, src[i]); hi = std::max(hi, src[i]); }
+}
+
+inline bool all_whole_scalar(const float* src, size_t n) {
+    for(size_t i = 0; i < n; ++i) if(src[i] != std::nearbyint(src[i])) return false;
+    return true;
+}
+
+inline void quantize_u8_scalar(const float* src, uint8_t* dst, size_t n, Uint8Scale s) {
+    const float inv = 1.0f / s.scale;
+    for(size_t i = 0; i < n; ++i) {
+        float q = std::nearbyint((src[i] - s.offset) * inv);
+        dst[i] = static_cast<uint8_t>(std::min(255.0f, std::max(0.0f, q)));
+    }
+}
+
+inline void dequantize_u8_scalar(const uint8_t* src, float* dst, size_t n, Uint8Scale s) {
+    for(size_t i = 0; i < n; ++i) dst[i] = static_cast<float>(src[i]) * s.scale + s.offset;
+}
+
+// ---------------------------------------------------------------------------------------
+// AVX2 / F16C
+// ---------------------------------------------------------------------------------------
+
+#ifdef DESCRIPTOR_MATCHER_X86
+__attribute__((target("avx2,f16c"))) inline void float_to_half_avx2(const float* src, uint16_t* dst, size_t n) {
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+    float_to_half_scalar(src + i, dst + i, n - i);
+}
+
+__attribute__((target("avx2,f16c"))) inline void half_to_float_avx2(const uint16_t* src, float* dst, size_t n) {
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))));
+    half_to_float_scalar(src + i, dst + i, n - i);
+}
+
+__attribute__((target("avx2"))) inline void min_max_avx2(const float* src, size_t n, float& lo, float& hi) {
+    size_t i = 0;
+    if(n >= 8) {
+        __m256 vlo = _mm256_loadu_ps(src), vhi = vlo;
+        for(i = 8; i + 8 <= n; i += 8) {
+            __m256 v = _mm256_loadu_ps(src + i);
+            vlo = _mm256_min_ps(vlo, v);
+            vhi = _mm256_max_ps(vhi, v);
+        }
+        float l[8], h[8];
+        _mm256_storeu_ps(l, vlo);
+        _mm256_storeu_ps(h, vhi);
+        min_max_scalar(l, 8, lo, hi);
+        min_max_scalar(h, 8, lo, hi);
+    }
+    min_max_scalar(src + i, n - i, lo, hi);
+}
+
+__attribute__((target("avx2"))) inline bool all_whole_avx2(const float* src, size_t n) {
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_loadu_ps(src + i);
+        __m256 r = _mm256_round_ps(v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        if(_mm256_movemask_ps(_mm256_cmp_ps(v, r, _CMP_NEQ_UQ))) return false;
+    }
+    return all_whole_scalar(src + i, n - i);
+}
+
+// 32 entries per step: scale, round to nearest even (as nearbyint), saturate to 0..255
+__attribute__((target("avx2"))) inline void quantize_u8_avx2(const float* src, uint8_t* dst, size_t n, Uint8Scale s) {
+    const __m256 off = _mm256_set1_ps(s.offset), inv = _mm256_set1_ps(1.0f / s.scale);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7); // undo the per-lane packing
+    size_t i = 0;
+    for(; i + 32 <= n; i += 32) {
+        __m256i q[4];
+        for(int k = 0; k < 4; ++k)
+            q[k] = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(src + i + 8 * k), off), inv));
+        __m256i w = _mm256_packus_epi16(_mm256_packs_epi32(q[0], q[1]), _mm256_packs_epi32(q[2], q[3]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_permutevar8x32_epi32(w, order));
+    }
+    quantize_u8_scalar(src + i, dst + i, n - i, s);
+}
+
+__attribute__((target("avx2"))) inline void dequantize_u8_avx2(const uint8_t* src, float* dst, size_t n, Uint8Scale s) {
+    const __m256 off = _mm256_set1_ps(s.offset), scale = _mm256_set1_ps(s.scale);
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        __m256i q = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)));
+        // mul + add rather than FMA so results match the scalar path bit for bit
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(q), scale), off));
+    }
+    dequantize_u8_scalar(src + i, dst + i, n - i, s);
+}
+#endif
+
+// ---------------------------------------------------------------------------------------
+// Dispatch
+// ---------------------------------------------------------------------------------------
+
+inline void encode_float16(const float* src, uint16_t* dst, size_t n, SimdLevel simd = detect_simd_level()) {
+#ifdef DESCRIPTOR_MATCHER_X86
+    if(simd != SimdLevel::Scalar) return float_to_half_avx2(src, dst, n);
+#endif
+    (void)simd;
+    float_to_half_scalar(src, dst, n);
+}
+
+inline void decode_float16(const uint16_t* src, float* dst, size_t n, SimdLevel simd = detect_simd_level()) {
+#ifdef DESCRIPTOR_MATCHER_X86
+    if(simd != SimdLevel::Scalar) return half_to_float_avx2(src, dst, n);
+#endif
+    (void)simd;
+    half_to_float_scalar(src, dst, n);
+}
+
+inline bool all_whole(const float* src, size_t n, SimdLevel simd = detect_simd_level()) {
+#ifdef DESCRIPTOR_MATCHER_X86
+    if(simd != SimdLevel::Scalar) return all_whole_avx2(src, n);
+#endif
+    (void)simd;
+    return all_whole_scalar(src, n);
+}
+
+// Identity scale when every entry is a whole number in 0..255 (SIFT), else the block's range
+inline Uint8Scale choose_uint8_scale(const float* src, size_t n, SimdLevel simd = detect_simd_level()) {
+    float lo = 0, hi = 0;
+    if(n) {
+        lo = hi = src[0];
+#ifdef DESCRIPTOR_MATCHER_X86
+        if(simd != SimdLevel::Scalar) min_max_avx2(src, n, lo, hi);
+        else
+#endif
+        min_max_scalar(src, n, lo, hi);
+    }
+    if(lo >= 0 && hi <= 255 && all_whole(src, n, simd)) return {0.0f, 1.0f};
+    return {lo, hi > lo ? (hi - lo) / 255.0f : 1.0f};
+}
+
+inline void encode_uint8(const float* src, uint8_t* dst, size_t n, Uint8Scale s, SimdLevel simd = detect_simd_level()) {
+#ifdef DESCRIPTOR_MATCHER_X86
+    if(simd != SimdLevel::Scalar) return quantize_u8_avx2(src, dst, n, s);
+#endif
+    (void)simd;
+    quantize_u8_scalar(src, dst, n, s);
+}
+
+inline void decode_uint8(const uint8_t* src, float* dst, size_t n, Uint8Scale s, SimdLevel simd = detect_simd_level()) {
+#ifdef DESCRIPTOR_MATCHER_X86
+    if(simd != SimdLevel::Scalar) return dequantize_u8_avx2(src, dst, n, s);
+#endif
+    (void)simd;
+    dequantize_u8_scalar(src, dst, n, s);
+}
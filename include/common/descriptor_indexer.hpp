@@ -0,0 +1,226 @@
+#pragma once
+#include <sqlite3.h>
+#include <opencv2/opencv.hpp>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "common/bow_index.hpp"
+#include "common/ipc_utils.hpp"
+
+// View of a descriptor matrix as it comes out of a keypoint blob: CV_32F rows are
+// L2 descriptors, CV_8U rows packed binary ones
+inline DescriptorSet descriptor_set(const cv::Mat& desc) {
+    if(desc.empty() || !desc.isContinuous()) return {};
+    if(desc.type() == CV_32F) return DescriptorSet::floats(desc.ptr<float>(), desc.rows, desc.cols);
+    return DescriptorSet::binary(desc.ptr<uint8_t>(), desc.rows, desc.cols);
+}
+
+// Keeps a BowIndex snapshot of the `images` table up to date from a background thread.
+// The thread tails the table by rowid on its own read-only connection, so the insert
+// path never waits for it; rows committed while the logger was down (or before the index
+// existed) are picked up the same way. The vocabulary is trained once from the first
+// `train_frames` frames. The snapshot is rewritten atomically every `save_interval_ms`
+// while it has changes, and on shutdown, and records the last rowid it covers so a
+// restart resumes where it left off.
+class DescriptorIndexer {
+public:
+    struct Options {
+        bool enabled = false;
+        std::string path = "data/data_log.bow";
+        uint32_t vocabulary_words = 512;
+        size_t train_frames = 50;
+        size_t train_descriptors = 50000; // random sample of the training frames' rows
+        int train_iterations = 8;
+        int poll_interval_ms = 1000;
+        int save_interval_ms = 10000;
+        int batch_rows = 128;
+        bool fsync = false; // the index can always be rebuilt from the database
+
+        // Options from `logger.index`
+        static Options from_config(const nlohmann::json& j) {
+            Options o;
+            o.enabled = j.value("enabled", o.enabled);
+            o.path = j.value("path", o.path);
+            o.vocabulary_words = j.value("vocabulary_words", o.vocabulary_words);
+            o.train_frames = j.value("train_frames", o.train_frames);
+            o.train_descriptors = j.value("train_descriptors", o.train_descriptors);
+            o.train_iterations = j.value("train_iterations", o.train_iterations);
+            o.poll_interval_ms = j.value("poll_interval_ms", o.poll_interval_ms);
+            o.save_interval_ms = j.value("save_interval_ms", o.save_interval_ms);
+            o.batch_rows = j.value("batch_rows", o.batch_rows);
+            o.fsync = j.value("fsync", o.fsync);
+            if(o.vocabulary_words == 0 || o.train_frames == 0 || o.batch_rows <= 0)
+                throw std::runtime_error("logger.index: vocabulary_words, train_frames and batch_rows must be > 0");
+            return o;
+        }
+    };
+
+    using ErrorFn = std::function<void(const std::string&)>;
+
+    DescriptorIndexer(std::string db_path, const Options& opts,
+                      ErrorFn on_error = [](const std::string& e){ std::cerr << "[DescriptorIndexer ERROR] " << e << std::endl; })
+        : db_path(std::move(db_path)), opts(opts), on_error(std::move(on_error)) {
+        BowIndexView existing;
+        std::string error;
+        if(existing.open(opts.path, error)) index = BowIndexBuilder::load(existing);
+        frames_indexed = index.frames();
+        is_trained = index.trained();
+        worker = std::thread([this]{ run(); });
+    }
+
+    // Indexes whatever is committed by now, then writes the final snapshot
+    ~DescriptorIndexer() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        cv.notify_all();
+        if(worker.joinable()) worker.join();
+    }
+
+    DescriptorIndexer(const DescriptorIndexer&) = delete;
+    DescriptorIndexer& operator=(const DescriptorIndexer&) = delete;
+
+    uint64_t frames() const { return frames_indexed.load(); }
+    uint64_t skipped() const { return frames_skipped.load(); }
+    uint64_t snapshots() const { return snapshots_saved.load(); }
+    bool trained() const { return is_trained.load(); }
+
+private:
+    struct Pending {
+        std::string id;
+        cv::Mat desc;
+    };
+
+    void run() {
+        sqlite3* db = nullptr;
+        sqlite3_stmt* stmt = nullptr;
+        auto next_save = std::chrono::steady_clock::now() + std::chrono::milliseconds(opts.save_interval_ms);
+        bool stop = false;
+        while(!stop) {
+            int rows = 0;
+            if(!stmt) open(db, stmt);
+            if(stmt) rows = poll(stmt);
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                stop = stopping && rows < opts.batch_rows; // drain what is committed before stopping
+            }
+            if(dirty && (stop || std::chrono::steady_clock::now() >= next_save)) {
+                save();
+                next_save = std::chrono::steady_clock::now() + std::chrono::milliseconds(opts.save_interval_ms);
+            }
+            if(stop || rows == opts.batch_rows) continue; // more rows are likely waiting
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait_for(lock, std::chrono::milliseconds(opts.poll_interval_ms), [&]{ return stopping; });
+        }
+        sqlite3_finalize(stmt);
+        sqlite3_close(db);
+    }
+
+    void open(sqlite3*& db, sqlite3_stmt*& stmt) {
+        if(!db && sqlite3_open_v2(db_path.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+            sqlite3_close(db);
+            db = nullptr;
+            return; // the writer has not created it yet
+        }
+        const char* sql = "SELECT rowid, id, kp_blob FROM images WHERE rowid > ? ORDER BY rowid LIMIT ?;";
+        if(sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) stmt = nullptr; // table not created yet
+    }
+
+    // Index the next batch of rows; returns how many rows were read
+    int poll(sqlite3_stmt* stmt) {
+        sqlite3_bind_int64(stmt, 1, last_rowid());
+        sqlite3_bind_int(stmt, 2, opts.batch_rows);
+        int rows = 0, rc;
+        while((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            rows++;
+            int64_t rowid = sqlite3_column_int64(stmt, 0);
+            auto id_text = sqlite3_column_text(stmt, 1);
+            std::string id = id_text ? reinterpret_cast<const char*>(id_text) : "";
+            auto blob = static_cast<const uint8_t*>(sqlite3_column_blob(stmt, 2));
+            size_t bytes = static_cast<size_t>(sqlite3_column_bytes(stmt, 2));
+            scanned_rowid = rowid;
+            cv::Mat desc;
+            try { if(blob) desc = deserialize_keypoints_and_descriptors(blob, bytes).second; }
+            catch(const std::exception& e) { on_error("Unreadable kp_blob for " + id + ": " + e.what()); }
+            add(id, desc);
+        }
+        if(rc != SQLITE_DONE) on_error(std::string("Index scan failed: ") + sqlite3_errstr(rc));
+        sqlite3_reset(stmt);
+        if(index.trained()) index.last_rowid = last_rowid();
+        return rows;
+    }
+
+    int64_t last_rowid() const { return std::max(index.last_rowid, scanned_rowid); }
+
+    void add(const std::string& id, const cv::Mat& desc) {
+        DescriptorSet set = descriptor_set(desc);
+        if(index.trained()) {
+            if(index.add(id, set)) { frames_indexed++; dirty = true; }
+            else if(!index.contains(id)) frames_skipped++;
+            return;
+        }
+        // Collect training frames of the first descriptor type seen
+        if(set.empty() || (!training.empty() && (desc.type() != training[0].desc.type() || desc.cols != training[0].desc.cols))) {
+            frames_skipped++;
+            return;
+        }
+        training.push_back({id, desc});
+        if(training.size() >= opts.train_frames) train();
+    }
+
+    void train() {
+        const cv::Mat& first = training[0].desc;
+        size_t total = 0;
+        for(const auto& p : training) total += static_cast<size_t>(p.desc.rows);
+        std::vector<std::pair<size_t, int>> rows; // (frame, row)
+        rows.reserve(total);
+        for(size_t f = 0; f < training.size(); ++f)
+            for(int r = 0; r < training[f].desc.rows; ++r) rows.emplace_back(f, r);
+        std::mt19937 rng(1);
+        std::shuffle(rows.begin(), rows.end(), rng);
+        rows.resize(std::min(rows.size(), opts.train_descriptors));
+
+        cv::Mat sample(static_cast<int>(rows.size()), first.cols, first.type());
+        for(size_t i = 0; i < rows.size(); ++i) training[rows[i].first].desc.row(rows[i].second).copyTo(sample.row(static_cast<int>(i)));
+        index = BowIndexBuilder(BowVocabulary::train(descriptor_set(sample), opts.vocabulary_words, opts.train_iterations));
+        is_trained = true;
+
+        for(const auto& p : training) add(p.id, p.desc);
+        training.clear();
+    }
+
+    void save() {
+        std::string error;
+        if(index.save(opts.path, opts.fsync, error)) { snapshots_saved++; dirty = false; }
+        else on_error("Failed to save descriptor index: " + error);
+    }
+
+    std::string db_path;
+    Options opts;
+    ErrorFn on_error;
+
+    // Worker thread state
+    BowIndexBuilder index;
+    std::vector<Pending> training;
+    int64_t scanned_rowid = 0;
+    bool dirty = false;
+
+    std::atomic<uint64_t> frames_indexed{0};
+    std::atomic<uint64_t> frames_skipped{0};
+    std::atomic<uint64_t> snapshots_saved{0};
+    std::atomic<bool> is_trained{false};
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool stopping = false;
+    std::thread worker;
+};
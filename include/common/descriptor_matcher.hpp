@@ -0,0 +1,309 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DESCRIPTOR_MATCHER_X86 1
+#endif
+
+// Brute-force descriptor matching with Lowe's ratio test: squared L2 for float32
+// descriptors (SIFT, AKAZE/KAZE) and Hamming distance for packed binary ones (ORB, BRISK,
+// AKAZE/MLDB). The distance kernels come in scalar, AVX2 and AVX-512 variants compiled
+// with per-function target attributes, so no special compiler flags are needed; the
+// best one the CPU supports is picked at runtime. Matching walks the train set in
+// cache-sized blocks so a block of train rows stays in L1/L2 while a block of query
+// rows is compared against it.
+//
+// Works on plain row-major memory (DescriptorSet), e.g. the descriptor block of a
+// keypoint blob or a cv::Mat's data.
+
+enum class DescriptorMetric { L2, Hamming };
+enum class SimdLevel { Scalar, AVX2, AVX512 };
+
+inline const char* simd_level_name(SimdLevel s) {
+    switch(s) {
+        case SimdLevel::AVX512: return "avx512";
+        case SimdLevel::AVX2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+inline SimdLevel detect_simd_level() {
+#ifdef DESCRIPTOR_MATCHER_X86
+    static const SimdLevel level = []{
+        __builtin_cpu_init();
+        // AVX2 level code may also use FMA and F16C, which every AVX2 CPU has
+        bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c");
+        if(avx2 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) return SimdLevel::AVX512;
+        if(avx2) return SimdLevel::AVX2;
+        return SimdLevel::Scalar;
+    }();
+    return level;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+// ---------------------------------------------------------------------------------------
+// Distance kernels. n = floats for L2, bytes for Hamming.
+// ---------------------------------------------------------------------------------------
+
+inline float l2_sq_scalar(const float* a, const float* b, size_t n) {
+    float sum = 0;
+    for(size_t i = 0; i < n; ++i) {
+        float d = a[i] - b[i];
+        sum += d * d;
+    }
+    return sum;
+}
+
+inline uint32_t hamming_scalar(const uint8_t* a, const uint8_t* b, size_t n) {
+    uint32_t bits = 0;
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        uint64_t x, y;
+        std::memcpy(&x, a + i, 8);
+        std::memcpy(&y, b + i, 8);
+        bits += static_cast<uint32_t>(__builtin_popcountll(x ^ y));
+    }
+    for(; i < n; ++i) bits += static_cast<uint32_t>(__builtin_popcount(static_cast<unsigned>(a[i] ^ b[i])));
+    return bits;
+}
+
+#ifdef DESCRIPTOR_MATCHER_X86
+__attribute__((target("avx2,fma"))) inline float l2_sq_avx2(const float* a, const float* b, size_t n) {
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16) {
+        __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));
+        acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+        acc1 = _mm256_fmadd_ps(d1, d1, acc1);
+    }
+    for(; i + 8 <= n; i += 8) {
+        __m256 d = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        acc0 = _mm256_fmadd_ps(d, d, acc0);
+    }
+    __m256 acc = _mm256_add_ps(acc0, acc1);
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s) + l2_sq_scalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx512f"))) inline float l2_sq_avx512(const float* a, const float* b, size_t n) {
+    __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+    size_t i = 0;
+    for(; i + 32 <= n; i += 32) {
+        __m512 d0 = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+        __m512 d1 = _mm512_sub_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16));
+        acc0 = _mm512_fmadd_ps(d0, d0, acc0);
+        acc1 = _mm512_fmadd_ps(d1, d1, acc1);
+    }
+    if(i + 16 <= n) {
+        __m512 d = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+        acc0 = _mm512_fmadd_ps(d, d, acc0);
+        i += 16;
+    }
+    if(i < n) { // masked tail
+        __mmask16 m = static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m512 d = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, a + i), _mm512_maskz_loadu_ps(m, b + i));
+        acc1 = _mm512_fmadd_ps(d, d, acc1);
+    }
+    // Lane sum through memory; GCC 12's _mm512_reduce_* trip -Wmaybe-uninitialized
+    float lanes[16];
+    _mm512_storeu_ps(lanes, _mm512_add_ps(acc0, acc1));
+    float sum = 0;
+    for(float v : lanes) sum += v;
+    return sum;
+}
+
+// Popcount of 32 bytes at a time with the nibble lookup (pshufb) trick, summed by psadbw
+__attribute__((target("avx2"))) inline uint32_t hamming_avx2(const uint8_t* a, const uint8_t* b, size_t n) {
+    const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                         0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0f);
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for(; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                                     _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+        __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lut, _mm256_and_si256(x, low)),
+                                      _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(x, 4), low)));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(cnt, _mm256_setzero_si256()));
+    }
+    uint64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    return static_cast<uint32_t>(lanes[0] + lanes[1] + lanes[2] + lanes[3]) + hamming_scalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx512f,avx512bw"))) inline uint32_t hamming_avx512(const uint8_t* a, const uint8_t* b, size_t n) {
+    if(n < 64) return hamming_avx2(a, b, n); // ORB/BRISK rows (32 bytes) fit one 256-bit op
+    const __m512i lut = _mm512_set4_epi32(0x04030302, 0x03020201, 0x03020201, 0x02010100);
+    const __m512i low = _mm512_set1_epi8(0x0f);
+    __m512i acc = _mm512_setzero_si512();
+    size_t i = 0;
+    for(; i + 64 <= n; i += 64) {
+        __m512i x = _mm512_xor_si512(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+        __m512i cnt = _mm512_add_epi8(_mm512_shuffle_epi8(lut, _mm512_and_si512(x, low)),
+                                      _mm512_shuffle_epi8(lut, _mm512_and_si512(_mm512_srli_epi16(x, 4), low)));
+        acc = _mm512_add_epi64(acc, _mm512_sad_epu8(cnt, _mm512_setzero_si512()));
+    }
+    uint64_t lanes[8];
+    _mm512_storeu_si512(lanes, acc);
+    uint64_t bits = 0;
+    for(uint64_t v : lanes) bits += v;
+    return static_cast<uint32_t>(bits) + hamming_avx2(a + i, b + i, n - i);
+}
+#endif
+
+using L2Kernel = float (*)(const float*, const float*, size_t);
+using HammingKernel = uint32_t (*)(const uint8_t*, const uint8_t*, size_t);
+
+inline L2Kernel l2_kernel(SimdLevel s) {
+#ifdef DESCRIPTOR_MATCHER_X86
+    if(s == SimdLevel::AVX512) return l2_sq_avx512;
+    if(s == SimdLevel::AVX2) return l2_sq_avx2;
+#endif
+    (void)s;
+    return l2_sq_scalar;
+}
+
+inline HammingKernel hamming_kernel(SimdLevel s) {
+#ifdef DESCRIPTOR_MATCHER_X86
+    if(s == SimdLevel::AVX512) return hamming_avx512;
+    if(s == SimdLevel::AVX2) return hamming_avx2;
+#endif
+    (void)s;
+    return hamming_scalar;
+}
+
+// ---------------------------------------------------------------------------------------
+// Matching
+// ---------------------------------------------------------------------------------------
+
+// Non-owning view of `rows` descriptors of `cols` entries, `stride` bytes apart
+struct DescriptorSet {
+    const uint8_t* data = nullptr;
+    size_t rows = 0;
+    size_t cols = 0;
+    size_t stride = 0;
+    DescriptorMetric metric = DescriptorMetric::L2;
+
+    static DescriptorSet floats(const float* data, size_t rows, size_t cols) {
+        return {reinterpret_cast<const uint8_t*>(data), rows, cols, cols * sizeof(float), DescriptorMetric::L2};
+    }
+    static DescriptorSet binary(const uint8_t* data, size_t rows, size_t bytes) {
+        return {data, rows, bytes, bytes, DescriptorMetric::Hamming};
+    }
+
+    const uint8_t* row(size_t i) const { return data + i * stride; }
+    size_t row_bytes() const { return metric == DescriptorMetric::L2 ? cols * sizeof(float) : cols; }
+    bool empty() const { return rows == 0 || cols == 0; }
+};
+
+// Best train row for a query row. distance is the L2 distance (not squared) or the
+// number of differing bits.
+struct DescriptorMatch {
+    uint32_t query = 0;
+    uint32_t train = 0;
+    float distance = 0;
+};
+
+struct MatchOptions {
+    float ratio = 0.8f;           // keep a match when best < ratio * second best; >= 1 keeps every best match
+    size_t block_bytes = 64 << 10; // train rows per block: about half an L2 slice
+    size_t query_block = 32;      // query rows compared against each train block
+    SimdLevel simd = detect_simd_level();
+};
+
+// Running two nearest train rows per query row: squared L2 or bit count, so the ratio
+// test is applied in the same space
+struct NearestTwo {
+    std::vector<float> best, second;
+    std::vector<uint32_t> best_idx;
+    explicit NearestTwo(size_t rows)
+        : best(rows, std::numeric_limits<float>::max()), second(rows, std::numeric_limits<float>::max()), best_idx(rows, 0) {}
+};
+
+// Blocked scan: a block of query rows against a cache-sized block of train rows at a time.
+// Always inlined into the per-ISA entry points below so the kernel call inlines as well.
+template <typename Elem, typename Dist, Dist (*Kernel)(const Elem*, const Elem*, size_t)>
+__attribute__((always_inline)) inline void scan_nearest_two(const DescriptorSet& query, const DescriptorSet& train,
+                                                            const MatchOptions& opts, NearestTwo& nn) {
+    const size_t train_block = std::max<size_t>(1, opts.block_bytes / train.row_bytes());
+    const size_t query_block = std::max<size_t>(1, opts.query_block);
+    for(size_t q0 = 0; q0 < query.rows; q0 += query_block) {
+        size_t q1 = std::min(query.rows, q0 + query_block);
+        for(size_t t0 = 0; t0 < train.rows; t0 += train_block) {
+            size_t t1 = std::min(train.rows, t0 + train_block);
+            for(size_t q = q0; q < q1; ++q) {
+                const Elem* qr = reinterpret_cast<const Elem*>(query.row(q));
+                float b = nn.best[q], s = nn.second[q];
+                uint32_t bi = nn.best_idx[q];
+                for(size_t t = t0; t < t1; ++t) {
+                    float d = static_cast<float>(Kernel(qr, reinterpret_cast<const Elem*>(train.row(t)), query.cols));
+                    if(d < b) { s = b; b = d; bi = static_cast<uint32_t>(t); }
+                    else if(d < s) s = d;
+                }
+                nn.best[q] = b; nn.second[q] = s; nn.best_idx[q] = bi;
+            }
+        }
+    }
+}
+
+inline void nearest_two_scalar(const DescriptorSet& q, const DescriptorSet& t, const MatchOptions& o, NearestTwo& nn) {
+    if(q.metric == DescriptorMetric::L2) scan_nearest_two<float, float, l2_sq_scalar>(q, t, o, nn);
+    else scan_nearest_two<uint8_t, uint32_t, hamming_scalar>(q, t, o, nn);
+}
+
+#ifdef DESCRIPTOR_MATCHER_X86
+__attribute__((target("avx2,fma"))) inline void nearest_two_avx2(const DescriptorSet& q, const DescriptorSet& t,
+                                                                 const MatchOptions& o, NearestTwo& nn) {
+    if(q.metric == DescriptorMetric::L2) scan_nearest_two<float, float, l2_sq_avx2>(q, t, o, nn);
+    else scan_nearest_two<uint8_t, uint32_t, hamming_avx2>(q, t, o, nn);
+}
+
+__attribute__((target("avx2,fma,avx512f,avx512bw"))) inline void nearest_two_avx512(const DescriptorSet& q, const DescriptorSet& t,
+                                                                                   const MatchOptions& o, NearestTwo& nn) {
+    if(q.metric == DescriptorMetric::L2) scan_nearest_two<float, float, l2_sq_avx512>(q, t, o, nn);
+    else scan_nearest_two<uint8_t, uint32_t, hamming_avx512>(q, t, o, nn);
+}
+#endif
+
+// Nearest two train rows of every query row, then Lowe's ratio test. Both sets must use
+// the same metric and row length; otherwise nothing matches.
+inline std::vector<DescriptorMatch> match_descriptors(const DescriptorSet& query, const DescriptorSet& train,
+                                                      const MatchOptions& opts = MatchOptions()) {
+    std::vector<DescriptorMatch> out;
+    if(query.empty() || train.empty() || query.metric != train.metric || query.cols != train.cols) return out;
+
+    NearestTwo nn(query.rows);
+#ifdef DESCRIPTOR_MATCHER_X86
+    if(opts.simd == SimdLevel::AVX512) nearest_two_avx512(query, train, opts, nn);
+    else if(opts.simd == SimdLevel::AVX2) nearest_two_avx2(query, train, opts, nn);
+    else
+#endif
+    nearest_two_scalar(query, train, opts, nn);
+
+    const bool l2 = query.metric == DescriptorMetric::L2;
+    const float r = l2 ? opts.ratio * opts.ratio : opts.ratio;
+    for(size_t q = 0; q < query.rows; ++q) {
+        // With a single train row there is no second best; accept the best match
+        bool pass = opts.ratio >= 1.0f || nn.second[q] == std::numeric_limits<float>::max() || nn.best[q] < r * nn.second[q];
+        if(pass) out.push_back({static_cast<uint32_t>(q), nn.best_idx[q], l2 ? std::sqrt(nn.best[q]) : nn.best[q]});
+    }
+    return out;
+}
+
+// Similarity of two frames: ratio-test matches relative to the smaller descriptor count
+inline double frame_similarity(const DescriptorSet& query, const DescriptorSet& train, const MatchOptions& opts = MatchOptions()) {
+    size_t n = std::min(query.rows, train.rows);
+    if(n == 0) return 0;
+    return static_cast<double>(match_descriptors(query, train, opts).size()) / static_cast<double>(n);
+}
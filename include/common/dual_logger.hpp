@@ -2,12 +2,116 @@
 #include <iostream>
 #include <fstream>
 #include <filesystem>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
+#include <nlohmann/json.hpp>
 
+enum class LogLevel { DEBUG = 0, INFO = 1, WARN = 2, ERROR = 3 };
+
+inline LogLevel parse_log_level(const std::string& s) {
+    if(s == "DEBUG") return LogLevel::DEBUG;
+    if(s == "INFO") return LogLevel::INFO;
+    if(s == "WARN" || s == "WARNING") return LogLevel::WARN;
+    if(s == "ERROR") return LogLevel::ERROR;
+    throw std::runtime_error("Unknown log level: " + s);
+}
+
+// Bounded lock-free multi-producer / single-consumer ring. Every slot carries a sequence
+// number: a producer claims a slot by advancing `tail` with a CAS and publishes it by
+// bumping the slot's sequence, so producers never take a lock or make a syscall.
+template <typename T>
+class MpscRing {
+public:
+    explicit MpscRing(size_t min_capacity) {
+        size_t cap = 2;
+        while(cap < min_capacity) cap <<= 1;
+        mask = cap - 1;
+        slots = std::make_unique<Slot[]>(cap);
+        for(size_t i = 0; i < cap; ++i) slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    // false when the ring is full
+    bool try_push(T&& item) {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        for(;;) {
+            Slot& s = slots[pos & mask];
+            size_t seq = s.seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if(diff == 0) {
+                if(tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    s.value = std::move(item);
+                    s.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if(diff < 0) {
+                return false;
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer side only
+    bool try_pop(T& out) {
+        Slot& s = slots[head & mask];
+        if(s.seq.load(std::memory_order_acquire) != head + 1) return false;
+        out = std::move(s.value);
+        s.seq.store(head + mask + 1, std::memory_order_release);
+        ++head;
+        return true;
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+private:
+    struct Slot {
+        std::atomic<size_t> seq{0};
+        T value;
+    };
+    std::unique_ptr<Slot[]> slots;
+    size_t mask = 0;
+    alignas(64) std::atomic<size_t> tail{0};
+    alignas(64) size_t head = 0;
+};
+
+// Logs to the terminal and a file. In async mode (the default) callers only format the
+// line and push it into an MpscRing; a background thread writes whatever has accumulated
+// every `flush_interval_ms` with one write and one flush per batch. When the ring is full
+// the record is dropped (and counted) or, with `block_on_overflow`, the caller waits.
+// The destructor drains everything still queued, so lines logged before a SIGINT-driven
+// shutdown are not lost.
 class DualLogger {
 public:
-    DualLogger(const std::string& log_file_path) {
+    struct Options {
+        LogLevel level = LogLevel::INFO;
+        bool async = true;
+        size_t ring_capacity = 8192;
+        bool block_on_overflow = false;
+        int flush_interval_ms = 50;
+    };
+
+    // Options from the `logging` config section
+    static Options options_from_config(const nlohmann::json& logging) {
+        Options o;
+        o.level = parse_log_level(logging.value("level", "INFO"));
+        o.async = logging.value("async", true);
+        o.ring_capacity = logging.value("ring_capacity", o.ring_capacity);
+        std::string overflow = logging.value("overflow", "drop");
+        if(overflow != "drop" && overflow != "block") throw std::runtime_error("Unknown logging.overflow: " + overflow);
+        o.block_on_overflow = overflow == "block";
+        o.flush_interval_ms = logging.value("flush_interval_ms", o.flush_interval_ms);
+        return o;
+    }
+
+    DualLogger(const std::string& log_file_path) : DualLogger(log_file_path, Options()) {}
+
+    DualLogger(const std::string& log_file_path, const Options& opts) : opts(opts) {
         // Ensure parent folder exists
         std::filesystem::path p(log_file_path);
         std::filesystem::create_directories(p.parent_path());
@@ -17,31 +121,111 @@ public:
             std::cerr << "[DualLogger ERROR] Failed to open log file: " << log_file_path << std::endl;
             throw std::runtime_error("Failed to open log file");
         }
+        if(opts.async) {
+            ring = std::make_unique<MpscRing<Record>>(opts.ring_capacity);
+            writer = std::thread([this]{ run(); });
+        }
     }
 
     ~DualLogger() {
+        if(writer.joinable()) {
+            stopping = true;
+            wake.notify_one();
+            writer.join();
+        }
         std::lock_guard<std::mutex> lock(mtx);
         if(file.is_open()) file.close();
     }
 
+    DualLogger(const DualLogger&) = delete;
+    DualLogger& operator=(const DualLogger&) = delete;
+
+    bool enabled(LogLevel level) const { return level >= opts.level; }
+
     // Log message to both terminal and file
     void log(const std::string& msg, bool to_terminal=true, bool to_file=true) {
-        std::lock_guard<std::mutex> lock(mtx);
-        if(to_terminal) {
-            std::cout << msg << std::endl;
+        if(!ring) {
+            std::lock_guard<std::mutex> lock(mtx);
+            write_line(msg, to_terminal, to_file);
+            std::cout.flush();
+            file.flush();
+            return;
         }
-        if(to_file && file.is_open()) {
-            file << msg << std::endl;
-            file.flush(); // Ensure it writes immediately
+        Record rec{msg, to_terminal, to_file};
+        while(!ring->try_push(std::move(rec))) {
+            if(!opts.block_on_overflow) { dropped_count.fetch_add(1, std::memory_order_relaxed); return; }
+            wake.notify_one();
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
         }
+        pushed.fetch_add(1, std::memory_order_release);
+    }
+
+    // Block until every record logged so far has been written and flushed
+    void flush() {
+        if(!ring) return;
+        uint64_t target = pushed.load(std::memory_order_acquire);
+        std::unique_lock<std::mutex> lock(mtx);
+        flush_requested = true;
+        wake.notify_one();
+        flushed_cv.wait(lock, [&]{ return written >= target; });
     }
 
+    uint64_t dropped() const { return dropped_count.load(std::memory_order_relaxed); }
+
     // Convenience wrappers
-    void info(const std::string& msg, bool to_terminal=true, bool to_file=true) { log("[INFO] " + msg, to_terminal, to_file); }
-    void warn(const std::string& msg, bool to_terminal=true, bool to_file=true) { log("[WARN] " + msg, to_terminal, to_file); }
-    void error(const std::string& msg, bool to_terminal=true, bool to_file=true) { log("[ERROR] " + msg, to_terminal, to_file); }
+    void debug(const std::string& msg, bool to_terminal=true, bool to_file=true) { if(enabled(LogLevel::DEBUG)) log("[DEBUG] " + msg, to_terminal, to_file); }
+    void info(const std::string& msg, bool to_terminal=true, bool to_file=true) { if(enabled(LogLevel::INFO)) log("[INFO] " + msg, to_terminal, to_file); }
+    void warn(const std::string& msg, bool to_terminal=true, bool to_file=true) { if(enabled(LogLevel::WARN)) log("[WARN] " + msg, to_terminal, to_file); }
+    void error(const std::string& msg, bool to_terminal=true, bool to_file=true) { if(enabled(LogLevel::ERROR)) log("[ERROR] " + msg, to_terminal, to_file); }
 
 private:
+    struct Record {
+        std::string text;
+        bool to_terminal = false;
+        bool to_file = false;
+    };
+
+    // Caller holds mtx
+    void write_line(const std::string& msg, bool to_terminal, bool to_file) {
+        if(to_terminal) std::cout << msg << '\n';
+        if(to_file && file.is_open()) file << msg << '\n';
+    }
+
+    void run() {
+        Record rec;
+        uint64_t reported_drops = 0;
+        for(;;) {
+            bool stop = stopping.load();
+            std::unique_lock<std::mutex> lock(mtx);
+            uint64_t n = 0;
+            while(ring->try_pop(rec)) { write_line(rec.text, rec.to_terminal, rec.to_file); ++n; }
+            uint64_t drops = dropped_count.load(std::memory_order_relaxed);
+            if(drops != reported_drops) {
+                write_line("[WARN] DualLogger dropped " + std::to_string(drops - reported_drops) + " log records (ring full)", true, true);
+                reported_drops = drops;
+            }
+            if(n > 0 || flush_requested) {
+                std::cout.flush();
+                file.flush();
+            }
+            written += n;
+            flush_requested = false;
+            flushed_cv.notify_all();
+            if(stop) break; // stopping was seen before this final drain
+            wake.wait_for(lock, std::chrono::milliseconds(opts.flush_interval_ms),
+                          [&]{ return stopping.load() || flush_requested; });
+        }
+    }
+
+    Options opts;
     std::ofstream file;
     std::mutex mtx;
+    std::unique_ptr<MpscRing<Record>> ring;
+    std::thread writer;
+    std::condition_variable wake, flushed_cv;
+    std::atomic<bool> stopping{false};
+    std::atomic<uint64_t> pushed{0};
+    std::atomic<uint64_t> dropped_count{0};
+    uint64_t written = 0;       // guarded by mtx
+    bool flush_requested = false; // guarded by mtx
 };
@@ -0,0 +1,55 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Feature detector backends selectable with `processor.detector`. Every backend is a
+// cv::Feature2D, so the processor only calls detectAndCompute(); what differs is the
+// descriptor: SIFT (and AKAZE with a KAZE descriptor) produce float32 rows, ORB, BRISK
+// and AKAZE's default MLDB produce packed binary uint8 rows compared by Hamming distance.
+// The blob records which one it carries in its desc_type byte.
+//
+// Parameters come from `processor.detectors.<name>`; missing keys keep OpenCV's defaults.
+//   sift:  nfeatures, n_octave_layers, contrast_threshold, edge_threshold, sigma
+//   orb:   nfeatures, scale_factor, nlevels, edge_threshold, fast_threshold
+//   akaze: threshold, octaves, octave_layers, descriptor ("mldb" | "kaze")
+//   brisk: threshold, octaves, pattern_scale
+
+inline const std::vector<std::string>& detector_names() {
+    static const std::vector<std::string> names = {"sift", "orb", "akaze", "brisk"};
+    return names;
+}
+
+inline cv::Ptr<cv::Feature2D> create_detector(const std::string& name, const nlohmann::json& p = nlohmann::json::object()) {
+    if(name == "sift")
+        return cv::SIFT::create(p.value("nfeatures", 0), p.value("n_octave_layers", 3), p.value("contrast_threshold", 0.04),
+                                p.value("edge_threshold", 10.0), p.value("sigma", 1.6));
+    if(name == "orb")
+        return cv::ORB::create(p.value("nfeatures", 500), p.value("scale_factor", 1.2f), p.value("nlevels", 8),
+                               p.value("edge_threshold", 31), 0, 2, cv::ORB::HARRIS_SCORE, 31, p.value("fast_threshold", 20));
+    if(name == "akaze") {
+        std::string desc = p.value("descriptor", "mldb");
+        if(desc != "mldb" && desc != "kaze") throw std::runtime_error("akaze descriptor must be mldb or kaze, got " + desc);
+        return cv::AKAZE::create(desc == "mldb" ? cv::AKAZE::DESCRIPTOR_MLDB : cv::AKAZE::DESCRIPTOR_KAZE, 0, 3,
+                                 p.value("threshold", 0.001f), p.value("octaves", 4), p.value("octave_layers", 4));
+    }
+    if(name == "brisk")
+        return cv::BRISK::create(p.value("threshold", 30), p.value("octaves", 3), p.value("pattern_scale", 1.0f));
+    throw std::runtime_error("Unknown detector: " + name + " (sift | orb | akaze | brisk)");
+}
+
+// Parameters of the selected backend from the `processor` config section. The older
+// `processor.sift_nfeatures` still applies when the sift section does not set nfeatures.
+inline nlohmann::json detector_params(const nlohmann::json& processor) {
+    std::string name = processor.value("detector", "sift");
+    nlohmann::json params = processor.value("detectors", nlohmann::json::object()).value(name, nlohmann::json::object());
+    if(name == "sift" && !params.contains("nfeatures") && processor.contains("sift_nfeatures"))
+        params["nfeatures"] = processor["sift_nfeatures"];
+    return params;
+}
+
+inline cv::Ptr<cv::Feature2D> create_detector_from_config(const nlohmann::json& processor) {
+    return create_detector(processor.value("detector", "sift"), detector_params(processor));
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+// What the sender does with a new frame when downstream has no credit left
+enum class OverloadPolicy {
+    Block,      // wait for credit; the sender falls behind its schedule
+    DropOldest, // keep the newest `backlog` frames waiting, evict the oldest
+    DropNewest, // keep what is already waiting, drop the new frame
+    Sample      // while saturated keep only every Nth frame (queued like DropOldest)
+};
+
+inline OverloadPolicy parse_overload_policy(const std::string& s) {
+    if(s == "block") return OverloadPolicy::Block;
+    if(s == "drop-oldest") return OverloadPolicy::DropOldest;
+    if(s == "drop-newest") return OverloadPolicy::DropNewest;
+    if(s == "sample") return OverloadPolicy::Sample;
+    throw std::runtime_error("Unknown overload policy: " + s + " (block | drop-oldest | drop-newest | sample)");
+}
+
+inline const char* overload_policy_name(OverloadPolicy p) {
+    switch(p) {
+        case OverloadPolicy::Block: return "block";
+        case OverloadPolicy::DropOldest: return "drop-oldest";
+        case OverloadPolicy::DropNewest: return "drop-newest";
+        case OverloadPolicy::Sample: return "sample";
+    }
+    return "?";
+}
+
+// Credit messages on the processor -> generator channel: one little-endian u32 credit count
+constexpr size_t CREDIT_MSG_SIZE = 4;
+
+inline void encode_credit(uint32_t n, uint8_t* out) { std::memcpy(out, &n, CREDIT_MSG_SIZE); }
+
+inline uint32_t decode_credit(const void* data, size_t size) {
+    if(size != CREDIT_MSG_SIZE) return 0;
+    uint32_t n;
+    std::memcpy(&n, data, CREDIT_MSG_SIZE);
+    return n;
+}
+
+// Sender-side credit accounting. Each credit allows one frame downstream; the receiver
+// hands credits back as frames leave it, so frames in flight never exceed the credits it
+// granted. offer() a frame, then send whatever take_ready() returns. Frames that cannot
+// be sent yet wait in a small backlog governed by the OverloadPolicy.
+template <typename T>
+class CreditGate {
+public:
+    CreditGate(OverloadPolicy policy, size_t backlog, int sample_every, uint64_t max_credits)
+        : policy(policy), backlog_cap(backlog), sample_every(sample_every > 0 ? sample_every : 1), max_credits(max_credits) {}
+
+    // Credits beyond max_credits are discarded, so re-announced windows cannot pile up
+    void add_credits(uint64_t n) { credits_ = std::min(max_credits, credits_ + n); }
+
+    void offer(T frame) {
+        if(credits_ > waiting.size()) { // not saturated
+            saturated_seen = 0;
+            waiting.push_back(std::move(frame));
+            return;
+        }
+        switch(policy) {
+            case OverloadPolicy::Block:
+                waiting.push_back(std::move(frame));
+                break;
+            case OverloadPolicy::DropNewest:
+                if(waiting.size() < backlog_cap) waiting.push_back(std::move(frame));
+                else dropped_++;
+                break;
+            case OverloadPolicy::Sample:
+                if(saturated_seen++ % sample_every != 0) { dropped_++; break; }
+                [[fallthrough]];
+            case OverloadPolicy::DropOldest:
+                if(backlog_cap == 0) { dropped_++; break; }
+                if(waiting.size() >= backlog_cap) { waiting.pop_front(); dropped_++; }
+                waiting.push_back(std::move(frame));
+                break;
+        }
+    }
+
+    // Oldest waiting frame if a credit is available for it; consumes the credit
+    std::optional<T> take_ready() {
+        if(waiting.empty() || credits_ == 0) return std::nullopt;
+        credits_--;
+        T f = std::move(waiting.front());
+        waiting.pop_front();
+        return f;
+    }
+
+    // One credit for a frame that bypasses the backlog (a replay); false when none is left
+    bool take_credit() {
+        if(credits_ == 0) return false;
+        credits_--;
+        return true;
+    }
+
+    // Discard every waiting frame as dropped (the sender is done); returns how many
+    uint64_t drop_waiting() {
+        uint64_t n = waiting.size();
+        waiting.clear();
+        dropped_ += n;
+        return n;
+    }
+
+    bool has_waiting() const { return !waiting.empty(); }
+    uint64_t credits() const { return credits_; }
+    uint64_t dropped() const { return dropped_; }
+    OverloadPolicy overload_policy() const { return policy; }
+
+private:
+    OverloadPolicy policy;
+    size_t backlog_cap;
+    int sample_every;
+    uint64_t max_credits;
+    uint64_t credits_ = 0;
+    uint64_t dropped_ = 0;
+    uint64_t saturated_seen = 0;
+    std::deque<T> waiting;
+};
@@ -0,0 +1,181 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <random>
+#include <string>
+#include <string_view>
+#include "common/latency_trace.hpp"
+
+// 128-bit image id: 48 bits of Unix milliseconds followed by 80 random bits, so ids sort
+// by creation time. Printed as 32 lowercase hex digits, which is how it appears in the
+// database and in image file names.
+struct ImageId {
+    uint64_t hi = 0;
+    uint64_t lo = 0;
+
+    static ImageId generate() {
+        thread_local std::mt19937_64 rng(std::random_device{}() ^ (uint64_t(std::random_device{}()) << 32));
+        uint64_t ms = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+        return {(ms << 16) | (rng() & 0xffff), rng()};
+    }
+
+    // 32 hex digits into out, no terminator
+    void format(char* out) const {
+        static const char digits[] = "0123456789abcdef";
+        for(int i = 0; i < 16; ++i) {
+            out[i] = digits[(hi >> (60 - 4 * i)) & 0xf];
+            out[16 + i] = digits[(lo >> (60 - 4 * i)) & 0xf];
+        }
+    }
+
+    std::string to_string() const {
+        std::string s(32, '0');
+        format(&s[0]);
+        return s;
+    }
+
+    static bool parse(std::string_view s, ImageId& out) {
+        if(s.size() != 32) return false;
+        ImageId id;
+        for(size_t i = 0; i < 32; ++i) {
+            char c = s[i];
+            uint64_t v = c >= '0' && c <= '9' ? uint64_t(c - '0') : c >= 'a' && c <= 'f' ? uint64_t(c - 'a' + 10) : 16;
+            if(v == 16) return false;
+            uint64_t& half = i < 16 ? id.hi : id.lo;
+            half = (half << 4) | v;
+        }
+        out = id;
+        return true;
+    }
+
+    bool operator==(const ImageId& o) const { return hi == o.hi && lo == o.lo; }
+    bool operator!=(const ImageId& o) const { return !(*this == o); }
+};
+
+/*
+Frame header: first part of every generator -> processor -> logger message (little-endian,
+fixed layout, read in place). Replaces the per-frame JSON meta.
+    [0]   char[4]  magic        => "DISF"
+    [4]   uint16_t version      => FRAME_HEADER_VERSION, bumped on incompatible changes
+    [6]   uint16_t header_size  => where the extension starts; fields appended later only grow it
+    [8]   uint64_t id_hi, id_lo => ImageId
+    [24]  int64_t  timestamp_ns => capture time, Unix epoch
+    [32]  uint64_t seq
+    [40]  uint32_t width, height
+    [48]  uint32_t num_keypoints  (0 until the processor fills it in)
+    [52]  uint8_t  encoding       => FRAME_ENCODING_*
+    [53]  uint8_t  detector       => 1 + index into detector_names(), 0 = not detected yet
+    [54]  uint8_t  trace_points   => valid entries of trace[]
+    [55]  uint8_t  flags          => FRAME_FLAG_*
+    [56]  uint32_t ext_size       => bytes of the JSON extension after the header
+    [60]  uint32_t source         => id of the generator's replay log, 0 = seq not tracked
+    [64]  uint64_t trace[12]      => TraceStamps, 0 = not stamped
+    [160] ext_size bytes of JSON  => optional, for rare fields; forwarded untouched
+*/
+
+constexpr char FRAME_HEADER_MAGIC[4] = {'D', 'I', 'S', 'F'};
+constexpr uint16_t FRAME_HEADER_VERSION = 1;
+constexpr int FRAME_TRACE_SLOTS = 12;
+
+// Re-sent from the generator's replay log (same id, seq and capture time as the original)
+constexpr uint8_t FRAME_FLAG_REPLAY = 0x01;
+// Dropped by the processor on purpose (stale, undecodable): the image and keypoint parts
+// are empty and the logger counts the seq as given up rather than asking for a replay
+constexpr uint8_t FRAME_FLAG_DROPPED = 0x02;
+
+constexpr uint8_t FRAME_ENCODING_JPEG = 1;
+constexpr uint8_t FRAME_ENCODING_PNG = 2;
+
+inline const char* frame_encoding_name(uint8_t e) {
+    return e == FRAME_ENCODING_JPEG ? "jpg" : e == FRAME_ENCODING_PNG ? "png" : "unknown";
+}
+
+struct FrameHeader {
+    char magic[4] = {FRAME_HEADER_MAGIC[0], FRAME_HEADER_MAGIC[1], FRAME_HEADER_MAGIC[2], FRAME_HEADER_MAGIC[3]};
+    uint16_t version = FRAME_HEADER_VERSION;
+    uint16_t header_size = 160;
+    uint64_t id_hi = 0;
+    uint64_t id_lo = 0;
+    int64_t timestamp_ns = 0;
+    uint64_t seq = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t num_keypoints = 0;
+    uint8_t encoding = FRAME_ENCODING_JPEG;
+    uint8_t detector = 0;
+    uint8_t trace_points = 0;
+    uint8_t flags = 0;
+    uint32_t ext_size = 0;
+    uint32_t source = 0;
+    uint64_t trace[FRAME_TRACE_SLOTS] = {};
+
+    ImageId image_id() const { return {id_hi, id_lo}; }
+    void set_image_id(const ImageId& id) { id_hi = id.hi; id_lo = id.lo; }
+
+    void set_trace(const TraceStamps& t) {
+        trace_points = static_cast<uint8_t>(TRACE_NUM_POINTS);
+        for(int p = 0; p < TRACE_NUM_POINTS; ++p) trace[p] = t.ns[p];
+    }
+
+    // Entries past trace_points (a peer with fewer trace points) are left unstamped
+    TraceStamps trace_stamps() const {
+        TraceStamps t;
+        int n = std::min<int>(trace_points, TRACE_NUM_POINTS);
+        for(int p = 0; p < n; ++p) t.ns[p] = trace[p];
+        return t;
+    }
+
+    // Capture time as ISO 8601 UTC with milliseconds, e.g. 2024-05-01T12:00:00.123Z
+    std::string timestamp_iso8601() const {
+        std::time_t s = static_cast<std::time_t>(timestamp_ns / 1000000000);
+        std::tm tm{};
+        gmtime_r(&s, &tm);
+        char buf[32];
+        size_t n = std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+        std::snprintf(buf + n, sizeof(buf) - n, ".%03dZ", static_cast<int>(timestamp_ns / 1000000 % 1000));
+        return buf;
+    }
+};
+static_assert(sizeof(FrameHeader) == 160, "FrameHeader layout is part of the wire format");
+static_assert(offsetof(FrameHeader, trace) == 64, "FrameHeader layout is part of the wire format");
+static_assert(TRACE_NUM_POINTS <= FRAME_TRACE_SLOTS, "trace points do not fit the frame header");
+
+inline int64_t unix_ns() {
+    return static_cast<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+// Bytes of a header message carrying an extension of ext_size bytes
+inline size_t frame_header_wire_size(size_t ext_size) { return sizeof(FrameHeader) + ext_size; }
+
+// Write h and the extension to out (frame_header_wire_size(ext.size()) bytes); sets ext_size
+inline void write_frame_header(FrameHeader h, std::string_view ext, uint8_t* out) {
+    h.header_size = sizeof(FrameHeader);
+    h.ext_size = static_cast<uint32_t>(ext.size());
+    std::memcpy(out, &h, sizeof(h));
+    if(!ext.empty()) std::memcpy(out + sizeof(h), ext.data(), ext.size());
+}
+
+// Header at the start of a received message, validated. The header is returned in place
+// when the buffer is 8-byte aligned, otherwise copied into `scratch` (received ZMQ
+// messages can sit at any offset of a shared buffer). `ext` is set to the extension bytes
+// inside the message. nullptr when the message is not a frame header of a version this
+// build reads.
+inline const FrameHeader* read_frame_header(const void* data, size_t size, FrameHeader& scratch, std::string_view* ext = nullptr) {
+    if(size < sizeof(FrameHeader) || std::memcmp(data, FRAME_HEADER_MAGIC, 4) != 0) return nullptr;
+    const FrameHeader* h = reinterpret_cast<const FrameHeader*>(data);
+    if(reinterpret_cast<uintptr_t>(data) % alignof(FrameHeader) != 0) {
+        std::memcpy(&scratch, data, sizeof(scratch));
+        h = &scratch;
+    }
+    if(h->version != FRAME_HEADER_VERSION || h->header_size < sizeof(FrameHeader) ||
+       size < size_t(h->header_size) + h->ext_size) return nullptr;
+    if(ext) *ext = std::string_view(static_cast<const char*>(data) + h->header_size, h->ext_size);
+    return h;
+}
@@ -10,11 +10,16 @@
 #include <vector>
 #include <cstdint>
 #include <cstring>
+#include <algorithm>
+#include <limits>
 #include <opencv2/core.hpp>
 #include <opencv2/features2d.hpp>
+#include "common/descriptor_codec.hpp"
 
 namespace config {
-    nlohmann::json loadConfig(const std::string &path) {
+    constexpr const char *DEFAULT_CONFIG_PATH = "config/default_config.json";
+
+    inline nlohmann::json loadConfig(const std::string &path) {
         std::ifstream f(path);
         if (!f.is_open()) {
             throw std::runtime_error("Cannot open config file: " + path);
@@ -23,106 +28,307 @@ namespace config {
         f >> j;
         return j;
     }
-}
 
-inline std::string now_iso8601(){
-    using namespace std::chrono;
-    auto t = system_clock::now();
-    auto s = system_clock::to_time_t(t);
-    std::ostringstream oss;
-    oss << std::put_time(std::gmtime(&s), "%F%TZ");
-    return oss.str();
-}
+    // Command line of every binary: `--name value` options and bare `--flag`s anywhere, the rest
+    // positional. Flags must be listed for positional_args so they do not swallow the next word.
+    inline std::string option(int argc, char **argv, const std::string &name, const std::string &fallback = "") {
+        for(int i = 1; i + 1 < argc; ++i)
+            if(name == argv[i]) return argv[i + 1];
+        return fallback;
+    }
+
+    inline bool flag(int argc, char **argv, const std::string &name) {
+        for(int i = 1; i < argc; ++i)
+            if(name == argv[i]) return true;
+        return false;
+    }
+
+    inline std::vector<std::string> positional_args(int argc, char **argv, const std::vector<std::string> &flags = {}) {
+        std::vector<std::string> out;
+        for(int i = 1; i < argc; ++i) {
+            if(std::find(flags.begin(), flags.end(), argv[i]) != flags.end()) continue;
+            if(std::strncmp(argv[i], "--", 2) == 0) { ++i; continue; }
+            out.push_back(argv[i]);
+        }
+        return out;
+    }
 
-inline std::string gen_simple_id() {
-    // Quickly generate a psudo Unique ID UUID using timesptamp
-    static std::mt19937_64 rng(std::random_device{}());
-    uint64_t r = rng();
-    auto now = std::chrono::system_clock::now().time_since_epoch().count();
-    std::ostringstream oss;
-    oss <<std::hex << now << "- " << r;
-    return oss.str();
+    // The config file given with --config, or config/default_config.json
+    inline std::string config_path(int argc, char **argv) { return option(argc, argv, "--config", DEFAULT_CONFIG_PATH); }
+
+    // "a, b, c" for log lines
+    inline std::string join(const std::vector<std::string> &items) {
+        std::string out;
+        for(const auto &i : items) out += (out.empty() ? "" : ", ") + i;
+        return out;
+    }
+
+    // Endpoints from section[key], a string or a list of strings (tcp://, ipc://, inproc://, or
+    // shm://<name> for a shared-memory ring, see shm_transport.hpp).
+    // Configs without the key fall back to tcp://127.0.0.1:<section[port_key]>.
+    inline std::vector<std::string> endpoints(const nlohmann::json &section, const std::string &key, const std::string &port_key) {
+        std::vector<std::string> out;
+        if(!section.contains(key)) {
+            out.push_back("tcp://127.0.0.1:" + std::to_string(section.at(port_key).get<int>()));
+            return out;
+        }
+        const auto &v = section.at(key);
+        if(v.is_string()) out.push_back(v.get<std::string>());
+        else for(const auto &e : v) out.push_back(e.get<std::string>());
+        if(out.empty()) throw std::runtime_error("Empty endpoint list: " + key);
+        for(const auto &e : out)
+            if(e.rfind("tcp://", 0) != 0 && e.rfind("ipc://", 0) != 0 && e.rfind("inproc://", 0) != 0 &&
+               (e.rfind("shm://", 0) != 0 || e.size() == 6 || e.find('/', 6) != std::string::npos))
+                throw std::runtime_error("Unsupported endpoint " + e + " in " + key + " (expected tcp://, ipc://, inproc:// or shm://<name>)");
+        return out;
+    }
+
+    // Removes the shm:// endpoint from `eps` and returns its ring name ("" when there is none).
+    // What is left are the ZMQ endpoints, used by peers on other hosts and as the fallback.
+    inline std::string take_shm_endpoint(std::vector<std::string> &eps) {
+        std::string name;
+        for(auto it = eps.begin(); it != eps.end();) {
+            if(it->rfind("shm://", 0) != 0) { ++it; continue; }
+            if(!name.empty()) throw std::runtime_error("Only one shm:// endpoint per list: " + join(eps));
+            name = it->substr(6);
+            it = eps.erase(it);
+        }
+        return name;
+    }
 }
 
 /*
-uint32_t N => NUmber of keypoints
-uint32_t D => Descriptor lenght per keypoints
-uint32_t desc_type => (0=float32 descriptor entries, 1 = uint8_t descriptor entries)
+Keypoint blob wire format (little-endian)
+
+Legacy layout (v1, read-only):
+    uint32_t N          => Number of keypoints
+    uint32_t D          => Descriptor length per keypoint
+    uint8_t  desc_type  => KP_DESC_FLOAT32 (0) = float32 descriptor entries, KP_DESC_UINT8 (1) = uint8_t entries
+    N x { x, y, size, angle, response (float32), octave, class_id (int32), D descriptor entries }
 
+Struct-of-arrays layout (v2, written by serialize_keypoints_and_descriptors):
+    [0]  uint32_t N
+    [4]  uint32_t D
+    [8]  uint8_t  layout       => KP_BLOB_SOA; a v1 blob holds its desc_type (0/1) in this byte
+    [9]  uint8_t  version      => KP_BLOB_VERSION
+    [10] uint8_t  desc_type    => same codes as v1, plus the compressed float encodings
+                                  KP_DESC_FLOAT16 (2) and KP_DESC_UINT8_SCALED (3)
+    [11] uint8_t  reserved
+    [12] uint32_t desc_offset  => start of the descriptor block
+    [16] x[N], y[N], size[N], angle[N], response[N] (float32), octave[N], class_id[N] (int32),
+         each section padded to KP_BLOB_SECTION_ALIGN bytes
+    KP_DESC_UINT8_SCALED only: float32 offset, float32 scale (value = offset + q * scale),
+         in a KP_BLOB_SECTION_ALIGN slot after the sections
+    [desc_offset] N*D descriptor entries, row-major, aligned to KP_BLOB_DESC_ALIGN bytes
 */
 
-inline std::vector<uint8_t> serialize_keypoints_and_descriptors(
+constexpr uint8_t KP_BLOB_SOA = 0x80;
+constexpr uint8_t KP_BLOB_VERSION = 2;
+constexpr size_t KP_BLOB_HEADER_SIZE = 16;
+constexpr size_t KP_BLOB_SECTION_ALIGN = 16;
+constexpr size_t KP_BLOB_DESC_ALIGN = 64;
+constexpr int KP_BLOB_NUM_SECTIONS = 7; // x, y, size, angle, response, octave, class_id
+
+// desc_type codes: float32 rows (SIFT, AKAZE/KAZE) or packed binary uint8 rows (ORB, BRISK, AKAZE/MLDB).
+// Float rows can instead be stored as half floats or as uint8 with a per-blob offset/scale;
+// readers turn both back into float32.
+constexpr uint8_t KP_DESC_FLOAT32 = 0;
+constexpr uint8_t KP_DESC_UINT8 = 1;
+constexpr uint8_t KP_DESC_FLOAT16 = 2;
+constexpr uint8_t KP_DESC_UINT8_SCALED = 3;
+
+enum KeypointSection { KP_X = 0, KP_Y, KP_SIZE, KP_ANGLE, KP_RESPONSE, KP_OCTAVE, KP_CLASS_ID };
+
+inline size_t kp_blob_align(size_t v, size_t a) { return (v + a - 1) / a * a; }
+
+inline size_t kp_desc_elem_size(uint8_t desc_type) {
+    return desc_type == KP_DESC_FLOAT32 ? 4u : desc_type == KP_DESC_FLOAT16 ? 2u : 1u;
+}
+
+// Type of the decoded descriptor matrix: everything but packed binary rows reads back as float
+inline int kp_desc_cv_type(uint8_t desc_type) { return desc_type == KP_DESC_UINT8 ? CV_8U : CV_32F; }
+
+inline bool kp_desc_is_encoded(uint8_t desc_type) { return desc_type == KP_DESC_FLOAT16 || desc_type == KP_DESC_UINT8_SCALED; }
+
+// `processor.descriptor_encoding`: how float descriptors are stored ("float32", "float16" or "uint8")
+inline uint8_t parse_descriptor_encoding(const std::string& name) {
+    if(name == "float32") return KP_DESC_FLOAT32;
+    if(name == "float16") return KP_DESC_FLOAT16;
+    if(name == "uint8") return KP_DESC_UINT8_SCALED;
+    throw std::runtime_error("Unknown descriptor_encoding: " + name + " (expected float32, float16 or uint8)");
+}
+
+// Byte offsets of every section of a v2 blob, derived from N, D and desc_type alone
+struct KeypointBlobLayout {
+    uint32_t N = 0;
+    uint32_t D = 0;
+    uint8_t desc_type = KP_DESC_FLOAT32;
+    size_t section[KP_BLOB_NUM_SECTIONS] = {};
+    size_t desc_params = 0; // offset/scale slot, KP_DESC_UINT8_SCALED only
+    size_t desc_offset = 0;
+    size_t total_size = 0;
+
+    KeypointBlobLayout() = default;
+    KeypointBlobLayout(uint32_t n, uint32_t d, uint8_t type) : N(n), D(d), desc_type(type) {
+        size_t off = KP_BLOB_HEADER_SIZE;
+        for(int s = 0; s < KP_BLOB_NUM_SECTIONS; ++s) {
+            section[s] = off;
+            off += kp_blob_align(size_t(N) * 4, KP_BLOB_SECTION_ALIGN);
+        }
+        if(desc_type == KP_DESC_UINT8_SCALED) {
+            desc_params = off;
+            off += KP_BLOB_SECTION_ALIGN;
+        }
+        size_t desc_bytes = size_t(N) * D * kp_desc_elem_size(desc_type);
+        desc_offset = desc_bytes ? kp_blob_align(off, KP_BLOB_DESC_ALIGN) : off;
+        total_size = desc_offset + desc_bytes;
+    }
+};
+
+// Descriptor matrix in a type the blob can carry: CV_32F and CV_8U as-is, anything else widened to float.
+// Float rows get `float_encoding` as their desc_type; binary rows are never re-encoded.
+inline cv::Mat kp_blob_descriptors(const cv::Mat& descriptors, uint8_t& desc_type, uint8_t float_encoding = KP_DESC_FLOAT32) {
+    desc_type = KP_DESC_FLOAT32;
+    if(descriptors.empty()) return descriptors;
+    cv::Mat d = descriptors;
+    if(d.depth() == CV_8U) { desc_type = KP_DESC_UINT8; return d; }
+    if(d.depth() != CV_32F) d.convertTo(d, CV_32F);
+    desc_type = float_encoding;
+    return d;
+}
+
+inline KeypointBlobLayout keypoint_blob_layout(const std::vector<cv::KeyPoint>& kps, const cv::Mat& descriptors,
+                                               uint8_t float_encoding = KP_DESC_FLOAT32) {
+    uint8_t desc_type = KP_DESC_FLOAT32;
+    kp_blob_descriptors(descriptors, desc_type, float_encoding);
+    uint32_t D = descriptors.empty() ? 0 : static_cast<uint32_t>(descriptors.cols);
+    return KeypointBlobLayout(static_cast<uint32_t>(kps.size()), D, desc_type);
+}
+
+// Write a v2 blob into `out`, which must hold keypoint_blob_layout(kps, descriptors, float_encoding).total_size
+// bytes. Lets callers serialize straight into a preallocated zmq::message_t.
+inline void serialize_keypoints_and_descriptors_into(
     const std::vector<cv::KeyPoint>& kps,
-    const cv::Mat& descriptors){
-        std::vector<uint8_t> out;
-        uint32_t N = static_cast<uint32_t>(kps.size());
-        uint32_t D = 0;
-        uint8_t desc_type = 0; // 0=> float32, 1=>uint8
-        if(!descriptors.empty()){
-            D = static_cast<uint32_t>(descriptors.cols);
-            if(descriptors.type()==CV_32F) desc_type=0;
-            else desc_type = 1; // CV_8U or others -> store as bytes
+    const cv::Mat& descriptors,
+    uint8_t* out,
+    uint8_t float_encoding = KP_DESC_FLOAT32){
+        uint8_t desc_type = KP_DESC_FLOAT32;
+        cv::Mat desc = kp_blob_descriptors(descriptors, desc_type, float_encoding);
+        uint32_t D = desc.empty() ? 0 : static_cast<uint32_t>(desc.cols);
+        KeypointBlobLayout L(static_cast<uint32_t>(kps.size()), D, desc_type);
+
+        // header + zeroed padding
+        std::memset(out, 0, L.total_size - size_t(L.N) * L.D * kp_desc_elem_size(desc_type));
+        uint32_t desc_offset = static_cast<uint32_t>(L.desc_offset);
+        std::memcpy(out + 0, &L.N, 4);
+        std::memcpy(out + 4, &L.D, 4);
+        out[8] = KP_BLOB_SOA;
+        out[9] = KP_BLOB_VERSION;
+        out[10] = desc_type;
+        std::memcpy(out + 12, &desc_offset, 4);
+
+        // scatter keypoint fields into their sections
+        uint8_t* xs = out + L.section[KP_X];
+        uint8_t* ys = out + L.section[KP_Y];
+        uint8_t* sizes = out + L.section[KP_SIZE];
+        uint8_t* angles = out + L.section[KP_ANGLE];
+        uint8_t* responses = out + L.section[KP_RESPONSE];
+        uint8_t* octaves = out + L.section[KP_OCTAVE];
+        uint8_t* class_ids = out + L.section[KP_CLASS_ID];
+        for(uint32_t i = 0; i < L.N; ++i){
+            const cv::KeyPoint& kp = kps[i];
+            int32_t octave = kp.octave, class_id = kp.class_id;
+            std::memcpy(xs + 4*i, &kp.pt.x, 4);
+            std::memcpy(ys + 4*i, &kp.pt.y, 4);
+            std::memcpy(sizes + 4*i, &kp.size, 4);
+            std::memcpy(angles + 4*i, &kp.angle, 4);
+            std::memcpy(responses + 4*i, &kp.response, 4);
+            std::memcpy(octaves + 4*i, &octave, 4);
+            std::memcpy(class_ids + 4*i, &class_id, 4);
         }
 
-        // reserve approximate size
-        size_t per_kp_meta = 4*5 + 4 + 4; //x,y,size, angle, response (4 bytes each) + octave (int32) + calss_id(int32)
-        size_t desc_bytes_per = (desc_type==0 ? 4u:1u)*(D?D:0u);
-        out.reserve(8 + N * (per_kp_meta + desc_bytes_per));
-
-        // append N (uint32)
-        uint32_t tmp32 = N;
-        out.insert(out.end(), reinterpret_cast<uint8_t*>(&tmp32), reinterpret_cast<uint8_t*>(&tmp32) + sizeof(uint32_t));
-
-        // append D
-        tmp32 = D;
-        out.insert(out.end(),reinterpret_cast<uint8_t*>(&tmp32), reinterpret_cast<uint8_t*>(&tmp32) + sizeof(uint32_t));
-
-        // append desc_type
-        out.push_back(desc_type);
-
-        //for each keypoint
-        for(uint32_t i=0;i<N;i++){
-            const cv::KeyPoint &kp = kps[i];
-            float fx = kp.pt.x;
-            float fy = kp.pt.y;
-            float fsize = kp.size;
-            float fangle = kp.angle;
-            float fresponse = kp.response;
-            int32_t octave = kp.octave;
-            int32_t class_id = kp.class_id;
-
-            out.insert(out.end(), reinterpret_cast<uint8_t*>(&fx), reinterpret_cast<uint8_t*>(&fx) + sizeof(float));
-            out.insert(out.end(), reinterpret_cast<uint8_t*>(&fy), reinterpret_cast<uint8_t*>(&fy) + sizeof(float));
-            out.insert(out.end(), reinterpret_cast<uint8_t*>(&fsize), reinterpret_cast<uint8_t*>(&fsize) + sizeof(float));
-            out.insert(out.end(), reinterpret_cast<uint8_t*>(&fangle), reinterpret_cast<uint8_t*>(&fangle) + sizeof(float));
-            out.insert(out.end(), reinterpret_cast<uint8_t*>(&fresponse), reinterpret_cast<uint8_t*>(&fresponse) + sizeof(float));
-            out.insert(out.end(), reinterpret_cast<uint8_t*>(&octave), reinterpret_cast<uint8_t*>(&octave) + sizeof(int32_t));
-            out.insert(out.end(), reinterpret_cast<uint8_t*>(&class_id), reinterpret_cast<uint8_t*>(&class_id) + sizeof(int32_t));
-
-            //descriptors
-            if(D>0){
-                if(desc_type==0){
-                    // float descriptors expected (CV_32F)
-                    const float* row = descriptors.ptr<float>(i);
-                    for(uint32_t di=0; di<D; ++di){
-                        float v = row[di];
-                        out.insert(out.end(), reinterpret_cast<uint8_t*>(&v), reinterpret_cast<uint8_t*>(&v) + sizeof(float));
-                    }
-                }else {
-                    const uint8_t* row = descriptors.ptr<uint8_t>(i);
-                    out.insert(out.end(), row, row + D);
-                }
+        // descriptor block: one copy (or conversion) when the matrix is continuous, one per row otherwise
+        if(L.N > 0 && D > 0){
+            size_t row_bytes = size_t(D) * kp_desc_elem_size(desc_type);
+            uint8_t* dst = out + L.desc_offset;
+            uint32_t rows = std::min<uint32_t>(L.N, static_cast<uint32_t>(desc.rows));
+            if(desc_type == KP_DESC_UINT8_SCALED && !desc.isContinuous()) desc = desc.clone(); // one range for the block
+            Uint8Scale scale;
+            if(desc_type == KP_DESC_UINT8_SCALED) {
+                scale = choose_uint8_scale(desc.ptr<float>(0), size_t(rows) * D);
+                std::memcpy(out + L.desc_params, &scale.offset, 4);
+                std::memcpy(out + L.desc_params + 4, &scale.scale, 4);
             }
+            auto put = [&](uint8_t* to, const uint8_t* from, size_t n){ // n rows
+                if(desc_type == KP_DESC_FLOAT16)
+                    encode_float16(reinterpret_cast<const float*>(from), reinterpret_cast<uint16_t*>(to), n * D);
+                else if(desc_type == KP_DESC_UINT8_SCALED) encode_uint8(reinterpret_cast<const float*>(from), to, n * D, scale);
+                else std::memcpy(to, from, n * row_bytes);
+            };
+            if(desc.isContinuous()) put(dst, desc.ptr<uint8_t>(0), rows);
+            else for(uint32_t r = 0; r < rows; ++r) put(dst + r * row_bytes, desc.ptr<uint8_t>(r), 1);
+            if(rows < L.N) std::memset(dst + rows * row_bytes, 0, (L.N - rows) * row_bytes);
+        }
+}
+
+inline std::vector<uint8_t> serialize_keypoints_and_descriptors(
+    const std::vector<cv::KeyPoint>& kps,
+    const cv::Mat& descriptors,
+    uint8_t float_encoding = KP_DESC_FLOAT32){
+        std::vector<uint8_t> out(keypoint_blob_layout(kps, descriptors, float_encoding).total_size);
+        serialize_keypoints_and_descriptors_into(kps, descriptors, out.data(), float_encoding);
+        return out;
+}
+
+// Parse and validate the header of a v2 blob; false for v1 blobs or truncated data
+inline bool read_keypoint_blob_layout(const uint8_t* p, size_t bytes, KeypointBlobLayout& L){
+    if(bytes < KP_BLOB_HEADER_SIZE || p[8] != KP_BLOB_SOA || p[9] != KP_BLOB_VERSION) return false;
+    uint32_t N = 0, D = 0, desc_offset = 0;
+    std::memcpy(&N, p + 0, 4);
+    std::memcpy(&D, p + 4, 4);
+    std::memcpy(&desc_offset, p + 12, 4);
+    if(p[10] > KP_DESC_UINT8_SCALED) return false;
+    L = KeypointBlobLayout(N, D, p[10]);
+    return L.desc_offset == desc_offset && L.total_size <= bytes;
+}
 
+inline Uint8Scale read_uint8_scale(const uint8_t* p, const KeypointBlobLayout& L){
+    Uint8Scale s;
+    std::memcpy(&s.offset, p + L.desc_params, 4);
+    std::memcpy(&s.scale, p + L.desc_params + 4, 4);
+    return s;
+}
+
+// Decode `rows` descriptor rows starting at `row` of an encoded (or plain) v2 block into `dst`
+inline void decode_keypoint_descriptors(const uint8_t* p, const KeypointBlobLayout& L, uint32_t row, uint32_t rows, uint8_t* dst){
+    size_t n = size_t(rows) * L.D;
+    const uint8_t* src = p + L.desc_offset + size_t(row) * L.D * kp_desc_elem_size(L.desc_type);
+    if(L.desc_type == KP_DESC_FLOAT16) {
+        if(reinterpret_cast<uintptr_t>(src) % 2 == 0) return decode_float16(reinterpret_cast<const uint16_t*>(src), reinterpret_cast<float*>(dst), n);
+        for(size_t i = 0; i < n; ++i) { // blob at an odd address
+            uint16_t h;
+            std::memcpy(&h, src + 2 * i, 2);
+            reinterpret_cast<float*>(dst)[i] = half_to_float(h);
         }
+    }
+    else if(L.desc_type == KP_DESC_UINT8_SCALED) decode_uint8(src, reinterpret_cast<float*>(dst), n, read_uint8_scale(p, L));
+    else std::memcpy(dst, src, n * kp_desc_elem_size(L.desc_type));
+}
 
-    return out;
+// Descriptor block of a v2 blob as a cv::Mat header over the blob memory (no copy).
+// The blob must outlive the returned Mat. Returns an empty Mat for v1 blobs, blobs without
+// descriptors, compressed blocks (see LazyKeypointDescriptors), or when the block is not
+// suitably aligned in memory to be viewed in place.
+inline cv::Mat wrap_keypoint_descriptors(const uint8_t* p, size_t bytes){
+    KeypointBlobLayout L;
+    if(!read_keypoint_blob_layout(p, bytes, L) || L.N == 0 || L.D == 0 || kp_desc_is_encoded(L.desc_type)) return cv::Mat();
+    const uint8_t* block = p + L.desc_offset;
+    if(reinterpret_cast<uintptr_t>(block) % kp_desc_elem_size(L.desc_type) != 0) return cv::Mat();
+    return cv::Mat((int)L.N, (int)L.D, kp_desc_cv_type(L.desc_type), const_cast<uint8_t*>(block));
 }
 
-// minimal deserializer: returns pair of keypoints vector and descriptors Mat
-inline std::pair<std::vector<cv::KeyPoint>, cv::Mat> deserialize_keypoints_and_descriptors(const std::vector<uint8_t>& blob){
-    const uint8_t* p = blob.data();
-    size_t bytes = blob.size();
+// v1 reader, kept so blobs already stored in SQLite stay readable
+inline std::pair<std::vector<cv::KeyPoint>, cv::Mat> deserialize_legacy_keypoints_and_descriptors(const uint8_t* p, size_t bytes){
     size_t offset = 0;
     if(bytes < 9) return {{}, cv::Mat()}; // too small
 
@@ -150,6 +356,7 @@ inline std::pair<std::vector<cv::KeyPoint>, cv::Mat> deserialize_keypoints_and_d
     if(!read_u32(D)) return {{}, cv::Mat()};
     if(offset + 1 > bytes) return {{}, cv::Mat()};
     uint8_t desc_type = p[offset]; offset += 1;
+    if(desc_type != KP_DESC_FLOAT32 && desc_type != KP_DESC_UINT8) return {{}, cv::Mat()};
 
     std::vector<cv::KeyPoint> kps;
     kps.reserve(N);
@@ -157,8 +364,7 @@ inline std::pair<std::vector<cv::KeyPoint>, cv::Mat> deserialize_keypoints_and_d
     // prepare descriptor matrix
     cv::Mat descriptors;
     if(N>0 && D>0){
-        if(desc_type==0) descriptors.create((int)N, (int)D, CV_32F);
-        else descriptors.create((int)N, (int)D, CV_8U);
+        descriptors.create((int)N, (int)D, kp_desc_cv_type(desc_type));
     }
 
     for(uint32_t i=0;i<N;++i){
@@ -176,23 +382,214 @@ inline std::pair<std::vector<cv::KeyPoint>, cv::Mat> deserialize_keypoints_and_d
         kps.push_back(kp);
 
         if(D>0){
-            if(desc_type==0){
-                // float
-                float* row = descriptors.ptr<float>(i);
-                for(uint32_t di=0; di<D; ++di){
-                    float v;
-                    if(!read_f32(v)) break;
-                    row[di] = v;
-                }
-            } else {
-                uint8_t* row = descriptors.ptr<uint8_t>(i);
-                if(offset + D > bytes) break;
-                std::memcpy(row, p + offset, D);
-                offset += D;
-            }
+            size_t row_bytes = size_t(D) * kp_desc_elem_size(desc_type);
+            if(offset + row_bytes > bytes) break;
+            std::memcpy(descriptors.ptr<uint8_t>(i), p + offset, row_bytes);
+            offset += row_bytes;
         }
     }
 
     return {kps, descriptors};
 }
 
+// Deserializer for both layouts: returns pair of keypoints vector and an owning descriptors Mat.
+// Readers that only need some fields, rows or keypoints should use KeypointBlobView instead.
+inline std::pair<std::vector<cv::KeyPoint>, cv::Mat> deserialize_keypoints_and_descriptors(const uint8_t* p, size_t bytes){
+    if(bytes < 9) return {{}, cv::Mat()}; // too small
+    if(p[8] != KP_BLOB_SOA) return deserialize_legacy_keypoints_and_descriptors(p, bytes);
+
+    KeypointBlobLayout L;
+    if(!read_keypoint_blob_layout(p, bytes, L)) return {{}, cv::Mat()};
+
+    auto f32 = [&](int s, uint32_t i){ float v; std::memcpy(&v, p + L.section[s] + 4*i, 4); return v; };
+    auto i32 = [&](int s, uint32_t i){ int32_t v; std::memcpy(&v, p + L.section[s] + 4*i, 4); return v; };
+
+    std::vector<cv::KeyPoint> kps(L.N);
+    for(uint32_t i = 0; i < L.N; ++i){
+        kps[i] = cv::KeyPoint(cv::Point2f(f32(KP_X, i), f32(KP_Y, i)), f32(KP_SIZE, i), f32(KP_ANGLE, i),
+                              f32(KP_RESPONSE, i), i32(KP_OCTAVE, i), i32(KP_CLASS_ID, i));
+    }
+
+    cv::Mat descriptors;
+    if(L.N > 0 && L.D > 0){
+        descriptors.create((int)L.N, (int)L.D, kp_desc_cv_type(L.desc_type));
+        decode_keypoint_descriptors(p, L, 0, L.N, descriptors.ptr<uint8_t>(0));
+    }
+    return {kps, descriptors};
+}
+
+inline std::pair<std::vector<cv::KeyPoint>, cv::Mat> deserialize_keypoints_and_descriptors(const std::vector<uint8_t>& blob){
+    return deserialize_keypoints_and_descriptors(blob.data(), blob.size());
+}
+
+// Bit k of the result is set when lo <= v < hi for entry begin + k of a float32 section,
+// for n <= 64 entries. NaN never matches.
+inline uint64_t kp_range_mask_scalar(const uint8_t* section, uint32_t begin, uint32_t n, float lo, float hi){
+    uint64_t bits = 0;
+    for(uint32_t k = 0; k < n; ++k){
+        float v;
+        std::memcpy(&v, section + 4 * (size_t(begin) + k), 4);
+        if(v >= lo && v < hi) bits |= uint64_t(1) << k;
+    }
+    return bits;
+}
+
+#ifdef DESCRIPTOR_MATCHER_X86
+__attribute__((target("avx2"))) inline uint64_t kp_range_mask_avx2(const uint8_t* section, uint32_t begin, uint32_t n, float lo, float hi){
+    const __m256 vlo = _mm256_set1_ps(lo), vhi = _mm256_set1_ps(hi);
+    const float* v = reinterpret_cast<const float*>(section) + begin; // loadu: any alignment
+    uint64_t bits = 0;
+    uint32_t k = 0;
+    for(; k + 8 <= n; k += 8){
+        __m256 x = _mm256_loadu_ps(v + k);
+        __m256 in = _mm256_and_ps(_mm256_cmp_ps(x, vlo, _CMP_GE_OQ), _mm256_cmp_ps(x, vhi, _CMP_LT_OQ));
+        bits |= uint64_t(static_cast<uint32_t>(_mm256_movemask_ps(in))) << k;
+    }
+    if(k < n) bits |= kp_range_mask_scalar(section, begin + k, n - k, lo, hi) << k;
+    return bits;
+}
+#endif
+
+inline uint64_t kp_range_mask(const uint8_t* section, uint32_t begin, uint32_t n, float lo, float hi, SimdLevel simd){
+#ifdef DESCRIPTOR_MATCHER_X86
+    if(simd != SimdLevel::Scalar) return kp_range_mask_avx2(section, begin, n, lo, hi);
+#endif
+    (void)simd;
+    return kp_range_mask_scalar(section, begin, n, lo, hi);
+}
+
+// Read-only view of a v2 blob where it lies (a zmq::message_t, an SQLite column, an mmap):
+// random access to keypoint i and descriptor row i, and filters that scan the SoA sections
+// 64 keypoints at a time without allocating. Nothing is copied or decoded up front; the
+// memory must outlive the view. v1 blobs are not viewable (open() returns false).
+class KeypointBlobView {
+public:
+    KeypointBlobView() = default;
+    KeypointBlobView(const uint8_t* blob, size_t bytes) { open(blob, bytes); }
+
+    bool open(const uint8_t* blob, size_t bytes){
+        p = read_keypoint_blob_layout(blob, bytes, L) ? blob : nullptr;
+        if(!p) L = KeypointBlobLayout();
+        return p != nullptr;
+    }
+
+    bool valid() const { return p != nullptr; }
+    const uint8_t* data() const { return p; }
+    uint32_t size() const { return L.N; }
+    uint32_t descriptor_cols() const { return L.D; }
+    uint8_t desc_type() const { return L.desc_type; }
+    const KeypointBlobLayout& layout() const { return L; }
+
+    float x(uint32_t i) const { return f32(KP_X, i); }
+    float y(uint32_t i) const { return f32(KP_Y, i); }
+    float kp_size(uint32_t i) const { return f32(KP_SIZE, i); }
+    float angle(uint32_t i) const { return f32(KP_ANGLE, i); }
+    float response(uint32_t i) const { return f32(KP_RESPONSE, i); }
+    int32_t octave(uint32_t i) const { return i32(KP_OCTAVE, i); }
+    int32_t class_id(uint32_t i) const { return i32(KP_CLASS_ID, i); }
+
+    cv::KeyPoint keypoint(uint32_t i) const {
+        return cv::KeyPoint(cv::Point2f(x(i), y(i)), kp_size(i), angle(i), response(i), octave(i), class_id(i));
+    }
+
+    // Descriptor row i as stored (float32, binary, float16 or uint8 entries)
+    const uint8_t* descriptor_data(uint32_t i) const { return p + L.desc_offset + size_t(i) * stored_row_bytes(); }
+    size_t stored_row_bytes() const { return size_t(L.D) * kp_desc_elem_size(L.desc_type); }
+    // Bytes of a decoded row: float32 for float descriptors, the packed bytes for binary ones
+    size_t row_bytes() const { return size_t(L.D) * (L.desc_type == KP_DESC_UINT8 ? 1 : 4); }
+    // Decode row i into dst (row_bytes() bytes)
+    void descriptor(uint32_t i, void* dst) const { decode_keypoint_descriptors(p, L, i, 1, static_cast<uint8_t*>(dst)); }
+    // The whole block as a cv::Mat over the blob (see wrap_keypoint_descriptors); empty for compressed blocks
+    cv::Mat descriptors() const { return valid() ? wrap_keypoint_descriptors(p, L.total_size) : cv::Mat(); }
+
+    // Calls fn(i) for every keypoint with lo <= field < hi, in index order; returns the count.
+    // field is one of the float sections (KP_X .. KP_RESPONSE).
+    template<class Fn>
+    size_t for_each_in_range(KeypointSection field, float lo, float hi, Fn&& fn, SimdLevel simd = detect_simd_level()) const {
+        return scan([&](uint32_t b, uint32_t n){ return kp_range_mask(p + L.section[field], b, n, lo, hi, simd); }, fn);
+    }
+
+    template<class Fn>
+    size_t for_each_with_response(float min_response, Fn&& fn, SimdLevel simd = detect_simd_level()) const {
+        return for_each_in_range(KP_RESPONSE, min_response, std::numeric_limits<float>::infinity(), fn, simd);
+    }
+
+    // Keypoints inside roi, with cv::Rect2f::contains semantics (right and bottom edges excluded)
+    template<class Fn>
+    size_t for_each_in_roi(const cv::Rect2f& roi, Fn&& fn, SimdLevel simd = detect_simd_level()) const {
+        return scan([&](uint32_t b, uint32_t n){
+            return kp_range_mask(p + L.section[KP_X], b, n, roi.x, roi.x + roi.width, simd) &
+                   kp_range_mask(p + L.section[KP_Y], b, n, roi.y, roi.y + roi.height, simd);
+        }, fn);
+    }
+
+    // Any predicate over (view, i); scalar
+    template<class Pred, class Fn>
+    size_t for_each_where(Pred&& pred, Fn&& fn) const {
+        size_t count = 0;
+        for(uint32_t i = 0; i < L.N; ++i) if(pred(*this, i)) { fn(i); ++count; }
+        return count;
+    }
+
+private:
+    float f32(int s, uint32_t i) const { float v; std::memcpy(&v, p + L.section[s] + 4 * size_t(i), 4); return v; }
+    int32_t i32(int s, uint32_t i) const { int32_t v; std::memcpy(&v, p + L.section[s] + 4 * size_t(i), 4); return v; }
+
+    template<class Mask, class Fn>
+    size_t scan(Mask&& mask, Fn& fn) const {
+        size_t count = 0;
+        for(uint32_t b = 0; b < L.N; b += 64){
+            for(uint64_t bits = mask(b, std::min<uint32_t>(64, L.N - b)); bits; bits &= bits - 1){
+                fn(b + static_cast<uint32_t>(__builtin_ctzll(bits)));
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    const uint8_t* p = nullptr;
+    KeypointBlobLayout L;
+};
+
+// Descriptors of a v2 blob decoded on demand: plain blocks are viewed in place, compressed
+// ones are dequantized a row at a time (row()) or all at once on first use of mat(). The
+// blob must outlive the object.
+class LazyKeypointDescriptors {
+public:
+    bool open(const uint8_t* blob, size_t bytes){
+        decoded.release();
+        row_buf.clear();
+        return view.open(blob, bytes);
+    }
+
+    uint32_t rows() const { return view.size(); }
+    uint32_t cols() const { return view.descriptor_cols(); }
+    uint8_t desc_type() const { return view.desc_type(); }
+    int type() const { return kp_desc_cv_type(view.desc_type()); } // of the decoded rows
+    size_t stored_bytes() const { return size_t(rows()) * view.stored_row_bytes(); }
+
+    // Decoded row r; valid until the next call to row()
+    const uint8_t* row(uint32_t r){
+        if(!decoded.empty()) return decoded.ptr<uint8_t>(static_cast<int>(r));
+        row_buf.resize(view.row_bytes());
+        view.descriptor(r, row_buf.data());
+        return row_buf.data();
+    }
+
+    // The whole block, decoded once and cached
+    const cv::Mat& mat(){
+        if(decoded.empty() && rows() && cols()) {
+            decoded = view.descriptors();
+            if(decoded.empty()) {
+                decoded.create((int)rows(), (int)cols(), type());
+                decode_keypoint_descriptors(view.data(), view.layout(), 0, rows(), decoded.ptr<uint8_t>(0));
+            }
+        }
+        return decoded;
+    }
+
+private:
+    KeypointBlobView view;
+    cv::Mat decoded;
+    std::vector<uint8_t> row_buf;
+};
@@ -0,0 +1,198 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+// Monotonic clock in nanoseconds. steady_clock is CLOCK_MONOTONIC on Linux, which all
+// processes on one host share, so stamps from different binaries can be subtracted.
+inline uint64_t mono_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Stage boundaries a frame is stamped at, in pipeline order
+enum TracePoint : uint8_t {
+    GEN_SEND,
+    PROC_RECV,
+    PROC_DECODE_START, PROC_DECODE_END,
+    PROC_DETECT_START, PROC_DETECT_END,
+    PROC_SERIALIZE_START, PROC_SERIALIZE_END,
+    PROC_SEND,
+    LOG_RECV,
+    LOG_STORED,    // image durably written
+    LOG_COMMITTED, // row committed to SQLite
+    TRACE_NUM_POINTS
+};
+
+inline const char* trace_point_name(TracePoint p) {
+    static const char* names[TRACE_NUM_POINTS] = {
+        "gen_send", "proc_recv", "proc_decode_start", "proc_decode_end", "proc_detect_start", "proc_detect_end",
+        "proc_serialize_start", "proc_serialize_end", "proc_send", "log_recv", "log_stored", "log_committed"};
+    return names[p];
+}
+
+// Per-frame stamps; 0 = not stamped. Travels in the binary frame header (FrameHeader::trace);
+// the JSON form {"gen_send": ns, ...} is what the logger stores per row.
+struct TraceStamps {
+    std::array<uint64_t, TRACE_NUM_POINTS> ns{};
+
+    void stamp(TracePoint p) { ns[p] = mono_ns(); }
+    bool has(TracePoint p) const { return ns[p] != 0; }
+
+    nlohmann::json to_json() const {
+        nlohmann::json j = nlohmann::json::object();
+        for(int p = 0; p < TRACE_NUM_POINTS; ++p)
+            if(ns[p]) j[trace_point_name(static_cast<TracePoint>(p))] = ns[p];
+        return j;
+    }
+
+    // Reads {"trace": {...}} as written by to_json(); unknown or missing entries are left unstamped
+    static TraceStamps from_meta(const nlohmann::json& meta) {
+        TraceStamps t;
+        auto it = meta.find("trace");
+        if(it == meta.end() || !it->is_object()) return t;
+        for(int p = 0; p < TRACE_NUM_POINTS; ++p) {
+            auto v = it->find(trace_point_name(static_cast<TracePoint>(p)));
+            if(v != it->end() && v->is_number_unsigned()) t.ns[p] = v->get<uint64_t>();
+        }
+        return t;
+    }
+};
+
+// HDR-style histogram: log-linear buckets with 2048 sub-buckets per power of two, so every
+// recorded value is kept to within 0.1% up to `max_value` (larger values are clamped).
+class LatencyHistogram {
+public:
+    explicit LatencyHistogram(uint64_t max_value = 3600ull * 1000000000ull) : max_value(max_value) {
+        int buckets = 1;
+        while((SUB_MASK << (buckets - 1)) < max_value) buckets++;
+        counts.assign(static_cast<size_t>(buckets + 1) << SUB_HALF_MAGNITUDE, 0);
+    }
+
+    void record(uint64_t v) {
+        v = std::min(v, max_value);
+        counts[index_of(v)]++;
+        if(total == 0 || v < min_seen) min_seen = v;
+        max_seen = std::max(max_seen, v);
+        sum += v;
+        total++;
+    }
+
+    // Smallest recorded value v such that p percent of all values are <= v (within bucket precision)
+    uint64_t percentile(double p) const {
+        if(total == 0) return 0;
+        uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p / 100.0 * total)));
+        uint64_t seen = 0;
+        for(size_t i = 0; i < counts.size(); ++i) {
+            seen += counts[i];
+            if(seen >= rank) return std::min(highest_equivalent(i), max_seen);
+        }
+        return max_seen;
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t min() const { return total ? min_seen : 0; }
+    uint64_t max() const { return max_seen; }
+    double mean() const { return total ? static_cast<double>(sum) / total : 0; }
+
+    void reset() {
+        std::fill(counts.begin(), counts.end(), 0);
+        total = sum = max_seen = min_seen = 0;
+    }
+
+private:
+    static constexpr int SUB_HALF_MAGNITUDE = 10;
+    static constexpr uint64_t SUB_MASK = (1ull << (SUB_HALF_MAGNITUDE + 1)) - 1;
+
+    // Bucket b >= 1 covers [1024 << b, 2048 << b) in steps of 1 << b; bucket 0 covers [0, 2048)
+    static size_t index_of(uint64_t v) {
+        int bucket = 63 - __builtin_clzll(v | SUB_MASK) - SUB_HALF_MAGNITUDE;
+        return (static_cast<size_t>(bucket) << SUB_HALF_MAGNITUDE) + static_cast<size_t>(v >> bucket);
+    }
+
+    static uint64_t highest_equivalent(size_t i) {
+        int bucket = i < (SUB_MASK + 1) ? 0 : static_cast<int>(i >> SUB_HALF_MAGNITUDE) - 1;
+        uint64_t sub = i - (static_cast<size_t>(bucket) << SUB_HALF_MAGNITUDE);
+        return (sub << bucket) + (1ull << bucket) - 1;
+    }
+
+    uint64_t max_value;
+    std::vector<uint64_t> counts;
+    uint64_t total = 0, sum = 0, min_seen = 0, max_seen = 0;
+};
+
+// One histogram per pipeline interval. Each interval is measured between two stamps and
+// skipped for frames missing either one. Thread-safe.
+class LatencyTracker {
+public:
+    struct Interval { const char* name; TracePoint from; TracePoint to; };
+
+    static const std::vector<Interval>& intervals() {
+        static const std::vector<Interval> list = {
+            {"gen_to_proc", GEN_SEND, PROC_RECV},
+            {"decode_queue", PROC_RECV, PROC_DECODE_START},
+            {"decode", PROC_DECODE_START, PROC_DECODE_END},
+            {"detect_queue", PROC_DECODE_END, PROC_DETECT_START},
+            {"detect", PROC_DETECT_START, PROC_DETECT_END},
+            {"serialize_queue", PROC_DETECT_END, PROC_SERIALIZE_START},
+            {"serialize", PROC_SERIALIZE_START, PROC_SERIALIZE_END},
+            {"reorder_send", PROC_SERIALIZE_END, PROC_SEND},
+            {"proc_to_log", PROC_SEND, LOG_RECV},
+            {"store_image", LOG_RECV, LOG_STORED},
+            {"db_commit", LOG_STORED, LOG_COMMITTED},
+            {"end_to_end", GEN_SEND, LOG_COMMITTED},
+        };
+        return list;
+    }
+
+    LatencyTracker() : histograms(intervals().size()) {}
+
+    void record(const TraceStamps& t) {
+        std::lock_guard<std::mutex> lock(mtx);
+        const auto& list = intervals();
+        for(size_t i = 0; i < list.size(); ++i) {
+            if(!t.has(list[i].from) || !t.has(list[i].to) || t.ns[list[i].to] < t.ns[list[i].from]) continue;
+            histograms[i].record(t.ns[list[i].to] - t.ns[list[i].from]);
+        }
+    }
+
+    // {"<interval>": {"count", "min_ns", "mean_ns", "p50_ns", "p99_ns", "p999_ns", "max_ns"}, ...}
+    nlohmann::json snapshot() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        nlohmann::json j = nlohmann::json::object();
+        const auto& list = intervals();
+        for(size_t i = 0; i < list.size(); ++i) {
+            const auto& h = histograms[i];
+            j[list[i].name] = {{"count", h.count()}, {"min_ns", h.min()}, {"mean_ns", h.mean()},
+                               {"p50_ns", h.percentile(50)}, {"p99_ns", h.percentile(99)},
+                               {"p999_ns", h.percentile(99.9)}, {"max_ns", h.max()}};
+        }
+        return j;
+    }
+
+    // "name p50/p99/p999 ms" for every interval that has data
+    std::string summary() const {
+        nlohmann::json s = snapshot();
+        std::string out;
+        char buf[128];
+        for(const auto& iv : intervals()) {
+            const auto& h = s[iv.name];
+            if(h["count"].get<uint64_t>() == 0) continue;
+            std::snprintf(buf, sizeof(buf), "%s%s %.2f/%.2f/%.2f ms", out.empty() ? "" : ", ", iv.name,
+                          h["p50_ns"].get<uint64_t>() / 1e6, h["p99_ns"].get<uint64_t>() / 1e6, h["p999_ns"].get<uint64_t>() / 1e6);
+            out += buf;
+        }
+        return out;
+    }
+
+private:
+    mutable std::mutex mtx;
+    std::vector<LatencyHistogram> histograms;
+};
@@ -0,0 +1,262 @@
+#pragma once
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Counters and histograms are split into cache-line sized shards; each thread always
+// updates the same shard with a relaxed atomic add, so hot loops never contend on a
+// cache line or take a lock. Reading sums the shards and only happens on a scrape.
+constexpr size_t METRIC_SHARDS = 16;
+
+inline size_t metric_shard() {
+    static std::atomic<size_t> next{0};
+    thread_local size_t shard = next.fetch_add(1, std::memory_order_relaxed) % METRIC_SHARDS;
+    return shard;
+}
+
+class Counter {
+public:
+    void inc(uint64_t n = 1) { shards[metric_shard()].v.fetch_add(n, std::memory_order_relaxed); }
+
+    uint64_t value() const {
+        uint64_t sum = 0;
+        for(const auto& s : shards) sum += s.v.load(std::memory_order_relaxed);
+        return sum;
+    }
+
+private:
+    struct alignas(64) Shard { std::atomic<uint64_t> v{0}; };
+    Shard shards[METRIC_SHARDS];
+};
+
+class Gauge {
+public:
+    void set(double v) { value_.store(v, std::memory_order_relaxed); }
+    double value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> value_{0};
+};
+
+// Prometheus histogram with fixed upper bounds. observe() touches one bucket and the
+// sum of the calling thread's shard.
+class Histogram {
+public:
+    explicit Histogram(std::vector<double> bounds) : bounds(std::move(bounds)) {
+        for(auto& s : shards) s.buckets = std::make_unique<std::atomic<uint64_t>[]>(this->bounds.size() + 1);
+    }
+
+    void observe(double v) {
+        size_t b = 0;
+        while(b < bounds.size() && v > bounds[b]) ++b;
+        Shard& s = shards[metric_shard()];
+        s.buckets[b].fetch_add(1, std::memory_order_relaxed);
+        double sum = s.sum.load(std::memory_order_relaxed);
+        while(!s.sum.compare_exchange_weak(sum, sum + v, std::memory_order_relaxed)) {}
+    }
+
+    const std::vector<double>& upper_bounds() const { return bounds; }
+
+    // Per-bucket (non-cumulative) counts; the last entry is the +Inf bucket
+    std::vector<uint64_t> bucket_counts() const {
+        std::vector<uint64_t> out(bounds.size() + 1, 0);
+        for(const auto& s : shards)
+            for(size_t b = 0; b < out.size(); ++b) out[b] += s.buckets[b].load(std::memory_order_relaxed);
+        return out;
+    }
+
+    double sum() const {
+        double total = 0;
+        for(const auto& s : shards) total += s.sum.load(std::memory_order_relaxed);
+        return total;
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+        std::atomic<double> sum{0};
+    };
+    std::vector<double> bounds;
+    Shard shards[METRIC_SHARDS];
+};
+
+// Bucket bounds growing by `factor` from `start`, e.g. exponential_buckets(1e-4, 2, 16)
+inline std::vector<double> exponential_buckets(double start, double factor, int count) {
+    std::vector<double> b;
+    for(int i = 0; i < count; ++i, start *= factor) b.push_back(start);
+    return b;
+}
+
+// Owns every metric of a process and renders them in the Prometheus text format.
+// `labels` is the inside of the braces, e.g. `stage="decode"`. Registration is meant for
+// startup; returned references stay valid for the registry's lifetime.
+class MetricsRegistry {
+public:
+    Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "") {
+        auto m = std::make_unique<Counter>();
+        Counter& ref = *m;
+        add(Entry{name, help, labels, "counter", std::move(m), nullptr, nullptr, nullptr});
+        return ref;
+    }
+
+    Gauge& gauge(const std::string& name, const std::string& help, const std::string& labels = "") {
+        auto m = std::make_unique<Gauge>();
+        Gauge& ref = *m;
+        add(Entry{name, help, labels, "gauge", nullptr, std::move(m), nullptr, nullptr});
+        return ref;
+    }
+
+    Histogram& histogram(const std::string& name, const std::string& help, std::vector<double> bounds, const std::string& labels = "") {
+        auto m = std::make_unique<Histogram>(std::move(bounds));
+        Histogram& ref = *m;
+        add(Entry{name, help, labels, "histogram", nullptr, nullptr, std::move(m), nullptr});
+        return ref;
+    }
+
+    // Value computed on every scrape, e.g. a queue depth; costs nothing between scrapes.
+    // `type` is "gauge" or "counter".
+    void callback(const std::string& name, const std::string& help, std::function<double()> fn,
+                  const std::string& labels = "", const std::string& type = "gauge") {
+        add(Entry{name, help, labels, type, nullptr, nullptr, nullptr, std::move(fn)});
+    }
+
+    std::string render() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        std::ostringstream out;
+        std::set<std::string> described;
+        for(const auto& e : entries) {
+            if(described.insert(e.name).second) {
+                out << "# HELP " << e.name << " " << e.help << "\n";
+                out << "# TYPE " << e.name << " " << e.type << "\n";
+            }
+            if(e.counter) out << e.name << braces(e.labels) << " " << e.counter->value() << "\n";
+            else if(e.gauge) out << e.name << braces(e.labels) << " " << e.gauge->value() << "\n";
+            else if(e.fn) out << e.name << braces(e.labels) << " " << e.fn() << "\n";
+            else if(e.histogram) {
+                auto counts = e.histogram->bucket_counts();
+                const auto& bounds = e.histogram->upper_bounds();
+                std::string sep = e.labels.empty() ? "" : e.labels + ",";
+                uint64_t cumulative = 0;
+                for(size_t b = 0; b < counts.size(); ++b) {
+                    cumulative += counts[b];
+                    std::ostringstream le;
+                    if(b < bounds.size()) le << bounds[b]; else le << "+Inf";
+                    out << e.name << "_bucket{" << sep << "le=\"" << le.str() << "\"} " << cumulative << "\n";
+                }
+                out << e.name << "_sum" << braces(e.labels) << " " << e.histogram->sum() << "\n";
+                out << e.name << "_count" << braces(e.labels) << " " << cumulative << "\n";
+            }
+        }
+        return out.str();
+    }
+
+private:
+    struct Entry {
+        std::string name, help, labels, type;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+        std::function<double()> fn;
+    };
+
+    static std::string braces(const std::string& labels) { return labels.empty() ? "" : "{" + labels + "}"; }
+
+    void add(Entry e) {
+        std::lock_guard<std::mutex> lock(mtx);
+        entries.push_back(std::move(e));
+    }
+
+    mutable std::mutex mtx;
+    std::vector<Entry> entries;
+};
+
+// Serves registry.render() over HTTP on 127.0.0.1:port (any path) from its own thread.
+// Port 0 picks a free port, see port().
+class MetricsServer {
+public:
+    MetricsServer(const MetricsRegistry& registry, int port) : registry(registry) {
+        fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if(fd < 0) throw std::runtime_error(std::string("metrics socket: ") + std::strerror(errno));
+        int one = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        socklen_t len = sizeof(addr);
+        if(::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(fd, 16) != 0 ||
+           ::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+            std::string err = std::strerror(errno);
+            ::close(fd);
+            throw std::runtime_error("metrics endpoint on port " + std::to_string(port) + ": " + err);
+        }
+        bound_port = ntohs(addr.sin_port);
+        server = std::thread([this]{ run(); });
+    }
+
+    ~MetricsServer() {
+        stop = true;
+        server.join();
+        ::close(fd);
+    }
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    int port() const { return bound_port; }
+
+private:
+    void run() {
+        while(!stop) {
+            pollfd p{fd, POLLIN, 0};
+            if(::poll(&p, 1, 200) <= 0) continue; // timeout so `stop` is noticed
+            int client = ::accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if(client < 0) continue;
+            serve(client);
+            ::close(client);
+        }
+    }
+
+    // Read the request head (contents are ignored) and answer with the current metrics
+    void serve(int client) {
+        char buf[1024];
+        std::string request;
+        pollfd p{client, POLLIN, 0};
+        while(request.find("\r\n\r\n") == std::string::npos && request.size() < 8192 && ::poll(&p, 1, 1000) > 0) {
+            ssize_t n = ::recv(client, buf, sizeof(buf), 0);
+            if(n <= 0) break;
+            request.append(buf, static_cast<size_t>(n));
+        }
+        std::string body = registry.render();
+        std::string response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                               std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+        size_t off = 0;
+        while(off < response.size()) {
+            ssize_t n = ::send(client, response.data() + off, response.size() - off, MSG_NOSIGNAL);
+            if(n < 0 && errno == EINTR) continue;
+            if(n <= 0) break;
+            off += static_cast<size_t>(n);
+        }
+    }
+
+    const MetricsRegistry& registry;
+    int fd = -1;
+    int bound_port = 0;
+    std::atomic<bool> stop{false};
+    std::thread server;
+};
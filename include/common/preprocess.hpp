@@ -0,0 +1,102 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// How the processor turns the received JPEG into the image the detector runs on.
+// SIFT converts to grayscale internally anyway, so decoding straight to one channel
+// skips the colour conversion and two thirds of the pixel writes. `reduce` lets libjpeg
+// scale by 1/2, 1/4 or 1/8 in the DCT domain while decoding, which is much cheaper than
+// decoding at full size and resizing. `max_dimension` then caps the longer side with an
+// area resize. Keypoints found on the smaller image are mapped back to the original
+// geometry with rescale_keypoints(), so blob consumers see the same coordinates.
+struct PreprocessOptions {
+    bool grayscale = true;
+    int reduce = 1;        // 1, 2, 4, 8, or 0 = pick the largest factor that stays above max_dimension
+    int max_dimension = 0; // 0 = no resize
+
+    // Options from the `processor` config section
+    static PreprocessOptions from_config(const nlohmann::json& processor) {
+        PreprocessOptions o;
+        o.grayscale = processor.value("decode_grayscale", o.grayscale);
+        o.reduce = processor.value("decode_reduce", o.reduce);
+        o.max_dimension = processor.value("max_dimension", o.max_dimension);
+        if(o.reduce != 0 && o.reduce != 1 && o.reduce != 2 && o.reduce != 4 && o.reduce != 8)
+            throw std::runtime_error("processor.decode_reduce must be 0 (auto), 1, 2, 4 or 8");
+        if(o.max_dimension < 0) throw std::runtime_error("processor.max_dimension must be >= 0");
+        return o;
+    }
+
+    // Full-size colour decode with no resize, i.e. what the processor did before
+    bool is_identity() const { return !grayscale && reduce == 1 && max_dimension == 0; }
+};
+
+// Largest DCT reduction whose output still has a longer side >= max_dimension, so the
+// resize afterwards only ever shrinks. 1 when the original size is unknown.
+inline int choose_reduce(int orig_width, int orig_height, int max_dimension) {
+    int longest = std::max(orig_width, orig_height);
+    if(max_dimension <= 0 || longest <= 0) return 1;
+    for(int r : {8, 4, 2})
+        if(longest / r >= max_dimension) return r;
+    return 1;
+}
+
+inline int imdecode_flags(bool grayscale, int reduce) {
+    switch(reduce) {
+        case 2: return grayscale ? cv::IMREAD_REDUCED_GRAYSCALE_2 : cv::IMREAD_REDUCED_COLOR_2;
+        case 4: return grayscale ? cv::IMREAD_REDUCED_GRAYSCALE_4 : cv::IMREAD_REDUCED_COLOR_4;
+        case 8: return grayscale ? cv::IMREAD_REDUCED_GRAYSCALE_8 : cv::IMREAD_REDUCED_COLOR_8;
+        default: return grayscale ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR;
+    }
+}
+
+// Detector input plus the factors that map its pixel grid back to the original image
+struct PreparedImage {
+    cv::Mat img;
+    double scale_x = 1.0;
+    double scale_y = 1.0;
+};
+
+// Decode `size` bytes of JPEG for detection. orig_width/orig_height come from the frame
+// meta and are only needed for reduce = 0 and for exact scale factors; when they are 0
+// the reduction factor itself is assumed. Returns an empty image on decode failure.
+inline PreparedImage prepare_for_detection(const void* data, size_t size, const PreprocessOptions& opts,
+                                           int orig_width = 0, int orig_height = 0) {
+    PreparedImage out;
+    int reduce = opts.reduce == 0 ? choose_reduce(orig_width, orig_height, opts.max_dimension) : opts.reduce;
+    cv::Mat raw(1, static_cast<int>(size), CV_8U, const_cast<void*>(data));
+    out.img = cv::imdecode(raw, imdecode_flags(opts.grayscale, reduce));
+    if(out.img.empty()) return out;
+    int full_w = orig_width > 0 ? orig_width : out.img.cols * reduce;
+    int full_h = orig_height > 0 ? orig_height : out.img.rows * reduce;
+
+    int longest = std::max(out.img.cols, out.img.rows);
+    if(opts.max_dimension > 0 && longest > opts.max_dimension) {
+        double f = static_cast<double>(opts.max_dimension) / longest;
+        cv::Mat resized;
+        cv::resize(out.img, resized, cv::Size(std::max(1, static_cast<int>(out.img.cols * f + 0.5)),
+                                              std::max(1, static_cast<int>(out.img.rows * f + 0.5))),
+                   0, 0, cv::INTER_AREA);
+        out.img = resized;
+    }
+    out.scale_x = static_cast<double>(full_w) / out.img.cols;
+    out.scale_y = static_cast<double>(full_h) / out.img.rows;
+    return out;
+}
+
+// Map keypoints from the detector image back to the original image. Pixel centres are
+// aligned ((x + 0.5) * s - 0.5), matching how area resampling and DCT scaling place
+// pixels; the size grows with the mean scale. Octaves stay relative to the reduced image.
+inline void rescale_keypoints(std::vector<cv::KeyPoint>& kps, double scale_x, double scale_y) {
+    if(scale_x == 1.0 && scale_y == 1.0) return;
+    const float sx = static_cast<float>(scale_x), sy = static_cast<float>(scale_y);
+    const float ss = static_cast<float>((scale_x + scale_y) / 2);
+    for(auto& kp : kps) {
+        kp.pt.x = (kp.pt.x + 0.5f) * sx - 0.5f;
+        kp.pt.y = (kp.pt.y + 0.5f) * sy - 0.5f;
+        kp.size *= ss;
+    }
+}
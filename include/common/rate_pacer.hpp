@@ -0,0 +1,148 @@
+#pragma once
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// One segment of a "step" profile: hold `fps` for `duration_ms`
+struct RateStep {
+    int duration_ms = 0;
+    double fps = 0;
+};
+
+// Recorded inter-arrival gaps in milliseconds, one per line. Blank lines and lines
+// starting with '#' are skipped.
+inline std::vector<double> load_interarrival_trace(const std::string& path) {
+    std::ifstream f(path);
+    if(!f.is_open()) throw std::runtime_error("Cannot open trace file: " + path);
+    std::vector<double> gaps;
+    std::string line;
+    while(std::getline(f, line)) {
+        size_t first = line.find_first_not_of(" \t\r");
+        if(first == std::string::npos || line[first] == '#') continue;
+        double gap = std::stod(line.substr(first));
+        if(gap < 0) throw std::runtime_error("Negative gap in trace file: " + path);
+        gaps.push_back(gap);
+    }
+    if(gaps.empty()) throw std::runtime_error("Trace file has no gaps: " + path);
+    return gaps;
+}
+
+// Open-loop send schedule. Every deadline is derived from the previous deadline rather
+// than from when the previous frame actually went out, so encode and send time never
+// accumulate into drift; a sender that falls behind catches up instead of slipping.
+//
+// Profiles:
+//   constant  rate_fps
+//   burst     burst_fps for the first burst_ms of every burst_period_ms, rate_fps otherwise
+//             (rate_fps = 0 means silence between bursts)
+//   ramp      linear from rate_fps to ramp_to_fps over ramp_ms, then hold ramp_to_fps
+//   step      cycle through `steps`
+//   trace     replay `trace` gaps (ms), optionally looping
+class RatePacer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Options {
+        std::string profile = "constant";
+        double rate_fps = 10;
+        double burst_fps = 50;
+        int burst_ms = 1000;
+        int burst_period_ms = 10000;
+        double ramp_to_fps = 50;
+        int ramp_ms = 30000;
+        std::vector<RateStep> steps;
+        std::vector<double> trace;
+        bool trace_loop = true;
+    };
+
+    explicit RatePacer(const Options& opts, Clock::time_point start = Clock::now())
+        : opts(opts), start(start), deadline(start) {
+        const std::string& p = opts.profile;
+        if(p == "constant" || p == "ramp" || p == "step") {
+            if(p != "step" && opts.rate_fps <= 0) throw std::runtime_error("rate_fps must be > 0 for profile " + p);
+            if(p == "ramp" && (opts.ramp_to_fps <= 0 || opts.ramp_ms <= 0)) throw std::runtime_error("ramp needs ramp_to_fps > 0 and ramp_ms > 0");
+            if(p == "step") {
+                if(opts.steps.empty()) throw std::runtime_error("step profile needs at least one step");
+                for(const auto& s : opts.steps) {
+                    if(s.duration_ms <= 0 || s.fps <= 0) throw std::runtime_error("step needs duration_ms > 0 and fps > 0");
+                    steps_total_ms += s.duration_ms;
+                }
+            }
+        } else if(p == "burst") {
+            if(opts.burst_fps <= 0 || opts.rate_fps < 0) throw std::runtime_error("burst needs burst_fps > 0 and rate_fps >= 0");
+            if(opts.burst_ms <= 0 || opts.burst_period_ms < opts.burst_ms) throw std::runtime_error("burst needs 0 < burst_ms <= burst_period_ms");
+        } else if(p == "trace") {
+            if(opts.trace.empty()) throw std::runtime_error("trace profile needs a non-empty trace");
+        } else {
+            throw std::runtime_error("Unknown rate profile: " + p);
+        }
+    }
+
+    // Absolute time the next frame is due, or std::nullopt once a non-looping trace ends.
+    // The first call returns the start time.
+    std::optional<Clock::time_point> next() {
+        if(first) { first = false; return deadline; }
+        if(opts.profile == "trace") {
+            if(trace_pos == opts.trace.size()) {
+                if(!opts.trace_loop) return std::nullopt;
+                trace_pos = 0;
+            }
+            deadline += to_duration(opts.trace[trace_pos++] / 1000.0);
+            return deadline;
+        }
+        double fps = target_rate(deadline);
+        Clock::time_point due = fps > 0 ? deadline + to_duration(1.0 / fps) : Clock::time_point::max();
+        if(opts.profile == "burst") {
+            // Never skip over the start of a burst, and skip silent phases entirely
+            Clock::time_point burst = next_burst(deadline);
+            if(due > burst || target_rate(due) <= 0) due = burst;
+        }
+        deadline = due;
+        return deadline;
+    }
+
+    // Target frames/sec at `t`; for a trace, its mean rate
+    double target_rate(Clock::time_point t) const {
+        double ms = std::chrono::duration<double, std::milli>(t - start).count();
+        if(ms < 0) ms = 0;
+        const std::string& p = opts.profile;
+        if(p == "constant") return opts.rate_fps;
+        if(p == "burst") return std::fmod(ms, opts.burst_period_ms) < opts.burst_ms ? opts.burst_fps : opts.rate_fps;
+        if(p == "ramp") return ms >= opts.ramp_ms ? opts.ramp_to_fps : opts.rate_fps + (opts.ramp_to_fps - opts.rate_fps) * ms / opts.ramp_ms;
+        if(p == "step") {
+            double phase = std::fmod(ms, steps_total_ms);
+            for(const auto& s : opts.steps) {
+                if(phase < s.duration_ms) return s.fps;
+                phase -= s.duration_ms;
+            }
+            return opts.steps.back().fps;
+        }
+        double total_ms = 0;
+        for(double g : opts.trace) total_ms += g;
+        return total_ms > 0 ? 1000.0 * opts.trace.size() / total_ms : 0;
+    }
+
+    const std::string& profile() const { return opts.profile; }
+
+private:
+    static Clock::duration to_duration(double seconds) {
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    }
+
+    Clock::time_point next_burst(Clock::time_point t) const {
+        auto period = std::chrono::milliseconds(opts.burst_period_ms);
+        auto n = (t - start) / period + 1;
+        return start + n * period;
+    }
+
+    Options opts;
+    Clock::time_point start;
+    Clock::time_point deadline;
+    bool first = true;
+    size_t trace_pos = 0;
+    double steps_total_ms = 0;
+};
@@ -0,0 +1,244 @@
+#pragma once
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/*
+Generator replay log
+
+Every frame the generator sends is appended here first, so frames lost downstream (in the
+ZMQ buffers of a processor or logger that restarted) can be sent again when the logger asks.
+Frames are numbered 1, 2, 3, ... per log; the log lives in rolling segment files
+`<dir>/replay_<first seq>.log`, each record being
+    uint32_t magic      => REPLAY_RECORD_MAGIC
+    uint32_t meta_size  => frame header + extension bytes
+    uint64_t seq
+    uint64_t data_size  => image bytes
+    meta, data
+Once the segments exceed `max_bytes` the oldest one is deleted, so only recent frames can
+be replayed. `<dir>/source` holds the log's random 32-bit id, which the generator puts in
+every frame header: a new (or wiped) log is a new source whose seqs start again at 1.
+*/
+
+constexpr uint32_t REPLAY_RECORD_MAGIC = 0x594c5052; // "RPLY"
+constexpr size_t REPLAY_RECORD_HEADER = 24;
+
+// Logger -> generator request to send frames first..last (inclusive) of `source` again:
+// little-endian u32 source, u64 first, u64 last
+struct ReplayRequest {
+    uint32_t source = 0;
+    uint64_t first = 0;
+    uint64_t last = 0;
+};
+constexpr size_t REPLAY_REQUEST_SIZE = 20;
+
+inline void encode_replay_request(const ReplayRequest& r, uint8_t* out) {
+    std::memcpy(out, &r.source, 4);
+    std::memcpy(out + 4, &r.first, 8);
+    std::memcpy(out + 12, &r.last, 8);
+}
+
+inline bool decode_replay_request(const void* data, size_t size, ReplayRequest& r) {
+    if(size != REPLAY_REQUEST_SIZE) return false;
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    std::memcpy(&r.source, p, 4);
+    std::memcpy(&r.first, p + 4, 8);
+    std::memcpy(&r.last, p + 12, 8);
+    return r.first > 0 && r.first <= r.last;
+}
+
+// Appends and reads happen on the generator's send thread; not thread-safe.
+class ReplayLog {
+public:
+    struct Options {
+        std::string dir = "data/replay";
+        size_t max_bytes = 1024u << 20;
+        size_t segment_bytes = 64u << 20;
+        bool fsync = false; // sync every append (only matters for power loss, not process crashes)
+    };
+
+    explicit ReplayLog(const Options& opts) : opts(opts) {
+        std::filesystem::create_directories(opts.dir);
+        recover();
+    }
+
+    ~ReplayLog() {
+        for(auto& s : segments) ::close(s.fd);
+    }
+
+    ReplayLog(const ReplayLog&) = delete;
+    ReplayLog& operator=(const ReplayLog&) = delete;
+
+    uint32_t source() const { return source_id; }
+    // Seq the next appended frame must carry
+    uint64_t next_seq() const { return first_held + entries.size(); }
+    // Oldest frame still held (next_seq() when empty)
+    uint64_t first_seq() const { return first_held; }
+    uint64_t bytes() const { return total_bytes; }
+
+    bool append(uint64_t seq, const uint8_t* meta, size_t meta_size, const uint8_t* data, size_t data_size, std::string& error) {
+        if(seq != next_seq()) { error = "replay log expects seq " + std::to_string(next_seq()) + ", got " + std::to_string(seq); return false; }
+        uint64_t record = REPLAY_RECORD_HEADER + meta_size + data_size;
+        if(segments.empty() || (segments.back().size > 0 && segments.back().size + record > opts.segment_bytes)) {
+            if(!segments.empty() && opts.fsync) ::fdatasync(segments.back().fd);
+            if(!open_segment(seq, error)) return false;
+        }
+        Segment& seg = segments.back();
+        uint8_t hdr[REPLAY_RECORD_HEADER];
+        uint32_t msize = static_cast<uint32_t>(meta_size);
+        uint64_t dsize = data_size;
+        std::memcpy(hdr, &REPLAY_RECORD_MAGIC, 4); std::memcpy(hdr + 4, &msize, 4);
+        std::memcpy(hdr + 8, &seq, 8); std::memcpy(hdr + 16, &dsize, 8);
+        if(!pwrite_all(seg.fd, hdr, sizeof(hdr), seg.size) ||
+           !pwrite_all(seg.fd, meta, meta_size, seg.size + sizeof(hdr)) ||
+           !pwrite_all(seg.fd, data, data_size, seg.size + sizeof(hdr) + meta_size)) {
+            error = std::string("write: ") + std::strerror(errno);
+            if(::ftruncate(seg.fd, static_cast<off_t>(seg.size)) != 0) {} // keep the tail readable
+            return false;
+        }
+        if(opts.fsync && ::fdatasync(seg.fd) != 0) { error = std::string("fdatasync: ") + std::strerror(errno); return false; }
+        entries.push_back({seg.size, msize, dsize});
+        seg.size += record;
+        total_bytes += record;
+        evict();
+        return true;
+    }
+
+    // Frame `seq` if it is still held
+    bool read(uint64_t seq, std::vector<uint8_t>& meta, std::vector<uint8_t>& data) const {
+        if(seq < first_held || seq >= next_seq()) return false;
+        const Entry& e = entries[seq - first_held];
+        auto seg = std::upper_bound(segments.begin(), segments.end(), seq, [](uint64_t s, const Segment& g){ return s < g.first_seq; });
+        if(seg == segments.begin()) return false;
+        --seg;
+        meta.resize(e.meta_size);
+        data.resize(e.data_size);
+        return pread_all(seg->fd, meta.data(), meta.size(), e.offset + REPLAY_RECORD_HEADER) &&
+               pread_all(seg->fd, data.data(), data.size(), e.offset + REPLAY_RECORD_HEADER + e.meta_size);
+    }
+
+private:
+    struct Segment { uint64_t first_seq; int fd; uint64_t size; };
+    struct Entry { uint64_t offset; uint32_t meta_size; uint64_t data_size; };
+
+    std::string segment_path(uint64_t first_seq) const {
+        char name[48];
+        std::snprintf(name, sizeof(name), "replay_%020llu.log", static_cast<unsigned long long>(first_seq));
+        return (std::filesystem::path(opts.dir) / name).string();
+    }
+
+    bool open_segment(uint64_t first_seq, std::string& error) {
+        int fd = ::open(segment_path(first_seq).c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if(fd < 0) { error = "open " + segment_path(first_seq) + ": " + std::strerror(errno); return false; }
+        segments.push_back({first_seq, fd, 0});
+        return true;
+    }
+
+    // Drop the oldest segments beyond max_bytes; the one being appended to always stays
+    void evict() {
+        while(total_bytes > opts.max_bytes && segments.size() > 1) {
+            Segment& old = segments.front();
+            uint64_t count = segments[1].first_seq - old.first_seq;
+            ::close(old.fd);
+            ::unlink(segment_path(old.first_seq).c_str());
+            total_bytes -= old.size;
+            entries.erase(entries.begin(), entries.begin() + static_cast<std::ptrdiff_t>(count));
+            first_held += count;
+            segments.pop_front();
+        }
+    }
+
+    // Reads the source id (a fresh one for a new log), rebuilds the index from the record
+    // headers and cuts a torn record at the tail. Segments that do not continue the
+    // sequence of the ones before them are discarded.
+    void recover() {
+        std::string id_path = (std::filesystem::path(opts.dir) / "source").string();
+        std::vector<uint64_t> firsts;
+        for(const auto& e : std::filesystem::directory_iterator(opts.dir)) {
+            unsigned long long first = 0;
+            if(std::sscanf(e.path().filename().string().c_str(), "replay_%llu.log", &first) == 1) firsts.push_back(first);
+        }
+        std::sort(firsts.begin(), firsts.end());
+
+        std::ifstream in(id_path);
+        if(!(in >> source_id) || source_id == 0) {
+            // No id: whatever segments are here cannot be attributed to a source
+            for(uint64_t f : firsts) ::unlink(segment_path(f).c_str());
+            firsts.clear();
+            std::random_device rd;
+            do source_id = rd(); while(source_id == 0);
+            std::string tmp = id_path + ".tmp";
+            {
+                std::ofstream out(tmp, std::ios::trunc);
+                out << source_id << "\n";
+                if(!out) throw std::runtime_error("Cannot write " + tmp);
+            }
+            if(::rename(tmp.c_str(), id_path.c_str()) != 0) throw std::runtime_error("Cannot create " + id_path + ": " + std::strerror(errno));
+        }
+
+        first_held = 1;
+        for(size_t i = 0; i < firsts.size(); ++i) {
+            uint64_t first = firsts[i];
+            bool continues = segments.empty() ? true : first == next_seq();
+            int fd = continues ? ::open(segment_path(first).c_str(), O_RDWR | O_CLOEXEC) : -1;
+            if(fd < 0) { ::unlink(segment_path(first).c_str()); continue; }
+            if(segments.empty()) first_held = first;
+            struct stat st{};
+            ::fstat(fd, &st);
+            uint64_t off = 0, file_size = static_cast<uint64_t>(st.st_size), expect = first;
+            uint8_t hdr[REPLAY_RECORD_HEADER];
+            while(off + REPLAY_RECORD_HEADER <= file_size && pread_all(fd, hdr, sizeof(hdr), off)) {
+                uint32_t magic, msize; uint64_t seq, dsize;
+                std::memcpy(&magic, hdr, 4); std::memcpy(&msize, hdr + 4, 4);
+                std::memcpy(&seq, hdr + 8, 8); std::memcpy(&dsize, hdr + 16, 8);
+                if(magic != REPLAY_RECORD_MAGIC || seq != expect || off + REPLAY_RECORD_HEADER + msize + dsize > file_size) break;
+                entries.push_back({off, msize, dsize});
+                off += REPLAY_RECORD_HEADER + msize + dsize;
+                expect++;
+            }
+            if(off < file_size && ::ftruncate(fd, static_cast<off_t>(off)) != 0)
+                throw std::runtime_error("Cannot truncate torn replay segment " + segment_path(first));
+            segments.push_back({first, fd, off});
+            total_bytes += off;
+        }
+        evict();
+    }
+
+    static bool pwrite_all(int fd, const uint8_t* p, size_t n, uint64_t off) {
+        while(n > 0) {
+            ssize_t w = ::pwrite(fd, p, n, static_cast<off_t>(off));
+            if(w < 0) { if(errno == EINTR) continue; return false; }
+            p += w; n -= w; off += w;
+        }
+        return true;
+    }
+
+    static bool pread_all(int fd, uint8_t* p, size_t n, uint64_t off) {
+        while(n > 0) {
+            ssize_t r = ::pread(fd, p, n, static_cast<off_t>(off));
+            if(r < 0) { if(errno == EINTR) continue; return false; }
+            if(r == 0) return false;
+            p += r; n -= r; off += r;
+        }
+        return true;
+    }
+
+    Options opts;
+    uint32_t source_id = 0;
+    std::deque<Segment> segments;
+    std::deque<Entry> entries; // entries[i] is frame first_held + i
+    uint64_t first_held = 1;
+    uint64_t total_bytes = 0;
+};
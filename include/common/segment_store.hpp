@@ -0,0 +1,355 @@
+#pragma once
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "common/bounded_queue.hpp"
+
+/*
+Append-only image segment store
+
+Images are appended to rolling segment files `<dir>/segment_<id>.seg`, each record being
+    uint32_t magic   => SEGMENT_RECORD_MAGIC
+    uint32_t length  => payload bytes
+    uint64_t hash    => segment_content_hash(payload)
+    payload
+A stored image is addressed by (segment id, payload offset, length), kept in the
+`images.path` column as "seg:<id>:<offset>:<length>". Identical payloads are stored once.
+*/
+
+constexpr uint32_t SEGMENT_RECORD_MAGIC = 0x53474d49; // "IMGS"
+constexpr size_t SEGMENT_RECORD_HEADER = 16;
+
+struct SegmentRef {
+    uint32_t segment = 0;
+    uint64_t offset = 0;
+    uint64_t length = 0;
+};
+
+inline std::string segment_ref_to_path(const SegmentRef& ref) {
+    return "seg:" + std::to_string(ref.segment) + ":" + std::to_string(ref.offset) + ":" + std::to_string(ref.length);
+}
+
+inline bool parse_segment_path(const std::string& path, SegmentRef& ref) {
+    unsigned long long seg = 0, off = 0, len = 0;
+    int used = 0;
+    if(std::sscanf(path.c_str(), "seg:%llu:%llu:%llu%n", &seg, &off, &len, &used) != 3 || used != (int)path.size()) return false;
+    ref.segment = static_cast<uint32_t>(seg);
+    ref.offset = off;
+    ref.length = len;
+    return true;
+}
+
+inline std::string segment_file_name(const std::string& dir, uint32_t id) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "segment_%06u.seg", id);
+    return (std::filesystem::path(dir) / name).string();
+}
+
+// 64-bit content hash, 8 bytes per step. Only used to find dedup candidates, which
+// are then compared byte for byte, so it does not need to be cryptographic.
+inline uint64_t segment_content_hash(const uint8_t* p, size_t n) {
+    const uint64_t k = 0x9E3779B97F4A7C15ull;
+    uint64_t h = 0xcbf29ce484222325ull ^ (n * k);
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        uint64_t w;
+        std::memcpy(&w, p + i, 8);
+        h = (h ^ w) * k;
+        h ^= h >> 29;
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, p + i, n - i);
+    h = (h ^ tail) * k;
+    h ^= h >> 32; h *= 0xff51afd7ed558ccdull; h ^= h >> 33; // final avalanche
+    return h;
+}
+
+// Non-owning view of stored bytes
+struct ImageBytes {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    explicit operator bool() const { return data != nullptr; }
+};
+
+// Read-only access to segment files through mmap. Returned views point straight into
+// the mapping and stay valid for the lifetime of the reader. Each mapping covers at least
+// `map_reserve` bytes, so a segment that is still being appended to can grow into it
+// without a remap; beyond that a larger mapping is added and older ones are kept so
+// earlier views survive.
+class SegmentReader {
+public:
+    explicit SegmentReader(std::string dir, size_t map_reserve = 0) : dir(std::move(dir)), map_reserve(map_reserve) {}
+
+    ~SegmentReader() {
+        for(auto& [id, list] : maps)
+            for(auto& m : list) ::munmap(m.base, m.map_size);
+    }
+
+    SegmentReader(const SegmentReader&) = delete;
+    SegmentReader& operator=(const SegmentReader&) = delete;
+
+    ImageBytes read(const SegmentRef& ref) {
+        std::lock_guard<std::mutex> lock(mtx);
+        uint64_t end = ref.offset + ref.length;
+        auto& list = maps[ref.segment];
+        if(list.empty() || list.back().file_size < end) {
+            if(!refresh(ref.segment, list) || list.back().file_size < end) return {};
+        }
+        return {static_cast<const uint8_t*>(list.back().base) + ref.offset, static_cast<size_t>(ref.length)};
+    }
+
+    ImageBytes read(const std::string& path) {
+        SegmentRef ref;
+        if(!parse_segment_path(path, ref)) return {};
+        return read(ref);
+    }
+
+private:
+    // file_size is the readable part; the mapping itself may extend past EOF
+    struct Mapping { void* base = nullptr; size_t map_size = 0; size_t file_size = 0; };
+
+    bool refresh(uint32_t id, std::vector<Mapping>& list) {
+        std::string path = segment_file_name(dir, id);
+        struct stat st{};
+        if(::stat(path.c_str(), &st) != 0 || st.st_size <= 0) return false;
+        size_t file_size = static_cast<size_t>(st.st_size);
+        if(!list.empty() && file_size <= list.back().map_size) { list.back().file_size = file_size; return true; }
+
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0) return false;
+        size_t map_size = std::max(file_size, map_reserve);
+        void* base = ::mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if(base == MAP_FAILED) return false;
+        list.push_back({base, map_size, file_size});
+        return true;
+    }
+
+    std::string dir;
+    size_t map_reserve;
+    std::mutex mtx;
+    std::map<uint32_t, std::vector<Mapping>> maps;
+};
+
+// One image to append. `owner` keeps `data` alive until on_done has run.
+struct SegmentAppendJob {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    std::shared_ptr<void> owner;
+    std::function<void(bool ok, const SegmentRef& ref, bool duplicate, const std::string& error)> on_done;
+};
+
+// Single writer thread appending images to the current segment, rolling to a new segment
+// once `max_segment_bytes` would be exceeded. Jobs are taken in groups so one fdatasync
+// covers every record of the group; callbacks run only after that sync.
+class SegmentStore {
+public:
+    struct Options {
+        size_t max_segment_bytes = 256u << 20;
+        size_t queue_capacity = 256;
+        size_t max_group = 32;
+        bool fsync = true;
+    };
+
+    SegmentStore(std::string dir, const Options& opts)
+        : dir(std::move(dir)), opts(opts), reader(this->dir, opts.max_segment_bytes), jobs(opts.queue_capacity) {
+        std::filesystem::create_directories(this->dir);
+        recover();
+        writer = std::thread([this]{ run(); });
+    }
+
+    ~SegmentStore() {
+        jobs.close();
+        if(writer.joinable()) writer.join();
+        if(fd >= 0) ::close(fd);
+    }
+
+    SegmentStore(const SegmentStore&) = delete;
+    SegmentStore& operator=(const SegmentStore&) = delete;
+
+    // Blocks while the queue is full
+    bool submit(SegmentAppendJob job) { return jobs.push(std::move(job)); }
+
+    size_t queue_depth() const { return jobs.size(); }
+    uint64_t duplicates() const { return num_duplicates; }
+
+private:
+    // Rebuild the dedup index from record headers and cut any torn record at a segment's tail
+    void recover() {
+        std::vector<uint32_t> ids;
+        for(const auto& e : std::filesystem::directory_iterator(dir)) {
+            unsigned id = 0;
+            if(std::sscanf(e.path().filename().string().c_str(), "segment_%u.seg", &id) == 1) ids.push_back(id);
+        }
+        std::sort(ids.begin(), ids.end());
+        for(uint32_t id : ids) {
+            int rfd = ::open(segment_file_name(dir, id).c_str(), O_RDWR | O_CLOEXEC);
+            if(rfd < 0) throw std::runtime_error("Cannot open segment " + segment_file_name(dir, id));
+            struct stat st{};
+            ::fstat(rfd, &st);
+            uint64_t off = 0, file_size = static_cast<uint64_t>(st.st_size);
+            uint8_t hdr[SEGMENT_RECORD_HEADER];
+            while(off + SEGMENT_RECORD_HEADER <= file_size &&
+                  ::pread(rfd, hdr, sizeof(hdr), static_cast<off_t>(off)) == (ssize_t)sizeof(hdr)) {
+                uint32_t magic, len; uint64_t hash;
+                std::memcpy(&magic, hdr, 4); std::memcpy(&len, hdr + 4, 4); std::memcpy(&hash, hdr + 8, 8);
+                if(magic != SEGMENT_RECORD_MAGIC || off + SEGMENT_RECORD_HEADER + len > file_size) break;
+                index.emplace(hash, SegmentRef{id, off + SEGMENT_RECORD_HEADER, len});
+                off += SEGMENT_RECORD_HEADER + len;
+            }
+            if(off < file_size && ::ftruncate(rfd, static_cast<off_t>(off)) != 0)
+                throw std::runtime_error("Cannot truncate torn segment " + segment_file_name(dir, id));
+            ::close(rfd);
+            current = id;
+            current_size = off;
+        }
+        open_segment(current);
+    }
+
+    void open_segment(uint32_t id) {
+        if(fd >= 0) ::close(fd);
+        fd = ::open(segment_file_name(dir, id).c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+        if(fd < 0) throw std::runtime_error("Cannot open segment " + segment_file_name(dir, id) + ": " + std::strerror(errno));
+        current = id;
+    }
+
+    // Existing copy of the payload, if any: same hash, same length, same bytes
+    bool find_duplicate(uint64_t hash, const uint8_t* data, size_t size, SegmentRef& out) {
+        auto range = index.equal_range(hash);
+        for(auto it = range.first; it != range.second; ++it) {
+            if(it->second.length != size) continue;
+            ImageBytes stored = reader.read(it->second);
+            if(stored && std::memcmp(stored.data, data, size) == 0) { out = it->second; return true; }
+        }
+        return false;
+    }
+
+    bool append(const SegmentAppendJob& job, uint64_t hash, SegmentRef& ref, std::string& error) {
+        size_t record = SEGMENT_RECORD_HEADER + job.size;
+        if(current_size > 0 && current_size + record > opts.max_segment_bytes) {
+            if(opts.fsync && ::fdatasync(fd) != 0) { error = std::string("fdatasync: ") + std::strerror(errno); return false; }
+            open_segment(current + 1);
+            current_size = 0;
+            dir_dirty = true;
+        }
+        uint8_t hdr[SEGMENT_RECORD_HEADER];
+        uint32_t len = static_cast<uint32_t>(job.size);
+        std::memcpy(hdr, &SEGMENT_RECORD_MAGIC, 4); std::memcpy(hdr + 4, &len, 4); std::memcpy(hdr + 8, &hash, 8);
+        if(!pwrite_all(hdr, sizeof(hdr), current_size) || !pwrite_all(job.data, job.size, current_size + sizeof(hdr))) {
+            error = std::string("write: ") + std::strerror(errno);
+            return false;
+        }
+        ref = SegmentRef{current, current_size + SEGMENT_RECORD_HEADER, job.size};
+        current_size += record;
+        return true;
+    }
+
+    bool pwrite_all(const uint8_t* p, size_t n, uint64_t off) {
+        while(n > 0) {
+            ssize_t w = ::pwrite(fd, p, n, static_cast<off_t>(off));
+            if(w < 0) { if(errno == EINTR) continue; return false; }
+            p += w; n -= w; off += w;
+        }
+        return true;
+    }
+
+    struct Result { bool ok; SegmentRef ref; bool duplicate; std::string error; };
+
+    // Records of a group whose sync failed must not be offered as dedup targets
+    void forget_unsynced(const std::vector<Result>& results) {
+        for(const auto& r : results) {
+            if(!r.ok || r.duplicate) continue;
+            for(auto it = index.begin(); it != index.end(); ) {
+                bool same = it->second.segment == r.ref.segment && it->second.offset == r.ref.offset;
+                it = same ? index.erase(it) : std::next(it);
+            }
+        }
+    }
+
+    static bool appended_in(const std::vector<Result>& results, const SegmentRef& ref) {
+        for(const auto& r : results)
+            if(r.ok && !r.duplicate && r.ref.segment == ref.segment && r.ref.offset == ref.offset) return true;
+        return false;
+    }
+
+    void run() {
+        std::vector<SegmentAppendJob> group;
+        std::vector<Result> results;
+        while(auto first = jobs.pop()) {
+            group.push_back(std::move(*first));
+            while(group.size() < opts.max_group) {
+                auto more = jobs.try_pop();
+                if(!more) break;
+                group.push_back(std::move(*more));
+            }
+
+            bool wrote = false;
+            for(auto& job : group) {
+                Result r{false, {}, false, {}};
+                uint64_t hash = segment_content_hash(job.data, job.size);
+                if(find_duplicate(hash, job.data, job.size, r.ref)) { r.ok = r.duplicate = true; num_duplicates++; }
+                else if(append(job, hash, r.ref, r.error)) { r.ok = wrote = true; index.emplace(hash, r.ref); }
+                results.push_back(std::move(r));
+            }
+
+            // One sync for the whole group; a failure fails every record appended in it and
+            // every duplicate of one
+            std::string sync_error;
+            if(wrote && opts.fsync && ::fdatasync(fd) != 0) sync_error = std::string("fdatasync: ") + std::strerror(errno);
+            if(!sync_error.empty()) forget_unsynced(results);
+            if(dir_dirty && opts.fsync) {
+                int dfd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+                if(dfd >= 0) { ::fsync(dfd); ::close(dfd); }
+                dir_dirty = false;
+            }
+            if(!sync_error.empty()) {
+                // A duplicate of a record appended in this group points at the same unsynced bytes
+                std::vector<bool> unsynced(results.size());
+                for(size_t i = 0; i < results.size(); ++i)
+                    unsynced[i] = results[i].ok && (!results[i].duplicate || appended_in(results, results[i].ref));
+                for(size_t i = 0; i < results.size(); ++i) {
+                    if(!unsynced[i]) continue;
+                    if(results[i].duplicate) num_duplicates--;
+                    results[i].ok = results[i].duplicate = false;
+                    results[i].error = sync_error;
+                }
+            }
+            for(size_t i = 0; i < group.size(); ++i) {
+                Result& r = results[i];
+                if(group[i].on_done) group[i].on_done(r.ok, r.ref, r.duplicate, r.error);
+            }
+            group.clear();
+            results.clear();
+        }
+    }
+
+    std::string dir;
+    Options opts;
+    SegmentReader reader;
+    BoundedQueue<SegmentAppendJob> jobs;
+    std::thread writer;
+
+    int fd = -1;
+    uint32_t current = 0;
+    uint64_t current_size = 0;
+    bool dir_dirty = true; // first sync also persists a freshly created segment's entry
+    std::unordered_multimap<uint64_t, SegmentRef> index;
+    std::atomic<uint64_t> num_duplicates{0};
+};
@@ -0,0 +1,247 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "common/replay_log.hpp"
+
+// Durable state of one source, stored next to the rows (see SqliteBatchWriter)
+struct SourceProgress {
+    uint32_t source = 0;
+    uint64_t contiguous = 0; // every frame up to here is committed or given up
+    uint64_t lost = 0;       // frames given up
+};
+
+// Per-source sequence tracking in the logger. For every source (a generator's replay log,
+// see replay_log.hpp) it keeps the highest seq up to which every frame is committed, the
+// frames above it that are being stored or already committed, and the gaps in between.
+// A gap still open after `gap_timeout` is requested again from the generator every
+// `retry_interval`, up to `max_attempts` times; after that its frames count as lost and
+// the watermark moves past them. Frames the processor reports as dropped are given up at
+// once. Source 0 (a generator without a replay log) is not tracked.
+//
+// admit() / give_up() on the receive loop, committed() / abandon() from the writer threads, poll()
+// periodically from the receive loop.
+class SeqTracker {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Options {
+        std::chrono::milliseconds gap_timeout{2000};
+        std::chrono::milliseconds retry_interval{2000};
+        int max_attempts = 5;
+        uint64_t max_request = 256; // frames per replay request
+    };
+
+    struct PollResult {
+        std::vector<ReplayRequest> requests; // ask the generator for these
+        std::vector<ReplayRequest> given_up; // counted as lost from now on
+    };
+
+    explicit SeqTracker(const Options& opts) : opts(opts) {}
+
+    // State after a restart: the persisted progress plus the committed seqs above it
+    void restore(const SourceProgress& p, const std::vector<uint64_t>& committed_above) {
+        std::lock_guard<std::mutex> lock(mtx);
+        Source& s = sources[p.source];
+        s.contiguous = p.contiguous;
+        s.lost = p.lost;
+        for(uint64_t seq : committed_above) if(seq > s.contiguous) s.held[seq] = true;
+        advance(s);
+        s.dirty = false;
+    }
+
+    // false when the frame is already committed or being stored (a replay that raced the
+    // original): the caller skips it
+    bool admit(uint32_t source, uint64_t seq) {
+        if(source == 0 || seq == 0) return true;
+        std::lock_guard<std::mutex> lock(mtx);
+        Source& s = sources[source];
+        if(seq <= s.contiguous) return take_lost(s, seq); // a late copy of a given-up frame is still stored
+        if(s.held.count(seq)) return false;
+        take_lost(s, seq);
+        s.held[seq] = false;
+        return true;
+    }
+
+    // The frame could not be stored; it becomes a gap again
+    void abandon(uint32_t source, uint64_t seq) {
+        if(source == 0 || seq == 0) return;
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = sources.find(source);
+        if(it == sources.end()) return;
+        auto h = it->second.held.find(seq);
+        if(h != it->second.held.end() && !h->second) it->second.held.erase(h);
+    }
+
+    // The processor dropped the frame on purpose (stale, undecodable): it counts as lost right
+    // away instead of becoming a gap that is requested again. A copy that is already stored or
+    // being stored wins.
+    void give_up(uint32_t source, uint64_t seq) {
+        if(source == 0 || seq == 0) return;
+        std::lock_guard<std::mutex> lock(mtx);
+        Source& s = sources[source];
+        if(seq <= s.contiguous || s.held.count(seq)) return;
+        auto next = s.lost_ranges.upper_bound(seq);
+        if(next != s.lost_ranges.begin() && std::prev(next)->second >= seq) return; // already given up
+        uint64_t first = seq, last = seq;
+        if(next != s.lost_ranges.end() && next->first == seq + 1) { last = next->second; s.lost_ranges.erase(next); }
+        auto prev = s.lost_ranges.lower_bound(seq);
+        if(prev != s.lost_ranges.begin() && std::prev(prev)->second == seq - 1) first = std::prev(prev)->first;
+        s.lost_ranges[first] = last;
+        s.lost++;
+        s.dirty = true;
+        advance(s);
+    }
+
+    void committed(uint32_t source, uint64_t seq) {
+        if(source == 0 || seq == 0) return;
+        std::lock_guard<std::mutex> lock(mtx);
+        Source& s = sources[source];
+        if(seq <= s.contiguous) return;
+        s.held[seq] = true;
+        advance(s);
+    }
+
+    PollResult poll(Clock::time_point now) {
+        std::lock_guard<std::mutex> lock(mtx);
+        PollResult out;
+        for(auto& [id, s] : sources) {
+            std::map<uint64_t, Gap> next;
+            for(const auto& [first, last] : holes(s)) {
+                Gap g{last, now + opts.gap_timeout, 0};
+                // A gap that shrank or split keeps the timer and attempts of the one it came from
+                auto prev = s.gaps.upper_bound(first);
+                if(prev != s.gaps.begin() && (--prev)->second.last >= first) { g.next_request = prev->second.next_request; g.attempts = prev->second.attempts; }
+                if(now >= g.next_request) {
+                    if(g.attempts >= opts.max_attempts) {
+                        s.lost_ranges[first] = last;
+                        s.lost += last - first + 1;
+                        s.dirty = true;
+                        out.given_up.push_back({id, first, last});
+                        continue;
+                    }
+                    g.attempts++;
+                    g.next_request = now + opts.retry_interval;
+                    for(uint64_t f = first; f <= last; f += opts.max_request)
+                        out.requests.push_back({id, f, std::min(last, f + opts.max_request - 1)});
+                }
+                next.emplace(first, g);
+            }
+            s.gaps = std::move(next);
+            advance(s);
+        }
+        return out;
+    }
+
+    // Sources whose watermark or lost count changed since the last call
+    std::vector<SourceProgress> take_progress() {
+        std::lock_guard<std::mutex> lock(mtx);
+        std::vector<SourceProgress> out;
+        for(auto& [id, s] : sources) {
+            if(!s.dirty) continue;
+            out.push_back({id, s.contiguous, s.lost});
+            s.dirty = false;
+        }
+        return out;
+    }
+
+    uint64_t contiguous(uint32_t source) const {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = sources.find(source);
+        return it == sources.end() ? 0 : it->second.contiguous;
+    }
+
+    // Frames currently missing across all sources
+    uint64_t missing() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        uint64_t n = 0;
+        for(const auto& [id, s] : sources)
+            for(const auto& [first, g] : s.gaps) n += g.last - first + 1;
+        return n;
+    }
+
+    uint64_t lost() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        uint64_t n = 0;
+        for(const auto& [id, s] : sources) n += s.lost;
+        return n;
+    }
+
+private:
+    struct Gap {
+        uint64_t last;
+        Clock::time_point next_request;
+        int attempts;
+    };
+
+    struct Source {
+        uint64_t contiguous = 0;
+        uint64_t lost = 0;
+        std::map<uint64_t, bool> held;              // seq above contiguous -> committed (false: being stored)
+        std::map<uint64_t, uint64_t> lost_ranges;   // first -> last, given up
+        std::map<uint64_t, Gap> gaps;               // first -> state
+        bool dirty = false;
+    };
+
+    // Lost ranges behind the watermark are kept this long, so a late copy is still stored
+    static constexpr size_t KEEP_LOST_RANGES = 1024;
+
+    // Move the watermark over committed and given-up frames
+    void advance(Source& s) {
+        uint64_t before = s.contiguous;
+        for(;;) {
+            auto h = s.held.begin();
+            if(h != s.held.end() && h->first == s.contiguous + 1 && h->second) { s.contiguous++; s.held.erase(h); continue; }
+            auto l = s.lost_ranges.upper_bound(s.contiguous + 1);
+            if(l != s.lost_ranges.begin() && std::prev(l)->first <= s.contiguous + 1 && std::prev(l)->second > s.contiguous) {
+                s.contiguous = std::prev(l)->second;
+                continue;
+            }
+            break;
+        }
+        while(s.lost_ranges.size() > KEEP_LOST_RANGES && s.lost_ranges.begin()->second <= s.contiguous)
+            s.lost_ranges.erase(s.lost_ranges.begin());
+        if(s.contiguous != before) s.dirty = true;
+    }
+
+    // A given-up frame that turns up after all: it is no longer lost
+    bool take_lost(Source& s, uint64_t seq) {
+        auto l = s.lost_ranges.upper_bound(seq);
+        if(l == s.lost_ranges.begin()) return false;
+        --l;
+        uint64_t first = l->first, last = l->second;
+        if(seq > last) return false;
+        s.lost_ranges.erase(l);
+        if(first < seq) s.lost_ranges[first] = seq - 1;
+        if(seq < last) s.lost_ranges[seq + 1] = last;
+        s.lost--;
+        s.dirty = true;
+        return true;
+    }
+
+    // Missing ranges between the watermark and the highest seq seen
+    std::vector<std::pair<uint64_t, uint64_t>> holes(const Source& s) const {
+        std::vector<std::pair<uint64_t, uint64_t>> out;
+        uint64_t next = s.contiguous + 1;
+        auto h = s.held.begin();
+        auto l = s.lost_ranges.lower_bound(next);
+        while(h != s.held.end() || l != s.lost_ranges.end()) {
+            bool take_held = l == s.lost_ranges.end() || (h != s.held.end() && h->first < l->first);
+            uint64_t first = take_held ? h->first : l->first;
+            uint64_t last = take_held ? h->first : l->second;
+            if(first > next) out.emplace_back(next, first - 1);
+            next = std::max(next, last + 1);
+            if(take_held) ++h; else ++l;
+        }
+        return out;
+    }
+
+    Options opts;
+    mutable std::mutex mtx;
+    std::unordered_map<uint32_t, Source> sources;
+};
@@ -0,0 +1,449 @@
+#pragma once
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+/*
+Shared-memory frame ring: one POSIX shm segment per shm:// endpoint, for stages on the same host
+    [0]           ShmRingControl   => magic, geometry, consumer pids
+    [free_off]    free queue       => indices of unused slots
+    [ready_off]   ready queue      => indices of slots holding a message, in send order
+    [owners_off]  int32_t[slots]   => pid leasing each slot, 0 while queued
+    [data_off]    slots x slot_bytes, page aligned
+Both queues are bounded lock-free MPMC rings of slot indices (with one producer and one consumer
+their CAS never retries). A producer pops a free slot, copies the message parts into it and
+pushes the index to the ready queue; a consumer pops it, reads the parts in place and pushes it
+back to the free queue. Only 4-byte indices move through the queues, and waiting is a futex on
+each queue's push counter, which works across processes on a shared mapping. Slots leased by a
+process that dies are reclaimed by the next producer that runs out of free slots.
+
+A slot holds one multipart message:
+    uint32_t parts, uint32_t reserved, uint64_t size[SHM_MAX_PARTS]
+    each part at the next 64-byte aligned offset, starting at 64
+*/
+
+constexpr char SHM_RING_MAGIC[8] = {'D', 'I', 'S', 'R', 'I', 'N', 'G', '1'};
+constexpr uint32_t SHM_RING_VERSION = 1;
+constexpr size_t SHM_MAX_PARTS = 4;
+constexpr size_t SHM_MAX_CONSUMERS = 16;
+constexpr size_t SHM_PART_ALIGN = 64;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free &&
+              std::atomic<int32_t>::is_always_lock_free, "shared-memory atomics must be lock-free");
+
+struct ShmPart {
+    const void* data;
+    size_t size;
+};
+
+enum class ShmSendResult { Sent, Timeout, TooLarge, NoConsumer };
+
+// Shared (not process-private) futex on a word in the mapping. Elsewhere than Linux the
+// waiter polls the word every 50 us instead.
+inline void shm_futex_wait(std::atomic<uint32_t>* word, uint32_t expected, std::chrono::nanoseconds timeout) {
+#ifdef __linux__
+    timespec ts{static_cast<time_t>(timeout.count() / 1000000000), static_cast<long>(timeout.count() % 1000000000)};
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, &ts, nullptr, 0);
+#else
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while(word->load() == expected && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+#endif
+}
+
+inline void shm_futex_wake(std::atomic<uint32_t>* word, int n) {
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, n, nullptr, nullptr, 0);
+#else
+    (void)word; (void)n;
+#endif
+}
+
+inline bool shm_pid_alive(int32_t pid) { return pid > 0 && (::kill(pid, 0) == 0 || errno == EPERM); }
+
+struct ShmIndexQueueHead {
+    alignas(64) std::atomic<uint64_t> enqueue_pos;
+    alignas(64) std::atomic<uint64_t> dequeue_pos;
+    alignas(64) std::atomic<uint32_t> pushes;  // futex word, bumped on every push
+    std::atomic<uint32_t> waiters;
+};
+
+struct ShmIndexCell {
+    std::atomic<uint64_t> seq;
+    uint32_t value;
+    uint32_t pad;
+};
+
+// Bounded MPMC queue of slot indices over memory in the mapping (Vyukov's sequence-numbered
+// ring). Holds at most `capacity` (a power of two) entries.
+class ShmIndexQueue {
+public:
+    ShmIndexQueue() = default;
+    ShmIndexQueue(void* mem, uint64_t capacity)
+        : head(static_cast<ShmIndexQueueHead*>(mem)),
+          cells(reinterpret_cast<ShmIndexCell*>(static_cast<uint8_t*>(mem) + sizeof(ShmIndexQueueHead))),
+          mask(capacity - 1) {}
+
+    static size_t bytes(uint64_t capacity) { return sizeof(ShmIndexQueueHead) + capacity * sizeof(ShmIndexCell); }
+
+    // Creator only, before the ring is published
+    void init() {
+        new (head) ShmIndexQueueHead();
+        for(uint64_t i = 0; i <= mask; ++i) {
+            new (&cells[i]) ShmIndexCell();
+            cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool push(uint32_t v) {
+        uint64_t pos = head->enqueue_pos.load(std::memory_order_relaxed);
+        ShmIndexCell* cell;
+        for(;;) {
+            cell = &cells[pos & mask];
+            int64_t diff = static_cast<int64_t>(cell->seq.load(std::memory_order_acquire) - pos);
+            if(diff == 0 && head->enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            if(diff < 0) return false; // full
+            if(diff > 0) pos = head->enqueue_pos.load(std::memory_order_relaxed);
+        }
+        cell->value = v;
+        cell->seq.store(pos + 1, std::memory_order_release);
+        head->pushes.fetch_add(1);
+        if(head->waiters.load() != 0) shm_futex_wake(&head->pushes, 1);
+        return true;
+    }
+
+    bool try_pop(uint32_t& v) {
+        uint64_t pos = head->dequeue_pos.load(std::memory_order_relaxed);
+        ShmIndexCell* cell;
+        for(;;) {
+            cell = &cells[pos & mask];
+            int64_t diff = static_cast<int64_t>(cell->seq.load(std::memory_order_acquire) - (pos + 1));
+            if(diff == 0 && head->dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            if(diff < 0) return false; // empty
+            if(diff > 0) pos = head->dequeue_pos.load(std::memory_order_relaxed);
+        }
+        v = cell->value;
+        cell->seq.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Sleeps on the push counter until an entry arrives or the deadline passes
+    bool pop(uint32_t& v, std::chrono::steady_clock::time_point deadline) {
+        for(;;) {
+            uint32_t seen = head->pushes.load(std::memory_order_acquire);
+            if(try_pop(v)) return true;
+            auto now = std::chrono::steady_clock::now();
+            if(now >= deadline) return false;
+            head->waiters.fetch_add(1);
+            shm_futex_wait(&head->pushes, seen, deadline - now);
+            head->waiters.fetch_sub(1);
+        }
+    }
+
+    // Wake every sleeper, e.g. when the ring is closed
+    void wake_all() {
+        head->pushes.fetch_add(1);
+        shm_futex_wake(&head->pushes, 1 << 30);
+    }
+
+private:
+    ShmIndexQueueHead* head = nullptr;
+    ShmIndexCell* cells = nullptr;
+    uint64_t mask = 0;
+};
+
+struct ShmRingControl {
+    char magic[8];
+    uint32_t version;
+    uint32_t slots;
+    uint64_t queue_capacity;
+    uint64_t slot_bytes;
+    uint64_t total_bytes;
+    uint64_t free_off, ready_off, owners_off, data_off;
+    std::atomic<uint32_t> ready;  // set last by the creator; openers wait for it
+    std::atomic<uint32_t> closed; // set by the creator on shutdown
+    std::atomic<int32_t> consumers[SHM_MAX_CONSUMERS];
+};
+
+struct ShmSlotHeader {
+    uint32_t parts;
+    uint32_t reserved;
+    uint64_t size[SHM_MAX_PARTS];
+};
+static_assert(sizeof(ShmSlotHeader) <= SHM_PART_ALIGN, "slot header must fit before the first part");
+
+class ShmRing {
+public:
+    struct Options {
+        uint32_t slots = 32;
+        size_t slot_bytes = 4u << 20;
+    };
+
+    // "dis_frames" or "/dis_frames" => "/dis_frames"
+    static std::string shm_name(const std::string& name) { return name.empty() || name[0] != '/' ? "/" + name : name; }
+
+    // Bytes of a slot needed for a message with these parts
+    static size_t message_bytes(std::initializer_list<ShmPart> parts) {
+        size_t n = SHM_PART_ALIGN;
+        for(const auto& p : parts) n += align_up(p.size, SHM_PART_ALIGN);
+        return n;
+    }
+
+    // Creates the ring, replacing a segment of that name left behind by an earlier run. The
+    // creator unlinks it again when destroyed.
+    static std::shared_ptr<ShmRing> create(const std::string& name, const Options& opts) {
+        if(opts.slots == 0 || opts.slot_bytes <= SHM_PART_ALIGN) throw std::runtime_error("Invalid shared-memory ring geometry for " + name);
+        std::string path = shm_name(name);
+        ::shm_unlink(path.c_str());
+        int fd = ::shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if(fd < 0) throw std::runtime_error("shm_open " + path + ": " + std::strerror(errno));
+
+        uint64_t capacity = 1;
+        while(capacity < opts.slots) capacity <<= 1;
+        uint64_t slot_bytes = align_up(opts.slot_bytes, SHM_PART_ALIGN);
+        uint64_t free_off = align_up(sizeof(ShmRingControl), 64);
+        uint64_t ready_off = align_up(free_off + ShmIndexQueue::bytes(capacity), 64);
+        uint64_t owners_off = align_up(ready_off + ShmIndexQueue::bytes(capacity), 64);
+        uint64_t data_off = align_up(owners_off + opts.slots * sizeof(int32_t), 4096);
+        uint64_t total = data_off + opts.slots * slot_bytes;
+        if(::ftruncate(fd, static_cast<off_t>(total)) != 0) {
+            std::string err = std::strerror(errno);
+            ::close(fd);
+            ::shm_unlink(path.c_str());
+            throw std::runtime_error("Cannot size shared-memory ring " + path + " to " + std::to_string(total) + " bytes: " + err);
+        }
+        std::shared_ptr<ShmRing> ring(new ShmRing(path, fd, total, true));
+        ShmRingControl* c = new (ring->base) ShmRingControl();
+        c->version = SHM_RING_VERSION;
+        c->slots = opts.slots;
+        c->queue_capacity = capacity;
+        c->slot_bytes = slot_bytes;
+        c->total_bytes = total;
+        c->free_off = free_off;
+        c->ready_off = ready_off;
+        c->owners_off = owners_off;
+        c->data_off = data_off;
+        std::memcpy(c->magic, SHM_RING_MAGIC, sizeof(c->magic));
+        ring->bind_layout();
+        ring->free_q.init();
+        ring->ready_q.init();
+        for(uint32_t i = 0; i < opts.slots; ++i) {
+            new (&ring->owners[i]) std::atomic<int32_t>(0);
+            ring->free_q.push(i);
+        }
+        c->ready.store(1, std::memory_order_release);
+        return ring;
+    }
+
+    // Attaches to a ring created by another process. Throws when it does not exist (yet) or is
+    // not a ring of this version.
+    static std::shared_ptr<ShmRing> open(const std::string& name) {
+        std::string path = shm_name(name);
+        int fd = ::shm_open(path.c_str(), O_RDWR, 0);
+        if(fd < 0) throw std::runtime_error("shm_open " + path + ": " + std::strerror(errno));
+        struct stat st{};
+        if(::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(ShmRingControl)) {
+            ::close(fd);
+            throw std::runtime_error("Shared-memory ring " + path + " is not initialized");
+        }
+        std::shared_ptr<ShmRing> ring(new ShmRing(path, fd, static_cast<size_t>(st.st_size), false));
+        const ShmRingControl* c = ring->control();
+        if(c->ready.load(std::memory_order_acquire) != 1 || std::memcmp(c->magic, SHM_RING_MAGIC, sizeof(c->magic)) != 0 ||
+           c->version != SHM_RING_VERSION || c->total_bytes != static_cast<uint64_t>(st.st_size))
+            throw std::runtime_error("Shared-memory ring " + path + " is not initialized or has another version");
+        ring->bind_layout();
+        return ring;
+    }
+
+    ~ShmRing() {
+        if(consumer_index >= 0) control()->consumers[consumer_index].store(0);
+        if(creator) {
+            control()->closed.store(1);
+            free_q.wake_all();
+            ready_q.wake_all();
+            ::shm_unlink(path.c_str());
+        }
+        ::munmap(base, total);
+        ::close(fd);
+    }
+
+    ShmRing(const ShmRing&) = delete;
+    ShmRing& operator=(const ShmRing&) = delete;
+
+    const std::string& name() const { return path; }
+    uint32_t slots() const { return control()->slots; }
+    size_t slot_bytes() const { return control()->slot_bytes; }
+
+    // ---- producer side ----
+
+    // Copies the parts into a free slot and queues it. Waits up to `timeout` for a slot,
+    // reclaiming slots of crashed processes before giving up.
+    ShmSendResult send(std::initializer_list<ShmPart> parts, std::chrono::milliseconds timeout) {
+        if(parts.size() == 0 || parts.size() > SHM_MAX_PARTS || message_bytes(parts) > slot_bytes()) return ShmSendResult::TooLarge;
+        int slot = acquire(timeout);
+        if(slot < 0) return ShmSendResult::Timeout;
+        uint8_t* p = slot_data(slot);
+        ShmSlotHeader h{};
+        h.parts = static_cast<uint32_t>(parts.size());
+        size_t off = SHM_PART_ALIGN, i = 0;
+        for(const auto& part : parts) {
+            h.size[i++] = part.size;
+            if(part.size) std::memcpy(p + off, part.data, part.size);
+            off += align_up(part.size, SHM_PART_ALIGN);
+        }
+        std::memcpy(p, &h, sizeof(h));
+        publish(slot);
+        return ShmSendResult::Sent;
+    }
+
+    // Free slot for the caller to fill, or -1 after `timeout`
+    int acquire(std::chrono::milliseconds timeout) {
+        uint32_t slot;
+        if(!free_q.pop(slot, std::chrono::steady_clock::now() + timeout)) {
+            if(reclaim() == 0 || !free_q.try_pop(slot)) return -1;
+        }
+        owners[slot].store(self_pid());
+        return static_cast<int>(slot);
+    }
+
+    void publish(int slot) {
+        owners[slot].store(0);
+        ready_q.push(static_cast<uint32_t>(slot));
+    }
+
+    // ---- consumer side ----
+
+    // Registers this process as a consumer, so producers know someone drains the ring
+    void attach_consumer() {
+        if(consumer_index >= 0) return;
+        for(size_t i = 0; i < SHM_MAX_CONSUMERS; ++i) {
+            int32_t expected = control()->consumers[i].load();
+            if((expected == 0 || !shm_pid_alive(expected)) &&
+               control()->consumers[i].compare_exchange_strong(expected, self_pid())) {
+                consumer_index = static_cast<int>(i);
+                return;
+            }
+        }
+        throw std::runtime_error("Shared-memory ring " + path + " has no room for another consumer");
+    }
+
+    // Consumers whose process is still alive
+    size_t consumers() const {
+        size_t n = 0;
+        for(const auto& c : control()->consumers) n += shm_pid_alive(c.load());
+        return n;
+    }
+
+    // Next slot holding a message, or -1 after `timeout`. The slot belongs to the caller until release().
+    int receive(std::chrono::milliseconds timeout) {
+        uint32_t slot;
+        if(!ready_q.pop(slot, std::chrono::steady_clock::now() + timeout)) return -1;
+        owners[slot].store(self_pid());
+        return static_cast<int>(slot);
+    }
+
+    // Parts of a received message; 0 when the slot header is corrupt
+    size_t part_count(int slot) const {
+        ShmSlotHeader h;
+        std::memcpy(&h, slot_data(slot), sizeof(h));
+        if(h.parts > SHM_MAX_PARTS) return 0;
+        size_t off = SHM_PART_ALIGN;
+        for(uint32_t i = 0; i < h.parts; ++i) {
+            if(h.size[i] > slot_bytes()) return 0;
+            off += align_up(h.size[i], SHM_PART_ALIGN);
+        }
+        return off <= slot_bytes() ? h.parts : 0;
+    }
+
+    uint8_t* part_data(int slot, size_t i) const {
+        const ShmSlotHeader* h = reinterpret_cast<const ShmSlotHeader*>(slot_data(slot));
+        size_t off = SHM_PART_ALIGN;
+        for(size_t k = 0; k < i; ++k) off += align_up(h->size[k], SHM_PART_ALIGN);
+        return slot_data(slot) + off;
+    }
+
+    size_t part_size(int slot, size_t i) const { return reinterpret_cast<const ShmSlotHeader*>(slot_data(slot))->size[i]; }
+
+    void release(int slot) {
+        owners[slot].store(0);
+        free_q.push(static_cast<uint32_t>(slot));
+    }
+
+    // ---- lifecycle ----
+
+    // Returns slots leased by processes that died with them to the free queue
+    size_t reclaim() {
+        size_t n = 0;
+        for(uint32_t i = 0; i < slots(); ++i) {
+            int32_t owner = owners[i].load();
+            if(owner != 0 && !shm_pid_alive(owner) && owners[i].compare_exchange_strong(owner, 0)) {
+                free_q.push(i);
+                n++;
+            }
+        }
+        return n;
+    }
+
+    // True once the creator has shut down or a new ring has replaced this one under the same
+    // name; attached processes then open the name again
+    bool stale() const {
+        if(control()->closed.load() != 0) return true;
+        int probe = ::shm_open(path.c_str(), O_RDONLY, 0);
+        if(probe < 0) return true;
+        struct stat now{}, mine{};
+        bool same = ::fstat(probe, &now) == 0 && ::fstat(fd, &mine) == 0 && now.st_ino == mine.st_ino && now.st_dev == mine.st_dev;
+        ::close(probe);
+        return !same;
+    }
+
+private:
+    ShmRing(std::string path, int fd, size_t total, bool creator) : path(std::move(path)), fd(fd), total(total), creator(creator) {
+        base = static_cast<uint8_t*>(::mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+        if(base == MAP_FAILED) {
+            std::string err = std::strerror(errno);
+            ::close(fd);
+            if(creator) ::shm_unlink(this->path.c_str());
+            throw std::runtime_error("mmap " + this->path + ": " + err);
+        }
+    }
+
+    static uint64_t align_up(uint64_t v, uint64_t a) { return (v + a - 1) / a * a; }
+    static int32_t self_pid() { return static_cast<int32_t>(::getpid()); } // not cached: forked children have their own
+
+    ShmRingControl* control() const { return reinterpret_cast<ShmRingControl*>(base); }
+    uint8_t* slot_data(int slot) const { return base + control()->data_off + static_cast<size_t>(slot) * control()->slot_bytes; }
+
+    void bind_layout() {
+        const ShmRingControl* c = control();
+        free_q = ShmIndexQueue(base + c->free_off, c->queue_capacity);
+        ready_q = ShmIndexQueue(base + c->ready_off, c->queue_capacity);
+        owners = reinterpret_cast<std::atomic<int32_t>*>(base + c->owners_off);
+    }
+
+    std::string path;
+    int fd;
+    size_t total;
+    bool creator;
+    uint8_t* base = nullptr;
+    ShmIndexQueue free_q, ready_q;
+    std::atomic<int32_t>* owners = nullptr;
+    int consumer_index = -1;
+};
@@ -0,0 +1,162 @@
+#pragma once
+#include <zmq.hpp>
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "common/shm_ring.hpp"
+
+// shm:// hops between stages on one host (see shm_ring.hpp). The binding stage of a hop (the
+// generator, the logger) creates the ring; the connecting stage (a processor) attaches to it and
+// keeps reattaching when the creator restarts. TCP/IPC endpoints listed next to the shm:// one
+// stay connected as the fallback.
+
+// Producer end. Copies each multipart frame into one slot.
+class ShmSender {
+public:
+    ShmSender(const std::string& name, bool create, const ShmRing::Options& opts = {}) : name(name), create(create) {
+        if(create) ring = ShmRing::create(name, opts);
+    }
+
+    // Waits for a free slot (in 200 ms steps, while keep_going() holds). NoConsumer when nothing
+    // drains the ring, TooLarge when the frame does not fit a slot: the caller then uses ZMQ.
+    template <typename KeepGoing>
+    ShmSendResult send(std::initializer_list<ShmPart> parts, KeepGoing keep_going) {
+        for(;;) {
+            if(!attached()) return ShmSendResult::NoConsumer;
+            ShmSendResult r = ring->send(parts, std::chrono::milliseconds(200));
+            if(r != ShmSendResult::Timeout || !keep_going()) return r;
+        }
+    }
+
+    // A ring with at least one live consumer
+    bool attached() {
+        if(!create) reattach();
+        return ring && ring->consumers() > 0;
+    }
+
+private:
+    // The consumer's ring, opened at most every 200 ms while missing or replaced
+    void reattach() {
+        auto now = std::chrono::steady_clock::now();
+        if(now < next_check) return;
+        next_check = now + std::chrono::milliseconds(200);
+        if(ring && !ring->stale()) return;
+        try { ring = ShmRing::open(name); }
+        catch(const std::exception&) { ring.reset(); }
+    }
+
+    std::string name;
+    bool create;
+    std::shared_ptr<ShmRing> ring;
+    std::chrono::steady_clock::time_point next_check{};
+};
+
+// Consumer end. A thread takes frames off the ring and pushes them, without copying, to
+// `inproc_endpoint`, which the stage's PULL socket binds next to its ZMQ endpoints, so the
+// receive loop handles both alike. Every part is a zmq::message_t over the slot; the slot goes
+// back to the ring once all parts are released, wherever they end up (a queue, a file write,
+// a ZMQ send to the next stage).
+class ShmReceiver {
+public:
+    ShmReceiver(zmq::context_t& ctx, const std::string& inproc_endpoint, const std::string& name, bool create,
+                const ShmRing::Options& opts, std::function<void(const std::string&)> on_error)
+        : push(ctx, zmq::socket_type::push), name(name), create(create), on_error(std::move(on_error)) {
+        if(create) {
+            ring = ShmRing::create(name, opts);
+            ring->attach_consumer();
+        }
+        push.set(zmq::sockopt::sndtimeo, 200);
+        push.set(zmq::sockopt::linger, 0);
+        push.connect(inproc_endpoint);
+        thread = std::thread([this]{ run(); });
+    }
+
+    ~ShmReceiver() {
+        stop = true;
+        thread.join();
+    }
+
+    uint64_t frames() const { return received.load(std::memory_order_relaxed); }
+
+private:
+    struct Lease {
+        std::shared_ptr<ShmRing> ring;
+        int slot;
+        std::atomic<int> refs;
+    };
+
+    static void release_part(void*, void* hint) {
+        auto* lease = static_cast<Lease*>(hint);
+        if(lease->refs.fetch_sub(1) == 1) {
+            lease->ring->release(lease->slot);
+            delete lease;
+        }
+    }
+
+    void run() {
+        bool reported = false;
+        while(!stop) {
+            if(!ring) {
+                try {
+                    ring = ShmRing::open(name);
+                    ring->attach_consumer();
+                    reported = false;
+                } catch(const std::exception& e) {
+                    ring.reset();
+                    if(!reported) on_error(std::string("Waiting for shared-memory ring: ") + e.what());
+                    reported = true;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                    continue;
+                }
+            }
+            int slot = ring->receive(std::chrono::milliseconds(200));
+            if(slot < 0) {
+                if(!create && ring->stale()) ring.reset(); // the producer restarted with a new ring
+                continue;
+            }
+            forward(slot);
+        }
+    }
+
+    void forward(int slot) {
+        size_t parts = ring->part_count(slot);
+        if(parts == 0) {
+            on_error("Dropping a corrupt message from shared-memory ring " + ring->name());
+            ring->release(slot);
+            return;
+        }
+        auto* lease = new Lease{ring, slot, {static_cast<int>(parts)}};
+        std::vector<zmq::message_t> msgs;
+        msgs.reserve(parts);
+        for(size_t i = 0; i < parts; ++i)
+            msgs.emplace_back(ring->part_data(slot, i), ring->part_size(slot, i), release_part, lease);
+        // The first part waits for room in the inproc pipe; the rest of a multipart message follows atomically
+        while(!push.send(msgs[0], parts > 1 ? zmq::send_flags::sndmore : zmq::send_flags::none))
+            if(stop) return; // unsent parts release the slot as they go out of scope
+        for(size_t i = 1; i < parts; ++i)
+            push.send(msgs[i], i + 1 < parts ? zmq::send_flags::sndmore : zmq::send_flags::none);
+        received.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    zmq::socket_t push;
+    std::string name;
+    bool create;
+    std::function<void(const std::string&)> on_error;
+    std::shared_ptr<ShmRing> ring;
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> received{0};
+    std::thread thread;
+};
+
+// Ring geometry of the binding stage: section["shm_slots"] slots of section["shm_slot_mb"] MB
+inline ShmRing::Options shm_ring_options(const nlohmann::json& section) {
+    ShmRing::Options o;
+    o.slots = section.value("shm_slots", o.slots);
+    o.slot_bytes = static_cast<size_t>(section.value("shm_slot_mb", static_cast<int>(o.slot_bytes >> 20))) << 20;
+    return o;
+}
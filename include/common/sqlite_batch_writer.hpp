@@ -0,0 +1,307 @@
+#pragma once
+#include <sqlite3.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "common/bounded_queue.hpp"
+#include "common/latency_trace.hpp"
+#include "common/seq_tracker.hpp"
+
+// One row of the `images` table
+struct ImageRecord {
+    std::string image_id;
+    int64_t seq = 0;
+    uint32_t source = 0;      // generator replay log the seq belongs to (NULL when 0: not tracked)
+    std::string timestamp;
+    std::string path;
+    int num_keypoints = 0;
+    std::vector<uint8_t> kp_blob;
+    std::string extra;        // frame header JSON extension, stored as is (NULL when empty)
+    TraceStamps trace;
+    bool store_trace = false; // write `trace` as JSON into the row's trace column
+    bool failed = false;      // set by the writer when the row did not make it into the database
+};
+
+// A tracked source as found in the database at startup: its progress row plus the seqs
+// committed above the watermark
+struct RecoveredSource {
+    SourceProgress progress;
+    std::vector<uint64_t> committed_above;
+};
+
+// Owns the SQLite connection and writes ImageRecords from a dedicated thread.
+// Records are grouped into one transaction per batch: a batch is committed once it
+// holds `batch_size` rows or its first row is `flush_interval_ms` old, whichever
+// comes first. The insert statement is prepared once and reused for every row.
+// Rows are keyed on image_id, so storing a replayed frame again leaves one row.
+// Per-source sequence progress (record_progress) is written in the same transactions,
+// into the `sources` table.
+class SqliteBatchWriter {
+public:
+    struct Options {
+        size_t batch_size = 64;
+        int flush_interval_ms = 100;
+        std::string synchronous = "NORMAL"; // OFF | NORMAL | FULL | EXTRA
+        size_t queue_capacity = 1024;
+        // Runs on the writer thread right after each COMMIT with the rows it contained
+        // and the time BEGIN..COMMIT took
+        std::function<void(std::vector<ImageRecord>&, double commit_seconds)> on_commit;
+    };
+
+    using ErrorFn = std::function<void(const std::string&)>;
+
+    SqliteBatchWriter(const std::string& db_path, const Options& opts,
+                      ErrorFn on_error = [](const std::string& e){ std::cerr << "[SqliteBatchWriter ERROR] " << e << std::endl; })
+        : opts(opts), on_error(std::move(on_error)), records(opts.queue_capacity) {
+        if(this->opts.batch_size == 0) this->opts.batch_size = 1;
+        const std::string& sync = this->opts.synchronous;
+        if(sync != "OFF" && sync != "NORMAL" && sync != "FULL" && sync != "EXTRA")
+            throw std::runtime_error("Invalid SQLite synchronous mode: " + sync);
+
+        if(sqlite3_open(db_path.c_str(), &db) != SQLITE_OK) {
+            std::string err = sqlite3_errmsg(db);
+            sqlite3_close(db);
+            throw std::runtime_error("Can't open DB: " + db_path + " (" + err + ")");
+        }
+        exec("PRAGMA journal_mode=WAL;");
+        exec("PRAGMA synchronous=" + sync + ";");
+        exec(R"(
+            CREATE TABLE IF NOT EXISTS images(
+                id TEXT PRIMARY KEY,
+                seq INTEGER,
+                timestamp TEXT,
+                path TEXT,
+                num_keypoints INTEGER,
+                kp_blob BLOB,
+                trace TEXT,
+                extra TEXT,
+                source INTEGER
+            );
+        )");
+        // Databases created before the trace / extra / source columns existed
+        sqlite3_exec(db, "ALTER TABLE images ADD COLUMN trace TEXT;", nullptr, nullptr, nullptr);
+        sqlite3_exec(db, "ALTER TABLE images ADD COLUMN extra TEXT;", nullptr, nullptr, nullptr);
+        sqlite3_exec(db, "ALTER TABLE images ADD COLUMN source INTEGER;", nullptr, nullptr, nullptr);
+        exec("CREATE INDEX IF NOT EXISTS images_source_seq ON images(source, seq) WHERE source IS NOT NULL;");
+        exec(R"(
+            CREATE TABLE IF NOT EXISTS sources(
+                source INTEGER PRIMARY KEY,
+                contiguous_seq INTEGER NOT NULL,
+                lost INTEGER NOT NULL DEFAULT 0
+            );
+        )");
+
+        const char* insert_sql = "INSERT OR REPLACE INTO images(id,seq,timestamp,path,num_keypoints,kp_blob,trace,extra,source) VALUES(?,?,?,?,?,?,?,?,?);";
+        const char* progress_sql = "INSERT OR REPLACE INTO sources(source,contiguous_seq,lost) VALUES(?,?,?);";
+        if(sqlite3_prepare_v2(db, insert_sql, -1, &insert_stmt, nullptr) != SQLITE_OK ||
+           sqlite3_prepare_v2(db, progress_sql, -1, &progress_stmt, nullptr) != SQLITE_OK) {
+            std::string err = sqlite3_errmsg(db);
+            sqlite3_finalize(insert_stmt);
+            sqlite3_close(db);
+            throw std::runtime_error("Failed to prepare insert statement: " + err);
+        }
+        recover_sources();
+
+        writer = std::thread([this]{ run(); });
+    }
+
+    // Commits everything still queued before closing the database
+    ~SqliteBatchWriter() {
+        records.close();
+        if(writer.joinable()) writer.join();
+        sqlite3_finalize(insert_stmt);
+        sqlite3_finalize(progress_stmt);
+        sqlite3_close(db);
+    }
+
+    SqliteBatchWriter(const SqliteBatchWriter&) = delete;
+    SqliteBatchWriter& operator=(const SqliteBatchWriter&) = delete;
+
+    // Queue a record for the writer thread; blocks only while the queue is full
+    bool submit(ImageRecord rec) {
+        if(!records.push(Pending{std::move(rec), false})) return false;
+        submitted++;
+        return true;
+    }
+
+    // Commit the current partial batch now and block until every record submitted
+    // so far has been committed (or failed)
+    void wait_committed() {
+        records.push(Pending{ImageRecord(), true});
+        std::unique_lock<std::mutex> lock(done_mtx);
+        done_cv.wait(lock, [&]{ return done.load() >= submitted.load(); });
+    }
+
+    // Written with the next commit (or within flush_interval_ms when idle); a newer
+    // progress of the same source replaces one still waiting
+    void record_progress(const std::vector<SourceProgress>& progress) {
+        if(progress.empty()) return;
+        std::lock_guard<std::mutex> lock(progress_mtx);
+        for(const auto& p : progress) pending_progress[p.source] = p;
+    }
+
+    // Tracked sources found when the database was opened
+    const std::vector<RecoveredSource>& recovered_sources() const { return recovered; }
+
+    size_t queue_depth() const { return records.size(); }
+    uint64_t rows_committed() const { return committed.load(); }
+    uint64_t commits() const { return num_commits.load(); }
+
+private:
+    // Queue entry; a barrier entry carries no row and forces the current batch out
+    struct Pending {
+        ImageRecord rec;
+        bool barrier = false;
+    };
+
+    bool exec(const std::string& sql) {
+        char* err = nullptr;
+        if(sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &err) != SQLITE_OK) {
+            on_error("SQL failed: " + sql + " (" + (err ? err : "unknown") + ")");
+            sqlite3_free(err);
+            return false;
+        }
+        return true;
+    }
+
+    // Progress rows plus the seqs committed above each watermark. Rows of a source whose
+    // progress was never written (crash before the first one) are found as well.
+    void recover_sources() {
+        std::map<uint32_t, RecoveredSource> found;
+        sqlite3_stmt* st = nullptr;
+        if(sqlite3_prepare_v2(db, "SELECT source, contiguous_seq, lost FROM sources;", -1, &st, nullptr) == SQLITE_OK) {
+            while(sqlite3_step(st) == SQLITE_ROW) {
+                SourceProgress p;
+                p.source = static_cast<uint32_t>(sqlite3_column_int64(st, 0));
+                p.contiguous = static_cast<uint64_t>(sqlite3_column_int64(st, 1));
+                p.lost = static_cast<uint64_t>(sqlite3_column_int64(st, 2));
+                found[p.source].progress = p;
+            }
+        }
+        sqlite3_finalize(st);
+        st = nullptr;
+        if(sqlite3_prepare_v2(db, "SELECT DISTINCT source FROM images WHERE source IS NOT NULL;", -1, &st, nullptr) == SQLITE_OK) {
+            while(sqlite3_step(st) == SQLITE_ROW) {
+                uint32_t source = static_cast<uint32_t>(sqlite3_column_int64(st, 0));
+                found[source].progress.source = source;
+            }
+        }
+        sqlite3_finalize(st);
+        st = nullptr;
+        if(sqlite3_prepare_v2(db, "SELECT seq FROM images WHERE source = ? AND seq > ? ORDER BY seq;", -1, &st, nullptr) == SQLITE_OK) {
+            for(auto& [source, r] : found) {
+                sqlite3_bind_int64(st, 1, source);
+                sqlite3_bind_int64(st, 2, static_cast<sqlite3_int64>(r.progress.contiguous));
+                while(sqlite3_step(st) == SQLITE_ROW) r.committed_above.push_back(static_cast<uint64_t>(sqlite3_column_int64(st, 0)));
+                sqlite3_reset(st);
+            }
+        }
+        sqlite3_finalize(st);
+        for(auto& [source, r] : found) recovered.push_back(std::move(r));
+    }
+
+    void run() {
+        std::vector<ImageRecord> batch;
+        batch.reserve(opts.batch_size);
+        auto deadline = std::chrono::steady_clock::now();
+        for(;;) {
+            // While idle, wake every flush interval to write progress that arrived without rows
+            auto item = records.pop_until(batch.empty() ? std::chrono::steady_clock::now() + std::chrono::milliseconds(opts.flush_interval_ms) : deadline);
+            if(!item && batch.empty()) {
+                flush(batch);
+                if(records.is_closed() && records.size() == 0) break; // closed and drained
+                continue;
+            }
+            if(item && !item->barrier) {
+                if(batch.empty()) deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(opts.flush_interval_ms);
+                batch.push_back(std::move(item->rec));
+                if(batch.size() < opts.batch_size && std::chrono::steady_clock::now() < deadline) continue;
+            }
+            flush(batch); // batch full, interval elapsed, barrier, or queue closed
+        }
+    }
+
+    void flush(std::vector<ImageRecord>& batch) {
+        std::map<uint32_t, SourceProgress> progress;
+        {
+            std::lock_guard<std::mutex> lock(progress_mtx);
+            progress.swap(pending_progress);
+        }
+        if(batch.empty() && progress.empty()) return;
+        auto begin = std::chrono::steady_clock::now();
+        exec("BEGIN;");
+        uint64_t ok = 0;
+        for(auto& r : batch) {
+            sqlite3_bind_text(insert_stmt, 1, r.image_id.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_int64(insert_stmt, 2, r.seq);
+            sqlite3_bind_text(insert_stmt, 3, r.timestamp.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_text(insert_stmt, 4, r.path.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_int(insert_stmt, 5, r.num_keypoints);
+            if(!r.kp_blob.empty()) sqlite3_bind_blob(insert_stmt, 6, r.kp_blob.data(), static_cast<int>(r.kp_blob.size()), SQLITE_STATIC);
+            else sqlite3_bind_null(insert_stmt, 6);
+            std::string trace = r.store_trace ? r.trace.to_json().dump() : std::string();
+            if(r.store_trace) sqlite3_bind_text(insert_stmt, 7, trace.c_str(), -1, SQLITE_TRANSIENT);
+            else sqlite3_bind_null(insert_stmt, 7);
+            if(!r.extra.empty()) sqlite3_bind_text(insert_stmt, 8, r.extra.data(), static_cast<int>(r.extra.size()), SQLITE_STATIC);
+            else sqlite3_bind_null(insert_stmt, 8);
+            if(r.source != 0) sqlite3_bind_int64(insert_stmt, 9, r.source);
+            else sqlite3_bind_null(insert_stmt, 9);
+            if(sqlite3_step(insert_stmt) == SQLITE_DONE) ok++;
+            else { on_error("Insert failed for " + r.image_id + ": " + sqlite3_errmsg(db)); r.failed = true; }
+            sqlite3_reset(insert_stmt);
+            sqlite3_clear_bindings(insert_stmt);
+        }
+        for(const auto& [source, p] : progress) {
+            sqlite3_bind_int64(progress_stmt, 1, p.source);
+            sqlite3_bind_int64(progress_stmt, 2, static_cast<sqlite3_int64>(p.contiguous));
+            sqlite3_bind_int64(progress_stmt, 3, static_cast<sqlite3_int64>(p.lost));
+            if(sqlite3_step(progress_stmt) != SQLITE_DONE) on_error(std::string("Progress update failed: ") + sqlite3_errmsg(db));
+            sqlite3_reset(progress_stmt);
+        }
+        if(!exec("COMMIT;")) {
+            if(!sqlite3_get_autocommit(db)) exec("ROLLBACK;");
+            for(auto& r : batch) r.failed = true;
+            ok = 0;
+            std::lock_guard<std::mutex> lock(progress_mtx);
+            for(const auto& [source, p] : progress) pending_progress.emplace(source, p); // unless a newer one arrived
+        }
+        committed += ok;
+        if(batch.empty()) return;
+        num_commits++;
+        if(opts.on_commit) opts.on_commit(batch, std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+        {
+            std::lock_guard<std::mutex> lock(done_mtx);
+            done += batch.size();
+        }
+        done_cv.notify_all();
+        batch.clear();
+    }
+
+    Options opts;
+    ErrorFn on_error;
+    sqlite3* db = nullptr;
+    sqlite3_stmt* insert_stmt = nullptr;
+    sqlite3_stmt* progress_stmt = nullptr;
+    BoundedQueue<Pending> records;
+    std::thread writer;
+
+    std::atomic<uint64_t> submitted{0};
+    std::atomic<uint64_t> done{0};
+    std::atomic<uint64_t> committed{0};
+    std::atomic<uint64_t> num_commits{0};
+    std::mutex done_mtx;
+    std::condition_variable done_cv;
+
+    std::mutex progress_mtx;
+    std::map<uint32_t, SourceProgress> pending_progress;
+    std::vector<RecoveredSource> recovered;
+};
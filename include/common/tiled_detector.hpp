@@ -0,0 +1,210 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "common/bounded_queue.hpp"
+
+// Tiled detection for very large frames: the image is cut into a grid of `tile_size`
+// core tiles, each detected on a copy-free view padded by `overlap` pixels on every side
+// so keypoints near a tile edge still get their full neighbourhood (scale space and
+// descriptor support). A keypoint is only kept by the tile whose core contains it, which
+// removes the duplicates found twice in the overlap zones. Tiles are spread over
+// `threads` threads, each with its own detector from the factory: the calling thread plus
+// a pool of `threads - 1` workers, started on the first tiled frame and kept until the
+// TiledDetector is destroyed.
+struct TilingOptions {
+    int tile_size = 0;        // core tile edge in pixels; 0 disables tiling
+    int overlap = 64;         // padding around each core tile
+    double min_megapixels = 8; // smaller frames are detected in one piece
+    int threads = 0;          // 0 = hardware_concurrency
+
+    // Options from `processor.tiling`
+    static TilingOptions from_config(const nlohmann::json& t) {
+        TilingOptions o;
+        if(!t.value("enabled", false)) return o;
+        o.tile_size = t.value("tile_size", 1024);
+        o.overlap = t.value("overlap", o.overlap);
+        o.min_megapixels = t.value("min_megapixels", o.min_megapixels);
+        o.threads = t.value("threads", o.threads);
+        if(o.tile_size < 64) throw std::runtime_error("processor.tiling.tile_size must be >= 64");
+        if(o.overlap < 0) throw std::runtime_error("processor.tiling.overlap must be >= 0");
+        return o;
+    }
+};
+
+struct DetectionTile {
+    cv::Rect core;   // keypoints inside this rect belong to the tile
+    cv::Rect padded; // region handed to the detector
+};
+
+// Row-major grid of tiles covering `size`; the last row/column takes the remainder
+inline std::vector<DetectionTile> make_detection_tiles(cv::Size size, int tile_size, int overlap) {
+    std::vector<DetectionTile> tiles;
+    cv::Rect image(0, 0, size.width, size.height);
+    for(int y = 0; y < size.height; y += tile_size) {
+        for(int x = 0; x < size.width; x += tile_size) {
+            cv::Rect core(x, y, std::min(tile_size, size.width - x), std::min(tile_size, size.height - y));
+            cv::Rect padded(core.x - overlap, core.y - overlap, core.width + 2 * overlap, core.height + 2 * overlap);
+            tiles.push_back({core, padded & image});
+        }
+    }
+    return tiles;
+}
+
+class TiledDetector {
+public:
+    using Factory = std::function<cv::Ptr<cv::Feature2D>()>;
+
+    // `max_features` > 0 keeps only the strongest keypoints by response across all tiles.
+    // The factory's detectors should not cap their own output (e.g. SIFT nfeatures = 0),
+    // otherwise a tile may drop keypoints that would have made the global cut.
+    TiledDetector(Factory factory, TilingOptions opts, int max_features = 0)
+        : factory(std::move(factory)), opts(opts), max_features(max_features),
+          detectors(thread_count(opts)), jobs(detectors.size()) {}
+
+    ~TiledDetector() {
+        jobs.close();
+        for(auto& th : pool) th.join();
+    }
+
+    TiledDetector(const TiledDetector&) = delete;
+    TiledDetector& operator=(const TiledDetector&) = delete;
+
+    bool applies(const cv::Mat& img) const {
+        return opts.tile_size > 0 && static_cast<double>(img.total()) >= opts.min_megapixels * 1e6;
+    }
+
+    // Not reentrant: one frame at a time per TiledDetector (each detect worker owns one)
+    void detectAndCompute(const cv::Mat& img, std::vector<cv::KeyPoint>& keypoints, cv::Mat& descriptors) {
+        std::vector<DetectionTile> tiles = make_detection_tiles(img.size(), opts.tile_size, opts.overlap);
+        std::vector<TileResult> results(tiles.size());
+
+        // Every pool worker handed the job pulls tile indices until none are left, as does
+        // this thread; the job lives on this stack, so wait for all of them to let go of it
+        TileJob job(img, tiles, results);
+        size_t helpers = std::min(detectors.size(), tiles.size());
+        helpers = helpers > 0 ? helpers - 1 : 0;
+        if(helpers > 0 && pool.empty()) start_pool();
+        job.pending = helpers;
+        for(size_t i = 0; i < helpers; ++i) jobs.push(&job);
+        run_tiles(0, job);
+        {
+            std::unique_lock<std::mutex> lock(job.mtx);
+            job.done.wait(lock, [&]{ return job.pending == 0; });
+        }
+        if(job.error) std::rethrow_exception(job.error);
+
+        merge(results, keypoints, descriptors);
+    }
+
+private:
+    struct TileResult {
+        std::vector<cv::KeyPoint> kps; // image coordinates, core keypoints only
+        cv::Mat desc;
+    };
+
+    // One frame's tiles, shared by the calling thread and the pool workers it was handed to
+    struct TileJob {
+        TileJob(const cv::Mat& img, const std::vector<DetectionTile>& tiles, std::vector<TileResult>& results)
+            : img(img), tiles(tiles), results(results) {}
+        const cv::Mat& img;
+        const std::vector<DetectionTile>& tiles;
+        std::vector<TileResult>& results;
+        std::atomic<size_t> next{0};
+        std::mutex mtx;
+        std::condition_variable done;
+        size_t pending = 0;       // pool workers still holding the job
+        std::exception_ptr error; // first detector failure, rethrown by the caller
+    };
+
+    static size_t thread_count(const TilingOptions& opts) {
+        int n = opts.threads > 0 ? opts.threads : static_cast<int>(std::thread::hardware_concurrency());
+        return static_cast<size_t>(std::max(1, n));
+    }
+
+    void start_pool() {
+        for(size_t t = 1; t < detectors.size(); ++t)
+            pool.emplace_back([this, t]{
+                while(auto job = jobs.pop()) {
+                    run_tiles(t, **job);
+                    std::lock_guard<std::mutex> lock((*job)->mtx);
+                    if(--(*job)->pending == 0) (*job)->done.notify_one();
+                }
+            });
+    }
+
+    // Detect tiles of `job` with thread t's detector until none are left
+    void run_tiles(size_t t, TileJob& job) {
+        try {
+            if(!detectors[t]) detectors[t] = factory();
+            for(size_t i = job.next++; i < job.tiles.size(); i = job.next++) detect_tile(*detectors[t], job.img, job.tiles[i], job.results[i]);
+        } catch(...) {
+            job.next = job.tiles.size();
+            std::lock_guard<std::mutex> lock(job.mtx);
+            if(!job.error) job.error = std::current_exception();
+        }
+    }
+
+    static void detect_tile(cv::Feature2D& detector, const cv::Mat& img, const DetectionTile& tile, TileResult& out) {
+        std::vector<cv::KeyPoint> kps;
+        cv::Mat desc;
+        detector.detectAndCompute(img(tile.padded), cv::noArray(), kps, desc);
+        const float ox = static_cast<float>(tile.padded.x), oy = static_cast<float>(tile.padded.y);
+        const float x0 = static_cast<float>(tile.core.x), x1 = static_cast<float>(tile.core.x + tile.core.width);
+        const float y0 = static_cast<float>(tile.core.y), y1 = static_cast<float>(tile.core.y + tile.core.height);
+        std::vector<int> keep;
+        for(size_t i = 0; i < kps.size(); ++i) {
+            kps[i].pt.x += ox;
+            kps[i].pt.y += oy;
+            if(kps[i].pt.x >= x0 && kps[i].pt.x < x1 && kps[i].pt.y >= y0 && kps[i].pt.y < y1) keep.push_back(static_cast<int>(i));
+        }
+        out.kps.reserve(keep.size());
+        if(!desc.empty()) out.desc.create(static_cast<int>(keep.size()), desc.cols, desc.type());
+        for(size_t j = 0; j < keep.size(); ++j) {
+            out.kps.push_back(kps[keep[j]]);
+            if(!desc.empty()) desc.row(keep[j]).copyTo(out.desc.row(static_cast<int>(j)));
+        }
+    }
+
+    // Concatenate the tiles (keeping the strongest max_features when set) into one list
+    // and one descriptor matrix
+    void merge(const std::vector<TileResult>& results, std::vector<cv::KeyPoint>& keypoints, cv::Mat& descriptors) const {
+        std::vector<std::pair<int, int>> refs; // (tile, index)
+        int cols = 0, type = CV_32F;
+        for(size_t t = 0; t < results.size(); ++t) {
+            for(size_t i = 0; i < results[t].kps.size(); ++i) refs.emplace_back(static_cast<int>(t), static_cast<int>(i));
+            if(!results[t].desc.empty()) { cols = results[t].desc.cols; type = results[t].desc.type(); }
+        }
+        if(max_features > 0 && refs.size() > static_cast<size_t>(max_features)) {
+            auto stronger = [&](const std::pair<int, int>& a, const std::pair<int, int>& b) {
+                return results[a.first].kps[a.second].response > results[b.first].kps[b.second].response;
+            };
+            std::nth_element(refs.begin(), refs.begin() + max_features, refs.end(), stronger);
+            refs.resize(static_cast<size_t>(max_features));
+            std::sort(refs.begin(), refs.end()); // back to tile order
+        }
+        keypoints.clear();
+        keypoints.reserve(refs.size());
+        descriptors = cols ? cv::Mat(static_cast<int>(refs.size()), cols, type) : cv::Mat();
+        for(size_t k = 0; k < refs.size(); ++k) {
+            const TileResult& r = results[refs[k].first];
+            keypoints.push_back(r.kps[refs[k].second]);
+            if(cols) r.desc.row(refs[k].second).copyTo(descriptors.row(static_cast<int>(k)));
+        }
+    }
+
+    Factory factory;
+    TilingOptions opts;
+    int max_features;
+    std::vector<cv::Ptr<cv::Feature2D>> detectors; // one per thread, created on first use
+    BoundedQueue<TileJob*> jobs;   // at most detectors.size() - 1 hand-offs per frame
+    std::vector<std::thread> pool; // detectors.size() - 1 workers, joined by the destructor
+};
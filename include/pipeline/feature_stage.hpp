@@ -0,0 +1,476 @@
+#pragma once
+#include <zmq.hpp>
+#include <opencv2/opencv.hpp>
+#include <nlohmann/json.hpp>
+#include <vector>
+#include <cerrno>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <map>
+#include "common/ipc_utils.hpp"
+#include "common/frame_header.hpp"
+#include "common/dual_logger.hpp"
+#include "common/bounded_queue.hpp"
+#include "common/latency_trace.hpp"
+#include "common/metrics.hpp"
+#include "common/flow_control.hpp"
+#include "common/preprocess.hpp"
+#include "common/feature_detector.hpp"
+#include "common/tiled_detector.hpp"
+#include "common/shm_transport.hpp"
+
+// The processor stage: pulls header + image frames, runs them through decode -> detect ->
+// serialize worker pools and pushes header + image + keypoint blob on to the logger, in
+// arrival order unless `ordered_output` is off. Unmodified images are forwarded as the
+// received message. With flow control it grants the generator one credit per frame done.
+//
+// Set up in the constructor (throws std::runtime_error), then run() until `running` clears;
+// run() finishes every frame already received before it returns. The processor binary runs
+// one on its own; InProcessPipeline composes it with the other stages over inproc://.
+class FeatureStage {
+public:
+    struct Options {
+        std::vector<std::string> pull_endpoints; // ZMQ endpoints, without the shm:// ones
+        std::vector<std::string> push_endpoints;
+        std::string pull_desc, push_desc;        // as configured, for log lines
+        std::string shm_in_name, shm_out_name;   // "" = no shared-memory ring
+        std::string detector = "sift";
+        nlohmann::json detector_params = nlohmann::json::object();
+        TilingOptions tiling;
+        int num_workers = 1;
+        int queue_capacity = 2;
+        bool ordered_output = true;
+        bool reencode_jpeg = false;
+        std::string encoding_name = "float32";
+        uint8_t descriptor_encoding = KP_DESC_FLOAT32;
+        PreprocessOptions preprocess;
+        int rcvhwm = 1000;
+        int sndhwm = 1000;
+        int max_frame_age_ms = 0;
+        bool flow_control = false;
+        std::vector<std::string> credit_endpoints;
+        uint32_t credit_window = 4;
+        std::chrono::milliseconds credit_refresh{1000};
+        int metrics_port = 0;
+
+        // Options from the `processor` config section
+        static Options from_config(const nlohmann::json& p) {
+            Options o;
+            try {
+                o.pull_endpoints = config::endpoints(p, "subscribe_endpoints", "subscribe_port");
+                o.push_endpoints = config::endpoints(p, "publish_endpoints", "publish_port");
+                o.pull_desc = config::join(o.pull_endpoints);
+                o.push_desc = config::join(o.push_endpoints);
+                o.shm_in_name = config::take_shm_endpoint(o.pull_endpoints);
+                o.shm_out_name = config::take_shm_endpoint(o.push_endpoints);
+            } catch(const std::exception& e) { throw std::runtime_error(std::string("Invalid processor endpoints: ") + e.what()); }
+            o.detector = p.value("detector", o.detector);
+            o.detector_params = ::detector_params(p);
+            try { create_detector(o.detector, o.detector_params); } // validate before starting anything
+            catch(const std::exception& e) { throw std::runtime_error(std::string("Invalid detector config: ") + e.what()); }
+            o.tiling = TilingOptions::from_config(p.value("tiling", nlohmann::json::object()));
+            o.num_workers = p.value("num_workers", 0);
+            if(o.num_workers <= 0) o.num_workers = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+            o.queue_capacity = p.value("queue_capacity", 2 * o.num_workers);
+            // Tile threads share the cores with the other detect workers
+            if(o.tiling.threads <= 0) o.tiling.threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) / o.num_workers);
+            o.ordered_output = p.value("ordered_output", o.ordered_output);
+            o.reencode_jpeg = p.value("reencode_jpeg", o.reencode_jpeg);
+            o.encoding_name = p.value("descriptor_encoding", o.encoding_name);
+            o.descriptor_encoding = parse_descriptor_encoding(o.encoding_name);
+            o.preprocess = PreprocessOptions::from_config(p);
+            o.rcvhwm = p.value("rcvhwm", o.rcvhwm);
+            o.sndhwm = p.value("sndhwm", o.sndhwm);
+            o.max_frame_age_ms = p.value("max_frame_age_ms", o.max_frame_age_ms);
+            o.flow_control = p.value("flow_control", false);
+            if(o.flow_control) {
+                try { o.credit_endpoints = config::endpoints(p, "credit_endpoints", "credit_port"); }
+                catch(const std::exception& e) { throw std::runtime_error(std::string("Invalid processor credit endpoints: ") + e.what()); }
+            }
+            o.credit_window = p.value("credit_window", 2 * o.queue_capacity);
+            o.credit_refresh = std::chrono::milliseconds(p.value("credit_refresh_ms", 1000));
+            o.metrics_port = p.value("metrics_port", 0);
+            return o;
+        }
+    };
+
+    FeatureStage(const Options& opts, DualLogger& logger, zmq::context_t& ctx)
+        : opts(opts), logger(logger),
+          pull_sock(ctx, zmq::socket_type::pull), push_sock(ctx, zmq::socket_type::push), credit_sock(ctx, zmq::socket_type::push),
+          decode_q(opts.queue_capacity), detect_q(opts.queue_capacity), serialize_q(opts.queue_capacity), send_q(opts.queue_capacity),
+          frames_in(metrics.counter("processor_frames_received_total", "Frames received from the generator")),
+          frames_out(metrics.counter("processor_frames_sent_total", "Frames pushed to the logger")),
+          decode_drops(metrics.counter("processor_frames_dropped_total", "Frames dropped by the processor", "reason=\"decode\"")),
+          stale_drops(metrics.counter("processor_frames_dropped_total", "Frames dropped by the processor", "reason=\"stale\"")),
+          header_drops(metrics.counter("processor_frames_dropped_total", "Frames dropped by the processor", "reason=\"header\"")),
+          shm_drops(metrics.counter("processor_frames_dropped_total", "Frames dropped by the processor", "reason=\"shm\"")),
+          drops_reported(metrics.counter("processor_drop_notices_total", "Header-only notices of dropped frames pushed to the logger")),
+          shm_frames(metrics.counter("processor_shm_frames_sent_total", "Frames handed to the logger through the shared-memory ring")),
+          shm_oversize(metrics.counter("processor_shm_oversize_total", "Frames too large for a shared-memory slot (sent over ZMQ when configured, else dropped)")),
+          bytes_out(metrics.counter("processor_bytes_sent_total", "Image and keypoint bytes pushed to the logger")),
+          detect_seconds(metrics.histogram("processor_detect_seconds", "detectAndCompute time per frame", exponential_buckets(1e-4, 2, 16),
+                                           "detector=\"" + opts.detector + "\"")),
+          tiled_frames(metrics.counter("processor_tiled_frames_total", "Frames detected tile by tile")),
+          keypoints(metrics.histogram("processor_keypoints_per_frame", "Keypoints found per frame", exponential_buckets(16, 2, 10))) {
+        const auto& names = detector_names();
+        detector_code = static_cast<uint8_t>(std::find(names.begin(), names.end(), opts.detector) - names.begin() + 1);
+        const PreprocessOptions& preprocess = opts.preprocess;
+        const TilingOptions& tiling = opts.tiling;
+        logger.info("Processor STARTED. Pulling from " + opts.pull_desc + " and pushing to " + opts.push_desc +
+                    " with " + std::to_string(opts.num_workers) + " workers per stage, detector " + opts.detector +
+                    (opts.ordered_output ? " (ordered output)" : "") +
+                    (opts.reencode_jpeg ? ", re-encoding every image" : ", forwarding original image bytes") +
+                    ", " + opts.encoding_name + " float descriptors" +
+                    ", detecting on " + (preprocess.grayscale ? "grayscale" : "colour") +
+                    (preprocess.reduce != 1 ? " reduced " + (preprocess.reduce ? "1/" + std::to_string(preprocess.reduce) : std::string("(auto)")) : "") +
+                    (preprocess.max_dimension ? " capped at " + std::to_string(preprocess.max_dimension) + " px" : "") +
+                    (tiling.tile_size ? ", tiling frames from " + std::to_string(tiling.min_megapixels) + " MP into " +
+                                        std::to_string(tiling.tile_size) + " px tiles on " + std::to_string(tiling.threads) + " threads" : ""), true, true);
+
+        pull_sock.set(zmq::sockopt::rcvtimeo, 200); // wake up periodically to notice SIGINT
+        pull_sock.set(zmq::sockopt::rcvhwm, opts.rcvhwm);
+        // Processors only connect: the generator and logger bind, so any number of processors can join
+        for(const auto& ep : opts.pull_endpoints) pull_sock.connect(ep);
+        logger.info("Processor PULL connected", true, true);
+
+        // Frames from the generator's shared-memory ring arrive on the same PULL socket, over inproc;
+        // they stay in the ring's slot (decoded in place) until this processor is done with them
+        if(!opts.shm_in_name.empty()) {
+            std::string bridge = "inproc://shm-in-" + opts.shm_in_name;
+            pull_sock.bind(bridge);
+            shm_in = std::make_unique<ShmReceiver>(ctx, bridge, opts.shm_in_name, false, ShmRing::Options{},
+                                                   [&logger](const std::string& e){ logger.warn(e, true, true); });
+            logger.info("Processor reading shm://" + opts.shm_in_name, true, true);
+        }
+
+        push_sock.set(zmq::sockopt::sndhwm, opts.sndhwm);
+        for(const auto& ep : opts.push_endpoints) push_sock.connect(ep);
+        logger.info("Processor PUSH connected", true, true);
+
+        // Credits back to the generator, owned by the sender thread
+        if(opts.flow_control) {
+            credit_sock.set(zmq::sockopt::linger, 0);
+            for(const auto& ep : opts.credit_endpoints) credit_sock.connect(ep);
+            logger.info("Flow control on: window of " + std::to_string(opts.credit_window) + " frames granted via " +
+                        config::join(opts.credit_endpoints), true, true);
+        }
+
+        for(auto q : {std::make_pair("decode", &decode_q), std::make_pair("detect", &detect_q),
+                      std::make_pair("serialize", &serialize_q), std::make_pair("send", &send_q)})
+            metrics.callback("processor_queue_depth", "Frames waiting for a stage", [q]{ return static_cast<double>(q.second->size()); },
+                             std::string("stage=\"") + q.first + "\"");
+        if(opts.metrics_port > 0) {
+            metrics_server = std::make_unique<MetricsServer>(metrics, opts.metrics_port);
+            logger.info("Metrics on http://127.0.0.1:" + std::to_string(opts.metrics_port) + "/metrics", true, true);
+        }
+    }
+
+    FeatureStage(const FeatureStage&) = delete;
+    FeatureStage& operator=(const FeatureStage&) = delete;
+
+    void run(const std::atomic<bool>& running) {
+        // The stages already give us one thread per core; stop OpenCV from fanning out again inside each call
+        if(opts.num_workers > 1) cv::setNumThreads(1);
+
+        auto decoders = start_stage(opts.num_workers, decode_q, detect_q, PROC_DECODE_START, PROC_DECODE_END, [this]{
+            return [this](Frame& f){
+                // Decode straight out of the ZMQ buffer, img_msg stays intact for pass-through
+                PreparedImage prep = prepare_for_detection(f.img_msg.data(), f.img_msg.size(), opts.preprocess,
+                                                           static_cast<int>(f.header.width), static_cast<int>(f.header.height));
+                if(prep.img.empty()) { logger.warn("Failed to decode image", true, true); f.ok = false; decode_drops.inc(); return; }
+                f.work = prep.img;
+                f.scale_x = prep.scale_x;
+                f.scale_y = prep.scale_y;
+                if(opts.reencode_jpeg) {
+                    cv::Mat raw(1, static_cast<int>(f.img_msg.size()), CV_8U, f.img_msg.data());
+                    f.img = opts.preprocess.is_identity() ? f.work : cv::imdecode(raw, cv::IMREAD_COLOR);
+                }
+            };
+        });
+
+        auto detectors = start_stage(opts.num_workers, detect_q, serialize_q, PROC_DETECT_START, PROC_DETECT_END, [this]{
+            cv::Ptr<cv::Feature2D> detector = create_detector(opts.detector, opts.detector_params);
+            // Tiles detect uncapped; the configured SIFT nfeatures becomes the cut across all tiles
+            nlohmann::json tile_params = opts.detector_params;
+            int max_features = tile_params.value("nfeatures", 0);
+            if(opts.detector == "sift") tile_params["nfeatures"] = 0;
+            auto tiled = std::make_shared<TiledDetector>([name = opts.detector, tile_params]{ return create_detector(name, tile_params); },
+                                                         opts.tiling, max_features);
+            return [this, detector, tiled](Frame& f){
+                if(tiled->applies(f.work)) {
+                    tiled->detectAndCompute(f.work, f.keypoints, f.descriptors);
+                    tiled_frames.inc();
+                } else {
+                    detector->detectAndCompute(f.work, cv::noArray(), f.keypoints, f.descriptors);
+                }
+                f.work.release();
+                rescale_keypoints(f.keypoints, f.scale_x, f.scale_y);
+                f.header.num_keypoints = static_cast<uint32_t>(f.keypoints.size());
+                f.header.detector = detector_code;
+            };
+        });
+
+        auto serializers = start_stage(opts.num_workers, serialize_q, send_q, PROC_SERIALIZE_START, PROC_SERIALIZE_END, [this]{
+            return [reencode_jpeg = opts.reencode_jpeg, descriptor_encoding = opts.descriptor_encoding](Frame& f){
+                if(reencode_jpeg)
+                    cv::imencode(".jpg", f.img, f.outbuf, {cv::IMWRITE_JPEG_QUALITY, 90});
+                // Size the message up front and serialize straight into it
+                f.kp_msg.rebuild(keypoint_blob_layout(f.keypoints, f.descriptors, descriptor_encoding).total_size);
+                serialize_keypoints_and_descriptors_into(f.keypoints, f.descriptors, static_cast<uint8_t*>(f.kp_msg.data()), descriptor_encoding);
+                f.img.release();
+                f.descriptors.release();
+            };
+        });
+
+        // ZMQ sockets are not thread-safe, so a single sender owns the PUSH and credit sockets
+        std::thread sender([this, &running]{ send_loop(running); });
+
+        uint64_t arrival = 0;
+        while(running) {
+            zmq::message_t meta_msg, img_msg;
+            try {
+                if(!pull_sock.recv(meta_msg, zmq::recv_flags::none)) continue;
+                pull_sock.recv(img_msg, zmq::recv_flags::none);
+            } catch(const zmq::error_t& e) {
+                if(e.num() == EINTR) continue;
+                throw;
+            }
+
+            uint64_t recv_ns = mono_ns();
+            last_recv_ns = recv_ns;
+            in_flight++;
+            frames_in.inc();
+            auto frame = std::make_unique<Frame>();
+            const FrameHeader* header = read_frame_header(meta_msg.data(), meta_msg.size(), frame->header);
+            if(!header) {
+                // Not a frame this build understands (e.g. JSON meta from an older generator). It
+                // still holds a credit, so it goes through as dropped.
+                logger.warn("Dropping frame with an unreadable header (" + std::to_string(meta_msg.size()) + " bytes)", true, true);
+                frame->header = FrameHeader(); // no seq to report downstream
+                frame->ok = false;
+                header_drops.inc();
+            } else if(header != &frame->header) {
+                frame->header = *header;
+            }
+            frame->index = arrival++;
+            frame->meta_msg = std::move(meta_msg);
+            frame->trace = frame->header.trace_stamps();
+            frame->trace.ns[PROC_RECV] = recv_ns;
+            frame->img_msg = std::move(img_msg);
+            // Too old to be worth the detector time: it still flows through (as dropped) so ordering
+            // and credits stay intact
+            if(opts.max_frame_age_ms > 0 && frame->trace.has(GEN_SEND) &&
+               recv_ns > frame->trace.ns[GEN_SEND] + static_cast<uint64_t>(opts.max_frame_age_ms) * 1000000ull) {
+                frame->ok = false;
+                stale_drops.inc();
+            }
+            decode_q.push(std::move(frame));
+        }
+
+        // Drain every in-flight frame before shutting down
+        shm_in.reset();
+        decode_q.close();
+        join_stage(decoders, detect_q);
+        join_stage(detectors, serialize_q);
+        join_stage(serializers, send_q);
+        sender.join();
+        logger.info("Processor STOPPED", true, true);
+    }
+
+    uint64_t frames_received() const { return frames_in.value(); }
+    uint64_t frames_sent() const { return frames_out.value(); }
+    uint64_t drop_notices_sent() const { return drops_reported.value(); }
+
+private:
+    // One image travelling through the decode -> detect -> serialize -> send stages
+    struct Frame {
+        uint64_t index = 0;      // arrival order at this processor, used to restore ordering
+        zmq::message_t meta_msg; // received frame header (+ extension), updated and forwarded as is
+        FrameHeader header;      // working copy, written back into meta_msg before sending
+        zmq::message_t img_msg;
+        cv::Mat img;             // full-size colour image, only decoded when it will be re-encoded
+        cv::Mat work;            // detector input (see PreprocessOptions)
+        double scale_x = 1.0, scale_y = 1.0; // work -> original image coordinates
+        std::vector<cv::KeyPoint> keypoints;
+        cv::Mat descriptors;
+        std::vector<uchar> outbuf;
+        zmq::message_t kp_msg;
+        bool ok = true;          // false => dropped by a stage, the sender only releases its slot
+        TraceStamps trace;       // stamps from the generator plus this processor's stage boundaries
+    };
+    using FramePtr = std::unique_ptr<Frame>;
+    using FrameQueue = BoundedQueue<FramePtr>;
+
+    // Start n threads moving frames from `in` to `out`. make_work() is called once per
+    // thread so every worker owns its own state (e.g. its own detector instance).
+    // Each frame is stamped with `start`/`end` around the work.
+    template <typename MakeWork>
+    static std::vector<std::thread> start_stage(int n, FrameQueue& in, FrameQueue& out, TracePoint start, TracePoint end, MakeWork make_work) {
+        std::vector<std::thread> threads;
+        for(int i = 0; i < n; ++i) {
+            threads.emplace_back([&in, &out, start, end, make_work]{
+                auto work = make_work();
+                while(auto item = in.pop()) {
+                    FramePtr frame = std::move(*item);
+                    if(frame->ok) {
+                        frame->trace.stamp(start);
+                        work(*frame);
+                        frame->trace.stamp(end);
+                    }
+                    out.push(std::move(frame));
+                }
+            });
+        }
+        return threads;
+    }
+
+    // Wait for every worker of a stage, then let the next stage drain and stop
+    static void join_stage(std::vector<std::thread>& threads, FrameQueue& out) {
+        for(auto& t : threads) t.join();
+        out.close();
+    }
+
+    void grant(uint32_t n) {
+        uint8_t buf[CREDIT_MSG_SIZE];
+        encode_credit(n, buf);
+        zmq::message_t msg(buf, CREDIT_MSG_SIZE);
+        // Never block on the generator; a lost credit is made up by the idle refresh in send_loop
+        credit_sock.send(msg, zmq::send_flags::dontwait);
+    }
+
+    // Copies the frame into a ring slot. false: send it over ZMQ (or drop it without ZMQ endpoints).
+    bool send_shm(Frame& f, const void* img, size_t img_size, const std::atomic<bool>& running) {
+        std::initializer_list<ShmPart> parts = {{f.meta_msg.data(), f.meta_msg.size()}, {img, img_size}, {f.kp_msg.data(), f.kp_msg.size()}};
+        ShmSendResult r;
+        // Without a ZMQ fallback, wait for the logger to attach
+        while((r = shm_out->send(parts, []{ return true; })) == ShmSendResult::NoConsumer && opts.push_endpoints.empty() && running)
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        if(r == ShmSendResult::Sent) { shm_frames.inc(); return true; }
+        if(r == ShmSendResult::TooLarge) shm_oversize.inc();
+        if(opts.push_endpoints.empty()) {
+            logger.warn("Dropping seq=" + std::to_string(f.header.seq) + (r == ShmSendResult::TooLarge ?
+                        ": frame does not fit a shared-memory slot" : ": no logger attached to shm://" + opts.shm_out_name), true, true);
+            shm_drops.inc();
+            return true;
+        }
+        return false;
+    }
+
+    void send_frame(Frame& f, const std::atomic<bool>& running) {
+        in_flight--;
+        if(opts.flow_control) { grant(1); last_grant = std::chrono::steady_clock::now(); }
+        if(!f.ok) { send_dropped(f, running); return; }
+        detect_seconds.observe((f.trace.ns[PROC_DETECT_END] - f.trace.ns[PROC_DETECT_START]) / 1e9);
+        keypoints.observe(static_cast<double>(f.keypoints.size()));
+        f.trace.stamp(PROC_SEND);
+        f.header.set_trace(f.trace);
+        std::memcpy(f.meta_msg.data(), &f.header, sizeof(FrameHeader)); // extension bytes stay untouched
+        bytes_out.inc((f.outbuf.empty() ? f.img_msg.size() : f.outbuf.size()) + f.kp_msg.size());
+
+        if(shm_out && (f.outbuf.empty() ? send_shm(f, f.img_msg.data(), f.img_msg.size(), running)
+                                        : send_shm(f, f.outbuf.data(), f.outbuf.size(), running))) {
+            frames_out.inc();
+            logger.info("Processed image seq=" + std::to_string(f.header.seq) + " via shm", false, true);
+            return;
+        }
+        push_sock.send(f.meta_msg, zmq::send_flags::sndmore);
+        if(f.outbuf.empty()) {
+            // Unmodified image: hand the received message straight back to ZMQ, no copy
+            push_sock.send(f.img_msg, zmq::send_flags::sndmore);
+        } else {
+            zmq::message_t out_img(f.outbuf.data(), f.outbuf.size());
+            push_sock.send(out_img, zmq::send_flags::sndmore);
+        }
+        push_sock.send(f.kp_msg, zmq::send_flags::none);
+        frames_out.inc();
+
+        logger.info("Processed image seq=" + std::to_string(f.header.seq), false, true);
+    }
+
+    // Header-only notice for a frame of a tracked source dropped here on purpose, so the logger
+    // gives its seq up instead of asking the generator to send it again
+    void send_dropped(Frame& f, const std::atomic<bool>& running) {
+        if(f.header.source == 0 || f.header.seq == 0) return;
+        f.header.flags |= FRAME_FLAG_DROPPED;
+        f.header.num_keypoints = 0;
+        f.trace.stamp(PROC_SEND);
+        f.header.set_trace(f.trace);
+        std::memcpy(f.meta_msg.data(), &f.header, sizeof(FrameHeader));
+        f.kp_msg.rebuild(0);
+        drops_reported.inc();
+        if(shm_out && send_shm(f, nullptr, 0, running)) return; // zero-size parts are not copied
+        zmq::message_t empty_img;
+        push_sock.send(f.meta_msg, zmq::send_flags::sndmore);
+        push_sock.send(empty_img, zmq::send_flags::sndmore);
+        push_sock.send(f.kp_msg, zmq::send_flags::none);
+    }
+
+    // The sender thread. In ordered mode frames that finish early wait in `pending` until their turn.
+    void send_loop(const std::atomic<bool>& running) {
+        if(opts.flow_control) grant(opts.credit_window);
+        last_grant = std::chrono::steady_clock::now();
+
+        // The logger's shared-memory ring, if configured; ZMQ while no logger drains it
+        if(!opts.shm_out_name.empty()) shm_out = std::make_unique<ShmSender>(opts.shm_out_name, false);
+
+        std::map<uint64_t, FramePtr> pending;
+        uint64_t next_index = 0;
+        for(;;) {
+            auto item = send_q.pop_until(std::chrono::steady_clock::now() + std::chrono::milliseconds(200));
+            if(!item) {
+                if(send_q.is_closed() && send_q.size() == 0) break;
+                // Nothing in flight and nothing arriving: the generator may have restarted or
+                // credits were lost, so announce the window again (the generator caps its total)
+                auto now = std::chrono::steady_clock::now();
+                bool quiet = mono_ns() - last_recv_ns.load() > static_cast<uint64_t>(std::chrono::nanoseconds(opts.credit_refresh).count());
+                if(opts.flow_control && in_flight == 0 && quiet && now - last_grant >= opts.credit_refresh) {
+                    grant(opts.credit_window);
+                    last_grant = now;
+                }
+                continue;
+            }
+            FramePtr frame = std::move(*item);
+            if(!opts.ordered_output) { send_frame(*frame, running); continue; }
+            pending.emplace(frame->index, std::move(frame));
+            for(auto it = pending.begin(); it != pending.end() && it->first == next_index; it = pending.erase(it)) {
+                send_frame(*it->second, running);
+                ++next_index;
+            }
+        }
+        shm_out.reset();
+    }
+
+    Options opts;
+    DualLogger& logger;
+    uint8_t detector_code = 0;
+
+    zmq::socket_t pull_sock;
+    zmq::socket_t push_sock;
+    zmq::socket_t credit_sock;
+    std::unique_ptr<ShmReceiver> shm_in;
+    std::unique_ptr<ShmSender> shm_out; // owned by the sender thread
+
+    FrameQueue decode_q, detect_q, serialize_q, send_q;
+    // Frames received but not yet sent or dropped; the credits they hold go back as they leave
+    std::atomic<uint64_t> in_flight{0};
+    std::atomic<uint64_t> last_recv_ns{mono_ns()};
+    std::chrono::steady_clock::time_point last_grant;
+
+    MetricsRegistry metrics;
+    Counter& frames_in;
+    Counter& frames_out;
+    Counter& decode_drops;
+    Counter& stale_drops;
+    Counter& header_drops;
+    Counter& shm_drops;
+    Counter& drops_reported;
+    Counter& shm_frames;
+    Counter& shm_oversize;
+    Counter& bytes_out;
+    Histogram& detect_seconds;
+    Counter& tiled_frames;
+    Histogram& keypoints;
+    std::unique_ptr<MetricsServer> metrics_server; // last: its callbacks read the queues above
+};
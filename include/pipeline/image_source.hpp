@@ -0,0 +1,506 @@
+#pragma once
+#include <zmq.hpp>
+#include <opencv2/opencv.hpp>
+#include <nlohmann/json.hpp>
+#include <filesystem>
+#include <thread>
+#include <chrono>
+#include <cerrno>
+#include <atomic>
+#include <algorithm>
+#include <memory>
+#include <deque>
+#include "common/ipc_utils.hpp"
+#include "common/frame_header.hpp"
+#include "common/dual_logger.hpp"
+#include "common/rate_pacer.hpp"
+#include "common/latency_trace.hpp"
+#include "common/metrics.hpp"
+#include "common/flow_control.hpp"
+#include "common/shm_transport.hpp"
+#include "common/replay_log.hpp"
+
+// The generator stage: reads the images of a folder, encodes them as JPEG and pushes
+// header + image frames at the paced rate, to processors over ZMQ or a shared-memory ring.
+// With flow control it only sends on the processors' credits; with a replay log every frame
+// is kept on disk first and sent again when the logger asks for it.
+//
+// Set up in the constructor (throws std::runtime_error), then run() until `running` clears
+// or a non-looping run has sent every image. The generator binary runs one on its own;
+// InProcessPipeline composes it with the other stages over inproc://.
+class ImageSource {
+public:
+    struct Options {
+        std::string image_folder;
+        std::vector<std::string> publish_endpoints; // ZMQ endpoints, without the shm:// one
+        std::string shm_ring_name;                  // "" = no shared-memory ring
+        ShmRing::Options shm_ring;
+        int sndhwm = 1000;
+        bool flow_control = false;
+        std::vector<std::string> credit_endpoints;
+        OverloadPolicy policy = OverloadPolicy::DropOldest;
+        size_t backlog = 1;
+        int sample_every = 4;
+        uint64_t max_credits = 64;
+        int drain_timeout_ms = 2000;                // for frames still waiting for credit at the end
+        std::string frame_ext;                      // JSON extension attached to every frame
+        bool loop_images = true;
+        int report_interval_ms = 1000;
+        int metrics_port = 0;
+        bool preload = true;
+        size_t cache_max_bytes = size_t(512) << 20;
+        bool replay = false;
+        ReplayLog::Options replay_log;
+        std::vector<std::string> replay_endpoints;
+        RatePacer::Options pacing;
+
+        // Options from the `generator` config section
+        static Options from_config(const nlohmann::json& g) {
+            Options o;
+            o.image_folder = g.value("image_folder", "");
+            try {
+                o.publish_endpoints = config::endpoints(g, "publish_endpoints", "publish_port");
+                o.shm_ring_name = config::take_shm_endpoint(o.publish_endpoints);
+            } catch(const std::exception& e) { throw std::runtime_error(std::string("Invalid generator endpoints: ") + e.what()); }
+            o.shm_ring = shm_ring_options(g);
+            o.sndhwm = g.value("sndhwm", o.sndhwm);
+            o.flow_control = g.value("flow_control", false);
+            if(o.flow_control) {
+                try { o.credit_endpoints = config::endpoints(g, "credit_endpoints", "credit_port"); }
+                catch(const std::exception& e) { throw std::runtime_error(std::string("Invalid generator credit endpoints: ") + e.what()); }
+            }
+            o.policy = parse_overload_policy(g.value("overload_policy", "drop-oldest"));
+            o.backlog = g.value("backlog", 1);
+            o.sample_every = g.value("sample_every", o.sample_every);
+            o.max_credits = g.value("max_credits", o.max_credits);
+            o.drain_timeout_ms = g.value("drain_timeout_ms", o.drain_timeout_ms);
+            // Rare per-frame fields travel as a JSON extension after the binary frame header;
+            // encoded once here and attached to every frame
+            nlohmann::json extension = g.value("frame_extension", nlohmann::json::object());
+            o.frame_ext = extension.empty() ? std::string() : extension.dump();
+            o.loop_images = g.value("loop_images", o.loop_images);
+            o.report_interval_ms = g.value("report_interval_ms", o.report_interval_ms);
+            o.metrics_port = g.value("metrics_port", 0);
+            o.preload = g.value("preload_images", o.preload);
+            o.cache_max_bytes = static_cast<size_t>(g.value("cache_max_mb", 512)) << 20;
+            nlohmann::json replay_cfg = g.value("replay", nlohmann::json::object());
+            o.replay = replay_cfg.value("enabled", false);
+            o.replay_log.dir = replay_cfg.value("dir", o.replay_log.dir);
+            o.replay_log.max_bytes = static_cast<size_t>(replay_cfg.value("max_mb", 1024)) << 20;
+            o.replay_log.segment_bytes = static_cast<size_t>(replay_cfg.value("segment_mb", 64)) << 20;
+            o.replay_log.fsync = replay_cfg.value("fsync", false);
+            if(o.replay) {
+                try { o.replay_endpoints = config::endpoints(replay_cfg, "endpoints", "port"); }
+                catch(const std::exception& e) { throw std::runtime_error(std::string("Invalid generator replay endpoints: ") + e.what()); }
+            }
+            try { o.pacing = pacer_options(g); }
+            catch(const std::exception& e) { throw std::runtime_error(std::string("Invalid pacing config: ") + e.what()); }
+            return o;
+        }
+
+        // Pacing settings from the generator section. Without rate_fps the old sleep_ms
+        // setting is turned into the equivalent constant rate.
+        static RatePacer::Options pacer_options(const nlohmann::json& g) {
+            RatePacer::Options p;
+            p.profile = g.value("rate_profile", "constant");
+            p.rate_fps = g.value("rate_fps", 1000.0 / std::max(1, g.value("sleep_ms", 200)));
+            p.burst_fps = g.value("burst_fps", p.burst_fps);
+            p.burst_ms = g.value("burst_ms", p.burst_ms);
+            p.burst_period_ms = g.value("burst_period_ms", p.burst_period_ms);
+            p.ramp_to_fps = g.value("ramp_to_fps", p.ramp_to_fps);
+            p.ramp_ms = g.value("ramp_ms", p.ramp_ms);
+            for(const auto& s : g.value("rate_steps", nlohmann::json::array()))
+                p.steps.push_back(RateStep{s.value("duration_ms", 0), s.value("fps", 0.0)});
+            if(p.profile == "trace") p.trace = load_interarrival_trace(g.value("trace_path", ""));
+            p.trace_loop = g.value("trace_loop", true);
+            return p;
+        }
+    };
+
+    ImageSource(const Options& opts, DualLogger& logger, zmq::context_t& ctx)
+        : opts(opts), logger(logger), push_sock(ctx, zmq::socket_type::push), credit_sock(ctx, zmq::socket_type::pull),
+          replay_sock(ctx, zmq::socket_type::sub),
+          gate(opts.policy, opts.backlog, opts.sample_every, opts.max_credits),
+          frames_sent(metrics.counter("generator_frames_sent_total", "Frames pushed to the processor")),
+          bytes_sent(metrics.counter("generator_bytes_sent_total", "Encoded image bytes pushed to the processor")),
+          read_failures(metrics.counter("generator_read_failures_total", "Images skipped because they could not be read")),
+          frames_dropped(metrics.counter("generator_frames_dropped_total", "Frames dropped because the processors had no credit left",
+                                         std::string("policy=\"") + overload_policy_name(opts.policy) + "\"")),
+          shm_frames(metrics.counter("generator_shm_frames_sent_total", "Frames handed to processors through the shared-memory ring")),
+          shm_oversize(metrics.counter("generator_shm_oversize_total", "Frames too large for a shared-memory slot (sent over ZMQ when configured, else dropped)")),
+          frames_replayed(metrics.counter("generator_frames_replayed_total", "Frames sent again from the replay log on the logger's request")),
+          replay_unavailable(metrics.counter("generator_replay_unavailable_total", "Requested frames no longer held by the replay log")),
+          replay_failures(metrics.counter("generator_replay_append_failures_total", "Frames sent without a copy in the replay log")),
+          credits(metrics.gauge("generator_credits", "Frames the processors can currently accept")),
+          schedule_lag(metrics.histogram("generator_schedule_lag_seconds", "How late each send was against its pacing deadline",
+                                         exponential_buckets(1e-4, 4, 8))) {
+        namespace fs = std::filesystem;
+        if(!fs::exists(opts.image_folder) || !fs::is_directory(opts.image_folder))
+            throw std::runtime_error("No images found in folder: " + opts.image_folder);
+        logger.info("Generator STARTED. Publishing images from: " + opts.image_folder, true, true);
+
+        push_sock.set(zmq::sockopt::sndhwm, opts.sndhwm);
+        // Every processor instance connects here; PUSH round-robins frames across them
+        for(const auto& ep : opts.publish_endpoints) push_sock.bind(ep);
+        if(!opts.publish_endpoints.empty()) logger.info("Generator bound to " + config::join(opts.publish_endpoints), true, true);
+
+        // Processors on this host take frames from a shared-memory ring instead; ZMQ then only
+        // carries frames while none is attached, or frames too large for a slot
+        if(!opts.shm_ring_name.empty()) {
+            shm_out = std::make_unique<ShmSender>(opts.shm_ring_name, true, opts.shm_ring);
+            logger.info("Generator ring shm://" + opts.shm_ring_name + ": " + std::to_string(opts.shm_ring.slots) + " slots of " +
+                        std::to_string(opts.shm_ring.slot_bytes >> 20) + " MB" +
+                        (opts.publish_endpoints.empty() ? "" : ", ZMQ fallback"), true, true);
+        }
+
+        // Processors hand back one credit per frame they are done with (see flow_control.hpp)
+        if(opts.flow_control) {
+            for(const auto& ep : opts.credit_endpoints) credit_sock.bind(ep);
+            logger.info("Flow control on: credits from " + config::join(opts.credit_endpoints) +
+                        ", overload policy " + overload_policy_name(opts.policy), true, true);
+        }
+
+        // Every frame sent is kept in the replay log first; the logger asks for the ones it
+        // never received over the replay channel (logger PUB -> generator SUB)
+        if(opts.replay) {
+            try { replay_log = std::make_unique<ReplayLog>(opts.replay_log); }
+            catch(const std::exception& e) { throw std::runtime_error(std::string("Cannot open replay log: ") + e.what()); }
+            replay_sock.set(zmq::sockopt::subscribe, "");
+            for(const auto& ep : opts.replay_endpoints) replay_sock.bind(ep);
+            logger.info("Replay log " + opts.replay_log.dir + ": source " + std::to_string(replay_log->source()) +
+                        ", frames " + std::to_string(replay_log->first_seq()) + ".." + std::to_string(replay_log->next_seq() - 1) +
+                        " held, requests on " + config::join(opts.replay_endpoints), true, true);
+        }
+        // Seqs number the frames that actually leave, so dropped frames leave no gap behind.
+        // With a replay log they continue its numbering across restarts.
+        next_seq = replay_log ? replay_log->next_seq() : 1;
+
+        for(auto& p : fs::directory_iterator(opts.image_folder)) if(p.is_regular_file()) imgs.push_back(p.path());
+        if(imgs.empty()) throw std::runtime_error("No images found in folder: " + opts.image_folder);
+        cache.resize(imgs.size());
+        if(opts.preload) {
+            size_t cached_bytes = 0;
+            cache = preload_images(imgs, opts.cache_max_bytes, cached_bytes);
+            size_t cached = std::count_if(cache.begin(), cache.end(), [](const EncodedImagePtr& c){ return c != nullptr; });
+            logger.info("Preloaded " + std::to_string(cached) + "/" + std::to_string(imgs.size()) + " images (" +
+                        std::to_string(cached_bytes >> 20) + " MB), the rest are streamed from disk", true, true);
+        }
+
+        metrics.callback("generator_cached_images", "Images held pre-encoded in memory",
+                         [this]{ return static_cast<double>(std::count_if(cache.begin(), cache.end(), [](const EncodedImagePtr& c){ return c != nullptr; })); });
+        if(replay_log) metrics.callback("generator_replay_log_bytes", "Bytes held by the replay log", [this]{ return static_cast<double>(replay_log->bytes()); });
+        if(opts.metrics_port > 0) {
+            metrics_server = std::make_unique<MetricsServer>(metrics, opts.metrics_port);
+            logger.info("Metrics on http://127.0.0.1:" + std::to_string(opts.metrics_port) + "/metrics", true, true);
+        }
+
+        pacer = std::make_unique<RatePacer>(opts.pacing);
+        logger.info("Pacing: profile=" + pacer->profile() + " target=" + std::to_string(pacer->target_rate(Clock::now())) + " fps", true, true);
+    }
+
+    ImageSource(const ImageSource&) = delete;
+    ImageSource& operator=(const ImageSource&) = delete;
+
+    // Sends frames on the pacing schedule until `running` clears or, without loop_images,
+    // every image has been sent once
+    void run(const std::atomic<bool>& running) {
+        this->running = &running;
+        Clock::time_point run_start = Clock::now();
+        window_start = run_start;
+        size_t idx = 0;
+        while(running) {
+            auto due = pacer->next();
+            if(!due) break; // non-looping trace finished
+            // Wait for the absolute deadline in short slices so SIGINT is noticed during long
+            // gaps; with flow control the wait also picks up credits for frames still waiting
+            while(running && Clock::now() < *due) {
+                auto until = std::min(*due, Clock::now() + std::chrono::milliseconds(200));
+                if(opts.flow_control || replay_log) service_io(std::chrono::ceil<std::chrono::milliseconds>(until - Clock::now()));
+                else std::this_thread::sleep_until(until);
+            }
+            if(!running) break;
+            Clock::duration lag = Clock::now() - *due;
+            window_max_lag = std::max(window_max_lag, lag);
+            schedule_lag.observe(std::chrono::duration<double>(lag).count());
+
+            auto path = imgs[idx % imgs.size()];
+            EncodedImagePtr img = cache[idx % imgs.size()];
+            idx++;
+            if(!img) img = encode_image(path);
+            if(!img) {
+                logger.warn("Failed to read " + path.string(), true, true);
+                read_failures.inc();
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                continue;
+            }
+
+            OutFrame frame;
+            frame.header.set_image_id(ImageId::generate());
+            frame.header.timestamp_ns = unix_ns();
+            frame.header.width = static_cast<uint32_t>(img->width);
+            frame.header.height = static_cast<uint32_t>(img->height);
+            frame.header.encoding = FRAME_ENCODING_JPEG;
+            frame.header.source = replay_log ? replay_log->source() : 0;
+            frame.img = std::move(img);
+
+            if(!opts.flow_control) {
+                send_frame(frame);
+                if(replay_log) service_io(std::chrono::milliseconds(0));
+            } else {
+                uint64_t dropped_before = gate.dropped();
+                gate.offer(std::move(frame));
+                frames_dropped.inc(gate.dropped() - dropped_before);
+                service_io(std::chrono::milliseconds(0));
+                // Block: hold the schedule until the processors take the frame
+                while(running && opts.policy == OverloadPolicy::Block && gate.has_waiting())
+                    service_io(std::chrono::milliseconds(200));
+            }
+
+            auto now = Clock::now();
+            if(now - window_start >= std::chrono::milliseconds(opts.report_interval_ms)) report(now);
+            if(!opts.loop_images && idx >= imgs.size()) break;
+        }
+
+        // Frames still waiting for credit get drain_timeout_ms to leave, the rest count as
+        // dropped, so sent + dropped covers every frame offered
+        if(opts.flow_control) {
+            auto drain_until = Clock::now() + std::chrono::milliseconds(opts.drain_timeout_ms);
+            while(gate.has_waiting() && Clock::now() < drain_until)
+                service_io(std::chrono::ceil<std::chrono::milliseconds>(std::min<Clock::duration>(drain_until - Clock::now(), std::chrono::milliseconds(200))));
+            frames_dropped.inc(gate.drop_waiting());
+        }
+
+        double total_secs = std::chrono::duration<double>(Clock::now() - run_start).count();
+        if(total_secs > 0)
+            logger.info("Sent " + std::to_string(frames_sent.value()) + " frames in " + std::to_string(total_secs) + " s (" +
+                        std::to_string(frames_sent.value() / total_secs) + " fps), dropped " +
+                        std::to_string(gate.dropped()) + " for lack of credit", true, true);
+        logger.info("Generator STOPPED", true, true);
+    }
+
+    uint64_t frames_sent_total() const { return frames_sent.value(); }
+    uint64_t frames_dropped_total() const { return frames_dropped.value(); }
+    size_t images() const { return imgs.size(); }
+
+private:
+    using Clock = RatePacer::Clock;
+
+    // One image encoded the way it goes on the wire
+    struct EncodedImage {
+        std::vector<uchar> jpeg;
+        int width = 0;
+        int height = 0;
+    };
+    using EncodedImagePtr = std::shared_ptr<const EncodedImage>;
+
+    // A frame built at its pacing deadline; seq and trace stamp are added when it actually leaves.
+    // A replayed frame carries its original header and extension.
+    struct OutFrame {
+        FrameHeader header;
+        EncodedImagePtr img;
+        bool replay = false;
+        std::string ext;
+    };
+
+    // Decode a file from disk and re-encode it as JPEG quality 90
+    static EncodedImagePtr encode_image(const std::filesystem::path& path) {
+        cv::Mat image = cv::imread(path.string(), cv::IMREAD_COLOR);
+        if(image.empty()) return nullptr;
+        auto out = std::make_shared<EncodedImage>();
+        cv::imencode(".jpg", image, out->jpeg, {cv::IMWRITE_JPEG_QUALITY, 90});
+        out->width = image.cols;
+        out->height = image.rows;
+        return out;
+    }
+
+    // Zero-copy message over img->jpeg. The message holds a reference to `img` that ZMQ
+    // drops through the free function once it is done with the bytes.
+    static zmq::message_t make_image_message(EncodedImagePtr img) {
+        auto* hold = new EncodedImagePtr(std::move(img));
+        return zmq::message_t(const_cast<uchar*>((*hold)->jpeg.data()), (*hold)->jpeg.size(),
+                              [](void*, void* hint){ delete static_cast<EncodedImagePtr*>(hint); }, hold);
+    }
+
+    // Encode every image once, spread over all cores. Images that would push the cache past
+    // `max_bytes` are left out (nullptr) and get streamed from disk on every send instead.
+    static std::vector<EncodedImagePtr> preload_images(const std::vector<std::filesystem::path>& imgs, size_t max_bytes, size_t& cached_bytes) {
+        std::vector<EncodedImagePtr> cache(imgs.size());
+        std::atomic<size_t> next{0}, total{0};
+        std::vector<std::thread> loaders;
+        unsigned n = std::max(1u, std::thread::hardware_concurrency());
+        for(unsigned t = 0; t < n; ++t) {
+            loaders.emplace_back([&]{
+                for(size_t i = next++; i < imgs.size(); i = next++) {
+                    EncodedImagePtr img = encode_image(imgs[i]);
+                    if(!img) continue;
+                    size_t bytes = img->jpeg.size();
+                    if(total.fetch_add(bytes) + bytes > max_bytes) { total -= bytes; continue; }
+                    cache[i] = std::move(img);
+                }
+            });
+        }
+        for(auto& t : loaders) t.join();
+        cached_bytes = total;
+        return cache;
+    }
+
+    // Rate report window: frames sent and the worst lag behind schedule since the last report
+    void report(Clock::time_point now) {
+        double secs = std::chrono::duration<double>(now - window_start).count();
+        if(secs <= 0) return;
+        logger.info("Rate: actual=" + std::to_string(window_frames / secs) +
+                    " fps target=" + std::to_string(pacer->target_rate(now)) +
+                    " fps max_lag=" + std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(window_max_lag).count()) + " ms" +
+                    (opts.flow_control ? " dropped=" + std::to_string(gate.dropped() - window_dropped_start) : ""), true, true);
+        window_start = now;
+        window_frames = 0;
+        window_dropped_start = gate.dropped();
+        window_max_lag = Clock::duration{0};
+    }
+
+    void send_frame(OutFrame& f) {
+        if(!f.replay) f.header.seq = next_seq++;
+        TraceStamps trace;
+        trace.stamp(GEN_SEND);
+        f.header.set_trace(trace);
+        const std::string& ext = f.replay ? f.ext : opts.frame_ext;
+        meta_buf.resize(frame_header_wire_size(ext.size()));
+        write_frame_header(f.header, ext, meta_buf.data());
+        if(replay_log && !f.replay) {
+            std::string error;
+            if(!replay_log->append(f.header.seq, meta_buf.data(), meta_buf.size(), f.img->jpeg.data(), f.img->jpeg.size(), error)) {
+                logger.error("Replay log append failed for seq=" + std::to_string(f.header.seq) + ": " + error, true, true);
+                replay_failures.inc();
+            }
+        }
+        if(f.replay) frames_replayed.inc();
+        if(shm_out) {
+            std::initializer_list<ShmPart> parts = {{meta_buf.data(), meta_buf.size()}, {f.img->jpeg.data(), f.img->jpeg.size()}};
+            ShmSendResult r;
+            // Without a ZMQ fallback, hold the frame until a processor attaches
+            while((r = shm_out->send(parts, [this]{ return running->load(); })) == ShmSendResult::NoConsumer &&
+                  opts.publish_endpoints.empty() && *running)
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            if(r == ShmSendResult::Sent) {
+                frames_sent.inc();
+                shm_frames.inc();
+                bytes_sent.inc(f.img->jpeg.size());
+                window_frames++;
+                logger.info("Published image seq=" + std::to_string(f.header.seq) + " via shm", false, true);
+                return;
+            }
+            if(r == ShmSendResult::TooLarge) shm_oversize.inc();
+            if(opts.publish_endpoints.empty()) {
+                if(r == ShmSendResult::TooLarge)
+                    logger.warn("Dropping seq=" + std::to_string(f.header.seq) + ": " + std::to_string(f.img->jpeg.size()) +
+                                " bytes do not fit a shared-memory slot", true, true);
+                return;
+            }
+        }
+        zmq::message_t meta_msg(meta_buf.data(), meta_buf.size());
+        zmq::message_t img_msg = make_image_message(std::move(f.img));
+        size_t img_bytes = img_msg.size();
+        push_sock.send(meta_msg, zmq::send_flags::sndmore);
+        push_sock.send(img_msg, zmq::send_flags::none);
+        frames_sent.inc();
+        bytes_sent.inc(img_bytes);
+        window_frames++;
+        logger.info("Published image seq=" + std::to_string(f.header.seq), false, true);
+    }
+
+    void queue_replay(const zmq::message_t& msg) {
+        ReplayRequest r;
+        if(!decode_replay_request(msg.data(), msg.size(), r) || r.source != replay_log->source()) return; // another generator's
+        uint64_t first = std::max(r.first, replay_log->first_seq()), last = std::min(r.last, replay_log->next_seq() - 1);
+        uint64_t held = first <= last ? last - first + 1 : 0;
+        replay_unavailable.inc(r.last - r.first + 1 - held);
+        if(held > 0) replay_pending.push_back({r.source, first, last});
+        logger.info("Replay requested: seq " + std::to_string(r.first) + ".." + std::to_string(r.last) + ", " +
+                    std::to_string(held) + " still held", true, true);
+    }
+
+    // The next requested frame, read back from the replay log
+    void send_replay() {
+        ReplayRequest& r = replay_pending.front();
+        uint64_t seq = r.first++;
+        if(r.first > r.last) replay_pending.pop_front();
+        std::vector<uint8_t> meta, data;
+        FrameHeader scratch;
+        std::string_view ext;
+        const FrameHeader* h = replay_log->read(seq, meta, data) ? read_frame_header(meta.data(), meta.size(), scratch, &ext) : nullptr;
+        if(!h) { replay_unavailable.inc(); return; }
+        OutFrame f;
+        f.header = *h;
+        f.header.flags |= FRAME_FLAG_REPLAY;
+        f.ext.assign(ext.data(), ext.size());
+        auto img = std::make_shared<EncodedImage>();
+        img->jpeg = std::move(data);
+        img->width = static_cast<int>(h->width);
+        img->height = static_cast<int>(h->height);
+        f.img = std::move(img);
+        f.replay = true;
+        send_frame(f);
+    }
+
+    // Wait up to `timeout` for credits and replay requests, then send what they allow:
+    // requested replays first (each on a credit of its own), then the frames waiting for credit
+    void service_io(std::chrono::milliseconds timeout) {
+        zmq::pollitem_t items[2];
+        int n = 0;
+        if(opts.flow_control) items[n++] = {static_cast<void*>(credit_sock), 0, ZMQ_POLLIN, 0};
+        if(replay_log) items[n++] = {static_cast<void*>(replay_sock), 0, ZMQ_POLLIN, 0};
+        try {
+            if(zmq::poll(items, n, timeout) > 0) {
+                zmq::message_t msg;
+                if(opts.flow_control)
+                    while(credit_sock.recv(msg, zmq::recv_flags::dontwait)) gate.add_credits(decode_credit(msg.data(), msg.size()));
+                if(replay_log)
+                    while(replay_sock.recv(msg, zmq::recv_flags::dontwait)) queue_replay(msg);
+            }
+        } catch(const zmq::error_t& e) {
+            if(e.num() != EINTR) throw;
+        }
+        // A bounded burst per call, so a large request does not stall the schedule
+        for(int i = 0; i < 16 && !replay_pending.empty() && (!opts.flow_control || gate.take_credit()); ++i) send_replay();
+        if(!opts.flow_control) return;
+        while(auto f = gate.take_ready()) send_frame(*f);
+        credits.set(static_cast<double>(gate.credits()));
+    }
+
+    Options opts;
+    DualLogger& logger;
+    const std::atomic<bool>* running = nullptr;
+
+    zmq::socket_t push_sock;
+    zmq::socket_t credit_sock;
+    zmq::socket_t replay_sock;
+    std::unique_ptr<ShmSender> shm_out;
+    std::unique_ptr<ReplayLog> replay_log;
+    CreditGate<OutFrame> gate;
+    std::unique_ptr<RatePacer> pacer;
+
+    std::vector<std::filesystem::path> imgs;
+    std::vector<EncodedImagePtr> cache;
+    uint64_t next_seq = 1;
+    std::vector<uint8_t> meta_buf;
+    std::deque<ReplayRequest> replay_pending; // requested frames still to be sent again, oldest request first
+
+    Clock::time_point window_start;
+    size_t window_frames = 0;
+    uint64_t window_dropped_start = 0;
+    Clock::duration window_max_lag{0};
+
+    MetricsRegistry metrics;
+    Counter& frames_sent;
+    Counter& bytes_sent;
+    Counter& read_failures;
+    Counter& frames_dropped;
+    Counter& shm_frames;
+    Counter& shm_oversize;
+    Counter& frames_replayed;
+    Counter& replay_unavailable;
+    Counter& replay_failures;
+    Gauge& credits;
+    Histogram& schedule_lag;
+    std::unique_ptr<MetricsServer> metrics_server; // last: its callbacks read the members above
+};
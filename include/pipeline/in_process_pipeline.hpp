@@ -0,0 +1,89 @@
+#pragma once
+#include <zmq.hpp>
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include "common/dual_logger.hpp"
+#include "pipeline/image_source.hpp"
+#include "pipeline/feature_stage.hpp"
+#include "pipeline/persistence_sink.hpp"
+
+// Generator, processor and logger stages in one process, sharing one ZMQ context. Every hop
+// is rewritten to inproc:// (shm:// rings included), so frames move between the stages as
+// message pointers: no sockets, no copies of the image bytes, no shared-memory slots. The
+// stages keep their own log files and metrics ports.
+//
+// run() returns once the generator is done (`running` cleared, or a non-looping run sent
+// every image) and everything it sent has been stored: each stage is stopped only after the
+// next one has received all frames sent to it, or after `drain_timeout`.
+class InProcessPipeline {
+public:
+    // `cfg` with every stage endpoint moved onto inproc://
+    static nlohmann::json in_process_config(nlohmann::json cfg) {
+        cfg["generator"]["publish_endpoints"] = "inproc://frames";
+        cfg["processor"]["subscribe_endpoints"] = "inproc://frames";
+        cfg["processor"]["publish_endpoints"] = "inproc://features";
+        cfg["logger"]["subscribe_endpoints"] = "inproc://features";
+        cfg["generator"]["credit_endpoints"] = "inproc://credits";
+        cfg["processor"]["credit_endpoints"] = "inproc://credits";
+        if(cfg["generator"].contains("replay")) cfg["generator"]["replay"]["endpoints"] = "inproc://replay";
+        if(cfg["logger"].contains("sequence")) cfg["logger"]["sequence"]["replay_endpoints"] = "inproc://replay";
+        return cfg;
+    }
+
+    // Stages are set up in bind order: the generator binds frames, credits and replay, the
+    // logger binds features and connects to replay, the processor connects to the rest
+    InProcessPipeline(const nlohmann::json& cfg, const std::string& image_folder = "")
+        : cfg(in_process_config(cfg)), ctx(1) {
+        std::string log_dir = this->cfg["logging"]["log_folder"];
+        DualLogger::Options log_opts = DualLogger::options_from_config(this->cfg["logging"]);
+        ImageSource::Options source_opts = ImageSource::Options::from_config(this->cfg["generator"]);
+        if(!image_folder.empty()) source_opts.image_folder = image_folder;
+        FeatureStage::Options feature_opts = FeatureStage::Options::from_config(this->cfg["processor"]);
+        PersistenceSink::Options sink_opts = PersistenceSink::Options::from_config(this->cfg["logger"]);
+
+        source_log = std::make_unique<DualLogger>(log_dir + "/generator.log", log_opts);
+        feature_log = std::make_unique<DualLogger>(log_dir + "/processor.log", log_opts);
+        sink_log = std::make_unique<DualLogger>(log_dir + "/logger.log", log_opts);
+        source = std::make_unique<ImageSource>(source_opts, *source_log, ctx);
+        sink = std::make_unique<PersistenceSink>(sink_opts, *sink_log, ctx);
+        features = std::make_unique<FeatureStage>(feature_opts, *feature_log, ctx);
+    }
+
+    void run(const std::atomic<bool>& running, std::chrono::milliseconds drain_timeout = std::chrono::milliseconds(10000)) {
+        std::atomic<bool> features_running{true}, sink_running{true};
+        std::thread sink_thread([&]{ sink->run(sink_running); });
+        std::thread feature_thread([&]{ features->run(features_running); });
+        source->run(running);
+        wait_for([&]{ return features->frames_received() >= source->frames_sent_total(); }, drain_timeout);
+        features_running = false;
+        feature_thread.join(); // every received frame is sent on before it returns
+        wait_for([&]{ return sink->frames_received() + sink->drop_notices_received() >= features->frames_sent() + features->drop_notices_sent(); },
+                 drain_timeout);
+        sink_running = false;
+        sink_thread.join();
+    }
+
+    const ImageSource& image_source() const { return *source; }
+    const FeatureStage& feature_stage() const { return *features; }
+    const PersistenceSink& persistence_sink() const { return *sink; }
+
+private:
+    static void wait_for(const std::function<bool()>& done, std::chrono::milliseconds timeout) {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while(!done() && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    nlohmann::json cfg;
+    zmq::context_t ctx;
+    std::unique_ptr<DualLogger> source_log, feature_log, sink_log;
+    // Destroyed before the context (and in reverse: processor, logger, generator)
+    std::unique_ptr<ImageSource> source;
+    std::unique_ptr<PersistenceSink> sink;
+    std::unique_ptr<FeatureStage> features;
+};
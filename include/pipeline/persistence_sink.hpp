@@ -0,0 +1,388 @@
+#pragma once
+#include <zmq.hpp>
+#include <nlohmann/json.hpp>
+#include <filesystem>
+#include <cerrno>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include "common/ipc_utils.hpp"
+#include "common/frame_header.hpp"
+#include "common/dual_logger.hpp"
+#include "common/sqlite_batch_writer.hpp"
+#include "common/async_file_writer.hpp"
+#include "common/segment_store.hpp"
+#include "common/latency_trace.hpp"
+#include "common/metrics.hpp"
+#include "common/descriptor_indexer.hpp"
+#include "common/shm_transport.hpp"
+#include "common/seq_tracker.hpp"
+
+// The logger stage: pulls header + image + keypoint blob frames from the processors, stores
+// each image (one file per frame or appended to segment files) and then its row in SQLite.
+// Tracks the seq of every generator source and asks for lost frames again, keeps the
+// per-stage latency report and optionally the similar-frame index.
+//
+// Set up in the constructor (throws std::runtime_error), then run() until `running` clears;
+// run() stores every frame already received and commits the last rows before it returns.
+// The logger binary runs one on its own; InProcessPipeline composes it with the other
+// stages over inproc://.
+class PersistenceSink {
+public:
+    struct Options {
+        std::vector<std::string> subscribe_endpoints; // ZMQ endpoints, without the shm:// one
+        std::string subscribe_desc;                   // as configured, for log lines
+        std::string shm_ring_name;                    // "" = no shared-memory ring
+        ShmRing::Options shm_ring;
+        int rcvhwm = 1000;
+        std::string db_path = "data/data_log.db";
+        std::string images_dir = "processed_images/processed";
+        SqliteBatchWriter::Options db;
+        std::string storage_backend = "files";        // files | segments
+        AsyncFileWriter::Options files;
+        SegmentStore::Options segments;
+        bool latency_per_row = false;
+        std::string latency_report_path = "data/latency_report.json";
+        int latency_report_interval_ms = 10000;
+        int metrics_port = 0;
+        bool track_seq = false;
+        SeqTracker::Options seq;
+        std::vector<std::string> replay_endpoints;
+        DescriptorIndexer::Options index;
+
+        // Options from the `logger` config section
+        static Options from_config(const nlohmann::json& l) {
+            Options o;
+            try {
+                o.subscribe_endpoints = config::endpoints(l, "subscribe_endpoints", "subscribe_port");
+                o.subscribe_desc = config::join(o.subscribe_endpoints);
+                o.shm_ring_name = config::take_shm_endpoint(o.subscribe_endpoints);
+            } catch(const std::exception& e) { throw std::runtime_error(std::string("Invalid logger endpoints: ") + e.what()); }
+            o.shm_ring = shm_ring_options(l);
+            o.rcvhwm = l.value("rcvhwm", o.rcvhwm);
+            o.db_path = l.at("db_path").get<std::string>();
+            o.images_dir = l.at("image_save_path").get<std::string>();
+            o.db.batch_size = l.value("batch_size", 64);
+            o.db.flush_interval_ms = l.value("flush_interval_ms", 100);
+            o.db.synchronous = l.value("synchronous", "NORMAL");
+            o.db.queue_capacity = l.value("queue_capacity", 1024);
+            o.files.backend = l.value("file_writer_backend", "auto");
+            o.files.num_threads = l.value("file_writer_threads", 2);
+            o.files.queue_capacity = l.value("file_writer_queue_capacity", 256);
+            o.files.fsync = l.value("fsync_images", true);
+            o.storage_backend = l.value("storage_backend", o.storage_backend);
+            if(o.storage_backend != "files" && o.storage_backend != "segments")
+                throw std::runtime_error("Unknown logger.storage_backend: " + o.storage_backend);
+            o.segments.max_segment_bytes = static_cast<size_t>(l.value("segment_max_mb", 256)) << 20;
+            o.segments.queue_capacity = o.files.queue_capacity;
+            o.segments.fsync = o.files.fsync;
+            o.latency_per_row = l.value("latency_per_row", o.latency_per_row);
+            o.latency_report_path = l.value("latency_report_path", o.latency_report_path);
+            o.latency_report_interval_ms = l.value("latency_report_interval_ms", o.latency_report_interval_ms);
+            o.metrics_port = l.value("metrics_port", 0);
+            nlohmann::json seq_cfg = l.value("sequence", nlohmann::json::object());
+            o.track_seq = seq_cfg.value("enabled", false);
+            o.seq.gap_timeout = std::chrono::milliseconds(seq_cfg.value("gap_timeout_ms", 2000));
+            o.seq.retry_interval = std::chrono::milliseconds(seq_cfg.value("retry_interval_ms", 2000));
+            o.seq.max_attempts = seq_cfg.value("max_attempts", 5);
+            if(o.track_seq) {
+                try { o.replay_endpoints = config::endpoints(seq_cfg, "replay_endpoints", "replay_port"); }
+                catch(const std::exception& e) { throw std::runtime_error(std::string("Invalid logger replay endpoints: ") + e.what()); }
+            }
+            try { o.index = DescriptorIndexer::Options::from_config(l.value("index", nlohmann::json::object())); }
+            catch(const std::exception& e) { throw std::runtime_error(std::string("Invalid index config: ") + e.what()); }
+            return o;
+        }
+    };
+
+    PersistenceSink(const Options& opts, DualLogger& logger, zmq::context_t& ctx)
+        : opts(opts), logger(logger), pull_sock(ctx, zmq::socket_type::pull), replay_sock(ctx, zmq::socket_type::pub),
+          frames_in(metrics.counter("logger_frames_received_total", "Frames received from the processor")),
+          bytes_written(metrics.counter("logger_bytes_written_total", "Image bytes persisted (duplicates excluded)")),
+          store_failures(metrics.counter("logger_store_failures_total", "Frames dropped because their image could not be stored")),
+          header_failures(metrics.counter("logger_bad_header_total", "Frames dropped because their frame header could not be read")),
+          duplicates(metrics.counter("logger_duplicate_frames_total", "Frames skipped because their seq is already stored or being stored")),
+          replay_requests(metrics.counter("logger_replay_requests_total", "Replay requests sent to the generator")),
+          drop_notices(metrics.counter("logger_processor_drops_total", "Frames the processor reported as dropped on purpose (given up, not replayed)")),
+          frames_lost(metrics.counter("logger_frames_lost_total", "Frames given up on after the last replay attempt")),
+          commit_seconds(metrics.histogram("logger_sqlite_commit_seconds", "BEGIN..COMMIT time per batch", exponential_buckets(1e-4, 2, 14))),
+          tracker(opts.seq) {
+        logger.info("Logger STARTED. Listening on " + opts.subscribe_desc +
+                    ", saving images to " + opts.images_dir + ", DB: " + opts.db_path, true, true);
+
+        std::filesystem::create_directories(std::filesystem::path(opts.db_path).parent_path());
+        std::filesystem::create_directories(opts.images_dir);
+
+        pull_sock.set(zmq::sockopt::rcvtimeo, 200); // wake up periodically to notice SIGINT
+        pull_sock.set(zmq::sockopt::rcvhwm, opts.rcvhwm);
+        // Fan-in: the logger binds and every processor instance connects its PUSH here
+        for(const auto& ep : opts.subscribe_endpoints) pull_sock.bind(ep);
+        // Processors on this host write into a shared-memory ring instead; its frames reach the
+        // receive loop over inproc and keep their slot until the image is stored
+        if(!opts.shm_ring_name.empty()) {
+            std::string bridge = "inproc://shm-in-" + opts.shm_ring_name;
+            pull_sock.bind(bridge);
+            shm_in = std::make_unique<ShmReceiver>(ctx, bridge, opts.shm_ring_name, true, opts.shm_ring,
+                                                   [&logger](const std::string& e){ logger.warn(e, true, true); });
+            logger.info("Logger ring shm://" + opts.shm_ring_name + ": " + std::to_string(opts.shm_ring.slots) + " slots of " +
+                        std::to_string(opts.shm_ring.slot_bytes >> 20) + " MB", true, true);
+        }
+        logger.info("Logger bound, waiting for processors", true, true);
+
+        // Per-stage latency histograms, fed once a row's commit completes its trace
+        SqliteBatchWriter::Options db_opts = opts.db;
+        db_opts.on_commit = [this](std::vector<ImageRecord>& batch, double seconds){
+            commit_seconds.observe(seconds);
+            uint64_t now = mono_ns();
+            for(auto& r : batch) {
+                if(r.failed) { tracker.abandon(r.source, static_cast<uint64_t>(r.seq)); continue; }
+                tracker.committed(r.source, static_cast<uint64_t>(r.seq));
+                r.trace.ns[LOG_COMMITTED] = now;
+                latency.record(r.trace);
+            }
+        };
+
+        // All SQLite work happens on the writer thread, the receive loop only queues rows
+        db = std::make_unique<SqliteBatchWriter>(opts.db_path, db_opts, [&logger](const std::string& e){ logger.error(e, true, true); });
+        logger.info("SQLite writer started: batch_size=" + std::to_string(db_opts.batch_size) +
+                    " flush_interval_ms=" + std::to_string(db_opts.flush_interval_ms) +
+                    " synchronous=" + db_opts.synchronous, true, true);
+
+        // Sequence tracking resumes from what the database holds; replay requests go out on a
+        // PUB socket every generator subscribes to, each picks the ones for its source
+        if(opts.track_seq) {
+            for(const auto& r : db->recovered_sources()) {
+                tracker.restore(r.progress, r.committed_above);
+                logger.info("Source " + std::to_string(r.progress.source) + ": contiguous up to seq " +
+                            std::to_string(tracker.contiguous(r.progress.source)) + ", " +
+                            std::to_string(r.committed_above.size()) + " rows above, " + std::to_string(r.progress.lost) + " lost", true, true);
+            }
+            replay_sock.set(zmq::sockopt::linger, 0);
+            for(const auto& ep : opts.replay_endpoints) replay_sock.connect(ep);
+            logger.info("Sequence tracking on: replay requests to " + config::join(opts.replay_endpoints), true, true);
+        }
+
+        // Similar-frame index, built from committed rows on its own thread
+        if(opts.index.enabled) {
+            index = std::make_unique<DescriptorIndexer>(opts.db_path, opts.index, [&logger](const std::string& e){ logger.error(e, true, true); });
+            logger.info("Descriptor index: " + opts.index.path + " (" + std::to_string(index->frames()) + " frames, " +
+                        (index->trained() ? "vocabulary loaded" : "vocabulary trained after " + std::to_string(opts.index.train_frames) + " frames") + ")", true, true);
+        }
+
+        // Images are written off the receive loop, either one file per frame or appended to
+        // segment files. A row is only queued for SQLite once its image is durably stored.
+        if(opts.storage_backend == "segments") segments = std::make_unique<SegmentStore>(opts.images_dir, opts.segments);
+        else files = std::make_unique<AsyncFileWriter>(opts.files);
+        logger.info(std::string("Image writer started: backend=") +
+                    (segments ? "segments" : files->backend()) +
+                    " fsync=" + (opts.files.fsync ? "on" : "off"), true, true);
+
+        metrics.callback("logger_rows_committed_total", "Rows committed to SQLite", [this]{ return static_cast<double>(db->rows_committed()); }, "", "counter");
+        metrics.callback("logger_queue_depth", "Rows waiting for the SQLite writer", [this]{ return static_cast<double>(db->queue_depth()); }, "queue=\"sqlite\"");
+        metrics.callback("logger_queue_depth", "Images waiting to be written",
+                         [this]{ return static_cast<double>(segments ? segments->queue_depth() : files->queue_depth()); }, "queue=\"images\"");
+        if(segments) metrics.callback("logger_duplicate_images_total", "Images not stored again because an identical one exists",
+                                      [this]{ return static_cast<double>(segments->duplicates()); }, "", "counter");
+        if(opts.track_seq) metrics.callback("logger_frames_missing", "Frames in sequence gaps waiting for a replay", [this]{ return static_cast<double>(tracker.missing()); });
+        if(index) {
+            metrics.callback("logger_index_frames", "Frames in the descriptor index", [this]{ return static_cast<double>(index->frames()); });
+            metrics.callback("logger_index_skipped_total", "Frames left out of the index (no or incompatible descriptors)",
+                             [this]{ return static_cast<double>(index->skipped()); }, "", "counter");
+        }
+        if(opts.metrics_port > 0) {
+            metrics_server = std::make_unique<MetricsServer>(metrics, opts.metrics_port);
+            logger.info("Metrics on http://127.0.0.1:" + std::to_string(opts.metrics_port) + "/metrics", true, true);
+        }
+    }
+
+    PersistenceSink(const PersistenceSink&) = delete;
+    PersistenceSink& operator=(const PersistenceSink&) = delete;
+
+    void run(const std::atomic<bool>& running) {
+        auto next_latency_report = std::chrono::steady_clock::now() + std::chrono::milliseconds(opts.latency_report_interval_ms);
+        auto next_seq_check = std::chrono::steady_clock::now();
+        while(running) {
+            auto loop_now = std::chrono::steady_clock::now();
+            if(loop_now >= next_latency_report) {
+                persist_latency();
+                next_latency_report += std::chrono::milliseconds(opts.latency_report_interval_ms);
+            }
+            if(opts.track_seq && loop_now >= next_seq_check) {
+                service_seq();
+                next_seq_check = loop_now + std::chrono::milliseconds(200);
+            }
+            zmq::message_t meta_msg, img_msg, kp_msg;
+            try {
+                if(!pull_sock.recv(meta_msg, zmq::recv_flags::none)) continue;
+                pull_sock.recv(img_msg, zmq::recv_flags::none);
+                pull_sock.recv(kp_msg, zmq::recv_flags::none);
+            } catch(const zmq::error_t& e) {
+                if(e.num() == EINTR) continue;
+                throw;
+            }
+            store(meta_msg, std::move(img_msg), kp_msg);
+        }
+
+        shm_in.reset();
+        metrics_server.reset(); // its callbacks read the writers below
+        files.reset();    // finishes pending image writes, which queue their rows
+        segments.reset();
+        if(opts.track_seq) db->record_progress(tracker.take_progress()); // rows of the last batch are found again on restart
+        db.reset();       // commits the last partial batch
+        index.reset();    // indexes the last rows and writes the final snapshot
+        persist_latency();
+        logger.info("Logger STOPPED", true, true);
+    }
+
+    uint64_t frames_received() const { return frames_in.value(); }
+    uint64_t drop_notices_received() const { return drop_notices.value(); }
+    uint64_t replay_requests_sent() const { return replay_requests.value(); }
+    const LatencyTracker& latency_tracker() const { return latency; }
+
+private:
+    // One received frame: queue its image for storage, its row follows once the image is stored
+    void store(const zmq::message_t& meta_msg, zmq::message_t img_msg, const zmq::message_t& kp_msg) {
+        uint64_t recv_ns = mono_ns();
+        FrameHeader scratch;
+        std::string_view ext;
+        const FrameHeader* header = read_frame_header(meta_msg.data(), meta_msg.size(), scratch, &ext);
+        if(header && (header->flags & FRAME_FLAG_DROPPED)) {
+            // Nothing to store, and nothing to ask the generator for
+            drop_notices.inc();
+            if(opts.track_seq) tracker.give_up(header->source, header->seq);
+            logger.info("Processor dropped seq=" + std::to_string(header->seq) + " of source " + std::to_string(header->source), false, true);
+            return;
+        }
+        frames_in.inc();
+        if(!header) {
+            logger.warn("Dropping frame with an unreadable header (" + std::to_string(meta_msg.size()) + " bytes)", true, true);
+            header_failures.inc();
+            return;
+        }
+
+        // A replay that raced its original, or a frame stored before a restart
+        uint32_t source = opts.track_seq ? header->source : 0;
+        if(!tracker.admit(source, header->seq)) {
+            duplicates.inc();
+            logger.info("Skipping duplicate seq=" + std::to_string(header->seq) + " of source " + std::to_string(source), false, true);
+            return;
+        }
+
+        auto rec = std::make_shared<ImageRecord>();
+        rec->image_id = header->image_id().to_string();
+        rec->seq = static_cast<int64_t>(header->seq);
+        rec->source = source;
+        rec->timestamp = header->timestamp_iso8601();
+        rec->path = opts.images_dir + "/" + rec->image_id + "." + frame_encoding_name(header->encoding);
+        rec->num_keypoints = static_cast<int>(header->num_keypoints);
+        rec->extra.assign(ext.data(), ext.size());
+        rec->kp_blob.assign(static_cast<const uint8_t*>(kp_msg.data()), static_cast<const uint8_t*>(kp_msg.data()) + kp_msg.size());
+        rec->trace = header->trace_stamps();
+        rec->trace.ns[LOG_RECV] = recv_ns;
+        rec->store_trace = opts.latency_per_row;
+
+        // The job keeps the received message alive, so the image bytes are never copied
+        auto img = std::make_shared<zmq::message_t>(std::move(img_msg));
+        if(segments) {
+            SegmentAppendJob job;
+            job.data = static_cast<const uint8_t*>(img->data());
+            job.size = img->size();
+            job.owner = img;
+            job.on_done = [this, rec](bool ok, const SegmentRef& ref, bool duplicate, const std::string& error){
+                if(!ok) {
+                    logger.error("Failed to store image " + rec->image_id + ": " + error, true, true);
+                    store_failures.inc();
+                    tracker.abandon(rec->source, static_cast<uint64_t>(rec->seq));
+                    return;
+                }
+                rec->trace.stamp(LOG_STORED);
+                if(!duplicate) bytes_written.inc(ref.length);
+                rec->path = segment_ref_to_path(ref);
+                log_row(rec, duplicate ? " (dedup)" : "");
+            };
+            segments->submit(std::move(job)); // blocks only when the append queue is full
+            return;
+        }
+
+        FileWriteJob job;
+        job.path = rec->path;
+        job.data = static_cast<const uint8_t*>(img->data());
+        job.size = img->size();
+        job.owner = img;
+        job.on_done = [this, rec, size = job.size](bool ok, const std::string& error){
+            if(!ok) {
+                logger.error("Failed to write image " + rec->image_id + ": " + error, true, true);
+                store_failures.inc();
+                tracker.abandon(rec->source, static_cast<uint64_t>(rec->seq));
+                return;
+            }
+            rec->trace.stamp(LOG_STORED);
+            bytes_written.inc(size);
+            log_row(rec, "");
+        };
+        files->submit(std::move(job)); // blocks only when the write queue is full
+    }
+
+    void log_row(const std::shared_ptr<ImageRecord>& rec, const std::string& note) {
+        std::string msg = "Logged image: " + rec->image_id + " seq=" + std::to_string(rec->seq) +
+                          " keypoints=" + std::to_string(rec->num_keypoints) + note;
+        db->submit(std::move(*rec));
+        logger.info(msg, false, true);
+    }
+
+    void persist_latency() {
+        std::string report = latency.snapshot().dump(2), error;
+        if(!write_file_atomic(opts.latency_report_path, reinterpret_cast<const uint8_t*>(report.data()), report.size(), false, error))
+            logger.warn("Failed to write latency report: " + error, true, true);
+        logger.info("Latency p50/p99/p999: " + latency.summary(), true, true);
+    }
+
+    void service_seq() {
+        auto r = tracker.poll(SeqTracker::Clock::now());
+        for(const auto& req : r.requests) {
+            uint8_t buf[REPLAY_REQUEST_SIZE];
+            encode_replay_request(req, buf);
+            zmq::message_t msg(buf, sizeof(buf));
+            replay_sock.send(msg, zmq::send_flags::dontwait);
+            replay_requests.inc();
+            logger.info("Requesting replay of source " + std::to_string(req.source) + " seq " +
+                        std::to_string(req.first) + ".." + std::to_string(req.last), true, true);
+        }
+        for(const auto& g : r.given_up) {
+            frames_lost.inc(g.last - g.first + 1);
+            logger.warn("Giving up on source " + std::to_string(g.source) + " seq " + std::to_string(g.first) + ".." +
+                        std::to_string(g.last) + " after " + std::to_string(opts.seq.max_attempts) + " replay requests", true, true);
+        }
+        db->record_progress(tracker.take_progress());
+    }
+
+    Options opts;
+    DualLogger& logger;
+
+    zmq::socket_t pull_sock;
+    zmq::socket_t replay_sock;
+
+    MetricsRegistry metrics;
+    Counter& frames_in;
+    Counter& bytes_written;
+    Counter& store_failures;
+    Counter& header_failures;
+    Counter& duplicates;
+    Counter& replay_requests;
+    Counter& drop_notices;
+    Counter& frames_lost;
+    Histogram& commit_seconds;
+
+    // Highest contiguous committed seq per generator source; gaps behind it are requested
+    // again from the generator (see seq_tracker.hpp)
+    SeqTracker tracker;
+    LatencyTracker latency;
+
+    // Torn down in reverse: the ring first, then image writers (which still queue rows), SQLite, the index
+    std::unique_ptr<DescriptorIndexer> index;
+    std::unique_ptr<SqliteBatchWriter> db;
+    std::unique_ptr<AsyncFileWriter> files;
+    std::unique_ptr<SegmentStore> segments;
+    std::unique_ptr<ShmReceiver> shm_in;
+    std::unique_ptr<MetricsServer> metrics_server;
+};
@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+"""Compare two benchmark result directories written by the run_benchmarks target.
+
+Usage: scripts/compare_benchmarks.py <baseline_dir> <candidate_dir> [--threshold PCT]
+
+Prints real time per benchmark for both runs and the change; exits 1 when any benchmark
+got slower by more than the threshold (default 10%), so it can gate a commit.
+"""
+import argparse
+import json
+import pathlib
+import sys
+
+
+def load(results_dir):
+    times = {}
+    for path in sorted(pathlib.Path(results_dir).glob("*.json")):
+        with open(path) as f:
+            data = json.load(f)
+        for b in data.get("benchmarks", []):
+            if b.get("run_type") == "aggregate" or b.get("error_occurred"):
+                continue
+            times[f"{path.stem}/{b['name']}"] = (b["real_time"], b["time_unit"])
+    return times
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("baseline")
+    parser.add_argument("candidate")
+    parser.add_argument("--threshold", type=float, default=10.0, help="slowdown in percent that fails the comparison")
+    args = parser.parse_args()
+
+    base, cand = load(args.baseline), load(args.candidate)
+    regressions = 0
+    width = max((len(n) for n in cand), default=10)
+    print(f"{'benchmark':<{width}}  {'baseline':>12}  {'candidate':>12}  {'change':>8}")
+    for name in sorted(cand):
+        t, unit = cand[name]
+        if name not in base:
+            print(f"{name:<{width}}  {'-':>12}  {t:>10.3f}{unit:>2}  {'new':>8}")
+            continue
+        b, base_unit = base[name]
+        if base_unit != unit:
+            print(f"{name:<{width}}  time unit changed ({base_unit} -> {unit}), skipped")
+            continue
+        change = (t - b) / b * 100.0 if b else 0.0
+        flag = ""
+        if change > args.threshold:
+            regressions += 1
+            flag = "  SLOWER"
+        print(f"{name:<{width}}  {b:>10.3f}{unit:>2}  {t:>10.3f}{unit:>2}  {change:>+7.1f}%{flag}")
+    for name in sorted(set(base) - set(cand)):
+        print(f"{name:<{width}}  missing from candidate")
+
+    if regressions:
+        print(f"\n{regressions} benchmark(s) slower by more than {args.threshold:g}%")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
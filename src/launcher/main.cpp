@@ -0,0 +1,202 @@
+#include <nlohmann/json.hpp>
+#include <iostream>
+#include <filesystem>
+#include <csignal>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "common/ipc_utils.hpp"
+#include "common/dual_logger.hpp"
+#include "pipeline/in_process_pipeline.hpp"
+
+// Starts the logger, N processors and the generator as child processes and keeps them
+// running: a worker that dies is restarted, SIGINT/SIGTERM stops everything in pipeline
+// order (generator first, logger last) so in-flight frames are drained.
+// With --in-process (or launcher.in_process) the three stages run as threads of this
+// process instead, connected over inproc:// (see in_process_pipeline.hpp).
+//   launcher [num_processors] [--in-process] [--config <path>]
+
+using json = nlohmann::json;
+std::atomic<bool> running{true};
+void stop_handler(int) { running = false; }
+
+struct Child {
+    std::string name;
+    std::vector<std::string> argv;
+    pid_t pid = -1;
+    int restarts = 0;
+    std::chrono::steady_clock::time_point restart_at{};
+};
+
+static pid_t spawn(const Child &c) {
+    pid_t pid = fork();
+    if(pid != 0) return pid;
+    // Child: own process group so the terminal's Ctrl-C only reaches the launcher, which
+    // decides when and in which order each worker stops
+    setpgid(0, 0);
+    std::vector<char *> args;
+    for(const auto &a : c.argv) args.push_back(const_cast<char *>(a.c_str()));
+    args.push_back(nullptr);
+    execv(args[0], args.data());
+    std::cerr << "exec " << c.argv[0] << " failed: " << std::strerror(errno) << std::endl;
+    _exit(127);
+}
+
+static std::string describe_exit(int status) {
+    if(WIFEXITED(status)) return "exited with status " + std::to_string(WEXITSTATUS(status));
+    if(WIFSIGNALED(status)) return std::string("killed by signal ") + std::to_string(WTERMSIG(status));
+    return "stopped";
+}
+
+// SIGINT the children and wait for them to exit; SIGKILL whatever is left after `timeout`
+static void stop_children(std::vector<Child *> group, std::chrono::milliseconds timeout, DualLogger &logger) {
+    for(auto *c : group) if(c->pid > 0) kill(c->pid, SIGINT);
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    for(auto *c : group) {
+        while(c->pid > 0) {
+            int status = 0;
+            pid_t r = waitpid(c->pid, &status, WNOHANG);
+            if(r == c->pid || (r < 0 && errno == ECHILD)) {
+                logger.info(c->name + " stopped (" + describe_exit(status) + ")", true, true);
+                c->pid = -1;
+            } else if(std::chrono::steady_clock::now() >= deadline) {
+                logger.warn(c->name + " did not stop in time, killing it", true, true);
+                kill(c->pid, SIGKILL);
+                waitpid(c->pid, &status, 0);
+                c->pid = -1;
+            } else {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    signal(SIGINT, stop_handler);
+    signal(SIGTERM, stop_handler);
+
+    std::string config_path = config::config_path(argc, argv);
+    json cfg;
+    try { cfg = config::loadConfig(config_path); }
+    catch(const std::exception &e){ std::cerr << "Failed to load config: " << e.what() << "\n"; return -1; }
+
+    json lc = cfg.value("launcher", json::object());
+    auto args = config::positional_args(argc, argv, {"--in-process"});
+    bool in_process = lc.value("in_process", false) || config::flag(argc, argv, "--in-process");
+    int num_processors = !args.empty() ? std::atoi(args[0].c_str()) : lc.value("num_processors", 1);
+    std::string bin_dir = lc.value("bin_dir", "build/src");
+    bool restart = lc.value("restart_on_failure", true);
+    int max_restarts = lc.value("max_restarts", 5);
+    auto restart_backoff = std::chrono::milliseconds(lc.value("restart_backoff_ms", 1000));
+    auto startup_delay = std::chrono::milliseconds(lc.value("startup_delay_ms", 500));
+    auto shutdown_timeout = std::chrono::milliseconds(lc.value("shutdown_timeout_ms", 10000));
+    if(num_processors < 1) { std::cerr << "num_processors must be >= 1\n"; return 1; }
+
+    // Processor i serves metrics on processor.metrics_port + i, which must stay clear of the
+    // generator's and logger's ports or that processor fails to start on every restart
+    int proc_port = cfg["processor"].value("metrics_port", 0), proc_count = in_process ? 1 : num_processors;
+    for(const char *stage : {"generator", "logger"}) {
+        int port = cfg[stage].value("metrics_port", 0);
+        if(proc_port > 0 && port > 0 && port >= proc_port && port < proc_port + proc_count) {
+            std::cerr << "processor.metrics_port range " << proc_port << ".." << proc_port + proc_count - 1
+                      << " overlaps " << stage << ".metrics_port " << port << "\n";
+            return 1;
+        }
+    }
+
+    std::string log_dir = cfg["logging"]["log_folder"];
+    DualLogger::Options log_opts;
+    try { log_opts = DualLogger::options_from_config(cfg["logging"]); }
+    catch(const std::exception &e){ std::cerr << "Invalid logging config: " << e.what() << "\n"; return 1; }
+    DualLogger logger(log_dir + "/launcher.log", log_opts);
+
+    std::filesystem::create_directories(std::filesystem::path(cfg["logger"].value("db_path", "data/data_log.db")).parent_path());
+    std::filesystem::create_directories(cfg["logger"].value("image_save_path", "processed_images/processed"));
+
+    if(in_process) {
+        // One processor stage; its worker pools already use every core
+        logger.info("Launcher STARTED in-process", true, true);
+        std::unique_ptr<InProcessPipeline> pipeline;
+        try { pipeline = std::make_unique<InProcessPipeline>(cfg); }
+        catch(const std::exception &e){ logger.error(e.what(), true, true); return 1; }
+        pipeline->run(running, shutdown_timeout);
+        pipeline.reset();
+        logger.info("Launcher STOPPED", true, true);
+        return 0;
+    }
+
+    // Start order: the logger and generator bind, processors connect to both
+    // Every worker reads the launcher's config file
+    Child logger_proc{"logger", {bin_dir + "/logger/logger", "--config", config_path}};
+    std::vector<Child> processors;
+    for(int i = 0; i < num_processors; ++i)
+        processors.push_back(Child{"processor[" + std::to_string(i) + "]",
+                                   {bin_dir + "/processor/processor", "--instance", std::to_string(i), "--config", config_path}});
+    Child generator{"generator", {bin_dir + "/generator/generator", "--config", config_path}};
+
+    std::vector<Child *> all{&logger_proc};
+    for(auto &p : processors) all.push_back(&p);
+    all.push_back(&generator);
+
+    for(auto *c : all) {
+        if(access(c->argv[0].c_str(), X_OK) != 0) {
+            logger.error(c->argv[0] + " not found or not executable. Build the project first.", true, true);
+            return 1;
+        }
+    }
+
+    logger.info("Launcher STARTED with " + std::to_string(num_processors) + " processor(s)", true, true);
+    for(auto *c : all) {
+        if(!running) break;
+        c->pid = spawn(*c);
+        logger.info("Started " + c->name + " (pid " + std::to_string(c->pid) + ")", true, true);
+        std::this_thread::sleep_for(startup_delay);
+    }
+
+    // Supervise: reap exited children and restart them after a backoff
+    while(running) {
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, WNOHANG);
+        if(pid > 0) {
+            for(auto *c : all) {
+                if(c->pid != pid) continue;
+                c->pid = -1;
+                bool failed = !(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+                logger.warn(c->name + " " + describe_exit(status), true, true);
+                if(restart && failed && c->restarts < max_restarts) {
+                    c->restarts++;
+                    c->restart_at = std::chrono::steady_clock::now() + restart_backoff;
+                } else if(failed) {
+                    logger.error(c->name + " will not be restarted", true, true);
+                }
+            }
+            continue;
+        }
+        auto now = std::chrono::steady_clock::now();
+        for(auto *c : all) {
+            if(c->pid < 0 && c->restarts > 0 && c->restart_at != std::chrono::steady_clock::time_point{} && now >= c->restart_at) {
+                c->restart_at = {};
+                c->pid = spawn(*c);
+                logger.info("Restarted " + c->name + " (pid " + std::to_string(c->pid) + ", restart " +
+                            std::to_string(c->restarts) + "/" + std::to_string(max_restarts) + ")", true, true);
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    logger.info("Stopping pipeline", true, true);
+    stop_children({&generator}, shutdown_timeout, logger);
+    std::vector<Child *> procs;
+    for(auto &p : processors) procs.push_back(&p);
+    stop_children(procs, shutdown_timeout, logger);
+    stop_children({&logger_proc}, shutdown_timeout, logger);
+    logger.info("Launcher STOPPED", true, true);
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include <opencv2/opencv.hpp>
+#include <nlohmann/json.hpp>
+#include <sqlite3.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "common/ipc_utils.hpp"
+#include "common/preprocess.hpp"
+#include "common/feature_detector.hpp"
+#include "common/descriptor_matcher.hpp"
+#include "common/descriptor_indexer.hpp"
+
+// Ranks the frames stored by the logger by similarity to a query image:
+//   matcher <query.jpg> [top_k] [--config <path>]
+// The query is prepared and detected exactly like the processor does (same preprocess
+// options and detector). When the logger's descriptor index is available, it narrows the
+// search to `matcher.candidates` frames first; otherwise every kp_blob in the database is
+// matched. Frames detected with a different descriptor type are skipped.
+
+using json = nlohmann::json;
+
+struct Ranked {
+    std::string id;
+    long long seq = 0;
+    std::string path;
+    size_t keypoints = 0;
+    size_t matches = 0;
+    double score = 0;
+};
+
+int main(int argc, char **argv) {
+    auto args = config::positional_args(argc, argv);
+    if(args.empty()) { std::cerr << "Usage: " << argv[0] << " <query_image> [top_k] [--config <path>]\n"; return 1; }
+
+    json cfg;
+    try { cfg = config::loadConfig(config::config_path(argc, argv)); }
+    catch(const std::exception &e){ std::cerr << "Failed to load config: " << e.what() << "\n"; return -1; }
+
+    json mc = cfg.value("matcher", json::object());
+    size_t top_k = static_cast<size_t>(args.size() > 1 ? std::atoi(args[1].c_str()) : mc.value("top_k", 10));
+    MatchOptions opts;
+    opts.ratio = mc.value("ratio", opts.ratio);
+    opts.block_bytes = static_cast<size_t>(mc.value("block_kb", 64)) << 10;
+    std::string db_path = cfg["logger"].value("db_path", "data/data_log.db");
+    std::string index_path = cfg["logger"].value("index", json::object()).value("path", "data/data_log.bow");
+    bool use_index = mc.value("use_index", true);
+    size_t candidates = mc.value("candidates", 100);
+
+    // Query descriptors
+    std::ifstream qf(args[0], std::ios::binary);
+    if(!qf) { std::cerr << "Cannot open query image: " << args[0] << "\n"; return 1; }
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(qf)), std::istreambuf_iterator<char>());
+    std::vector<cv::KeyPoint> qkps;
+    cv::Mat qdesc;
+    try {
+        PreparedImage prep = prepare_for_detection(bytes.data(), bytes.size(), PreprocessOptions::from_config(cfg["processor"]));
+        if(prep.img.empty()) { std::cerr << "Cannot decode query image: " << args[0] << "\n"; return 1; }
+        create_detector_from_config(cfg["processor"])->detectAndCompute(prep.img, cv::noArray(), qkps, qdesc);
+    } catch(const std::exception &e) { std::cerr << "Query detection failed: " << e.what() << "\n"; return 1; }
+    DescriptorSet query = descriptor_set(qdesc);
+    if(query.empty()) { std::cerr << "No descriptors in query image\n"; return 1; }
+    std::cout << "Query " << args[0] << ": " << query.rows << " descriptors ("
+              << (query.metric == DescriptorMetric::L2 ? "L2" : "Hamming") << ", " << simd_level_name(opts.simd) << " kernels)\n";
+
+    sqlite3 *db = nullptr;
+    if(sqlite3_open_v2(db_path.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        std::cerr << "Cannot open " << db_path << ": " << sqlite3_errmsg(db) << "\n";
+        sqlite3_close(db);
+        return 1;
+    }
+
+    // Candidate frames from the index; an empty list means a full scan
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<IndexHit> hits;
+    if(use_index) {
+        BowIndexView index;
+        std::string error;
+        if(!index.open(index_path, error)) std::cout << "No descriptor index (" << error << "), scanning every frame\n";
+        else {
+            hits = index.query(query, candidates);
+            std::cout << "Index " << index_path << ": " << index.frames() << " frames, " << hits.size() << " candidates\n";
+        }
+    }
+
+    sqlite3_stmt *stmt = nullptr;
+    const char *sql = hits.empty() ? "SELECT id, seq, path, kp_blob FROM images" : "SELECT id, seq, path, kp_blob FROM images WHERE id = ?";
+    if(sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Query failed: " << sqlite3_errmsg(db) << "\n";
+        sqlite3_close(db);
+        return 1;
+    }
+
+    std::vector<Ranked> ranked;
+    size_t frames = 0, skipped = 0, next_hit = 0;
+    double comparisons = 0;
+    auto next_row = [&]{
+        if(hits.empty()) return sqlite3_step(stmt) == SQLITE_ROW;
+        while(next_hit < hits.size()) {
+            sqlite3_reset(stmt);
+            sqlite3_bind_text(stmt, 1, hits[next_hit++].image_id.c_str(), -1, SQLITE_TRANSIENT);
+            if(sqlite3_step(stmt) == SQLITE_ROW) return true;
+        }
+        return false;
+    };
+    while(next_row()) {
+        ++frames;
+        auto blob = static_cast<const uint8_t *>(sqlite3_column_blob(stmt, 3));
+        size_t blob_bytes = static_cast<size_t>(sqlite3_column_bytes(stmt, 3));
+        // Only the descriptors are needed: v2 blobs are viewed or dequantized in place, v1 fully parsed
+        LazyKeypointDescriptors lazy;
+        cv::Mat desc;
+        if(blob && lazy.open(blob, blob_bytes)) desc = lazy.mat();
+        else {
+            try { if(blob) desc = deserialize_keypoints_and_descriptors(blob, blob_bytes).second; }
+            catch(const std::exception &) { ++skipped; continue; }
+        }
+        DescriptorSet train = descriptor_set(desc);
+        if(train.empty() || train.metric != query.metric || train.cols != query.cols) { ++skipped; continue; }
+
+        Ranked r;
+        auto text = [&](int col) { auto p = sqlite3_column_text(stmt, col); return p ? std::string(reinterpret_cast<const char *>(p)) : std::string(); };
+        r.id = text(0);
+        r.seq = sqlite3_column_int64(stmt, 1);
+        r.path = text(2);
+        r.keypoints = train.rows;
+        r.matches = match_descriptors(query, train, opts).size();
+        r.score = static_cast<double>(r.matches) / std::min(query.rows, train.rows);
+        comparisons += static_cast<double>(query.rows) * train.rows;
+        ranked.push_back(std::move(r));
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    size_t k = std::min(top_k, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + k, ranked.end(),
+                      [](const Ranked &a, const Ranked &b) { return a.matches != b.matches ? a.matches > b.matches : a.seq < b.seq; });
+    std::cout << "Matched " << ranked.size() << " of " << frames << " frames (" << skipped << " skipped) in "
+              << std::fixed << std::setprecision(2) << secs << " s, " << comparisons / std::max(secs, 1e-9) / 1e6
+              << " M descriptor comparisons/s\n";
+    for(size_t i = 0; i < k; ++i) {
+        const Ranked &r = ranked[i];
+        std::cout << std::setw(3) << i + 1 << ". seq " << r.seq << "  matches " << r.matches << "/" << r.keypoints
+                  << "  score " << std::setprecision(3) << r.score << "  " << r.id << "  " << r.path << "\n";
+    }
+    return 0;
+}
@@ -63,6 +63,13 @@ TEST(E2ETest, RealImageSIFTRoundTrip) {
     ASSERT_EQ(desc_out.cols, desc_in.cols);
 
     EXPECT_NEAR(desc_in.at<float>(0,0), desc_out.at<float>(0,0), 1e-6);
+
+    // SIFT entries are integers in 0..255: the compressed encodings are lossless for them
+    for(uint8_t enc : {KP_DESC_FLOAT16, KP_DESC_UINT8_SCALED}) {
+        auto small = serialize_keypoints_and_descriptors(kps_in, desc_in, enc);
+        EXPECT_LT(small.size(), blob.size());
+        EXPECT_EQ(cv::norm(deserialize_keypoints_and_descriptors(small).second, desc_in, cv::NORM_INF), 0.0) << int(enc);
+    }
 }
 
 
@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include "common/async_file_writer.hpp"
+
+namespace fs = std::filesystem;
+
+static std::string read_file(const fs::path& p) {
+    std::ifstream f(p, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(f), {});
+}
+
+TEST(AsyncFileWriterTest, WritesFilesAndReportsCompletion) {
+    fs::path dir = fs::temp_directory_path() / "async_file_writer_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    std::atomic<int> ok_count{0};
+    {
+        AsyncFileWriter::Options opts;
+        opts.backend = "thread_pool";
+        opts.queue_capacity = 2; // forces submit() to wait on the writers
+        AsyncFileWriter writer(opts);
+        for(int i=0;i<10;i++) {
+            auto bytes = std::make_shared<std::string>("image-" + std::to_string(i));
+            FileWriteJob job;
+            job.path = (dir / (std::to_string(i) + ".jpg")).string();
+            job.data = reinterpret_cast<const uint8_t*>(bytes->data());
+            job.size = bytes->size();
+            job.owner = bytes;
+            job.on_done = [&](bool ok, const std::string&){ if(ok) ok_count++; };
+            ASSERT_TRUE(writer.submit(std::move(job)));
+        }
+    }
+    EXPECT_EQ(ok_count.load(), 10);
+    for(int i=0;i<10;i++) EXPECT_EQ(read_file(dir / (std::to_string(i) + ".jpg")), "image-" + std::to_string(i));
+    for(const auto& e : fs::directory_iterator(dir)) EXPECT_NE(e.path().extension(), ".tmp");
+}
+
+TEST(AsyncFileWriterTest, ReportsFailureForMissingDirectory) {
+    std::atomic<bool> failed{false};
+    std::string error;
+    {
+        AsyncFileWriter::Options opts;
+        opts.backend = "thread_pool";
+        AsyncFileWriter writer(opts);
+        static const uint8_t byte = 1;
+        FileWriteJob job;
+        job.path = (fs::temp_directory_path() / "no_such_dir_for_writer" / "x.jpg").string();
+        job.data = &byte;
+        job.size = 1;
+        job.on_done = [&](bool ok, const std::string& e){ failed = !ok; error = e; };
+        writer.submit(std::move(job));
+    }
+    EXPECT_TRUE(failed.load());
+    EXPECT_FALSE(error.empty());
+}
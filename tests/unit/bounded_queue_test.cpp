@@ -0,0 +1,42 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include "common/bounded_queue.hpp"
+
+TEST(BoundedQueueTest, PushPopFifo) {
+    BoundedQueue<int> q(4);
+    for(int i=0;i<4;i++) EXPECT_TRUE(q.push(i));
+    EXPECT_EQ(q.size(), 4u);
+    for(int i=0;i<4;i++) EXPECT_EQ(*q.pop(), i);
+}
+
+TEST(BoundedQueueTest, CloseDrainsRemainingItems) {
+    BoundedQueue<int> q(2);
+    q.push(7);
+    EXPECT_FALSE(q.is_closed());
+    q.close();
+    EXPECT_TRUE(q.is_closed());
+    EXPECT_FALSE(q.push(8));
+    auto v = q.pop();
+    ASSERT_TRUE(v.has_value());
+    EXPECT_EQ(*v, 7);
+    EXPECT_FALSE(q.pop().has_value());
+}
+
+TEST(BoundedQueueTest, ProducerBlocksUntilConsumerPops) {
+    BoundedQueue<int> q(1);
+    q.push(1);
+    std::thread producer([&]{ q.push(2); q.close(); });
+    EXPECT_EQ(*q.pop(), 1);
+    EXPECT_EQ(*q.pop(), 2);
+    producer.join();
+    EXPECT_FALSE(q.pop().has_value());
+}
+
+TEST(BoundedQueueTest, PopUntilTimesOut) {
+    BoundedQueue<int> q(1);
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(q.pop_until(start + std::chrono::milliseconds(20)).has_value());
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+    q.push(3);
+    EXPECT_EQ(*q.pop_until(std::chrono::steady_clock::now() + std::chrono::seconds(1)), 3);
+}
@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+#include "common/bow_index.hpp"
+
+namespace fs = std::filesystem;
+
+// Synthetic "scenes": 64 cluster centres, scene n drawing 100 descriptors from centres
+// 4n..4n+7 plus noise, so neighbouring scenes share half their words and a scene's noisy
+// copy is its best hit
+struct Scenes {
+    static constexpr size_t kCols = 32;
+    std::vector<std::vector<float>> centres;
+    std::mt19937 rng{42};
+
+    Scenes() {
+        std::uniform_real_distribution<float> d(0.0f, 1.0f);
+        centres.resize(64, std::vector<float>(kCols));
+        for(auto& c : centres) for(auto& v : c) v = d(rng);
+    }
+
+    std::vector<float> frame(int scene) {
+        std::normal_distribution<float> noise(0.0f, 0.02f);
+        std::vector<float> rows;
+        for(int i = 0; i < 100; ++i) {
+            const auto& c = centres[(scene * 4 + i % 8) % centres.size()];
+            for(float v : c) rows.push_back(v + noise(rng));
+        }
+        return rows;
+    }
+
+    // Bits set where the float descriptor is above 0.5
+    static std::vector<uint8_t> binarize(const std::vector<float>& rows) {
+        std::vector<uint8_t> out(rows.size() / kCols * (kCols / 8), 0);
+        for(size_t i = 0; i < rows.size(); ++i)
+            if(rows[i] > 0.5f) out[i / 8] |= static_cast<uint8_t>(1u << (i % 8));
+        return out;
+    }
+};
+
+static DescriptorSet fset(const std::vector<float>& rows) { return DescriptorSet::floats(rows.data(), rows.size() / Scenes::kCols, Scenes::kCols); }
+static DescriptorSet bset(const std::vector<uint8_t>& rows) { return DescriptorSet::binary(rows.data(), rows.size() / (Scenes::kCols / 8), Scenes::kCols / 8); }
+
+TEST(BowIndexTest, VocabularySeparatesClusters) {
+    Scenes s;
+    std::vector<float> sample;
+    for(int f = 0; f < 16; f += 2) { auto r = s.frame(f); sample.insert(sample.end(), r.begin(), r.end()); }
+    BowVocabulary v = BowVocabulary::train(fset(sample), 64, 8);
+    ASSERT_EQ(v.words(), 64u);
+    // Rows drawn from the same centre land on the same word, up to the odd centre that
+    // seeding split in two
+    auto words = v.quantize(fset(sample));
+    size_t same = 0, pairs = 0;
+    for(size_t r = 0; r < words.size(); ++r) {
+        if(r % 100 < 8) continue;
+        pairs++;
+        same += words[r] == words[r - 8];
+    }
+    EXPECT_GE(same, pairs * 95 / 100);
+}
+
+TEST(BowIndexTest, QueryFindsSameScene) {
+    Scenes s;
+    std::vector<std::vector<float>> frames;
+    std::vector<float> sample;
+    for(int f = 0; f < 8; ++f) { frames.push_back(s.frame(f)); sample.insert(sample.end(), frames.back().begin(), frames.back().end()); }
+
+    BowIndexBuilder idx(BowVocabulary::train(fset(sample), 64, 8));
+    for(int f = 0; f < 8; ++f) EXPECT_TRUE(idx.add("img" + std::to_string(f), fset(frames[f])));
+    EXPECT_FALSE(idx.add("img3", fset(frames[3]))); // already indexed
+    EXPECT_EQ(idx.frames(), 8u);
+
+    auto q = s.frame(5); // same scene, fresh noise
+    auto hits = idx.query(fset(q), 3);
+    ASSERT_EQ(hits.size(), 3u); // scene 5 and its neighbours 4 and 6
+    EXPECT_EQ(hits[0].image_id, "img5");
+    EXPECT_GT(hits[0].score, 0.9);
+    EXPECT_LT(hits[1].score, 0.7);
+    EXPECT_NE(hits[1].image_id, hits[2].image_id);
+}
+
+TEST(BowIndexTest, SnapshotIsQueryableInPlaceAndResumable) {
+    Scenes s;
+    std::vector<std::vector<uint8_t>> frames;
+    std::vector<uint8_t> sample;
+    for(int f = 0; f < 8; ++f) { frames.push_back(Scenes::binarize(s.frame(f))); sample.insert(sample.end(), frames.back().begin(), frames.back().end()); }
+
+    BowIndexBuilder idx(BowVocabulary::train(bset(sample), 32, 6));
+    for(int f = 0; f < 6; ++f) idx.add("img" + std::to_string(f), bset(frames[f]));
+    idx.last_rowid = 6;
+
+    fs::path dir = fs::temp_directory_path() / ("bow_index_test_" + std::to_string(::getpid()));
+    fs::create_directories(dir);
+    std::string path = (dir / "index.bow").string(), error;
+    ASSERT_TRUE(idx.save(path, false, error)) << error;
+
+    BowIndexView view;
+    ASSERT_TRUE(view.open(path, error)) << error;
+    EXPECT_EQ(view.frames(), 6u);
+    EXPECT_EQ(view.header().last_rowid, 6);
+    auto q = Scenes::binarize(s.frame(2));
+    auto mapped = view.query(bset(q), 2);
+    auto memory = idx.query(bset(q), 2);
+    ASSERT_EQ(mapped.size(), 2u);
+    EXPECT_EQ(mapped[0].image_id, "img2");
+    EXPECT_EQ(mapped[0].image_id, memory[0].image_id);
+    EXPECT_DOUBLE_EQ(mapped[0].score, memory[0].score);
+    EXPECT_TRUE(view.query(fset(s.frame(2)), 2).empty()); // float query against a binary index
+
+    // Resume, add the rest, replace the snapshot under the open view
+    BowIndexBuilder resumed = BowIndexBuilder::load(view);
+    EXPECT_TRUE(resumed.contains("img4"));
+    EXPECT_EQ(resumed.last_rowid, 6);
+    for(int f = 6; f < 8; ++f) EXPECT_TRUE(resumed.add("img" + std::to_string(f), bset(frames[f])));
+    ASSERT_TRUE(resumed.save(path, false, error)) << error;
+    EXPECT_EQ(view.frames(), 6u); // old mapping is unaffected by the rename
+
+    BowIndexView reopened;
+    ASSERT_TRUE(reopened.open(path, error)) << error;
+    EXPECT_EQ(reopened.frames(), 8u);
+    EXPECT_EQ(reopened.query(bset(Scenes::binarize(s.frame(7))), 1)[0].image_id, "img7");
+    fs::remove_all(dir);
+}
+
+TEST(BowIndexTest, RejectsCorruptSnapshots) {
+    fs::path dir = fs::temp_directory_path() / ("bow_index_bad_" + std::to_string(::getpid()));
+    fs::create_directories(dir);
+    std::string path = (dir / "index.bow").string(), error;
+    BowIndexView view;
+    EXPECT_FALSE(view.open(path, error)); // missing
+
+    Scenes s;
+    auto rows = s.frame(0);
+    BowIndexBuilder idx(BowVocabulary::train(fset(rows), 8, 2));
+    idx.add("a", fset(rows));
+    std::vector<uint8_t> bytes = idx.serialize();
+    bytes.resize(bytes.size() - 4); // truncated
+    ASSERT_TRUE(write_file_atomic(path, bytes.data(), bytes.size(), false, error));
+    EXPECT_FALSE(view.open(path, error));
+    EXPECT_FALSE(view.is_open());
+    fs::remove_all(dir);
+}
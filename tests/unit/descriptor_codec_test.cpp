@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+#include "common/descriptor_codec.hpp"
+
+static std::vector<SimdLevel> levels() {
+    std::vector<SimdLevel> out{SimdLevel::Scalar};
+    if(detect_simd_level() != SimdLevel::Scalar) out.push_back(detect_simd_level());
+    return out;
+}
+
+TEST(DescriptorCodecTest, HalfConversionHandlesSpecialValues) {
+    EXPECT_EQ(float_to_half(0.0f), 0x0000);
+    EXPECT_EQ(float_to_half(-0.0f), 0x8000);
+    EXPECT_EQ(float_to_half(1.0f), 0x3c00);
+    EXPECT_EQ(float_to_half(65504.0f), 0x7bff);  // largest half
+    EXPECT_EQ(float_to_half(70000.0f), 0x7c00);  // overflows to inf
+    EXPECT_EQ(float_to_half(std::numeric_limits<float>::infinity()), 0x7c00);
+    EXPECT_EQ(float_to_half(5.9604645e-8f), 0x0001); // smallest subnormal
+    EXPECT_EQ(float_to_half(1.0f + 1.0f / 2048), 0x3c00); // tie rounds to even
+    EXPECT_EQ(float_to_half(1.0f + 3.0f / 2048), 0x3c02);
+    EXPECT_TRUE(std::isnan(half_to_float(float_to_half(std::numeric_limits<float>::quiet_NaN()))));
+    EXPECT_EQ(half_to_float(0x0001), 5.9604645e-8f);
+    EXPECT_EQ(half_to_float(0xc000), -2.0f);
+    // Every finite half survives a round trip through float
+    for(uint32_t h = 0; h < 0x10000; ++h) {
+        if((h & 0x7c00) == 0x7c00) continue;
+        ASSERT_EQ(float_to_half(half_to_float(static_cast<uint16_t>(h))), h);
+    }
+}
+
+TEST(DescriptorCodecTest, SimdMatchesScalar) {
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> d(-3.0f, 300.0f);
+    std::vector<float> src(1000 + 13); // odd length exercises the tails
+    for(auto& v : src) v = d(rng);
+
+    std::vector<uint16_t> h_ref(src.size()), h(src.size());
+    std::vector<uint8_t> q_ref(src.size()), q(src.size());
+    std::vector<float> f_ref(src.size()), f(src.size());
+    Uint8Scale s_ref = choose_uint8_scale(src.data(), src.size(), SimdLevel::Scalar);
+    encode_float16(src.data(), h_ref.data(), src.size(), SimdLevel::Scalar);
+    encode_uint8(src.data(), q_ref.data(), src.size(), s_ref, SimdLevel::Scalar);
+    for(SimdLevel level : levels()) {
+        Uint8Scale s = choose_uint8_scale(src.data(), src.size(), level);
+        EXPECT_EQ(s.offset, s_ref.offset);
+        EXPECT_EQ(s.scale, s_ref.scale);
+        encode_float16(src.data(), h.data(), src.size(), level);
+        EXPECT_EQ(h, h_ref) << simd_level_name(level);
+        encode_uint8(src.data(), q.data(), src.size(), s, level);
+        EXPECT_EQ(q, q_ref) << simd_level_name(level);
+
+        decode_float16(h.data(), f.data(), f.size(), level);
+        decode_float16(h.data(), f_ref.data(), f_ref.size(), SimdLevel::Scalar);
+        EXPECT_EQ(f, f_ref) << simd_level_name(level);
+        decode_uint8(q.data(), f.data(), f.size(), s, level);
+        decode_uint8(q.data(), f_ref.data(), f_ref.size(), s, SimdLevel::Scalar);
+        EXPECT_EQ(f, f_ref) << simd_level_name(level);
+    }
+}
+
+TEST(DescriptorCodecTest, IntegerDescriptorsSurviveUint8Exactly) {
+    // SIFT-like: integer values in 0..255 stored as float
+    std::mt19937 rng(5);
+    std::vector<float> src(128 * 50);
+    for(auto& v : src) v = static_cast<float>(rng() % 256);
+    for(SimdLevel level : levels()) {
+        Uint8Scale s = choose_uint8_scale(src.data(), src.size(), level);
+        EXPECT_EQ(s.offset, 0.0f);
+        EXPECT_EQ(s.scale, 1.0f);
+        std::vector<uint8_t> q(src.size());
+        std::vector<float> back(src.size()), half_back(src.size());
+        std::vector<uint16_t> h(src.size());
+        encode_uint8(src.data(), q.data(), src.size(), s, level);
+        decode_uint8(q.data(), back.data(), back.size(), s, level);
+        EXPECT_EQ(back, src);
+        encode_float16(src.data(), h.data(), src.size(), level);
+        decode_float16(h.data(), half_back.data(), half_back.size(), level);
+        EXPECT_EQ(half_back, src); // integers up to 2048 are exact in half precision
+    }
+}
+
+TEST(DescriptorCodecTest, ScaledUint8ErrorIsHalfAStep) {
+    std::mt19937 rng(9);
+    std::uniform_real_distribution<float> d(-0.2f, 0.2f); // KAZE-like range
+    std::vector<float> src(64 * 100);
+    for(auto& v : src) v = d(rng);
+    for(SimdLevel level : levels()) {
+        Uint8Scale s = choose_uint8_scale(src.data(), src.size(), level);
+        EXPECT_LT(s.offset, 0.0f);
+        std::vector<uint8_t> q(src.size());
+        std::vector<float> back(src.size());
+        encode_uint8(src.data(), q.data(), src.size(), s, level);
+        decode_uint8(q.data(), back.data(), back.size(), s, level);
+        for(size_t i = 0; i < src.size(); ++i) ASSERT_NEAR(back[i], src[i], s.scale * 0.5f + 1e-6f);
+
+        std::vector<uint16_t> h(src.size());
+        encode_float16(src.data(), h.data(), src.size(), level);
+        decode_float16(h.data(), back.data(), back.size(), level);
+        for(size_t i = 0; i < src.size(); ++i) ASSERT_NEAR(back[i], src[i], std::fabs(src[i]) / 2048 + 1e-7f);
+    }
+}
+
+TEST(DescriptorCodecTest, FractionalNonNegativeDataIsScaled) {
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> d(0.0f, 1.0f); // unit-normalised descriptor
+    std::vector<float> src(64 * 100);
+    for(auto& v : src) v = d(rng);
+    src[5] = 3.0f; // whole numbers alone do not earn the identity scale
+    for(SimdLevel level : levels()) {
+        EXPECT_FALSE(all_whole(src.data(), src.size(), level));
+        Uint8Scale s = choose_uint8_scale(src.data(), src.size(), level);
+        EXPECT_LT(s.scale, 1.0f);
+        std::vector<uint8_t> q(src.size());
+        std::vector<float> back(src.size());
+        encode_uint8(src.data(), q.data(), src.size(), s, level);
+        decode_uint8(q.data(), back.data(), back.size(), s, level);
+        for(size_t i = 0; i < src.size(); ++i) ASSERT_NEAR(back[i], src[i], s.scale * 0.5f + 1e-6f);
+    }
+}
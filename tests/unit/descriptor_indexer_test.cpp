@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <random>
+#include <opencv2/opencv.hpp>
+#include "common/descriptor_indexer.hpp"
+#include "common/sqlite_batch_writer.hpp"
+
+namespace fs = std::filesystem;
+
+// Frame i carries 60 ORB-sized binary descriptors drawn from 6 of 48 random patterns
+// (scene i % 8), with one flipped bit each
+static cv::Mat frame_descriptors(int i) {
+    static cv::Mat patterns = []{
+        std::mt19937 rng(7);
+        cv::Mat p(48, 32, CV_8U);
+        for(int r = 0; r < p.rows; ++r)
+            for(int c = 0; c < p.cols; ++c) p.at<uchar>(r, c) = static_cast<uchar>(rng());
+        return p;
+    }();
+    std::mt19937 rng(static_cast<unsigned>(i) + 1);
+    cv::Mat d(60, 32, CV_8U);
+    for(int r = 0; r < d.rows; ++r) {
+        patterns.row((i % 8) * 6 + r % 6).copyTo(d.row(r));
+        d.at<uchar>(r, static_cast<int>(rng() % 32)) ^= static_cast<uchar>(1u << (rng() % 8));
+    }
+    return d;
+}
+
+static ImageRecord make_record(int i) {
+    ImageRecord r;
+    r.image_id = "img-" + std::to_string(i);
+    r.seq = i;
+    r.path = "processed/" + r.image_id + ".jpg";
+    cv::Mat d = frame_descriptors(i);
+    std::vector<cv::KeyPoint> kps(static_cast<size_t>(d.rows), cv::KeyPoint(1.0f, 2.0f, 3.0f));
+    r.num_keypoints = d.rows;
+    r.kp_blob = serialize_keypoints_and_descriptors(kps, d);
+    return r;
+}
+
+static void insert(const fs::path& db_path, int from, int to) {
+    SqliteBatchWriter::Options opts;
+    SqliteBatchWriter db(db_path.string(), opts);
+    for(int i = from; i < to; ++i) db.submit(make_record(i));
+    db.wait_committed();
+}
+
+static DescriptorIndexer::Options index_options(const fs::path& dir) {
+    DescriptorIndexer::Options o;
+    o.enabled = true;
+    o.path = (dir / "index.bow").string();
+    o.vocabulary_words = 48;
+    o.train_frames = 8;
+    o.poll_interval_ms = 20;
+    o.save_interval_ms = 50;
+    o.batch_rows = 5; // several polls per run
+    return o;
+}
+
+TEST(DescriptorIndexerTest, IndexesCommittedRowsAndResumes) {
+    fs::path dir = fs::temp_directory_path() / "descriptor_indexer_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    fs::path db_path = dir / "data_log.db";
+    auto opts = index_options(dir);
+
+    insert(db_path, 0, 16);
+    {
+        DescriptorIndexer indexer(db_path.string(), opts);
+    } // drains the table and writes the snapshot
+
+    BowIndexView view;
+    std::string error;
+    ASSERT_TRUE(view.open(opts.path, error)) << error;
+    EXPECT_EQ(view.frames(), 16u);
+    cv::Mat q = frame_descriptors(3);
+    auto hits = view.query(descriptor_set(q), 2);
+    ASSERT_EQ(hits.size(), 2u);
+    // Frames 3 and 11 show the same scene
+    EXPECT_TRUE((hits[0].image_id == "img-3" && hits[1].image_id == "img-11") ||
+                (hits[0].image_id == "img-11" && hits[1].image_id == "img-3"));
+
+    // A restart only indexes the rows added since the snapshot
+    insert(db_path, 16, 20);
+    {
+        DescriptorIndexer indexer(db_path.string(), opts);
+        EXPECT_TRUE(indexer.trained());
+        EXPECT_GE(indexer.frames(), 16u); // loaded from the snapshot
+    }
+    BowIndexView reopened;
+    ASSERT_TRUE(reopened.open(opts.path, error)) << error;
+    EXPECT_EQ(reopened.frames(), 20u);
+    fs::remove_all(dir);
+}
+
+TEST(DescriptorIndexerTest, WaitsForTrainingFrames) {
+    fs::path dir = fs::temp_directory_path() / "descriptor_indexer_untrained";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    fs::path db_path = dir / "data_log.db";
+    auto opts = index_options(dir);
+
+    insert(db_path, 0, 4); // fewer than train_frames
+    {
+        DescriptorIndexer indexer(db_path.string(), opts);
+    }
+    EXPECT_FALSE(fs::exists(opts.path));
+    fs::remove_all(dir);
+}
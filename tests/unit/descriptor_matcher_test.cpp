@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include "common/descriptor_matcher.hpp"
+
+static std::vector<SimdLevel> supported_levels() {
+    std::vector<SimdLevel> levels = {SimdLevel::Scalar};
+    if(detect_simd_level() != SimdLevel::Scalar) levels.push_back(SimdLevel::AVX2);
+    if(detect_simd_level() == SimdLevel::AVX512) levels.push_back(SimdLevel::AVX512);
+    return levels;
+}
+
+TEST(DescriptorMatcherTest, KernelsAgreeWithScalar) {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> f(-1.0f, 1.0f);
+    std::uniform_int_distribution<int> b(0, 255);
+    // Lengths around every vector width, including SIFT (128), ORB (32) and AKAZE (61) rows
+    for(size_t n : {1u, 7u, 8u, 15u, 16u, 31u, 32u, 33u, 61u, 64u, 65u, 100u, 128u, 200u}) {
+        std::vector<float> a(n), c(n);
+        std::vector<uint8_t> x(n), y(n);
+        for(size_t i = 0; i < n; ++i) { a[i] = f(rng); c[i] = f(rng); x[i] = static_cast<uint8_t>(b(rng)); y[i] = static_cast<uint8_t>(b(rng)); }
+        float l2 = l2_sq_scalar(a.data(), c.data(), n);
+        uint32_t ham = hamming_scalar(x.data(), y.data(), n);
+        for(SimdLevel s : supported_levels()) {
+            EXPECT_NEAR(l2_kernel(s)(a.data(), c.data(), n), l2, 1e-4f * l2) << simd_level_name(s) << " n=" << n;
+            EXPECT_EQ(hamming_kernel(s)(x.data(), y.data(), n), ham) << simd_level_name(s) << " n=" << n;
+        }
+    }
+}
+
+TEST(DescriptorMatcherTest, HammingCountsBits) {
+    std::vector<uint8_t> a(32, 0x00), b(32, 0x00);
+    EXPECT_EQ(hamming_scalar(a.data(), b.data(), 32), 0u);
+    b[0] = 0xff;
+    b[31] = 0x01;
+    for(SimdLevel s : supported_levels()) EXPECT_EQ(hamming_kernel(s)(a.data(), b.data(), 32), 9u);
+}
+
+TEST(DescriptorMatcherTest, FindsNearestAndAppliesRatioTest) {
+    // train: three well separated rows and two nearly identical ones
+    std::vector<float> train = {0, 0, 0, 0,
+                                10, 0, 0, 0,
+                                0, 10, 0, 0,
+                                0, 0, 10, 0,
+                                0, 0, 10.1f, 0};
+    std::vector<float> query = {0.1f, 0, 0, 0,  // clear match to row 0
+                                0, 9.5f, 0, 0,  // clear match to row 2
+                                0, 0, 10.05f, 0}; // ambiguous between rows 3 and 4
+    for(SimdLevel s : supported_levels()) {
+        MatchOptions opts;
+        opts.simd = s;
+        opts.block_bytes = 32; // two train rows per block, so the running best spans blocks
+        auto m = match_descriptors(DescriptorSet::floats(query.data(), 3, 4), DescriptorSet::floats(train.data(), 5, 4), opts);
+        ASSERT_EQ(m.size(), 2u);
+        EXPECT_EQ(m[0].query, 0u);
+        EXPECT_EQ(m[0].train, 0u);
+        EXPECT_NEAR(m[0].distance, 0.1f, 1e-5f);
+        EXPECT_EQ(m[1].query, 1u);
+        EXPECT_EQ(m[1].train, 2u);
+
+        opts.ratio = 1.0f;
+        EXPECT_EQ(match_descriptors(DescriptorSet::floats(query.data(), 3, 4), DescriptorSet::floats(train.data(), 5, 4), opts).size(), 3u);
+    }
+}
+
+TEST(DescriptorMatcherTest, BinaryFrameSimilarity) {
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<int> b(0, 255);
+    std::vector<uint8_t> frame(200 * 32), other(200 * 32);
+    for(auto& v : frame) v = static_cast<uint8_t>(b(rng));
+    for(auto& v : other) v = static_cast<uint8_t>(b(rng));
+    std::vector<uint8_t> noisy = frame;
+    for(size_t r = 0; r < 200; ++r) noisy[r * 32 + r % 32] ^= 0x11; // 2 bits per row
+
+    auto f = DescriptorSet::binary(frame.data(), 200, 32);
+    double same = frame_similarity(DescriptorSet::binary(noisy.data(), 200, 32), f);
+    double diff = frame_similarity(DescriptorSet::binary(other.data(), 200, 32), f);
+    EXPECT_DOUBLE_EQ(same, 1.0);
+    EXPECT_LT(diff, 0.1);
+}
+
+TEST(DescriptorMatcherTest, IncompatibleSetsDoNotMatch) {
+    std::vector<float> a(8, 0.0f);
+    std::vector<uint8_t> b(8, 0);
+    EXPECT_TRUE(match_descriptors(DescriptorSet::floats(a.data(), 2, 4), DescriptorSet::binary(b.data(), 2, 4)).empty());
+    EXPECT_TRUE(match_descriptors(DescriptorSet::floats(a.data(), 2, 4), DescriptorSet::floats(a.data(), 1, 8)).empty());
+    EXPECT_TRUE(match_descriptors(DescriptorSet::floats(a.data(), 0, 4), DescriptorSet::floats(a.data(), 2, 4)).empty());
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <set>
+#include <thread>
+#include "common/dual_logger.hpp"
+
+namespace fs = std::filesystem;
+
+static fs::path fresh_log(const std::string& name) {
+    fs::path p = fs::temp_directory_path() / "dual_logger_test" / name;
+    fs::remove(p);
+    return p;
+}
+
+static std::vector<std::string> read_lines(const fs::path& p) {
+    std::ifstream f(p);
+    std::vector<std::string> lines;
+    for(std::string l; std::getline(f, l);) lines.push_back(l);
+    return lines;
+}
+
+TEST(MpscRingTest, ConcurrentProducersLoseNothing) {
+    MpscRing<int> ring(1024);
+    constexpr int producers = 4, per_producer = 20000;
+    std::vector<std::thread> threads;
+    for(int t = 0; t < producers; ++t)
+        threads.emplace_back([&, t]{
+            for(int i = 0; i < per_producer; ++i) {
+                int v = t * per_producer + i;
+                while(!ring.try_push(std::move(v))) std::this_thread::yield();
+            }
+        });
+    std::set<int> seen;
+    int v;
+    while(seen.size() < size_t(producers * per_producer))
+        if(ring.try_pop(v)) { EXPECT_TRUE(seen.insert(v).second); }
+    for(auto& t : threads) t.join();
+    EXPECT_FALSE(ring.try_pop(v));
+}
+
+TEST(DualLoggerTest, AsyncWritesEveryLineAndFiltersLevels) {
+    auto path = fresh_log("async.log");
+    DualLogger::Options opts;
+    opts.level = LogLevel::WARN;
+    {
+        DualLogger logger(path.string(), opts);
+        logger.info("hidden", false, true);
+        for(int i = 0; i < 100; ++i) logger.warn("line " + std::to_string(i), false, true);
+        logger.flush();
+        EXPECT_EQ(read_lines(path).size(), 100u);
+        logger.error("last", false, true);
+    } // destructor drains
+    auto lines = read_lines(path);
+    ASSERT_EQ(lines.size(), 101u);
+    EXPECT_EQ(lines.front(), "[WARN] line 0");
+    EXPECT_EQ(lines.back(), "[ERROR] last");
+}
+
+TEST(DualLoggerTest, CountsDropsWhenRingIsFull) {
+    auto path = fresh_log("drops.log");
+    DualLogger::Options opts;
+    opts.ring_capacity = 4;
+    opts.flush_interval_ms = 10000;
+    uint64_t dropped = 0;
+    {
+        DualLogger logger(path.string(), opts);
+        for(int i = 0; i < 50; ++i) logger.info("msg", false, true);
+        dropped = logger.dropped();
+        EXPECT_GT(dropped, 0u);
+    }
+    auto lines = read_lines(path);
+    size_t logged = std::count(lines.begin(), lines.end(), std::string("[INFO] msg"));
+    EXPECT_EQ(logged + dropped, 50u);
+    EXPECT_NE(lines.back().find("dropped"), std::string::npos);
+}
+
+TEST(DualLoggerTest, OptionsFromConfig) {
+    auto o = DualLogger::options_from_config(nlohmann::json{{"level", "ERROR"}, {"overflow", "block"}, {"async", false}});
+    EXPECT_EQ(o.level, LogLevel::ERROR);
+    EXPECT_TRUE(o.block_on_overflow);
+    EXPECT_FALSE(o.async);
+    EXPECT_THROW(DualLogger::options_from_config(nlohmann::json{{"level", "LOUD"}}), std::runtime_error);
+}
@@ -0,0 +1,54 @@
+#include <gtest/gtest.h>
+#include <opencv2/opencv.hpp>
+#include "common/feature_detector.hpp"
+#include "common/ipc_utils.hpp"
+
+// Checkerboard with some texture so every backend finds corners
+static cv::Mat test_image() {
+    cv::Mat img(240, 320, CV_8UC1);
+    for(int y = 0; y < img.rows; ++y)
+        for(int x = 0; x < img.cols; ++x)
+            img.at<uchar>(y, x) = static_cast<uchar>((((x / 20) + (y / 20)) % 2) * 200 + (x * y) % 37);
+    return img;
+}
+
+TEST(FeatureDetectorTest, CreatesEveryBackend) {
+    for(const auto& name : detector_names()) EXPECT_NE(create_detector(name), nullptr) << name;
+    EXPECT_THROW(create_detector("surf"), std::runtime_error);
+    EXPECT_THROW(create_detector("akaze", {{"descriptor", "nope"}}), std::runtime_error);
+}
+
+TEST(FeatureDetectorTest, ParametersFromConfig) {
+    cv::Mat img = test_image();
+    std::vector<cv::KeyPoint> kps;
+    cv::Mat desc;
+
+    // ORB keeps at most nfeatures keypoints
+    auto orb = create_detector_from_config({{"detector", "orb"}, {"detectors", {{"orb", {{"nfeatures", 10}}}}}});
+    orb->detectAndCompute(img, cv::noArray(), kps, desc);
+    EXPECT_LE(kps.size(), 10u);
+
+    // The older sift_nfeatures key still applies
+    auto sift = create_detector_from_config({{"sift_nfeatures", 5}});
+    sift->detectAndCompute(img, cv::noArray(), kps, desc);
+    EXPECT_LE(kps.size(), 5u);
+    EXPECT_EQ(desc.type(), CV_32F);
+}
+
+TEST(FeatureDetectorTest, BinaryDescriptorsRoundTripAsUint8) {
+    cv::Mat img = test_image();
+    for(const char* name : {"orb", "akaze", "brisk"}) {
+        std::vector<cv::KeyPoint> kps;
+        cv::Mat desc;
+        create_detector(name)->detectAndCompute(img, cv::noArray(), kps, desc);
+        ASSERT_FALSE(kps.empty()) << name;
+        ASSERT_EQ(desc.type(), CV_8U) << name;
+
+        auto blob = serialize_keypoints_and_descriptors(kps, desc);
+        EXPECT_EQ(blob[10], KP_DESC_UINT8) << name;
+        auto [kps_out, desc_out] = deserialize_keypoints_and_descriptors(blob);
+        ASSERT_EQ(kps_out.size(), kps.size()) << name;
+        ASSERT_EQ(desc_out.type(), CV_8U) << name;
+        EXPECT_EQ(cv::norm(desc, desc_out, cv::NORM_HAMMING), 0) << name;
+    }
+}
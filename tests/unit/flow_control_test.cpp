@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "common/flow_control.hpp"
+
+static std::vector<int> drain(CreditGate<int>& g) {
+    std::vector<int> out;
+    while(auto f = g.take_ready()) out.push_back(*f);
+    return out;
+}
+
+TEST(CreditGateTest, SendsWhileCreditsLast) {
+    CreditGate<int> g(OverloadPolicy::DropNewest, 0, 1, 100);
+    g.add_credits(2);
+    for(int i = 0; i < 4; ++i) g.offer(i);
+    EXPECT_EQ(drain(g), (std::vector<int>{0, 1}));
+    EXPECT_EQ(g.dropped(), 2u);
+    EXPECT_EQ(g.credits(), 0u);
+}
+
+TEST(CreditGateTest, TakeCreditBypassesBacklog) {
+    CreditGate<int> g(OverloadPolicy::DropOldest, 4, 1, 100);
+    EXPECT_FALSE(g.take_credit());
+    g.add_credits(2);
+    g.offer(0);
+    EXPECT_TRUE(g.take_credit());
+    EXPECT_EQ(drain(g), (std::vector<int>{0}));
+    EXPECT_FALSE(g.take_credit());
+}
+
+TEST(CreditGateTest, DropOldestKeepsNewestBacklog) {
+    CreditGate<int> g(OverloadPolicy::DropOldest, 2, 1, 100);
+    for(int i = 0; i < 5; ++i) g.offer(i);
+    EXPECT_TRUE(drain(g).empty());
+    EXPECT_EQ(g.dropped(), 3u);
+    g.add_credits(10);
+    EXPECT_EQ(drain(g), (std::vector<int>{3, 4}));
+}
+
+TEST(CreditGateTest, DropWaitingCountsAsDropped) {
+    CreditGate<int> g(OverloadPolicy::DropOldest, 2, 1, 100);
+    for(int i = 0; i < 3; ++i) g.offer(i);
+    EXPECT_EQ(g.drop_waiting(), 2u);
+    EXPECT_FALSE(g.has_waiting());
+    EXPECT_EQ(g.dropped(), 3u); // every offered frame is sent or dropped
+}
+
+TEST(CreditGateTest, DropNewestKeepsOldestBacklog) {
+    CreditGate<int> g(OverloadPolicy::DropNewest, 2, 1, 100);
+    for(int i = 0; i < 5; ++i) g.offer(i);
+    g.add_credits(10);
+    EXPECT_EQ(drain(g), (std::vector<int>{0, 1}));
+    EXPECT_EQ(g.dropped(), 3u);
+}
+
+TEST(CreditGateTest, SampleKeepsEveryNthWhileSaturated) {
+    CreditGate<int> g(OverloadPolicy::Sample, 8, 3, 100);
+    for(int i = 0; i < 7; ++i) g.offer(i);
+    g.add_credits(10);
+    EXPECT_EQ(drain(g), (std::vector<int>{0, 3, 6}));
+    EXPECT_EQ(g.dropped(), 4u);
+    g.offer(7); // credit available again: no sampling
+    g.offer(8);
+    EXPECT_EQ(drain(g), (std::vector<int>{7, 8}));
+}
+
+TEST(CreditGateTest, BlockNeverDropsAndCreditsAreCapped) {
+    CreditGate<int> g(OverloadPolicy::Block, 0, 1, 4);
+    for(int i = 0; i < 3; ++i) g.offer(i);
+    EXPECT_TRUE(g.has_waiting());
+    g.add_credits(100);
+    EXPECT_EQ(g.credits(), 4u);
+    EXPECT_EQ(drain(g), (std::vector<int>{0, 1, 2}));
+    EXPECT_EQ(g.dropped(), 0u);
+}
+
+TEST(CreditGateTest, CreditMessagesAndPolicyNames) {
+    uint8_t buf[CREDIT_MSG_SIZE];
+    encode_credit(1234, buf);
+    EXPECT_EQ(decode_credit(buf, sizeof(buf)), 1234u);
+    EXPECT_EQ(decode_credit(buf, 3), 0u);
+    EXPECT_EQ(parse_overload_policy("sample"), OverloadPolicy::Sample);
+    EXPECT_STREQ(overload_policy_name(OverloadPolicy::DropOldest), "drop-oldest");
+    EXPECT_THROW(parse_overload_policy("random"), std::runtime_error);
+}
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+#include <set>
+#include <vector>
+#include "common/frame_header.hpp"
+
+TEST(FrameHeaderTest, ImageIdFormatsAndParses) {
+    ImageId id{0x0123456789abcdefull, 0xfedcba9876543210ull};
+    EXPECT_EQ(id.to_string(), "0123456789abcdeffedcba9876543210");
+    ImageId back;
+    ASSERT_TRUE(ImageId::parse(id.to_string(), back));
+    EXPECT_EQ(back, id);
+    EXPECT_FALSE(ImageId::parse("0123", back));
+    EXPECT_FALSE(ImageId::parse("0123456789ABCDEFfedcba9876543210", back)); // lowercase only
+
+    // Unique, and ordered by creation time at millisecond resolution
+    std::set<std::string> seen;
+    uint64_t last_ms = 0;
+    for(int i = 0; i < 1000; ++i) {
+        ImageId g = ImageId::generate();
+        EXPECT_TRUE(seen.insert(g.to_string()).second);
+        EXPECT_GE(g.hi >> 16, last_ms);
+        last_ms = g.hi >> 16;
+    }
+}
+
+TEST(FrameHeaderTest, RoundTripWithExtension) {
+    FrameHeader h;
+    h.set_image_id(ImageId::generate());
+    h.timestamp_ns = 1714564800123456789; // 2024-05-01T12:00:00.123Z
+    h.seq = 42;
+    h.width = 1920;
+    h.height = 1080;
+    h.num_keypoints = 1234;
+    h.detector = 1;
+    TraceStamps t;
+    t.ns[GEN_SEND] = 111;
+    t.ns[PROC_SEND] = 222;
+    h.set_trace(t);
+    std::string ext = R"({"camera":"cam0"})";
+
+    std::vector<uint64_t> buf(frame_header_wire_size(ext.size()) / 8 + 1); // 8-byte aligned
+    auto* bytes = reinterpret_cast<uint8_t*>(buf.data());
+    write_frame_header(h, ext, bytes);
+
+    FrameHeader scratch;
+    std::string_view got_ext;
+    const FrameHeader* r = read_frame_header(bytes, frame_header_wire_size(ext.size()), scratch, &got_ext);
+    ASSERT_NE(r, nullptr);
+    EXPECT_EQ(static_cast<const void*>(r), static_cast<const void*>(bytes)); // read in place
+    EXPECT_EQ(r->image_id(), h.image_id());
+    EXPECT_EQ(r->seq, 42u);
+    EXPECT_EQ(r->width, 1920u);
+    EXPECT_EQ(r->num_keypoints, 1234u);
+    EXPECT_EQ(r->ext_size, ext.size());
+    EXPECT_EQ(got_ext, ext);
+    EXPECT_EQ(r->trace_stamps().ns[GEN_SEND], 111u);
+    EXPECT_EQ(r->trace_stamps().ns[PROC_SEND], 222u);
+    EXPECT_FALSE(r->trace_stamps().has(LOG_RECV));
+    EXPECT_EQ(r->timestamp_iso8601(), "2024-05-01T12:00:00.123Z");
+    EXPECT_STREQ(frame_encoding_name(r->encoding), "jpg");
+}
+
+TEST(FrameHeaderTest, UnalignedBufferIsCopied) {
+    FrameHeader h;
+    h.seq = 7;
+    std::vector<uint8_t> buf(frame_header_wire_size(0) + 1);
+    write_frame_header(h, {}, buf.data() + 1);
+    FrameHeader scratch;
+    const FrameHeader* r = read_frame_header(buf.data() + 1, buf.size() - 1, scratch);
+    ASSERT_EQ(r, &scratch);
+    EXPECT_EQ(r->seq, 7u);
+}
+
+TEST(FrameHeaderTest, RejectsOtherMessages) {
+    FrameHeader scratch;
+    std::string json = R"({"image_id":"abc","seq":1})";
+    EXPECT_EQ(read_frame_header(json.data(), json.size(), scratch), nullptr); // JSON meta of older builds
+
+    FrameHeader h;
+    std::vector<uint64_t> buf(frame_header_wire_size(0) / 8);
+    auto* bytes = reinterpret_cast<uint8_t*>(buf.data());
+    write_frame_header(h, {}, bytes);
+    EXPECT_EQ(read_frame_header(bytes, sizeof(FrameHeader) - 1, scratch), nullptr); // truncated
+    bytes[4] = 9; // unknown version
+    EXPECT_EQ(read_frame_header(bytes, sizeof(FrameHeader), scratch), nullptr);
+    bytes[4] = FRAME_HEADER_VERSION;
+    uint32_t ext_size = 100; // extension past the end of the message
+    std::memcpy(bytes + offsetof(FrameHeader, ext_size), &ext_size, 4);
+    EXPECT_EQ(read_frame_header(bytes, sizeof(FrameHeader), scratch), nullptr);
+}
+
+TEST(FrameHeaderTest, FewerTracePointsFromPeer) {
+    FrameHeader h;
+    for(int p = 0; p < FRAME_TRACE_SLOTS; ++p) h.trace[p] = 100 + p;
+    h.trace_points = 2; // an older peer that only knew two trace points
+    TraceStamps t = h.trace_stamps();
+    EXPECT_EQ(t.ns[0], 100u);
+    EXPECT_EQ(t.ns[1], 101u);
+    EXPECT_FALSE(t.has(static_cast<TracePoint>(2)));
+}
@@ -72,3 +72,220 @@ TEST(IPCUtilsTest, SerializeDeserializeNonFloatDescriptor) {
     ASSERT_EQ(desc_out.cols,3);
     EXPECT_EQ(desc_out.at<uint8_t>(0,2),3);
 }
+
+// Hand-built v1 (interleaved) blob, as written by older processors
+static std::vector<uint8_t> make_legacy_blob(const std::vector<cv::KeyPoint>& kps, const cv::Mat& desc) {
+    std::vector<uint8_t> out;
+    auto put = [&](const void* p, size_t n){ out.insert(out.end(), (const uint8_t*)p, (const uint8_t*)p + n); };
+    uint32_t N = kps.size(), D = desc.empty() ? 0 : desc.cols;
+    put(&N, 4); put(&D, 4);
+    out.push_back(desc.type() == CV_32F ? 0 : 1);
+    for(uint32_t i=0;i<N;i++) {
+        const auto& kp = kps[i];
+        int32_t octave = kp.octave, class_id = kp.class_id;
+        put(&kp.pt.x, 4); put(&kp.pt.y, 4); put(&kp.size, 4); put(&kp.angle, 4); put(&kp.response, 4);
+        put(&octave, 4); put(&class_id, 4);
+        put(desc.ptr<uint8_t>(i), D * desc.elemSize());
+    }
+    return out;
+}
+
+TEST(IPCUtilsTest, SoaHeaderAndSectionAlignment) {
+    std::vector<cv::KeyPoint> kps(5, cv::KeyPoint(1.0f, 2.0f, 3.0f));
+    cv::Mat desc(5, 128, CV_32F);
+    auto blob = serialize_keypoints_and_descriptors(kps, desc);
+
+    KeypointBlobLayout L;
+    ASSERT_TRUE(read_keypoint_blob_layout(blob.data(), blob.size(), L));
+    EXPECT_EQ(blob[8], KP_BLOB_SOA);
+    EXPECT_EQ(L.N, 5u);
+    EXPECT_EQ(L.D, 128u);
+    for(int s=0; s<KP_BLOB_NUM_SECTIONS; s++) EXPECT_EQ(L.section[s] % KP_BLOB_SECTION_ALIGN, 0u);
+    EXPECT_EQ(L.desc_offset % KP_BLOB_DESC_ALIGN, 0u);
+    EXPECT_EQ(blob.size(), L.desc_offset + 5 * 128 * sizeof(float));
+}
+
+TEST(IPCUtilsTest, ReadsLegacyBlob) {
+    std::vector<cv::KeyPoint> kps;
+    kps.emplace_back(3.0f, 4.0f, 7.0f, 45.0f, 0.5f, 2, 9);
+    kps.emplace_back(5.0f, 6.0f, 8.0f, 90.0f, 0.25f, 1, -1);
+    cv::Mat desc(2, 4, CV_32F);
+    for(int i=0;i<2;i++) for(int j=0;j<4;j++) desc.at<float>(i,j) = float(i*4+j);
+
+    auto legacy = make_legacy_blob(kps, desc);
+    ASSERT_NE(legacy[8], KP_BLOB_SOA);
+    auto [kps_out, desc_out] = deserialize_keypoints_and_descriptors(legacy);
+
+    ASSERT_EQ(kps_out.size(), 2);
+    EXPECT_FLOAT_EQ(kps_out[0].angle, 45.0f);
+    EXPECT_EQ(kps_out[0].octave, 2);
+    EXPECT_EQ(kps_out[0].class_id, 9);
+    EXPECT_FLOAT_EQ(kps_out[1].response, 0.25f);
+    EXPECT_FLOAT_EQ(desc_out.at<float>(1,3), 7.0f);
+    EXPECT_TRUE(wrap_keypoint_descriptors(legacy.data(), legacy.size()).empty());
+}
+
+TEST(IPCUtilsTest, WrapDescriptorsWithoutCopy) {
+    std::vector<cv::KeyPoint> kps(3, cv::KeyPoint(0.0f, 0.0f, 1.0f));
+    cv::Mat desc(3, 32, CV_8U);
+    for(int i=0;i<3;i++) for(int j=0;j<32;j++) desc.at<uint8_t>(i,j) = uint8_t(i+j);
+
+    auto blob = serialize_keypoints_and_descriptors(kps, desc);
+    cv::Mat view = wrap_keypoint_descriptors(blob.data(), blob.size());
+
+    ASSERT_EQ(view.rows, 3);
+    ASSERT_EQ(view.cols, 32);
+    EXPECT_EQ(view.type(), CV_8U);
+    EXPECT_EQ(view.ptr<uint8_t>(0), blob.data() + KeypointBlobLayout(3, 32, 1).desc_offset);
+    EXPECT_EQ(view.at<uint8_t>(2,31), 33);
+}
+
+TEST(IPCUtilsTest, TruncatedSoaBlobIsRejected) {
+    std::vector<cv::KeyPoint> kps(2, cv::KeyPoint(1.0f, 1.0f, 1.0f));
+    cv::Mat desc(2, 8, CV_32F);
+    auto blob = serialize_keypoints_and_descriptors(kps, desc);
+    blob.resize(blob.size() - 1);
+    auto [kps_out, desc_out] = deserialize_keypoints_and_descriptors(blob);
+    EXPECT_TRUE(kps_out.empty());
+    EXPECT_TRUE(desc_out.empty());
+}
+
+TEST(IPCUtilsTest, CompressedFloatDescriptorsRoundTrip) {
+    // SIFT-like rows: integers 0..255 stored as float survive both encodings exactly
+    std::vector<cv::KeyPoint> kps(4, cv::KeyPoint(1.0f, 2.0f, 3.0f));
+    cv::Mat desc(4, 128, CV_32F);
+    for(int i=0;i<4;i++) for(int j=0;j<128;j++) desc.at<float>(i,j) = float((i*37 + j*11) % 256);
+    auto plain = serialize_keypoints_and_descriptors(kps, desc);
+
+    for(uint8_t enc : {KP_DESC_FLOAT16, KP_DESC_UINT8_SCALED}) {
+        auto blob = serialize_keypoints_and_descriptors(kps, desc, enc);
+        EXPECT_EQ(blob.size(), keypoint_blob_layout(kps, desc, enc).total_size);
+        EXPECT_LT(blob.size(), plain.size());
+        EXPECT_EQ(blob[10], enc);
+        auto [kps_out, desc_out] = deserialize_keypoints_and_descriptors(blob);
+        ASSERT_EQ(kps_out.size(), 4u);
+        ASSERT_EQ(desc_out.type(), CV_32F);
+        EXPECT_EQ(cv::norm(desc_out, desc, cv::NORM_INF), 0.0) << int(enc);
+    }
+
+    // Binary descriptors are never re-encoded
+    cv::Mat bin(4, 32, CV_8U, cv::Scalar(7));
+    EXPECT_EQ(serialize_keypoints_and_descriptors(kps, bin, KP_DESC_FLOAT16)[10], KP_DESC_UINT8);
+    EXPECT_THROW(parse_descriptor_encoding("int4"), std::runtime_error);
+}
+
+TEST(IPCUtilsTest, ScaledUint8DecodesLazily) {
+    std::vector<cv::KeyPoint> kps(3, cv::KeyPoint(0.0f, 0.0f, 1.0f));
+    cv::Mat desc(3, 64, CV_32F);
+    for(int i=0;i<3;i++) for(int j=0;j<64;j++) desc.at<float>(i,j) = float(i*64 + j) / 1000.0f - 0.1f; // KAZE-like range
+    auto blob = serialize_keypoints_and_descriptors(kps, desc, KP_DESC_UINT8_SCALED);
+
+    KeypointBlobLayout L;
+    ASSERT_TRUE(read_keypoint_blob_layout(blob.data(), blob.size(), L));
+    EXPECT_EQ(L.desc_params % KP_BLOB_SECTION_ALIGN, 0u);
+    EXPECT_EQ(L.desc_offset % KP_BLOB_DESC_ALIGN, 0u);
+    EXPECT_EQ(blob.size(), L.desc_offset + 3 * 64);
+    Uint8Scale s = read_uint8_scale(blob.data(), L);
+    EXPECT_FLOAT_EQ(s.offset, -0.1f);
+    EXPECT_TRUE(wrap_keypoint_descriptors(blob.data(), blob.size()).empty()); // no float view of a uint8 block
+
+    LazyKeypointDescriptors lazy;
+    ASSERT_TRUE(lazy.open(blob.data(), blob.size()));
+    EXPECT_EQ(lazy.rows(), 3u);
+    EXPECT_EQ(lazy.stored_bytes(), 3u * 64);
+    const float* r2 = reinterpret_cast<const float*>(lazy.row(2));
+    for(int j=0;j<64;j++) EXPECT_NEAR(r2[j], desc.at<float>(2,j), s.scale / 2 + 1e-6f);
+    const cv::Mat& all = lazy.mat();
+    ASSERT_EQ(all.type(), CV_32F);
+    EXPECT_EQ(std::memcmp(all.ptr<float>(2), r2, 64 * sizeof(float)), 0);
+    EXPECT_LE(cv::norm(all, desc, cv::NORM_INF), s.scale / 2 + 1e-6);
+
+    // Plain blocks are viewed in place
+    auto plain = serialize_keypoints_and_descriptors(kps, desc);
+    ASSERT_TRUE(lazy.open(plain.data(), plain.size()));
+    EXPECT_EQ(lazy.mat().ptr<uint8_t>(0), plain.data() + KeypointBlobLayout(3, 64, KP_DESC_FLOAT32).desc_offset);
+}
+
+// 150 keypoints on a 15 x 10 grid (x = 10 * (i % 15), y = 10 * (i / 15)), response = i / 150
+static std::vector<uint8_t> grid_blob(uint8_t enc = KP_DESC_FLOAT32) {
+    std::vector<cv::KeyPoint> kps;
+    cv::Mat desc(150, 16, CV_32F);
+    for(int i=0;i<150;i++) {
+        kps.emplace_back(float(10 * (i % 15)), float(10 * (i / 15)), 4.0f, float(i), i / 150.0f, i % 3, i);
+        for(int j=0;j<16;j++) desc.at<float>(i,j) = float(i + j);
+    }
+    return serialize_keypoints_and_descriptors(kps, desc, enc);
+}
+
+TEST(IPCUtilsTest, BlobViewRandomAccess) {
+    auto blob = grid_blob();
+    auto [kps, desc] = deserialize_keypoints_and_descriptors(blob);
+    KeypointBlobView view(blob.data(), blob.size());
+    ASSERT_TRUE(view.valid());
+    ASSERT_EQ(view.size(), 150u);
+    EXPECT_EQ(view.descriptor_cols(), 16u);
+    for(uint32_t i : {0u, 77u, 149u}) {
+        cv::KeyPoint kp = view.keypoint(i);
+        EXPECT_EQ(kp.pt.x, kps[i].pt.x);
+        EXPECT_EQ(kp.angle, kps[i].angle);
+        EXPECT_EQ(kp.response, kps[i].response);
+        EXPECT_EQ(view.octave(i), kps[i].octave);
+        EXPECT_EQ(view.class_id(i), int32_t(i));
+        EXPECT_EQ(std::memcmp(view.descriptor_data(i), desc.ptr<float>(int(i)), view.row_bytes()), 0);
+    }
+    EXPECT_EQ(view.descriptors().ptr<uint8_t>(0), view.descriptor_data(0)); // in place
+
+    // Compressed rows decode on request
+    auto small = grid_blob(KP_DESC_UINT8_SCALED);
+    ASSERT_TRUE(view.open(small.data(), small.size()));
+    float row[16];
+    view.descriptor(100, row);
+    EXPECT_EQ(row[15], 115.0f);
+    EXPECT_TRUE(view.descriptors().empty());
+
+    auto legacy = make_legacy_blob(kps, desc);
+    EXPECT_FALSE(view.open(legacy.data(), legacy.size()));
+    EXPECT_EQ(view.size(), 0u);
+}
+
+TEST(IPCUtilsTest, BlobViewFilters) {
+    // Copy to an odd address: the view must not depend on alignment
+    auto src = grid_blob();
+    std::vector<uint8_t> buf(src.size() + 1);
+    std::memcpy(buf.data() + 1, src.data(), src.size());
+    KeypointBlobView view(buf.data() + 1, src.size());
+    ASSERT_TRUE(view.valid());
+
+    for(SimdLevel simd : {SimdLevel::Scalar, detect_simd_level()}) {
+        std::vector<uint32_t> hits;
+        size_t n = view.for_each_with_response(0.5f, [&](uint32_t i){ hits.push_back(i); }, simd);
+        ASSERT_EQ(n, 75u);
+        EXPECT_EQ(hits.front(), 75u);
+        EXPECT_EQ(hits.back(), 149u);
+        EXPECT_TRUE(std::is_sorted(hits.begin(), hits.end()));
+
+        // x in [20, 50), y in [80, 100): columns 2..4 of rows 8..9
+        hits.clear();
+        n = view.for_each_in_roi(cv::Rect2f(20.0f, 80.0f, 30.0f, 20.0f), [&](uint32_t i){ hits.push_back(i); }, simd);
+        EXPECT_EQ(n, 6u);
+        EXPECT_EQ(hits, (std::vector<uint32_t>{122, 123, 124, 137, 138, 139}));
+    }
+    size_t odd_octave = view.for_each_where([](const KeypointBlobView& v, uint32_t i){ return v.octave(i) == 1; }, [](uint32_t){});
+    EXPECT_EQ(odd_octave, 50u);
+}
+
+TEST(IPCUtilsTest, CommandLineOptionsAndPositionalArgs) {
+    const char *args[] = {"generator", "--config", "cfg/test.json", "images/", "--instance", "2", "extra"};
+    char **argv = const_cast<char **>(args);
+    EXPECT_EQ(config::config_path(7, argv), "cfg/test.json");
+    EXPECT_EQ(config::option(7, argv, "--instance"), "2");
+    EXPECT_EQ(config::option(7, argv, "--missing", "x"), "x");
+    EXPECT_EQ(config::positional_args(7, argv), (std::vector<std::string>{"images/", "extra"}));
+    EXPECT_EQ(config::config_path(1, argv), config::DEFAULT_CONFIG_PATH);
+
+    const char *launcher_args[] = {"launcher", "--in-process", "3"};
+    char **largv = const_cast<char **>(launcher_args);
+    EXPECT_TRUE(config::flag(3, largv, "--in-process"));
+    EXPECT_FALSE(config::flag(7, argv, "--in-process"));
+    EXPECT_EQ(config::positional_args(3, largv, {"--in-process"}), (std::vector<std::string>{"3"}));
+}
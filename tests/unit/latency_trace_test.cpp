@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include "common/latency_trace.hpp"
+
+TEST(LatencyHistogramTest, PercentilesWithinPrecision) {
+    LatencyHistogram h;
+    for(uint64_t v = 1; v <= 100000; ++v) h.record(v * 1000); // 1 us .. 100 ms
+    EXPECT_EQ(h.count(), 100000u);
+    EXPECT_EQ(h.min(), 1000u);
+    EXPECT_EQ(h.max(), 100000000u);
+    EXPECT_NEAR(h.percentile(50), 50000000.0, 50000000 * 0.001);
+    EXPECT_NEAR(h.percentile(99), 99000000.0, 99000000 * 0.001);
+    EXPECT_NEAR(h.percentile(99.9), 99900000.0, 99900000 * 0.001);
+    EXPECT_EQ(h.percentile(100), h.max());
+}
+
+TEST(LatencyHistogramTest, SmallValuesAreExactAndLargeOnesClamped) {
+    LatencyHistogram h(1000000);
+    h.record(0);
+    h.record(7);
+    h.record(2047);
+    h.record(5000000); // above max_value
+    EXPECT_EQ(h.percentile(25), 0u);
+    EXPECT_EQ(h.percentile(50), 7u);
+    EXPECT_EQ(h.percentile(75), 2047u);
+    EXPECT_EQ(h.max(), 1000000u);
+    h.reset();
+    EXPECT_EQ(h.count(), 0u);
+    EXPECT_EQ(h.percentile(50), 0u);
+}
+
+TEST(LatencyTrackerTest, MetaRoundTripAndMissingStamps) {
+    TraceStamps t;
+    t.ns[GEN_SEND] = 1000;
+    t.ns[PROC_RECV] = 3000;
+    t.ns[LOG_COMMITTED] = 11000;
+    nlohmann::json meta;
+    meta["trace"] = t.to_json();
+    EXPECT_EQ(meta["trace"].size(), 3u);
+
+    TraceStamps back = TraceStamps::from_meta(nlohmann::json::parse(meta.dump()));
+    EXPECT_EQ(back.ns, t.ns);
+    EXPECT_FALSE(TraceStamps::from_meta(nlohmann::json::object()).has(GEN_SEND));
+
+    LatencyTracker tracker;
+    tracker.record(back);
+    auto s = tracker.snapshot();
+    EXPECT_EQ(s["gen_to_proc"]["count"], 1u);
+    EXPECT_EQ(s["gen_to_proc"]["p50_ns"], 2000u);
+    EXPECT_EQ(s["end_to_end"]["p99_ns"], 10000u);
+    EXPECT_EQ(s["decode"]["count"], 0u); // never stamped
+    EXPECT_NE(tracker.summary().find("end_to_end"), std::string::npos);
+}
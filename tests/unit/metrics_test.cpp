@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include "common/metrics.hpp"
+
+static std::string http_get(int port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if(::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) { ::close(fd); return ""; }
+    std::string req = "GET /metrics HTTP/1.0\r\n\r\n";
+    ::send(fd, req.data(), req.size(), 0);
+    std::string resp;
+    char buf[4096];
+    for(ssize_t n; (n = ::recv(fd, buf, sizeof(buf), 0)) > 0;) resp.append(buf, static_cast<size_t>(n));
+    ::close(fd);
+    return resp;
+}
+
+TEST(MetricsTest, CounterSumsAcrossThreads) {
+    MetricsRegistry reg;
+    Counter& c = reg.counter("frames_total", "Frames");
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 8; ++t) threads.emplace_back([&]{ for(int i = 0; i < 10000; ++i) c.inc(); });
+    for(auto& t : threads) t.join();
+    EXPECT_EQ(c.value(), 80000u);
+    EXPECT_NE(reg.render().find("frames_total 80000\n"), std::string::npos);
+}
+
+TEST(MetricsTest, RendersPrometheusText) {
+    MetricsRegistry reg;
+    reg.gauge("temp", "Temperature").set(1.5);
+    int depth = 3;
+    reg.callback("queue_depth", "Queued frames", [&]{ return double(depth); }, "stage=\"decode\"");
+    reg.callback("queue_depth", "Queued frames", []{ return 0.0; }, "stage=\"send\"");
+    Histogram& h = reg.histogram("sift_seconds", "SIFT time", {0.01, 0.1});
+    h.observe(0.005);
+    h.observe(0.05);
+    h.observe(1);
+
+    std::string text = reg.render();
+    EXPECT_NE(text.find("# TYPE temp gauge\ntemp 1.5\n"), std::string::npos);
+    EXPECT_NE(text.find("queue_depth{stage=\"decode\"} 3\n"), std::string::npos);
+    EXPECT_NE(text.find("queue_depth{stage=\"send\"} 0\n"), std::string::npos);
+    EXPECT_EQ(text.find("# HELP queue_depth"), text.rfind("# HELP queue_depth")); // one header per family
+    EXPECT_NE(text.find("sift_seconds_bucket{le=\"0.01\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("sift_seconds_bucket{le=\"0.1\"} 2\n"), std::string::npos);
+    EXPECT_NE(text.find("sift_seconds_bucket{le=\"+Inf\"} 3\n"), std::string::npos);
+    EXPECT_NE(text.find("sift_seconds_count 3\n"), std::string::npos);
+    EXPECT_NEAR(h.sum(), 1.055, 1e-9);
+}
+
+TEST(MetricsTest, ServesOverHttp) {
+    MetricsRegistry reg;
+    reg.counter("requests_total", "Requests").inc(42);
+    MetricsServer server(reg, 0);
+    ASSERT_GT(server.port(), 0);
+    std::string resp = http_get(server.port());
+    EXPECT_EQ(resp.rfind("HTTP/1.0 200 OK", 0), 0u);
+    EXPECT_NE(resp.find("requests_total 42"), std::string::npos);
+}
@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+#include <opencv2/opencv.hpp>
+#include "common/preprocess.hpp"
+
+static std::vector<uchar> encode_test_image(int width, int height) {
+    cv::Mat img(height, width, CV_8UC3);
+    for(int y = 0; y < height; ++y)
+        for(int x = 0; x < width; ++x)
+            img.at<cv::Vec3b>(y, x) = cv::Vec3b(uchar(x), uchar(y), uchar(x + y));
+    std::vector<uchar> jpeg;
+    cv::imencode(".jpg", img, jpeg, {cv::IMWRITE_JPEG_QUALITY, 90});
+    return jpeg;
+}
+
+TEST(PreprocessTest, ChooseReduceStaysAboveMaxDimension) {
+    EXPECT_EQ(choose_reduce(4000, 3000, 1000), 4);
+    EXPECT_EQ(choose_reduce(4000, 3000, 500), 8);
+    EXPECT_EQ(choose_reduce(1200, 900, 1000), 1);
+    EXPECT_EQ(choose_reduce(2000, 1500, 1000), 2);
+    EXPECT_EQ(choose_reduce(0, 0, 1000), 1);
+    EXPECT_EQ(choose_reduce(4000, 3000, 0), 1);
+}
+
+TEST(PreprocessTest, ConfigValidation) {
+    auto o = PreprocessOptions::from_config({{"decode_grayscale", false}, {"decode_reduce", 4}, {"max_dimension", 800}});
+    EXPECT_FALSE(o.grayscale);
+    EXPECT_EQ(o.reduce, 4);
+    EXPECT_EQ(o.max_dimension, 800);
+    EXPECT_TRUE(PreprocessOptions::from_config({{"decode_grayscale", false}}).is_identity());
+    EXPECT_THROW(PreprocessOptions::from_config({{"decode_reduce", 3}}), std::runtime_error);
+    EXPECT_THROW(PreprocessOptions::from_config({{"max_dimension", -1}}), std::runtime_error);
+}
+
+TEST(PreprocessTest, ReducedGrayscaleDecodeAndResize) {
+    auto jpeg = encode_test_image(640, 480);
+    PreprocessOptions opts;
+    opts.reduce = 2;
+    opts.max_dimension = 160;
+    PreparedImage p = prepare_for_detection(jpeg.data(), jpeg.size(), opts, 640, 480);
+    ASSERT_FALSE(p.img.empty());
+    EXPECT_EQ(p.img.channels(), 1);
+    EXPECT_EQ(p.img.cols, 160);
+    EXPECT_EQ(p.img.rows, 120);
+    EXPECT_DOUBLE_EQ(p.scale_x, 4.0);
+    EXPECT_DOUBLE_EQ(p.scale_y, 4.0);
+
+    // Auto reduction decodes at 1/4, which already meets max_dimension without a resize
+    opts.reduce = 0;
+    p = prepare_for_detection(jpeg.data(), jpeg.size(), opts, 640, 480);
+    EXPECT_EQ(p.img.cols, 160);
+    EXPECT_DOUBLE_EQ(p.scale_x, 4.0);
+
+    // Without the original size in the meta the reduction factor is assumed
+    opts.reduce = 2;
+    opts.max_dimension = 0;
+    p = prepare_for_detection(jpeg.data(), jpeg.size(), opts);
+    EXPECT_EQ(p.img.cols, 320);
+    EXPECT_DOUBLE_EQ(p.scale_x, 2.0);
+
+    uchar garbage[16] = {0};
+    EXPECT_TRUE(prepare_for_detection(garbage, sizeof(garbage), opts).img.empty());
+}
+
+TEST(PreprocessTest, RescaleKeypointsToOriginalGeometry) {
+    std::vector<cv::KeyPoint> kps{cv::KeyPoint(9.5f, 4.5f, 3.0f, 45.0f, 0.5f, 1, -1)};
+    rescale_keypoints(kps, 2.0, 4.0);
+    EXPECT_FLOAT_EQ(kps[0].pt.x, 19.5f);
+    EXPECT_FLOAT_EQ(kps[0].pt.y, 19.5f);
+    EXPECT_FLOAT_EQ(kps[0].size, 9.0f);
+    EXPECT_FLOAT_EQ(kps[0].angle, 45.0f);
+
+    std::vector<cv::KeyPoint> same{cv::KeyPoint(1.0f, 2.0f, 3.0f)};
+    rescale_keypoints(same, 1.0, 1.0);
+    EXPECT_FLOAT_EQ(same[0].pt.x, 1.0f);
+}
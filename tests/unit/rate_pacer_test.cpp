@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include "common/rate_pacer.hpp"
+
+using namespace std::chrono;
+
+static RatePacer::Clock::time_point t0() { return RatePacer::Clock::time_point(seconds(100)); }
+
+TEST(RatePacerTest, ConstantDeadlinesDoNotDrift) {
+    RatePacer::Options o;
+    o.rate_fps = 100;
+    RatePacer pacer(o, t0());
+    RatePacer::Clock::time_point last;
+    for(int i = 0; i <= 1000; ++i) last = *pacer.next();
+    EXPECT_EQ(last - t0(), seconds(10));
+}
+
+TEST(RatePacerTest, BurstProfileSwitchesRateAndSkipsSilence) {
+    RatePacer::Options o;
+    o.profile = "burst";
+    o.rate_fps = 0;
+    o.burst_fps = 10;
+    o.burst_ms = 500;
+    o.burst_period_ms = 2000;
+    RatePacer pacer(o, t0());
+    std::vector<milliseconds> offsets;
+    for(int i = 0; i < 7; ++i) offsets.push_back(duration_cast<milliseconds>(*pacer.next() - t0()));
+    // Five frames at 10 fps inside the first 500 ms, then nothing until the next period
+    std::vector<milliseconds> expected{milliseconds(0), milliseconds(100), milliseconds(200), milliseconds(300),
+                                       milliseconds(400), milliseconds(2000), milliseconds(2100)};
+    EXPECT_EQ(offsets, expected);
+    EXPECT_DOUBLE_EQ(pacer.target_rate(t0() + milliseconds(100)), 10);
+    EXPECT_DOUBLE_EQ(pacer.target_rate(t0() + milliseconds(1000)), 0);
+}
+
+TEST(RatePacerTest, RampAndStepTargets) {
+    RatePacer::Options ramp;
+    ramp.profile = "ramp";
+    ramp.rate_fps = 10;
+    ramp.ramp_to_fps = 30;
+    ramp.ramp_ms = 1000;
+    RatePacer r(ramp, t0());
+    EXPECT_DOUBLE_EQ(r.target_rate(t0()), 10);
+    EXPECT_DOUBLE_EQ(r.target_rate(t0() + milliseconds(500)), 20);
+    EXPECT_DOUBLE_EQ(r.target_rate(t0() + seconds(5)), 30);
+
+    RatePacer::Options step;
+    step.profile = "step";
+    step.steps = {{1000, 5}, {500, 20}};
+    RatePacer s(step, t0());
+    EXPECT_DOUBLE_EQ(s.target_rate(t0() + milliseconds(999)), 5);
+    EXPECT_DOUBLE_EQ(s.target_rate(t0() + milliseconds(1200)), 20);
+    EXPECT_DOUBLE_EQ(s.target_rate(t0() + milliseconds(1600)), 5); // cycles
+}
+
+TEST(RatePacerTest, ReplaysTraceGaps) {
+    std::string path = testing::TempDir() + "rate_pacer_trace.txt";
+    { std::ofstream f(path); f << "# gaps in ms\n10\n\n30\n"; }
+    RatePacer::Options o;
+    o.profile = "trace";
+    o.trace = load_interarrival_trace(path);
+    o.trace_loop = false;
+    std::remove(path.c_str());
+
+    RatePacer pacer(o, t0());
+    EXPECT_EQ(*pacer.next(), t0());
+    EXPECT_EQ(*pacer.next(), t0() + milliseconds(10));
+    EXPECT_EQ(*pacer.next(), t0() + milliseconds(40));
+    EXPECT_FALSE(pacer.next().has_value());
+    EXPECT_DOUBLE_EQ(pacer.target_rate(t0()), 50);
+}
+
+TEST(RatePacerTest, RejectsInvalidProfiles) {
+    RatePacer::Options o;
+    o.profile = "sine";
+    EXPECT_THROW(RatePacer{o}, std::runtime_error);
+    o.profile = "constant";
+    o.rate_fps = 0;
+    EXPECT_THROW(RatePacer{o}, std::runtime_error);
+}
@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+#include "common/seq_tracker.hpp"
+
+using namespace std::chrono_literals;
+
+static SeqTracker::Options fast_options() {
+    SeqTracker::Options o;
+    o.gap_timeout = 100ms;
+    o.retry_interval = 100ms;
+    o.max_attempts = 2;
+    o.max_request = 4;
+    return o;
+}
+
+static void store(SeqTracker& t, uint32_t source, uint64_t seq) {
+    ASSERT_TRUE(t.admit(source, seq));
+    t.committed(source, seq);
+}
+
+TEST(SeqTrackerTest, WatermarkFollowsContiguousCommits) {
+    SeqTracker t(fast_options());
+    store(t, 1, 1);
+    store(t, 1, 2);
+    store(t, 1, 4);
+    EXPECT_EQ(t.contiguous(1), 2u);
+    ASSERT_TRUE(t.admit(1, 3));
+    EXPECT_EQ(t.contiguous(1), 2u); // being stored does not count yet
+    t.committed(1, 3);
+    EXPECT_EQ(t.contiguous(1), 4u);
+    auto progress = t.take_progress();
+    ASSERT_EQ(progress.size(), 1u);
+    EXPECT_EQ(progress[0].contiguous, 4u);
+    EXPECT_TRUE(t.take_progress().empty());
+}
+
+TEST(SeqTrackerTest, DuplicatesAreRejected) {
+    SeqTracker t(fast_options());
+    store(t, 1, 1);
+    EXPECT_FALSE(t.admit(1, 1)); // below the watermark
+    ASSERT_TRUE(t.admit(1, 3));
+    EXPECT_FALSE(t.admit(1, 3)); // still being stored
+    t.abandon(1, 3);
+    EXPECT_TRUE(t.admit(1, 3)); // the store failed, a copy is welcome
+    EXPECT_TRUE(t.admit(0, 1)); // untracked source
+    EXPECT_TRUE(t.admit(0, 1));
+}
+
+TEST(SeqTrackerTest, GapIsRequestedAfterTimeoutInChunks) {
+    SeqTracker t(fast_options());
+    auto now = SeqTracker::Clock::now();
+    store(t, 9, 1);
+    store(t, 9, 8);
+    EXPECT_TRUE(t.poll(now).requests.empty()); // may still be in flight
+    EXPECT_EQ(t.missing(), 6u);
+
+    auto r = t.poll(now + 150ms);
+    ASSERT_EQ(r.requests.size(), 2u);
+    EXPECT_EQ(r.requests[0].source, 9u);
+    EXPECT_EQ(r.requests[0].first, 2u);
+    EXPECT_EQ(r.requests[0].last, 5u);
+    EXPECT_EQ(r.requests[1].first, 6u);
+    EXPECT_EQ(r.requests[1].last, 7u);
+    EXPECT_TRUE(t.poll(now + 200ms).requests.empty()); // not before the retry interval
+
+    // Part of it arrives: the rest keeps its schedule
+    store(t, 9, 2);
+    store(t, 9, 3);
+    r = t.poll(now + 260ms);
+    ASSERT_EQ(r.requests.size(), 1u);
+    EXPECT_EQ(r.requests[0].first, 4u);
+    EXPECT_EQ(r.requests[0].last, 7u);
+    EXPECT_EQ(t.contiguous(9), 3u);
+}
+
+TEST(SeqTrackerTest, GivesUpAfterMaxAttempts) {
+    SeqTracker t(fast_options());
+    auto now = SeqTracker::Clock::now();
+    store(t, 2, 1);
+    store(t, 2, 4);
+    t.poll(now);
+    EXPECT_EQ(t.poll(now + 100ms).requests.size(), 1u);
+    EXPECT_EQ(t.poll(now + 200ms).requests.size(), 1u);
+    auto r = t.poll(now + 300ms);
+    EXPECT_TRUE(r.requests.empty());
+    ASSERT_EQ(r.given_up.size(), 1u);
+    EXPECT_EQ(r.given_up[0].first, 2u);
+    EXPECT_EQ(r.given_up[0].last, 3u);
+    EXPECT_EQ(t.contiguous(2), 4u);
+    EXPECT_EQ(t.lost(), 2u);
+    EXPECT_EQ(t.missing(), 0u);
+
+    // A late copy of a given-up frame is still stored and no longer lost
+    EXPECT_TRUE(t.admit(2, 3));
+    EXPECT_EQ(t.lost(), 1u);
+    EXPECT_FALSE(t.admit(2, 3));
+}
+
+TEST(SeqTrackerTest, DroppedFramesAreNotRequested) {
+    SeqTracker t(fast_options());
+    auto now = SeqTracker::Clock::now();
+    store(t, 3, 1);
+    t.give_up(3, 3); // dropped by the processor before 2 arrived
+    t.give_up(3, 2);
+    t.give_up(3, 2); // counted once
+    store(t, 3, 5);
+    EXPECT_EQ(t.contiguous(3), 3u);
+    EXPECT_EQ(t.lost(), 2u);
+    t.poll(now);
+    auto r = t.poll(now + 150ms);
+    ASSERT_EQ(r.requests.size(), 1u); // only seq 4 is a real gap
+    EXPECT_EQ(r.requests[0].first, 4u);
+    EXPECT_EQ(r.requests[0].last, 4u);
+    t.give_up(3, 4);
+    EXPECT_EQ(t.contiguous(3), 5u);
+    EXPECT_TRUE(t.poll(now + 300ms).requests.empty());
+    EXPECT_EQ(t.missing(), 0u);
+    EXPECT_EQ(t.lost(), 3u);
+
+    // Being stored or already committed wins over a drop report
+    ASSERT_TRUE(t.admit(3, 6));
+    t.give_up(3, 6);
+    t.give_up(3, 1);
+    t.committed(3, 6);
+    EXPECT_EQ(t.contiguous(3), 6u);
+    EXPECT_EQ(t.lost(), 3u);
+}
+
+TEST(SeqTrackerTest, RestoreContinuesFromDatabaseState) {
+    SeqTracker t(fast_options());
+    t.restore({5, 10, 1}, {11, 13});
+    EXPECT_EQ(t.contiguous(5), 11u);
+    EXPECT_EQ(t.lost(), 1u);
+    EXPECT_FALSE(t.admit(5, 13));
+    EXPECT_TRUE(t.take_progress().empty()); // nothing new to persist until it moves
+    auto now = SeqTracker::Clock::now();
+    t.poll(now);
+    auto r = t.poll(now + 150ms);
+    ASSERT_EQ(r.requests.size(), 1u);
+    EXPECT_EQ(r.requests[0].first, 12u);
+    EXPECT_EQ(r.requests[0].last, 12u);
+}
+
+TEST(SeqTrackerTest, ReplayRequestRoundTrip) {
+    uint8_t buf[REPLAY_REQUEST_SIZE];
+    encode_replay_request({42, 7, 9}, buf);
+    ReplayRequest r;
+    ASSERT_TRUE(decode_replay_request(buf, sizeof(buf), r));
+    EXPECT_EQ(r.source, 42u);
+    EXPECT_EQ(r.first, 7u);
+    EXPECT_EQ(r.last, 9u);
+    EXPECT_FALSE(decode_replay_request(buf, sizeof(buf) - 1, r));
+    encode_replay_request({42, 9, 7}, buf);
+    EXPECT_FALSE(decode_replay_request(buf, sizeof(buf), r));
+}
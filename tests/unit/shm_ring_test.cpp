@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <atomic>
+#include <numeric>
+#include <set>
+#include <thread>
+#include <vector>
+#include "common/shm_ring.hpp"
+
+using namespace std::chrono_literals;
+
+static std::string ring_name(const std::string& test) { return "dis_test_" + test + "_" + std::to_string(::getpid()); }
+
+static ShmRing::Options small_ring(uint32_t slots = 4, size_t slot_bytes = 4096) {
+    ShmRing::Options o;
+    o.slots = slots;
+    o.slot_bytes = slot_bytes;
+    return o;
+}
+
+TEST(ShmRingTest, PartsRoundTripAligned) {
+    auto ring = ShmRing::create(ring_name("parts"), small_ring());
+    auto peer = ShmRing::open(ring_name("parts"));
+    std::string meta = "header", img(1000, 'x');
+    uint32_t blob[3] = {1, 2, 3};
+    ASSERT_EQ(ring->send({{meta.data(), meta.size()}, {img.data(), img.size()}, {blob, sizeof(blob)}}, 0ms), ShmSendResult::Sent);
+
+    int slot = peer->receive(100ms);
+    ASSERT_GE(slot, 0);
+    ASSERT_EQ(peer->part_count(slot), 3u);
+    EXPECT_EQ(std::string(reinterpret_cast<char*>(peer->part_data(slot, 0)), peer->part_size(slot, 0)), meta);
+    EXPECT_EQ(std::string(reinterpret_cast<char*>(peer->part_data(slot, 1)), peer->part_size(slot, 1)), img);
+    EXPECT_EQ(std::memcmp(peer->part_data(slot, 2), blob, sizeof(blob)), 0);
+    for(size_t i = 0; i < 3; ++i) EXPECT_EQ(reinterpret_cast<uintptr_t>(peer->part_data(slot, i)) % SHM_PART_ALIGN, 0u);
+    peer->release(slot);
+    EXPECT_EQ(peer->receive(0ms), -1);
+}
+
+TEST(ShmRingTest, FullRingTimesOutUntilReleased) {
+    auto ring = ShmRing::create(ring_name("full"), small_ring(2));
+    char b = 1;
+    EXPECT_EQ(ring->send({{&b, 1}}, 0ms), ShmSendResult::Sent);
+    EXPECT_EQ(ring->send({{&b, 1}}, 0ms), ShmSendResult::Sent);
+    EXPECT_EQ(ring->send({{&b, 1}}, 10ms), ShmSendResult::Timeout);
+    std::string big(4096, 'x');
+    EXPECT_EQ(ring->send({{big.data(), big.size()}}, 0ms), ShmSendResult::TooLarge); // no room for the slot header
+
+    // A consumer freeing a slot wakes the waiting producer
+    std::thread consumer([&]{
+        std::this_thread::sleep_for(20ms);
+        ring->release(ring->receive(0ms));
+    });
+    EXPECT_EQ(ring->send({{&b, 1}}, 2000ms), ShmSendResult::Sent);
+    consumer.join();
+}
+
+TEST(ShmRingTest, ManyProducersAndConsumersDeliverEachMessageOnce) {
+    auto ring = ShmRing::create(ring_name("mpmc"), small_ring(8, 256));
+    constexpr int producers = 3, consumers = 3, per_producer = 20000;
+    std::atomic<int> received{0};
+    std::vector<std::vector<uint32_t>> got(consumers);
+    std::vector<std::thread> threads;
+    for(int c = 0; c < consumers; ++c)
+        threads.emplace_back([&, c]{
+            while(received < producers * per_producer) {
+                int slot = ring->receive(10ms);
+                if(slot < 0) continue;
+                uint32_t v;
+                std::memcpy(&v, ring->part_data(slot, 0), sizeof(v));
+                got[c].push_back(v);
+                ring->release(slot);
+                received++;
+            }
+        });
+    for(int p = 0; p < producers; ++p)
+        threads.emplace_back([&, p]{
+            for(uint32_t i = 0; i < per_producer; ++i) {
+                uint32_t v = p * per_producer + i;
+                while(ring->send({{&v, sizeof(v)}}, 100ms) != ShmSendResult::Sent) {}
+            }
+        });
+    for(auto& t : threads) t.join();
+    std::set<uint32_t> all;
+    for(const auto& g : got) all.insert(g.begin(), g.end());
+    EXPECT_EQ(all.size(), static_cast<size_t>(producers * per_producer));
+}
+
+TEST(ShmRingTest, CrossProcessWakeupAndConsumerLiveness) {
+    std::string name = ring_name("fork"); // before fork(): the child has another pid
+    auto ring = ShmRing::create(name, small_ring());
+    EXPECT_EQ(ring->consumers(), 0u);
+    int to_child[2];
+    ASSERT_EQ(::pipe(to_child), 0);
+    pid_t child = ::fork();
+    if(child == 0) {
+        // Attach, receive one message and echo its size through the exit code
+        try {
+            auto peer = ShmRing::open(name);
+            peer->attach_consumer();
+            char go = 1;
+            if(::write(to_child[1], &go, 1) != 1) ::_exit(100); // attached
+            int slot = peer->receive(5000ms);
+            ::_exit(slot < 0 ? 101 : static_cast<int>(peer->part_size(slot, 0)));
+        } catch(...) { ::_exit(102); }
+    }
+    ::close(to_child[1]);
+    char attached;
+    ASSERT_EQ(::read(to_child[0], &attached, 1), 1);
+    EXPECT_EQ(ring->consumers(), 1u);
+    std::string msg(42, 'm');
+    ASSERT_EQ(ring->send({{msg.data(), msg.size()}}, 0ms), ShmSendResult::Sent);
+    int status = 0;
+    ::waitpid(child, &status, 0);
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 42);
+    EXPECT_EQ(ring->consumers(), 0u); // the dead child no longer counts
+    ::close(to_child[0]);
+
+    // The child exited holding the slot: it comes back once the ring runs dry
+    char b = 0;
+    for(int i = 0; i < 3; ++i) ASSERT_EQ(ring->send({{&b, 1}}, 0ms), ShmSendResult::Sent);
+    EXPECT_EQ(ring->send({{&b, 1}}, 0ms), ShmSendResult::Sent);
+}
+
+TEST(ShmRingTest, ReplacedRingIsStale) {
+    auto first = ShmRing::create(ring_name("stale"), small_ring());
+    auto peer = ShmRing::open(ring_name("stale"));
+    EXPECT_FALSE(peer->stale());
+    auto second = ShmRing::create(ring_name("stale"), small_ring()); // creator restarted
+    EXPECT_TRUE(peer->stale());
+    EXPECT_FALSE(ShmRing::open(ring_name("stale"))->stale());
+    second.reset();
+    EXPECT_THROW(ShmRing::open(ring_name("stale")), std::runtime_error);
+}
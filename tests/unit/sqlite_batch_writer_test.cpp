@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include "common/sqlite_batch_writer.hpp"
+
+namespace fs = std::filesystem;
+
+static fs::path fresh_db(const std::string& name) {
+    fs::path p = fs::temp_directory_path() / name;
+    fs::remove(p); fs::remove(p.string() + "-wal"); fs::remove(p.string() + "-shm");
+    return p;
+}
+
+static int count_rows(const fs::path& db_path) {
+    sqlite3* db = nullptr;
+    sqlite3_open(db_path.c_str(), &db);
+    sqlite3_stmt* stmt = nullptr;
+    sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM images;", -1, &stmt, nullptr);
+    int n = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int(stmt, 0) : -1;
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    return n;
+}
+
+static ImageRecord make_record(int i) {
+    ImageRecord r;
+    r.image_id = "img-" + std::to_string(i);
+    r.seq = i;
+    r.timestamp = "2024-01-01T00:00:00Z";
+    r.path = "processed/" + r.image_id + ".jpg";
+    r.num_keypoints = i;
+    r.kp_blob.assign(16, uint8_t(i));
+    return r;
+}
+
+TEST(SqliteBatchWriterTest, CommitsFullBatchesAndRemainderOnClose) {
+    auto db_path = fresh_db("sqlite_batch_writer_test.db");
+    SqliteBatchWriter::Options opts;
+    opts.batch_size = 10;
+    opts.flush_interval_ms = 60000;
+    {
+        SqliteBatchWriter writer(db_path.string(), opts);
+        for(int i=0;i<25;i++) ASSERT_TRUE(writer.submit(make_record(i)));
+    }
+    EXPECT_EQ(count_rows(db_path), 25);
+}
+
+TEST(SqliteBatchWriterTest, FlushIntervalCommitsPartialBatch) {
+    auto db_path = fresh_db("sqlite_batch_writer_interval_test.db");
+    SqliteBatchWriter::Options opts;
+    opts.batch_size = 1000;
+    opts.flush_interval_ms = 10;
+    SqliteBatchWriter writer(db_path.string(), opts);
+    for(int i=0;i<3;i++) writer.submit(make_record(i));
+    writer.wait_committed();
+    EXPECT_EQ(writer.rows_committed(), 3u);
+    EXPECT_EQ(count_rows(db_path), 3);
+}
+
+TEST(SqliteBatchWriterTest, RejectsUnknownSynchronousMode) {
+    SqliteBatchWriter::Options opts;
+    opts.synchronous = "SOMETIMES";
+    EXPECT_THROW(SqliteBatchWriter(fresh_db("sqlite_batch_writer_bad.db").string(), opts), std::runtime_error);
+}
+
+TEST(SqliteBatchWriterTest, StoresTraceExtraAndReportsCommits) {
+    auto db_path = fresh_db("sqlite_batch_writer_trace_test.db");
+    SqliteBatchWriter::Options opts;
+    std::vector<std::string> committed_ids;
+    opts.on_commit = [&](std::vector<ImageRecord>& batch, double){ for(auto& r : batch) committed_ids.push_back(r.image_id); };
+    {
+        SqliteBatchWriter writer(db_path.string(), opts);
+        ImageRecord traced = make_record(1);
+        traced.trace.ns[GEN_SEND] = 5;
+        traced.store_trace = true;
+        traced.extra = R"({"camera":"cam0"})";
+        writer.submit(traced);
+        writer.submit(make_record(2));
+        writer.wait_committed();
+        EXPECT_EQ(committed_ids, (std::vector<std::string>{"img-1", "img-2"}));
+    }
+
+    sqlite3* db = nullptr;
+    sqlite3_open(db_path.c_str(), &db);
+    sqlite3_stmt* stmt = nullptr;
+    sqlite3_prepare_v2(db, "SELECT trace, extra FROM images ORDER BY seq;", -1, &stmt, nullptr);
+    ASSERT_EQ(sqlite3_step(stmt), SQLITE_ROW);
+    EXPECT_EQ(std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0))), "{\"gen_send\":5}");
+    EXPECT_EQ(std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1))), "{\"camera\":\"cam0\"}");
+    ASSERT_EQ(sqlite3_step(stmt), SQLITE_ROW);
+    EXPECT_EQ(sqlite3_column_type(stmt, 0), SQLITE_NULL);
+    EXPECT_EQ(sqlite3_column_type(stmt, 1), SQLITE_NULL);
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+}
+
+TEST(SqliteBatchWriterTest, ProgressAndRowsAboveItAreRecovered) {
+    auto db_path = fresh_db("sqlite_batch_writer_progress_test.db");
+    SqliteBatchWriter::Options opts;
+    {
+        SqliteBatchWriter writer(db_path.string(), opts);
+        for(int i : {1, 2, 3, 5, 6}) {
+            ImageRecord r = make_record(i);
+            r.source = 7;
+            writer.submit(r);
+        }
+        writer.submit(make_record(9)); // untracked row
+        writer.record_progress({{7, 3, 0}});
+        writer.wait_committed();
+        EXPECT_TRUE(writer.recovered_sources().empty());
+    }
+
+    SqliteBatchWriter writer(db_path.string(), opts);
+    ASSERT_EQ(writer.recovered_sources().size(), 1u);
+    const RecoveredSource& r = writer.recovered_sources()[0];
+    EXPECT_EQ(r.progress.source, 7u);
+    EXPECT_EQ(r.progress.contiguous, 3u);
+    EXPECT_EQ(r.committed_above, (std::vector<uint64_t>{5, 6}));
+}
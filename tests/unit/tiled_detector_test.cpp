@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <set>
+#include "common/tiled_detector.hpp"
+
+// Reports every pixel >= 100 as a keypoint whose response and one-column descriptor are
+// the pixel value, so the tests can check positions, dedup and descriptor rows exactly
+class BrightPixelDetector : public cv::Feature2D {
+public:
+    void detectAndCompute(cv::InputArray image, cv::InputArray, std::vector<cv::KeyPoint>& kps,
+                          cv::OutputArray descriptors, bool) override {
+        cv::Mat img = image.getMat();
+        kps.clear();
+        for(int y = 0; y < img.rows; ++y)
+            for(int x = 0; x < img.cols; ++x)
+                if(img.at<uchar>(y, x) >= 100)
+                    kps.emplace_back(static_cast<float>(x), static_cast<float>(y), 1.0f, -1.0f, static_cast<float>(img.at<uchar>(y, x)));
+        descriptors.create(static_cast<int>(kps.size()), 1, CV_32F);
+        cv::Mat d = descriptors.getMat();
+        for(size_t i = 0; i < kps.size(); ++i) d.at<float>(static_cast<int>(i), 0) = kps[i].response;
+    }
+};
+
+static TilingOptions small_tiles() {
+    TilingOptions o;
+    o.tile_size = 64;
+    o.overlap = 16;
+    o.min_megapixels = 0;
+    o.threads = 3;
+    return o;
+}
+
+TEST(TiledDetectorTest, TilesPartitionTheImage) {
+    auto tiles = make_detection_tiles(cv::Size(150, 70), 64, 8);
+    ASSERT_EQ(tiles.size(), 6u); // 3 columns x 2 rows
+    int area = 0;
+    for(const auto& t : tiles) {
+        area += t.core.area();
+        EXPECT_EQ(t.padded & t.core, t.core);
+        EXPECT_GE(t.padded.x, 0);
+        EXPECT_LE(t.padded.x + t.padded.width, 150);
+    }
+    EXPECT_EQ(area, 150 * 70);
+    EXPECT_EQ(tiles[2].core.width, 150 - 128);
+    EXPECT_EQ(tiles[3].padded.y, 64 - 8);
+}
+
+TEST(TiledDetectorTest, OverlapKeypointsAreReportedOnce) {
+    cv::Mat img(200, 200, CV_8UC1, cv::Scalar(0));
+    // Points inside tiles, on core borders and inside overlap zones
+    std::vector<cv::Point> pts = {{5, 5}, {63, 10}, {64, 10}, {70, 70}, {127, 128}, {150, 60}, {199, 199}};
+    uchar v = 100;
+    for(const auto& p : pts) img.at<uchar>(p.y, p.x) = v++;
+
+    TiledDetector tiled([]{ return cv::makePtr<BrightPixelDetector>(); }, small_tiles());
+    ASSERT_TRUE(tiled.applies(img));
+    std::vector<cv::KeyPoint> kps;
+    cv::Mat desc;
+    tiled.detectAndCompute(img, kps, desc);
+
+    ASSERT_EQ(kps.size(), pts.size());
+    ASSERT_EQ(desc.rows, static_cast<int>(pts.size()));
+    std::set<std::pair<int, int>> seen;
+    for(size_t i = 0; i < kps.size(); ++i) {
+        int x = static_cast<int>(kps[i].pt.x), y = static_cast<int>(kps[i].pt.y);
+        EXPECT_TRUE(seen.insert({x, y}).second);
+        EXPECT_EQ(img.at<uchar>(y, x), kps[i].response); // coordinates are in image space
+        EXPECT_FLOAT_EQ(desc.at<float>(static_cast<int>(i), 0), kps[i].response); // row follows its keypoint
+    }
+}
+
+TEST(TiledDetectorTest, KeepsStrongestGlobally) {
+    cv::Mat img(200, 200, CV_8UC1, cv::Scalar(0));
+    img.at<uchar>(10, 10) = 250;
+    img.at<uchar>(10, 11) = 249; // same tile as the strongest
+    img.at<uchar>(150, 150) = 240;
+    img.at<uchar>(100, 30) = 120;
+    img.at<uchar>(30, 180) = 110;
+
+    TiledDetector tiled([]{ return cv::makePtr<BrightPixelDetector>(); }, small_tiles(), 3);
+    std::vector<cv::KeyPoint> kps;
+    cv::Mat desc;
+    tiled.detectAndCompute(img, kps, desc);
+    ASSERT_EQ(kps.size(), 3u);
+    std::multiset<float> responses;
+    for(const auto& k : kps) responses.insert(k.response);
+    EXPECT_EQ(responses, (std::multiset<float>{240, 249, 250}));
+}
+
+TEST(TiledDetectorTest, SmallFramesAreNotTiled) {
+    TilingOptions o = small_tiles();
+    o.min_megapixels = 1;
+    TiledDetector tiled([]{ return cv::makePtr<BrightPixelDetector>(); }, o);
+    EXPECT_FALSE(tiled.applies(cv::Mat(100, 100, CV_8UC1)));
+    EXPECT_TRUE(tiled.applies(cv::Mat(1000, 1000, CV_8UC1)));
+    EXPECT_FALSE(TiledDetector([]{ return cv::makePtr<BrightPixelDetector>(); }, TilingOptions()).applies(cv::Mat(4000, 4000, CV_8UC1)));
+    EXPECT_THROW(TilingOptions::from_config({{"enabled", true}, {"tile_size", 8}}), std::runtime_error);
+}
+
+TEST(TiledDetectorTest, PoolThreadsAreReusedAcrossFrames) {
+    cv::Mat img(200, 200, CV_8UC1, cv::Scalar(0));
+    img.at<uchar>(10, 10) = 200;
+    img.at<uchar>(150, 150) = 150;
+    std::atomic<int> created{0};
+    TiledDetector tiled([&]{ ++created; return cv::makePtr<BrightPixelDetector>(); }, small_tiles());
+    for(int frame = 0; frame < 20; ++frame) {
+        std::vector<cv::KeyPoint> kps;
+        cv::Mat desc;
+        tiled.detectAndCompute(img, kps, desc);
+        ASSERT_EQ(kps.size(), 2u);
+    }
+    EXPECT_LE(created.load(), 3); // one detector per pool thread, not per frame
+}
+
+class ThrowingDetector : public cv::Feature2D {
+public:
+    void detectAndCompute(cv::InputArray, cv::InputArray, std::vector<cv::KeyPoint>&, cv::OutputArray, bool) override {
+        throw std::runtime_error("detector failed");
+    }
+};
+
+TEST(TiledDetectorTest, DetectorErrorsReachTheCaller) {
+    cv::Mat img(200, 200, CV_8UC1, cv::Scalar(0));
+    TiledDetector tiled([]{ return cv::makePtr<ThrowingDetector>(); }, small_tiles());
+    std::vector<cv::KeyPoint> kps;
+    cv::Mat desc;
+    EXPECT_THROW(tiled.detectAndCompute(img, kps, desc), std::runtime_error);
+    EXPECT_THROW(tiled.detectAndCompute(img, kps, desc), std::runtime_error); // the pool survives
+}
@@ -4,6 +4,7 @@ import numpy as np
 import os
 import json
 import struct
+import mmap
 
 # Path to your database and output folder
 CONFIG_PATH = "../config/default_config.json"
@@ -18,6 +19,61 @@ os.makedirs(OUTPUT_FOLDER, exist_ok=True)
 
 
 
+def load_image(base_folder, img_path):
+    """
+    Regular rows hold a file path; rows written with logger.storage_backend = "segments"
+    hold "seg:<segment id>:<offset>:<length>" pointing into image_save_path/segment_<id>.seg.
+    """
+    if not img_path.startswith("seg:"):
+        return cv2.imread(os.path.join(base_folder, img_path))
+    seg_id, offset, length = (int(v) for v in img_path[4:].split(":"))
+    seg_file = os.path.join(base_folder, cfg["logger"]["image_save_path"], f"segment_{seg_id:06d}.seg")
+    with open(seg_file, "rb") as f, mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) as m:
+        buf = np.frombuffer(m[offset:offset + length], dtype=np.uint8)
+    return cv2.imdecode(buf, cv2.IMREAD_COLOR)
+
+
+KP_BLOB_SOA = 0x80  # blob[8] marker of the v2 struct-of-arrays layout
+# desc_type byte: float32 rows (SIFT, AKAZE/KAZE) or packed binary rows (ORB, BRISK, AKAZE/MLDB),
+# or float rows compressed to half floats (2) / uint8 with a per-blob offset and scale (3)
+DESC_DTYPES = {0: np.float32, 1: np.uint8, 2: np.float16, 3: np.uint8}
+KP_DESC_UINT8_SCALED = 3
+
+
+def deserialize_keypoints_soa(blob: bytes):
+    """
+    v2 layout: 16-byte header, one 16-byte aligned section per keypoint field,
+    then one contiguous descriptor block at desc_offset. Compressed float
+    descriptors are returned as float32.
+    """
+    N, D = struct.unpack_from("<II", blob, 0)
+    desc_type = blob[10]
+    desc_offset = struct.unpack_from("<I", blob, 12)[0]
+    section = (N * 4 + 15) // 16 * 16
+
+    def column(i, dtype):
+        return np.frombuffer(blob, dtype=dtype, count=N, offset=16 + i * section)
+
+    xs, ys, sizes, angles, responses = (column(i, "<f4") for i in range(5))
+    octaves, class_ids = column(5, "<i4"), column(6, "<i4")
+    keypoints = [
+        cv2.KeyPoint(x=float(xs[i]), y=float(ys[i]), size=float(sizes[i]), angle=float(angles[i]),
+                     response=float(responses[i]), octave=int(octaves[i]), class_id=int(class_ids[i]))
+        for i in range(N)]
+
+    descriptors = None
+    if N > 0 and D > 0:
+        if desc_type not in DESC_DTYPES:
+            raise ValueError(f"unknown descriptor type {desc_type}")
+        descriptors = np.frombuffer(blob, dtype=DESC_DTYPES[desc_type], count=N * D, offset=desc_offset).reshape(N, D)
+        if desc_type == 2:
+            descriptors = descriptors.astype(np.float32)
+        elif desc_type == KP_DESC_UINT8_SCALED:
+            offset, scale = struct.unpack_from("<ff", blob, 16 + 7 * section)
+            descriptors = descriptors.astype(np.float32) * np.float32(scale) + np.float32(offset)
+    return keypoints, descriptors
+
+
 def deserialize_keypoints(blob: bytes):
     """
     Deserialize keypoints + descriptors stored as BLOB in Logger DB.
@@ -26,6 +82,8 @@ def deserialize_keypoints(blob: bytes):
 
     if blob is None or len(blob) < 9:
         return [], None
+    if len(blob) >= 16 and blob[8] == KP_BLOB_SOA:
+        return deserialize_keypoints_soa(blob)
 
     offset = 0
 
@@ -102,9 +160,7 @@ def main():
 
     for row in cursor.fetchall():
         img_id, img_path, kpt_blob = row
-        img_full_path = os.path.join(BASE_FOLDER, img_path)
-
-        img = cv2.imread(img_full_path)
+        img = load_image(BASE_FOLDER, img_path)
         if img is None:
             print(f"Failed to load {img_path}")
             continue